@@ -0,0 +1,309 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Bench.hpp"
+#include "Console/Console.hpp"
+#include "File/File.hpp"
+#include "Unicode/Unicode.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <format>
+#include <array>
+
+/// <summary>
+/// Generates a file of roughly 'bytes' bytes. The same type and size always generate the same contents
+/// </summary>
+/// <param name="type">C++ source (lots of keywords, strings and comments to highlight), a log file (long uniform lines) or minified JSON (one huge line)</param>
+/// <param name="bytes"></param>
+std::string Bench::generateCorpus(const CorpusType type, const size_t bytes)
+{
+	static constexpr std::array<std::string_view, 12> cppLines = { //$ is replaced with the line number, so lines aren't all identical
+		"#include <vector>",
+		"/* Processes a batch of $ entries",
+		"   and returns the number that changed */",
+		"static int process$(const std::vector<int>& values, int limit)",
+		"{",
+		"\tint changed = $; // running total",
+		"\tfor (int i = 0; i < static_cast<int>(values.size()); ++i)",
+		"\t{",
+		"\t\tif (values[i] > limit && values[i] != $) ++changed;",
+		"\t}",
+		"\treturn changed == 0 ? -1 : changed; // \"none\" is reported as -1",
+		"}"
+	};
+	static constexpr std::array<std::string_view, 4> levels = { "INFO", "DEBUG", "WARN", "ERROR" };
+
+	std::mt19937 random(static_cast<uint32_t>(bytes) ^ static_cast<uint32_t>(type));
+	std::string corpus;
+	corpus.reserve(bytes + 256);
+	size_t line = 0;
+	while (corpus.size() < bytes)
+	{
+		if (type == CorpusType::Json)
+		{
+			corpus.append(corpus.empty() ? "[" : ",");
+			corpus.append(std::format("{{\"id\":{},\"name\":\"item {}\",\"tags\":[\"a\",\"b\"],\"price\":{}.{:02},\"active\":{}}}", line, random() % 100000, random() % 1000, random() % 100, line % 3 == 0 ? "false" : "true"));
+			++line;
+			continue;
+		}
+		if (type == CorpusType::Cpp)
+		{
+			const std::string_view text = cppLines[line % cppLines.size()];
+			const size_t marker = text.find('$');
+			if (marker == std::string_view::npos)
+			{
+				corpus.append(text);
+			}
+			else
+			{
+				corpus.append(text.substr(0, marker)).append(std::to_string(line)).append(text.substr(marker + 1));
+			}
+		}
+		else
+		{
+			const size_t seconds = line / 50;
+			const uint32_t requestId = random(), duration = random() % 2000;
+			corpus.append(std::format("2024-05-01T{:02}:{:02}:{:02}.{:03}Z {} [worker-{}] request id={} took {}ms path=/api/v1/items/{}",
+				(seconds / 3600) % 24, (seconds / 60) % 60, seconds % 60, line % 1000, levels[random() % levels.size()], random() % 16, requestId, duration, requestId % 100000));
+		}
+		corpus.push_back('\n');
+		++line;
+	}
+	if (type == CorpusType::Json) corpus.append("]\n");
+	return corpus;
+}
+
+/// <summary>
+/// Shows a corpus file in the active view and closes every other buffer, so only one corpus is in memory at a time
+/// </summary>
+void Bench::loadCorpus(const std::filesystem::path& path)
+{
+	Console::openBuffer(path.string());
+	std::erase_if(Console::mBuffers, [](const std::shared_ptr<Buffer>& buffer) { return buffer.get() != Console::mBuffer; });
+}
+
+/// <summary>
+/// Runs setup then body 'warmup' times untimed, then 'repetitions' times timing only body
+/// </summary>
+void Bench::measure(const std::string_view& name, const Options& options, const std::function<void()>& setup, const std::function<void()>& body)
+{
+	Result result{ std::string(name), mCorpusName, mCorpusBytes, mCorpusRows, {} };
+	for (size_t i = 0; i < options.warmup + options.repetitions; ++i)
+	{
+		setup();
+		const auto start = std::chrono::steady_clock::now();
+		body();
+		const auto end = std::chrono::steady_clock::now();
+		if (i >= options.warmup) result.times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+	std::cerr << std::format("{:<16}{:<14}{:>14.3f} ms\n", name, mCorpusName, *std::min_element(result.times.begin(), result.times.end()) / 1e6);
+	mResults.push_back(std::move(result));
+}
+
+/// <summary>
+/// Builds the machine readable report: one entry per benchmark and corpus with the min/median/mean/max time in nanoseconds
+/// </summary>
+std::string Bench::toJson(const Options& options)
+{
+	std::string json = std::format("{{\n  \"warmup\": {},\n  \"repetitions\": {},\n  \"benchmarks\": [", options.warmup, options.repetitions);
+	for (size_t i = 0; i < mResults.size(); ++i)
+	{
+		Result& result = mResults[i];
+		std::sort(result.times.begin(), result.times.end());
+		const uint64_t total = std::accumulate(result.times.begin(), result.times.end(), uint64_t(0));
+		const size_t count = result.times.size();
+		const uint64_t median = count % 2 == 1 ? result.times[count / 2] : (result.times[count / 2 - 1] + result.times[count / 2]) / 2;
+
+		json.append(i == 0 ? "\n" : ",\n");
+		json.append(std::format("    {{ \"name\": \"{}\", \"corpus\": \"{}\", \"bytes\": {}, \"rows\": {}, \"min_ns\": {}, \"median_ns\": {}, \"mean_ns\": {}, \"max_ns\": {} }}",
+			result.name, result.corpus, result.bytes, result.rows, result.times.front(), median, total / count, result.times.back()));
+	}
+	json.append("\n  ]\n}\n");
+	return json;
+}
+
+/// <summary>
+/// Generates each corpus, runs every benchmark against it and writes the JSON report
+/// </summary>
+int Bench::run(const Options& options)
+{
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "nve_bench";
+	std::filesystem::create_directories(directory);
+
+	bool consoleStarted = false;
+	for (const size_t size : options.corpusSizes)
+	{
+		for (const CorpusType type : { CorpusType::Cpp, CorpusType::Log, CorpusType::Json })
+		{
+			const std::string sizeName = size >= (1 << 30) && size % (1 << 30) == 0 ? std::format("{}GB", size >> 30)
+				: size >= (1 << 20) && size % (1 << 20) == 0 ? std::format("{}MB", size >> 20) : std::format("{}KB", size >> 10);
+			const std::string_view extension = type == CorpusType::Cpp ? "cpp" : type == CorpusType::Log ? "log" : "json";
+			mCorpusName = std::format("{}-{}", extension, sizeName);
+			const std::filesystem::path path = directory / std::format("{}.{}", mCorpusName, extension);
+
+			std::string corpus = generateCorpus(type, size);
+			{
+				std::ofstream file(path, std::ios::binary);
+				file << corpus;
+			}
+			mCorpusBytes = corpus.size();
+
+			if (!consoleStarted) //The console needs a file to start with, so it is started with the first corpus
+			{
+				Console::initConsole({ path.string() }, std::make_unique<HeadlessTerminal>(std::string(), 50, 200));
+				consoleStarted = true;
+			}
+			else
+			{
+				loadCorpus(path);
+			}
+			mCorpusRows = Console::mBuffer->fileRows.size();
+
+			std::vector<FileHandler::Row> loadedRows;
+			measure("loadRows", options, [&]() { loadedRows = std::vector<FileHandler::Row>(); },
+				[&]() { loadedRows = FileHandler::loadRows(corpus); });
+			loadedRows = std::vector<FileHandler::Row>(); //The rows point into the corpus, so they go first
+			corpus = std::string();
+
+			View& view = *Console::mView;
+			Buffer& buffer = *Console::mBuffer;
+			const auto resetHighlights = [&](const size_t row) //Drops the cached row states, so the view's rows are lexed from the top of the file again
+				{
+					Console::goToRow(row);
+					Console::prepRenderedString();
+					buffer.highlightDirtyRow = 0;
+					Console::setRenderedString(view);
+				};
+			measure("setHighlight", options, [&]() { resetHighlights(0); }, [&]() { Console::setHighlight(view); });
+			if (buffer.syntax != nullptr) //What the background highlighter does after the file is loaded or edited near the top
+			{
+				SyntaxHighlight::LineState state = SyntaxHighlight::normalState;
+				measure("lexFile", options, []() {}, [&]()
+					{
+						for (const auto& row : buffer.fileRows) state = SyntaxHighlight::lexLine(*buffer.syntax, row.line, state);
+					});
+			}
+			size_t columns = 0;
+			measure("displayWidth", options, [&]() { columns = 0; }, [&]() //Rendering and cursor movement measure the rows they touch
+				{
+					for (const auto& row : buffer.fileRows) columns += Unicode::column(row.line, row.line.length());
+				});
+			WrapIndex wrapIndex;
+			measure("wrapIndex", options, [&]() { wrapIndex.clear(); }, [&]() { wrapIndex.build(buffer.fileRows, view.cols); }); //What :set wrap does before the first frame
+			measure("frame", options, [&]() { Console::goToRow(mCorpusRows / 2); Console::prepRenderedString(); }, [&]() { Console::refreshScreen(); });
+			measure("frameMidRow", options, [&]() //Scrolled halfway along the middle row, which for JSON is halfway through the file
+				{
+					Console::goToRow(mCorpusRows / 2);
+					view.fileCursorX = buffer.fileRows.at(view.fileCursorY).line.length() / 2;
+					view.updateSavedPos = true;
+					Console::prepRenderedString();
+				}, [&]() { Console::refreshScreen(); });
+
+			measure("addUndoHistory", options, [&]() { buffer.undoHistory = {}; buffer.redoHistory = {}; }, [&]() { Console::addUndoHistory(); });
+			measure("undoChange", options, [&]() { buffer.redoHistory = {}; if (buffer.undoHistory.empty()) Console::addUndoHistory(); }, [&]() { Console::undoChange(); });
+			buffer.undoHistory = {};
+			buffer.redoHistory = {};
+
+			measure("save", options, []() {}, []() { Console::save(); });
+		}
+	}
+
+	Console::closeConsole(); //Stops the corpus's background workers before its file is removed
+	const std::string json = toJson(options);
+	if (options.outputFileName.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream(options.outputFileName) << json;
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+	return EXIT_SUCCESS;
+}
+
+/// <summary>
+/// Parses a size like 512K, 16M or 1G
+/// </summary>
+/// <returns>0 if the size is invalid</returns>
+static size_t parseSize(const std::string_view& text)
+{
+	size_t size = 0, i = 0;
+	while (i < text.length() && text[i] >= '0' && text[i] <= '9')
+	{
+		size = size * 10 + (text[i++] - '0');
+	}
+	if (i == text.length()) return size;
+	if (i + 1 != text.length()) return 0;
+	switch (text[i])
+	{
+	case 'K': case 'k': return size << 10;
+	case 'M': case 'm': return size << 20;
+	case 'G': case 'g': return size << 30;
+	}
+	return 0;
+}
+
+int main(int argc, const char** argv)
+{
+	Bench::Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--sizes" && hasValue) //Comma separated, e.g. 1M,64M,1G
+		{
+			options.corpusSizes.clear();
+			std::string_view sizes = argv[++i];
+			while (!sizes.empty())
+			{
+				const size_t comma = sizes.find(',');
+				const size_t size = parseSize(sizes.substr(0, comma));
+				if (size == 0)
+				{
+					std::cerr << "ERROR: Invalid size " << sizes.substr(0, comma) << "\n";
+					return EXIT_FAILURE;
+				}
+				options.corpusSizes.push_back(size);
+				sizes = comma == std::string_view::npos ? std::string_view() : sizes.substr(comma + 1);
+			}
+		}
+		else if (arg == "--warmup" && hasValue) options.warmup = std::stoul(argv[++i]);
+		else if (arg == "--reps" && hasValue) options.repetitions = std::max<size_t>(1, std::stoul(argv[++i]));
+		else if (arg == "--out" && hasValue) options.outputFileName = argv[++i];
+		else
+		{
+			std::cerr << "ERROR: Usage: nve_bench [--sizes 1M,16M,1G] [--warmup N] [--reps N] [--out results.json]\n";
+			return EXIT_FAILURE;
+		}
+	}
+	return Bench::run(options);
+}
@@ -0,0 +1,74 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Times the editor's hot paths (loading, highlighting, frame building, undo and saving) against generated files.
+/// Bench is a friend of Console, so private stages like setHighlight can be timed on their own
+/// </summary>
+class Bench
+{
+public:
+	struct Options
+	{
+		std::vector<size_t> corpusSizes = { 1 << 20, 16 << 20 }; //In bytes
+		size_t warmup = 1, repetitions = 5;
+		std::string outputFileName; //Empty to write to stdout
+	};
+
+	struct Result
+	{
+		std::string name, corpus;
+		size_t bytes, rows;
+		std::vector<uint64_t> times; //Nanoseconds, one per repetition
+	};
+
+	static int run(const Options& options);
+
+private:
+	enum class CorpusType : uint8_t
+	{
+		Cpp,
+		Log,
+		Json
+	};
+
+	static std::string generateCorpus(const CorpusType type, const size_t bytes);
+	static void loadCorpus(const std::filesystem::path& path);
+	static void measure(const std::string_view& name, const Options& options, const std::function<void()>& setup, const std::function<void()>& body);
+	static std::string toJson(const Options& options);
+
+private:
+	inline static std::vector<Result> mResults;
+	inline static std::string mCorpusName; //The corpus being benchmarked, e.g. cpp-1MB
+	inline static size_t mCorpusBytes = 0, mCorpusRows = 0;
+};
@@ -0,0 +1,168 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Buffer.hpp"
+#include "Unicode/Unicode.hpp"
+
+#include <algorithm>
+
+/// <summary>
+/// Construct the buffer, loading the file
+/// </summary>
+/// <param name="fName"></param>
+Buffer::Buffer(const std::string_view& fName) : fileName(fName), fileText(std::make_shared<const std::string>(FileHandler::loadFileContents(fName))), fileRows(FileHandler::loadRows(*fileText)), fileBytes(fileText->size()), highlightDirtyRow(SIZE_MAX),
+lastCursorX(0), lastCursorY(0), lastRowOffset(0), diskStamp(FileHandler::fileStamp(fName)), changedOnDisk(false), swapFound(Journal::exists(fName)), dirty(false), syntax(SyntaxHighlight::syntax(fName, std::string_view(*fileText).substr(0, fileText->find('\n'))))
+{
+	marks.fill(SIZE_MAX);
+	lineChanges.reset(*fileText);
+	if (syntax != nullptr) highlighter = std::make_unique<Highlighter>(fileRows, rowsMutex, syntax, fileText->size() > Highlighter::limits().maxFileSize);
+}
+
+/// <summary>
+/// Checks whether another program changed the file since it was last read or written. The file is only read if its size or
+/// modification time changed, and only counts as changed if its contents hash differently, so touching it or saving it unchanged doesn't
+/// </summary>
+/// <param name="stamp">Set to the file's stamp now</param>
+/// <param name="text">Set to the file's contents, if it changed</param>
+/// <returns>False if the file didn't change, or was deleted</returns>
+bool Buffer::fileChanged(FileHandler::FileStamp& stamp, std::unique_ptr<std::string>& text)
+{
+	stamp = FileHandler::fileStamp(fileName);
+	if (stamp == diskStamp || !stamp.exists) return false;
+	text = std::make_unique<std::string>(FileHandler::loadFileContents(fileName));
+	if (!diskHash) diskHash = FileHandler::hashText(*fileText);
+	if (FileHandler::hashText(*text) != *diskHash) return true;
+	diskStamp = stamp;
+	text.reset();
+	return false;
+}
+
+/// <summary>
+/// Returns every text the rows may point into, so something holding copies of them (a register) can keep the text alive
+/// </summary>
+std::vector<std::shared_ptr<const std::string>> Buffer::texts() const
+{
+	std::vector<std::shared_ptr<const std::string>> pinned(loadedText);
+	pinned.push_back(fileText);
+	return pinned;
+}
+
+/// <summary>
+/// Keeps texts alive for as long as the buffer, as rows copied into it (from a register) may point into them
+/// </summary>
+void Buffer::keepTexts(const std::vector<std::shared_ptr<const std::string>>& pinned)
+{
+	for (const std::shared_ptr<const std::string>& text : pinned)
+	{
+		if (text != fileText && std::find(loadedText.begin(), loadedText.end(), text) == loadedText.end()) loadedText.push_back(text);
+	}
+}
+
+/// <summary>
+/// Records that 'removed' rows at 'row' were replaced by 'added' rows, or edited in place if the counts are the same.
+/// Column indexes of the replaced rows are dropped, and those of the rows after them move with them
+/// </summary>
+void Buffer::rowsReplaced(const size_t row, const size_t removed, const size_t added)
+{
+	editedRows.add(row, removed, added);
+	changedRows.add(row, removed, added);
+	journalRows.add(row, removed, added);
+	auto index = columnIndexes.lower_bound(row);
+	while (index != columnIndexes.end() && index->first < row + removed)
+	{
+		index = columnIndexes.erase(index);
+	}
+	if (added == removed || index == columnIndexes.end()) return;
+
+	std::map<size_t, ColumnIndex> moved;
+	while (index != columnIndexes.end())
+	{
+		auto node = columnIndexes.extract(index++);
+		node.key() = node.key() + added - removed;
+		moved.insert(std::move(node));
+	}
+	columnIndexes.merge(moved);
+}
+
+/// <summary>
+/// Records that 'erased' bytes at pos in a row were replaced by 'inserted' bytes. The row's column index is updated rather than dropped
+/// </summary>
+void Buffer::rowEdited(const size_t row, const size_t pos, const size_t erased, const size_t inserted)
+{
+	editedRows.add(row, 1, 1);
+	changedRows.add(row, 1, 1);
+	journalRows.add(row, 1, 1);
+	const auto index = columnIndexes.find(row);
+	if (index == columnIndexes.end()) return;
+	const Line& line = fileRows.at(row).line;
+	if (line.length() < ColumnIndex::minLineLength) columnIndexes.erase(index);
+	else index->second.edit(line, pos, erased, inserted);
+}
+
+/// <summary>
+/// The column the character at byte 'pos' of a row is drawn at. Long rows are looked up in their column index, which is built the first time
+/// </summary>
+size_t Buffer::column(const size_t row, const size_t pos)
+{
+	const Line& line = fileRows.at(row).line;
+	if (line.length() < ColumnIndex::minLineLength || pos < ColumnIndex::minLineLength) return Unicode::column(line, pos);
+	ColumnIndex& index = columnIndexes[row];
+	if (index.length() != line.length()) index.build(line);
+	return index.column(line, pos);
+}
+
+/// <summary>
+/// Finds the character of a row drawn over 'column', or the length of the row if it ends before it
+/// </summary>
+size_t Buffer::indexAtColumn(const size_t row, const size_t column)
+{
+	const Line& line = fileRows.at(row).line;
+	if (line.length() < ColumnIndex::minLineLength || column < ColumnIndex::minLineLength / 4) return Unicode::indexAtColumn(line, column);
+	ColumnIndex& index = columnIndexes[row];
+	if (index.length() != line.length()) index.build(line);
+	return index.indexAtColumn(line, column);
+}
+
+/// <summary>
+/// Adds an edit that replaced 'removed' rows at 'row' with 'added' rows
+/// </summary>
+void EditedRows::add(const size_t row, const size_t removed, const size_t added)
+{
+	if (empty())
+	{
+		first = row;
+		oldEnd = row + removed;
+		newEnd = row + added;
+		return;
+	}
+	const size_t end = std::max(newEnd, row + removed); //Rows past the span map to the rows the indexes know by the span's growth
+	oldEnd = end + oldEnd - newEnd;
+	newEnd = end + added - removed;
+	first = std::min(first, row);
+}
+
+bool EditedRows::empty() const
+{
+	return first == SIZE_MAX;
+}
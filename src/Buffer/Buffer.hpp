@@ -0,0 +1,113 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File/File.hpp"
+#include "File/ColumnIndex.hpp"
+#include "File/Follower.hpp"
+#include "SyntaxHighlight/SyntaxHighlight.hpp"
+#include "SyntaxHighlight/Highlighter.hpp"
+#include "Search/TrigramIndex.hpp"
+#include "Diff/LineChanges.hpp"
+#include "Journal/Journal.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <array>
+#include <map>
+#include <stack>
+#include <mutex>
+#include <optional>
+
+struct FileHistory
+{
+	std::vector<FileHandler::Row> rows;
+	size_t fileCursorX, fileCursorY;
+	size_t colOffset, rowOffset;
+};
+
+/// <summary>
+/// The span of rows edited since the wrap indexes of a buffer's views were last updated: rows [first, oldEnd) as the indexes know them
+/// were replaced by rows [first, newEnd). Edits are merged into one span, which covers everything between them
+/// </summary>
+struct EditedRows
+{
+	size_t first = SIZE_MAX, oldEnd = 0, newEnd = 0;
+
+	void add(const size_t row, const size_t removed, const size_t added);
+	bool empty() const;
+};
+
+/// <summary>
+/// An open file: its text, undo/redo history, highlighter, search index and marks.
+/// A buffer can be shown in any number of views at once without being copied
+/// </summary>
+struct Buffer
+{
+	Buffer(const std::string_view& fileName);
+	Buffer(const Buffer&) = delete; //The workers point at the rows and their mutex, so it must never move
+	Buffer& operator=(const Buffer&) = delete;
+
+	void rowsReplaced(const size_t row, const size_t removed, const size_t added);
+	void rowEdited(const size_t row, const size_t pos, const size_t erased, const size_t inserted);
+	size_t column(const size_t row, const size_t pos);
+	size_t indexAtColumn(const size_t row, const size_t column);
+	bool fileChanged(FileHandler::FileStamp& stamp, std::unique_ptr<std::string>& text);
+	std::vector<std::shared_ptr<const std::string>> texts() const;
+	void keepTexts(const std::vector<std::shared_ptr<const std::string>>& pinned);
+
+	std::string fileName;
+	const std::shared_ptr<const std::string> fileText; //The file as it was loaded. Rows (and their copies in the undo/redo history and registers) point into it until they are edited
+	std::vector<FileHandler::Row> fileRows;
+	std::vector<std::shared_ptr<const std::string>> loadedText; //What was read from the file after it was loaded: while following it, or reloading it after another program changed it, and the texts of rows put from registers. Like fileText, rows point into it
+	uint64_t fileBytes; //How much of the file the rows hold: what was loaded, plus what was read while following it, or what was saved last
+	std::stack<FileHistory> undoHistory;
+	std::stack<FileHistory> redoHistory;
+
+	std::mutex rowsMutex; //Held while the rows are edited, and by the background workers while they read them
+
+	std::vector<HighlightLocations> highlights; //The highlights of the view drawn last. Kept to reuse the capacity
+	size_t highlightDirtyRow; //The first row edited since the last frame
+	EditedRows editedRows;
+	LineChanges lineChanges; //How the rows differ from the file as it was last loaded or saved, for the gutter
+	EditedRows changedRows; //The span of rows edited since lineChanges was last updated
+	std::map<size_t, ColumnIndex> columnIndexes; //Indexes of the rows of at least ColumnIndex::minLineLength bytes that have been measured, by row
+	std::unique_ptr<Highlighter> highlighter; //Null if the file has no syntax
+	std::unique_ptr<TrigramIndex> searchIndex; //The workers are declared after fileRows so they are stopped before the rows go away
+	std::unique_ptr<Follower> follower; //Null unless the file is followed (:follow, -f)
+	std::array<size_t, 26> marks; //The row of marks a-z, or SIZE_MAX if the mark isn't set
+	size_t lastCursorX, lastCursorY, lastRowOffset; //Where the cursor was when the buffer was last shown, so switching back to it restores the position
+
+	FileHandler::FileStamp diskStamp; //The file as it was when it was last read or written
+	std::optional<uint64_t> diskHash; //The hash of the file's contents then. Worked out from fileText the first time it's needed, unless the file was read or written again
+	bool changedOnDisk; //Another program changed the file while the buffer had changes, so saving over it takes :w!
+
+	std::unique_ptr<Journal> journal; //The swap file. Started by the first edit after the file was loaded
+	EditedRows journalRows; //The span of rows edited since the journal last recorded an edit
+	bool swapFound; //A swap file was left by an earlier session. Nothing is journaled until it is recovered (:recover) or deleted (:dropswap)
+
+	bool dirty;
+	const std::shared_ptr<const SyntaxHighlight::EditorSyntax> syntax;
+};
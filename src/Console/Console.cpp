@@ -23,29 +23,19 @@ SOFTWARE.
 */
 
 #include "Console.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include "Diff/Diff.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <span>
 #include <format> //C++20 is required. MSVC/GCC-13/Clang-14/17/AppleClang-15
-
-#ifdef _WIN32
-#include <Windows.h>
-#elif defined(__linux__) || defined(__APPLE__)
-#include <termios.h>
-#include <unistd.h>
-#include <sys/ioctl.h>
-#include <signal.h>
-#endif
 #define NotVimVersion "0.4.0a"
 
-/// <summary>
-/// Construct the window
-/// </summary>
-/// <param name="fileName"></param>
-Console::Window::Window() : fileCursorX(0), fileCursorY(0), cols(0), rows(0), renderedCursorX(0), renderedCursorY(0), colNumberToDisplay(0), savedRenderedCursorXPos(0),
-rowOffset(0), colOffset(0), dirty(false), rawModeEnabled(false), fileRows(FileHandler::loadFileContents()), syntax(SyntaxHighlight::syntax())
-{}
-
 /// <summary>
 /// Sets/Gets the current mode the editor is in
 /// </summary>
@@ -65,113 +55,290 @@ Mode& Console::mode(Mode m)
 /// </summary>
 void Console::prepRenderedString()
 {
-	if (mWindow->fileRows.size() > 0 && mMode != Mode::CommandMode) fixRenderedCursorPosition(mWindow->fileRows.at(mWindow->fileCursorY));
-	setRenderedString();
-	setHighlight();
+	Profiler::ScopedStage prepStage(Profiler::Stage::Prep);
+	if (mBuffer->fileRows.size() > 0) fixRenderedCursorPosition(*mView);
 }
 
 /// <summary>
-/// Preps the rendered string by replacing tabs with necessary spaces
+/// Preps the rendered string by replacing tabs with necessary spaces.
+/// Rows over the line length limit only have the columns the view shows rendered, unless the view is wrapping
 /// </summary>
-void Console::setRenderedString()
+/// <param name="view">The view being drawn. Rows outside of it are left alone</param>
+void Console::setRenderedString(View& view)
 {
-	for (size_t r = 0; r < mWindow->fileRows.size(); ++r)
+	TRACE_SCOPE("setRenderedString");
+	Memory::Scope memoryScope(Memory::Subsystem::Rendered);
+	Buffer& buffer = *view.buffer;
+	for (size_t r = view.rowOffset; r < buffer.fileRows.size() && r <= view.rowOffset + view.rows; ++r)
 	{
-		if (r > mWindow->rowOffset + mWindow->rows) return;
-
-		FileHandler::Row& row = mWindow->fileRows.at(r);
-		row.renderedLine = row.line;
-		if (row.renderedLine.length() > 0 && (r >= mWindow->rowOffset && r <= mWindow->rowOffset + mWindow->rows))
+		FileHandler::Row& row = buffer.fileRows.at(r);
+		if (!view.wrap && row.line.length() > Highlighter::limits().maxLineLength)
+		{
+			renderColumns(buffer, r, view.colOffset, view.cols, row.renderedLine);
+		}
+		else
 		{
-			replaceRenderedStringTabs(row.renderedLine);
+			Unicode::expandTabs(row.line, row.renderedLine);
 		}
 	}
 }
 
 /// <summary>
-/// Builds the output buffer and displays it to the user through std::cout
+/// Renders the columns [firstColumn, firstColumn + columns) of a row, without measuring or copying the rest of it.
+/// A wide character cut by either edge is replaced by spaces
+/// </summary>
+void Console::renderColumns(Buffer& buffer, const size_t row, const size_t firstColumn, const size_t columns, std::string& rendered)
+{
+	rendered.clear();
+	const Line& line = buffer.fileRows.at(row).line;
+	const size_t first = buffer.indexAtColumn(row, firstColumn);
+	if (first >= line.length() || columns == 0) return;
+	const size_t end = Unicode::nextCharacter(line, buffer.indexAtColumn(row, firstColumn + columns - 1));
+
+	//Tabs are expanded from the tab stop before the first character, so they reach the same stops as in the whole row
+	const size_t startColumn = buffer.column(row, first), phase = startColumn % Unicode::tabWidth;
+	std::string text(phase, ' ');
+	text.append(std::string_view(line).substr(first, end - first));
+	std::string expanded;
+	Unicode::expandTabs(text, expanded);
+	const Unicode::Clip clip = Unicode::clipColumns(expanded, firstColumn - (startColumn - phase), columns);
+	rendered.assign(clip.spacesBefore, ' ');
+	rendered.append(expanded, clip.start, clip.end - clip.start);
+	rendered.append(clip.spacesAfter, ' ');
+}
+
+/// <summary>
+/// Builds the output buffer and displays it to the user through the terminal
 /// Uses ANSI escape codes for clearing screen/displaying cursor and for colors
 /// </summary>
-/// <param name="mode"></param>
 void Console::refreshScreen()
 {
-	std::string renderBuffer = "\x1b[1;1H"; //Move the cursor to (0, 0)
+	if (mBatchDepth > 0) return;
+	TRACE_SCOPE("refreshScreen");
+	Profiler::ScopedStage renderStage(Profiler::Stage::Render);
+	Memory::Scope memoryScope(Memory::Subsystem::Rendered);
+
+	std::string renderBuffer = "\x1b[?2026h"; //Begin a synchronized update, so terminals that support it show the frame all at once instead of while it arrives
+	renderBuffer.append("\x1b[1;1H"); //Move the cursor to (0, 0)
 	renderBuffer.append("\x1b[3J"); //Erase the screen to redraw changes
 
-	for (size_t y = mWindow->rowOffset; y < mWindow->fileRows.size() && y < mWindow->rows + mWindow->rowOffset; ++y)
+	std::vector<View*> views;
+	collectViews(*mLayout, views);
+	for (View* view : views) //Views come in layout order, so clearing the rest of a row never erases a view that was already drawn
+	{
+		appendView(renderBuffer, *view, view == mView);
+	}
+	renderBuffer.append(std::format("\x1b[{};1H\x1b[0K", mScreenRows)); //Clear the command row
+	if (Profiler::isEnabled() && mMode != Mode::CommandMode && mMode != Mode::FindMode) //The :perf overlay uses the command row while it isn't being typed in
+	{
+		renderBuffer.append(Profiler::overlay().substr(0, mScreenCols));
+	}
+
+	for (const Cursor& cursor : mView->extraCursors) //Secondary cursors are drawn over the rows in inverse color mode
+	{
+		if (cursor.fileCursorY < mView->rowOffset || cursor.fileCursorY >= mView->rowOffset + mView->rows) continue;
+		const FileHandler::Row& row = mBuffer->fileRows.at(cursor.fileCursorY);
+		const size_t renderedX = mBuffer->column(cursor.fileCursorY, cursor.fileCursorX);
+		size_t screenY, screenX, lineEnd;
+		if (!screenPosition(*mView, cursor.fileCursorY, renderedX, screenY, screenX, lineEnd)) continue;
+
+		std::string_view c = " ";
+		if (cursor.fileCursorX < row.line.length() && row.line[cursor.fileCursorX] != static_cast<char>(KeyActions::KeyAction::Tab))
+		{
+			const size_t end = Unicode::nextCharacter(row.line, cursor.fileCursorX);
+			if (renderedX + Unicode::characterWidth(row.line, cursor.fileCursorX, end) <= lineEnd) //A wide character cut by the right edge is drawn as a space
+			{
+				c = std::string_view(row.line).substr(cursor.fileCursorX, end - cursor.fileCursorX);
+			}
+		}
+		renderBuffer.append(std::format("\x1b[{};{}H\x1b[7m{}\x1b[0m", mView->top + screenY + 1, mView->left + screenX + 1, c));
+	}
+	if (mMode == Mode::VisualMode)
+	{
+		appendSelectionOverlay(renderBuffer);
+	}
+	if (!mView->extraCursors.empty() || mMode == Mode::VisualMode) mView->drawnValid = false; //The overlays are drawn over the rows, which then need writing again
+
+	std::string cursorPosition;
+	if (mMode == Mode::CommandMode || mMode == Mode::FindMode)
+	{
+		cursorPosition = std::format("\x1b[{};1H", mScreenRows); //The command/search pattern is typed on the bottom row
+	}
+	else
+	{
+		cursorPosition = std::format("\x1b[{};{}H", mView->top + mView->renderedCursorY + 1, mView->left + mView->renderedCursorX + 1); //Move the cursor to this position
+	}
+	renderBuffer.append(cursorPosition);
+	renderBuffer.append("\x1b[?2026l"); //End the synchronized update
+	mTerminal->write(renderBuffer); //Finally, write the whole frame at once
+	Profiler::frameWritten(renderBuffer.length());
+}
+
+/// <summary>
+/// Draws a view's rows and status row into the output buffer. Rows the screen already shows from the last frame are skipped
+/// </summary>
+/// <param name="renderBuffer"></param>
+/// <param name="view"></param>
+/// <param name="active">True if this is the view input goes to</param>
+void Console::appendView(std::string& renderBuffer, View& view, const bool active)
+{
+	TRACE_SCOPE("appendView");
+	Buffer& buffer = *view.buffer;
+	std::vector<FileHandler::Row>& fileRows = buffer.fileRows;
+	updateWrap(view);
+	if (!active) //The buffer may have been edited through another view
+	{
+		clampCursor(view);
+		if (fileRows.size() > 0) fixRenderedCursorPosition(view);
+	}
+	setRenderedString(view);
+	{
+		Profiler::ScopedStage highlightStage(Profiler::Stage::Highlight);
+		Memory::Scope highlightMemory(Memory::Subsystem::Highlights);
+		setHighlight(view);
+	}
+
+	renderBuffer.append("\x1b[0m");
+	if (view.left > view.gutter) //Views to the right of a vertical split have a separator column in front of them
 	{
-		FileHandler::Row& row = mWindow->fileRows.at(y);
+		for (size_t y = 0; y <= view.rows; ++y)
+		{
+			renderBuffer.append(std::format("\x1b[{};{}H|", view.top + y + 1, view.left - view.gutter));
+		}
+	}
 
-		//Set the render string length to the lesser of the terminal width and the line length.
-		const size_t renderedLength = (row.renderedLine.length() - mWindow->colOffset) > mWindow->cols ? mWindow->cols : row.renderedLine.length();
-		if (renderedLength > 0)
+	std::vector<std::string> lines; //What each screen row of the view shows
+	std::vector<size_t> lineRows; //The file row each screen row is a part of
+	std::vector<Unicode::Clip> clips; //Where each screen row was cut from its file row, for placing the highlights
+	lines.reserve(view.rows);
+	lineRows.reserve(view.rows);
+	clips.reserve(view.rows);
+	std::vector<size_t> starts;
+	for (size_t y = view.rowOffset; y < fileRows.size() && lines.size() < view.rows; ++y)
+	{
+		const FileHandler::Row& row = fileRows.at(y);
+		const bool ascii = row.line.isAscii();
+		if (view.wrap && !ascii) Unicode::wrapStarts(row.renderedLine, view.cols, starts);
+		const size_t rowLines = !view.wrap ? 1 : ascii ? view.wrap->rowLines(y) : starts.size();
+
+		//Cut the row down to the columns the view shows, or while wrapping into its display lines. Only rows with non-ASCII text need their character widths measured.
+		//Rows over the line length limit were only rendered from the view's first column
+		const size_t colOffset = row.line.length() > Highlighter::limits().maxLineLength ? 0 : view.colOffset;
+		for (size_t part = y == view.rowOffset ? view.wrapOffset : 0; part < rowLines && lines.size() < view.rows; ++part)
 		{
-			if (mWindow->colOffset < row.renderedLine.length())
+			const size_t firstColumn = !view.wrap ? colOffset : ascii ? part * view.cols : starts[part];
+			const size_t columns = view.wrap && !ascii && part + 1 < starts.size() ? starts[part + 1] - firstColumn : view.cols;
+			Unicode::Clip clip;
+			if (ascii)
 			{
-				row.renderedLine = row.renderedLine.substr(mWindow->colOffset, renderedLength);
+				clip.start = std::min(firstColumn, row.renderedLine.length());
+				clip.end = std::min(firstColumn + columns, row.renderedLine.length());
 			}
 			else
 			{
-				row.renderedLine.clear();
+				clip = Unicode::clipColumns(row.renderedLine, firstColumn, columns);
 			}
-		}
-		else
-		{
-			row.renderedLine.clear();
+			std::string& visible = lines.emplace_back(clip.spacesBefore, ' ');
+			visible.append(row.renderedLine, clip.start, clip.end - clip.start);
+			visible.append(clip.spacesAfter, ' ');
+			lineRows.push_back(y);
+			clips.push_back(clip);
 		}
 	}
-	updateRenderedColor(mWindow->rowOffset, mWindow->colOffset);
-	for (size_t i = mWindow->rowOffset; i < mWindow->fileRows.size() && i < mWindow->rowOffset + mWindow->rows; ++i)
 	{
-		renderBuffer.append(mWindow->fileRows.at(i).renderedLine);
-		renderBuffer.append("\x1b[0K\r\n");
+		Profiler::ScopedStage highlightStage(Profiler::Stage::Highlight);
+		updateRenderedColor(view, lines, lineRows, clips);
 	}
-
 	renderBuffer.append("\x1b[0m"); //Make sure color mode is back to normal
-	const char* emptyRowCharacter = "~";
 
-	if (mWindow->rowOffset + mWindow->rows >= mWindow->fileRows.size())
+	//Only rows that differ from what the last frame left on the screen are written. While raw mode is off, the terminal echoes what is typed and may scroll,
+	//so the screen is only trusted from frames drawn in raw mode
+	const bool screenKnown = view.drawnValid && mRawModeEnabled && view.drawnRows.size() == view.rows;
+	if (!screenKnown) view.drawnRows.assign(view.rows, std::string());
+
+	//When the view scrolled by a few rows, the rows still shown are moved by the terminal instead of being written again.
+	//The scroll region can only span whole rows, so views beside a vertical split are left to the row by row comparison
+	const size_t top = topLine(view);
+	const size_t shift = top > view.drawnRowOffset ? top - view.drawnRowOffset : view.drawnRowOffset - top;
+	if (screenKnown && shift > 0 && shift <= view.rows / maxScrollFraction && view.left == view.gutter && view.gutter + view.cols == mScreenCols)
 	{
-		for (size_t y = mWindow->rowOffset; y < mWindow->rows + mWindow->rowOffset; ++y)
+		const bool up = top > view.drawnRowOffset; //The text moves up when the view moves down the file
+		renderBuffer.append(std::format("\x1b[{};{}r\x1b[{}{}\x1b[r", view.top + 1, view.top + view.rows, shift, up ? 'S' : 'T')); //Set the scroll region, scroll it and reset it
+		if (up) std::rotate(view.drawnRows.begin(), view.drawnRows.begin() + shift, view.drawnRows.end());
+		else std::rotate(view.drawnRows.begin(), view.drawnRows.end() - shift, view.drawnRows.end());
+		for (size_t y = up ? view.rows - shift : 0; y < (up ? view.rows : shift); ++y)
 		{
-			if (y >= mWindow->fileRows.size())
-			{
-				if (mWindow->fileRows.size() == 0 && y == mWindow->rows / 3) //If the file is empty and the current row is at 1/3 height (good display position)
-				{
-					std::string welcome = std::format("NotVim Editor -- version {}\x1b[0K\r\n", NotVimVersion);
-					size_t padding = (mWindow->cols - welcome.length()) / 2;
-					if (padding > 0)
-					{
-						renderBuffer.append(emptyRowCharacter);
-						--padding;
-					}
-					while (padding > 0)
-					{
-						renderBuffer.append(" ");
-						--padding;
-					}
-					renderBuffer.append(welcome);
-				}
-				else
-				{
-					renderBuffer.append("\x1b[0m"); //Make sure color mode is back to normal
-					renderBuffer.append(emptyRowCharacter);
-					renderBuffer.append("\x1b[0K\r\n"); //Clear the rest of the row
-				}
-				continue;
-			}
+			view.drawnRows[y].clear(); //The terminal scrolls blank rows in, which look the same as an empty row
+		}
+	}
+
+	const char* emptyRowCharacter = "~";
+	std::string welcome;
+	if (fileRows.size() == 0) //If the file is empty, the welcome message is shown at 1/3 height (good display position)
+	{
+		const std::string message = std::format("NotVim Editor -- version {}", NotVimVersion);
+		size_t padding = view.cols > message.length() ? (view.cols - message.length()) / 2 : 0;
+		welcome = padding > 0 ? emptyRowCharacter : "";
+		if (padding > 0) welcome.append(padding - 1, ' ');
+		welcome.append(message.substr(0, view.cols));
+	}
+	const bool showChanges = view.gutter > 0 && !buffer.follower; //A followed file's new rows were never saved by the editor, so they aren't marked
+	if (showChanges && !buffer.changedRows.empty())
+	{
+		buffer.lineChanges.update(fileRows, buffer.changedRows.first, buffer.changedRows.oldEnd, buffer.changedRows.newEnd);
+		buffer.changedRows = EditedRows();
+	}
+	std::string drawn;
+	for (size_t y = 0; y < view.rows; ++y)
+	{
+		drawn.assign(view.gutter, ' ');
+		if (showChanges && y < lines.size())
+		{
+			static constexpr std::array<std::string_view, 5> signs = { " ", "\x1b[32m+\x1b[0m", "\x1b[33m~\x1b[0m", "\x1b[31m_\x1b[0m", "\x1b[31m\xe2\x80\xbe\x1b[0m" }; //Indexed by LineChanges::Sign
+			drawn.assign(signs[static_cast<size_t>(buffer.lineChanges.sign(lineRows[y]))]);
 		}
+		drawn.append(y < lines.size() ? std::string_view(lines[y])
+			: fileRows.size() == 0 && y == view.rows / 3 ? std::string_view(welcome) : emptyRowCharacter);
+		if (screenKnown && view.drawnRows[y] == drawn) continue;
+
+		renderBuffer.append(std::format("\x1b[{};{}H", view.top + y + 1, view.left - view.gutter + 1));
+		renderBuffer.append(drawn);
+		renderBuffer.append("\x1b[0K"); //Clear the rest of the row
+		view.drawnRows[y] = drawn;
 	}
+	view.drawnRowOffset = top;
+	view.drawnValid = true;
 
+	appendStatusRow(renderBuffer, view, active);
+}
+
+/// <summary>
+/// Draws the status row under a view. Only the active view shows the mode and the status message
+/// </summary>
+void Console::appendStatusRow(std::string& renderBuffer, const View& view, const bool active)
+{
+	const size_t width = view.gutter + view.cols; //The status row runs under the gutter too
+	renderBuffer.append(std::format("\x1b[{};{}H", view.top + view.rows + 1, view.left - view.gutter + 1));
 	renderBuffer.append("\x1b[7m"); //Set to inverse color mode (white background dark text) for status row
 
+	const Buffer& buffer = *view.buffer;
 	std::string status, rStatus, modeToDisplay;
-	status = std::format("{} - {} lines {}", FileHandler::fileName(), mWindow->fileRows.size(), mWindow->dirty ? "(modified)" : "");
-	if (mMode == Mode::EditMode)
+	status = std::format("{} - {} lines {} {}", buffer.fileName, buffer.fileRows.size(), buffer.dirty ? "(modified)" : buffer.follower ? "(following)" : "", active ? mStatusMessage : "");
+	if (!active)
+	{
+		//Inactive views only show the file
+	}
+	else if (mMode == Mode::EditMode)
 	{
-		rStatus = std::format("row {}/{} col {}", mWindow->rowOffset + mWindow->renderedCursorY + 1, mWindow->fileRows.size(), mWindow->colNumberToDisplay + 1);
+		rStatus = std::format("row {}/{} col {}", view.fileCursorY + 1, buffer.fileRows.size(), view.colNumberToDisplay + 1);
 		modeToDisplay = "EDIT";
 	}
+	else if (mMode == Mode::VisualMode)
+	{
+		rStatus = std::format("row {}/{} col {}", view.fileCursorY + 1, buffer.fileRows.size(), view.colNumberToDisplay + 1);
+		modeToDisplay = view.selectionType == Registers::SelectionType::Line ? "VISUAL LINE"
+			: view.selectionType == Registers::SelectionType::Block ? "VISUAL BLOCK" : "VISUAL";
+	}
 	else if (mMode == Mode::CommandMode)
 	{
 		rStatus = "Enter command";
@@ -182,14 +349,21 @@ void Console::refreshScreen()
 		rStatus = "Read mode";
 		modeToDisplay = "READ ONLY";
 	}
-	size_t statusLength = (status.length() > mWindow->cols) ? mWindow->cols : status.length();
+	else if (mMode == Mode::FindMode)
+	{
+		rStatus = "Enter search pattern";
+		modeToDisplay = "FIND";
+	}
+	if (status.length() > width) status.resize(width);
+	size_t statusLength = status.length();
 	renderBuffer.append(status);
 
-	while (statusLength < (mWindow->cols / 2))
+	while (statusLength < (width / 2))
 	{
-		if ((mWindow->cols / 2) - statusLength == modeToDisplay.length() / 2)
+		if ((width / 2) - statusLength == modeToDisplay.length() / 2)
 		{
 			renderBuffer.append(modeToDisplay);
+			statusLength += modeToDisplay.length();
 			break;
 		}
 		else
@@ -198,11 +372,11 @@ void Console::refreshScreen()
 			++statusLength;
 		}
 	}
-	statusLength += modeToDisplay.length();
 
-	while (statusLength < mWindow->cols)
+	if (rStatus.length() + 1 > width - statusLength) rStatus.resize(width - statusLength > 0 ? width - statusLength - 1 : 0); //Keep a space after the mode
+	while (statusLength < width)
 	{
-		if (mWindow->cols - statusLength == rStatus.length())
+		if (width - statusLength == rStatus.length())
 		{
 			renderBuffer.append(rStatus);
 			break;
@@ -214,12 +388,7 @@ void Console::refreshScreen()
 		}
 	}
 
-	renderBuffer.append("\x1b[0m\r\n"); //Set to default mode
-
-	std::string cursorPosition = std::format("\x1b[{};{}H", mWindow->renderedCursorY + 1, mWindow->renderedCursorX + 1); //Move the cursor to this position
-	renderBuffer.append(cursorPosition);
-	std::cout << renderBuffer;
-	std::cout.flush(); //Finally, flush the buffer so everything displays properly
+	renderBuffer.append("\x1b[0m"); //Set to default mode
 }
 
 /// <summary>
@@ -231,200 +400,232 @@ void Console::moveCursor(const KeyActions::KeyAction key)
 	switch (key)
 	{
 	case KeyActions::KeyAction::ArrowLeft:
-		if (mWindow->fileCursorX == 0 && mWindow->fileCursorY == 0) return; //Can't move any farther left if we are at the beginning of the file
+		if (mView->fileCursorX == 0 && mView->fileCursorY == 0) return; //Can't move any farther left if we are at the beginning of the file
 
-		if (mWindow->fileCursorX == 0)
+		if (mView->fileCursorX == 0)
 		{
-			--mWindow->fileCursorY;
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			--mView->fileCursorY;
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 		}
 		else
 		{
-			--mWindow->fileCursorX;
+			mView->fileCursorX = Unicode::previousCharacter(mBuffer->fileRows.at(mView->fileCursorY).line, mView->fileCursorX);
 		}
-		mWindow->updateSavedPos = true;
+		mView->updateSavedPos = true;
 		break;
 	case KeyActions::KeyAction::ArrowRight:
-		if (mWindow->fileCursorY == mWindow->fileRows.size() - 1)
+		if (mView->fileCursorY == mBuffer->fileRows.size() - 1)
 		{
-			if (mWindow->fileCursorX == mWindow->fileRows.at(mWindow->fileCursorY).line.length()) return; //Can't move any farther right if we are at the end of the file
+			if (mView->fileCursorX == mBuffer->fileRows.at(mView->fileCursorY).line.length()) return; //Can't move any farther right if we are at the end of the file
 		}
 
-		if (mWindow->fileCursorX == mWindow->fileRows.at(mWindow->fileCursorY).line.length())
+		if (mView->fileCursorX == mBuffer->fileRows.at(mView->fileCursorY).line.length())
 		{
-			mWindow->fileCursorX = 0;
-			++mWindow->fileCursorY;
+			mView->fileCursorX = 0;
+			++mView->fileCursorY;
 		}
 		else
 		{
-			++mWindow->fileCursorX;
+			mView->fileCursorX = Unicode::nextCharacter(mBuffer->fileRows.at(mView->fileCursorY).line, mView->fileCursorX);
 		}
-		mWindow->updateSavedPos = true;
+		mView->updateSavedPos = true;
 		break;
 
 	case KeyActions::KeyAction::ArrowUp:
-		if (mWindow->fileCursorY == 0)
+		if (mView->fileCursorY == 0)
 		{
-			mWindow->fileCursorX = 0;
+			mView->fileCursorX = 0;
 			return;
 		}
 
-		--mWindow->fileCursorY;
+		--mView->fileCursorY;
 		setCursorLinePosition();
 		break;
 
 	case KeyActions::KeyAction::ArrowDown:
-		if (mWindow->fileCursorY == mWindow->fileRows.size() - 1)
+		if (mView->fileCursorY == mBuffer->fileRows.size() - 1)
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 			return;
 		}
 
-		++mWindow->fileCursorY;
+		++mView->fileCursorY;
 		setCursorLinePosition();
 		break;
 
 	case KeyActions::KeyAction::CtrlArrowLeft:
 		//Stuff copied from ArrowLeft
-		if (mWindow->fileCursorX == 0 && mWindow->fileCursorY == 0) return; //Can't move any farther left if we are at the beginning of the file
+		if (mView->fileCursorX == 0 && mView->fileCursorY == 0) return; //Can't move any farther left if we are at the beginning of the file
 
-		if (mWindow->fileCursorX == 0)
+		if (mView->fileCursorX == 0)
 		{
-			--mWindow->fileCursorY;
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			--mView->fileCursorY;
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 		}
 		//New Stuff
 		else
 		{
 			size_t findPos; //If there isn't a separator character before the cursor
-			if ((findPos = mWindow->fileRows.at(mWindow->fileCursorY).line.substr(0, mWindow->fileCursorX).find_last_of(separators)) == std::string::npos)
+			if ((findPos = mBuffer->fileRows.at(mView->fileCursorY).line.substr(0, mView->fileCursorX).find_last_of(separators)) == std::string::npos)
 			{
-				mWindow->fileCursorX = 0;
+				mView->fileCursorX = 0;
 			}
-			else if (findPos == mWindow->fileCursorX - 1) //If the separator character is just before the cursor
+			else if (findPos == mView->fileCursorX - 1) //If the separator character is just before the cursor
 			{
-				--mWindow->fileCursorX;
+				--mView->fileCursorX;
 			}
 			else
 			{
-				mWindow->fileCursorX = findPos; //Go to the end of the previous word
+				mView->fileCursorX = findPos; //Go to the end of the previous word
 			}
 
 		}
-		mWindow->updateSavedPos = true;
+		mView->updateSavedPos = true;
 		break;
 	case KeyActions::KeyAction::CtrlArrowRight:
 		//Stuff copied from ArrowRight
-		if (mWindow->fileCursorY == mWindow->fileRows.size() - 1)
+		if (mView->fileCursorY == mBuffer->fileRows.size() - 1)
 		{
-			if (mWindow->fileCursorX == mWindow->fileRows.at(mWindow->fileCursorY).line.length()) return; //Can't move any farther right if we are at the end of the file
+			if (mView->fileCursorX == mBuffer->fileRows.at(mView->fileCursorY).line.length()) return; //Can't move any farther right if we are at the end of the file
 		}
 
-		if (mWindow->fileCursorX == mWindow->fileRows.at(mWindow->fileCursorY).line.length())
+		if (mView->fileCursorX == mBuffer->fileRows.at(mView->fileCursorY).line.length())
 		{
-			mWindow->fileCursorX = 0;
-			++mWindow->fileCursorY;
+			mView->fileCursorX = 0;
+			++mView->fileCursorY;
 		}
 
 		//New stuff
 		else
 		{
 			size_t findPos; //If there isn't a separator character within the remaining string
-			if ((findPos = mWindow->fileRows.at(mWindow->fileCursorY).line.substr(mWindow->fileCursorX).find_first_of(separators)) == std::string::npos)
+			if ((findPos = mBuffer->fileRows.at(mView->fileCursorY).line.substr(mView->fileCursorX).find_first_of(separators)) == std::string::npos)
 			{
-				mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+				mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 			}
 			else if (findPos == 0) //If the cursor is currently on the separator character
 			{
-				++mWindow->fileCursorX;
+				++mView->fileCursorX;
 			}
 			else
 			{
-				mWindow->fileCursorX += findPos + 1; //Go to the character just beyond the separator (the start of the next word)
+				mView->fileCursorX += findPos + 1; //Go to the character just beyond the separator (the start of the next word)
 			}
 		}
-		mWindow->updateSavedPos = true;
+		mView->updateSavedPos = true;
 		break;
 
 	case KeyActions::KeyAction::Home:
-		mWindow->fileCursorX = 0;
-		mWindow->updateSavedPos = true;
+		mView->fileCursorX = 0;
+		mView->updateSavedPos = true;
 		break;
 		
 	case KeyActions::KeyAction::End:
-		mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
-		mWindow->updateSavedPos = true;
+		mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
+		mView->updateSavedPos = true;
 		break;
 
 	case KeyActions::KeyAction::CtrlHome:
-		mWindow->fileCursorX = 0; mWindow->fileCursorY = 0;
-		mWindow->updateSavedPos = true;
+		mView->fileCursorX = 0; mView->fileCursorY = 0;
+		mView->updateSavedPos = true;
 		break;
 
 	case KeyActions::KeyAction::CtrlEnd:
-		mWindow->fileCursorY = mWindow->fileRows.size() - 1;
-		mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
-		mWindow->updateSavedPos = true;
+		mView->fileCursorY = mBuffer->fileRows.size() - 1;
+		mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
+		mView->updateSavedPos = true;
 		break;
 
-	case KeyActions::KeyAction::PageUp: //Shift screen offset up by 1 page worth (mWindow->rows)
-		if (mWindow->fileCursorY < mWindow->rows)
+	case KeyActions::KeyAction::PageUp: //Shift screen offset up by 1 page worth (mView->rows)
+		if (mView->wrap) //Pages are display lines, found through the wrap index
+		{
+			size_t x;
+			const size_t line = cursorLine(*mView, x), top = topLine(*mView);
+			mView->rowOffset = mView->wrap->rowAtLine(top > mView->rows ? top - mView->rows : 0, mView->wrapOffset);
+			moveCursorToLine(*mView, line > mView->rows ? line - mView->rows : 0, x);
+			break;
+		}
+		if (mView->fileCursorY < mView->rows)
 		{
-			mWindow->fileCursorY = 0;
-			mWindow->rowOffset = 0;
+			mView->fileCursorY = 0;
+			mView->rowOffset = 0;
 		}
 		else
 		{
-			mWindow->fileCursorY -= mWindow->rows;
-			if (mWindow->rowOffset >= mWindow->rows) mWindow->rowOffset -= mWindow->rows;
-			else mWindow->rowOffset = 0;
+			mView->fileCursorY -= mView->rows;
+			if (mView->rowOffset >= mView->rows) mView->rowOffset -= mView->rows;
+			else mView->rowOffset = 0;
 		}
-		if (mWindow->fileCursorX > mWindow->fileRows.at(mWindow->fileCursorY).line.length())
+		if (mView->fileCursorX > mBuffer->fileRows.at(mView->fileCursorY).line.length())
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 		}
 		break;
 
-	case KeyActions::KeyAction::PageDown: //Shift screen offset down by 1 page worth (mWindow->rows)
-		if (mWindow->fileCursorY + mWindow->rows > mWindow->fileRows.size() - 1)
+	case KeyActions::KeyAction::PageDown: //Shift screen offset down by 1 page worth (mView->rows)
+		if (mView->wrap)
 		{
-			if (mWindow->fileCursorY == mWindow->fileRows.size() - 1) return;
+			size_t x;
+			const size_t line = cursorLine(*mView, x), lastLine = mView->wrap->lineCount() - 1;
+			if (line >= lastLine) return;
+			const size_t newLine = std::min(line + mView->rows, lastLine);
+			mView->rowOffset = mView->wrap->rowAtLine(topLine(*mView) + newLine - line, mView->wrapOffset);
+			moveCursorToLine(*mView, newLine, x);
+			break;
+		}
+		if (mView->fileCursorY + mView->rows > mBuffer->fileRows.size() - 1)
+		{
+			if (mView->fileCursorY == mBuffer->fileRows.size() - 1) return;
 
-			mWindow->fileCursorY = mWindow->fileRows.size() - 1;
-			mWindow->rowOffset += mWindow->fileCursorY % mWindow->rows;
+			mView->fileCursorY = mBuffer->fileRows.size() - 1;
+			mView->rowOffset += mView->fileCursorY % mView->rows;
 		}
 		else
 		{
-			mWindow->fileCursorY += mWindow->rows;
-			mWindow->rowOffset += mWindow->rows;
+			mView->fileCursorY += mView->rows;
+			mView->rowOffset += mView->rows;
 		}
-		if (mWindow->fileCursorX > mWindow->fileRows.at(mWindow->fileCursorY).line.length())
+		if (mView->fileCursorX > mBuffer->fileRows.at(mView->fileCursorY).line.length())
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 		}
 		break;
 
 	case KeyActions::KeyAction::CtrlPageUp: //Move cursor to top of screen
-		mWindow->fileCursorY -= (mWindow->fileCursorY - mWindow->rowOffset) % mWindow->rows;
-		if (mWindow->fileCursorX > mWindow->fileRows.at(mWindow->fileCursorY).line.length())
+		if (mView->wrap)
+		{
+			size_t x;
+			cursorLine(*mView, x);
+			moveCursorToLine(*mView, topLine(*mView), x);
+			break;
+		}
+		mView->fileCursorY -= (mView->fileCursorY - mView->rowOffset) % mView->rows;
+		if (mView->fileCursorX > mBuffer->fileRows.at(mView->fileCursorY).line.length())
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 		}
 		break;
 
 	case KeyActions::KeyAction::CtrlPageDown: //Move cursor to bottom of screen
-		if (mWindow->fileCursorY + mWindow->rows - ((mWindow->fileCursorY - mWindow->rowOffset) % mWindow->rows) > mWindow->fileRows.size() - 1)
+		if (mView->wrap)
+		{
+			size_t x;
+			cursorLine(*mView, x);
+			moveCursorToLine(*mView, std::min(topLine(*mView) + mView->rows - 1, mView->wrap->lineCount() - 1), x);
+			break;
+		}
+		if (mView->fileCursorY + mView->rows - ((mView->fileCursorY - mView->rowOffset) % mView->rows) > mBuffer->fileRows.size() - 1)
 		{
-			mWindow->fileCursorY = mWindow->fileRows.size() - 1;
+			mView->fileCursorY = mBuffer->fileRows.size() - 1;
 		}
 		else
 		{
-			mWindow->fileCursorY += mWindow->rows - ((mWindow->fileCursorY - mWindow->rowOffset) % mWindow->rows);
+			mView->fileCursorY += mView->rows - ((mView->fileCursorY - mView->rowOffset) % mView->rows);
 		}
 
-		if (mWindow->fileCursorX > mWindow->fileRows.at(mWindow->fileCursorY).line.length())
+		if (mView->fileCursorX > mBuffer->fileRows.at(mView->fileCursorY).line.length())
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY).line.length();
 		}
 		break;
 	}
@@ -437,22 +638,42 @@ void Console::moveCursor(const KeyActions::KeyAction key)
 /// <param name="key"></param>
 void Console::shiftRowOffset(const KeyActions::KeyAction key)
 {
+	if (mView->wrap) //Shift by a display line, moving the cursor onto the screen if it scrolled off
+	{
+		size_t x;
+		const size_t line = cursorLine(*mView, x);
+		size_t top = topLine(*mView);
+		if (key == KeyActions::KeyAction::CtrlArrowDown)
+		{
+			if (top + 1 >= mView->wrap->lineCount()) return;
+			++top;
+			if (line < top) moveCursorToLine(*mView, top, x);
+		}
+		else if (key == KeyActions::KeyAction::CtrlArrowUp)
+		{
+			if (top == 0) return;
+			--top;
+			if (line >= top + mView->rows) moveCursorToLine(*mView, top + mView->rows - 1, x);
+		}
+		mView->rowOffset = mView->wrap->rowAtLine(top, mView->wrapOffset);
+		return;
+	}
 	if (key == KeyActions::KeyAction::CtrlArrowDown)
 	{
-		if (mWindow->rowOffset == mWindow->fileRows.size() - 1) return; //This is as far as the screen can be moved down
+		if (mView->rowOffset == mBuffer->fileRows.size() - 1) return; //This is as far as the screen can be moved down
 
-		++mWindow->rowOffset;
-		if (mWindow->fileCursorY < mWindow->fileRows.size() && mWindow->renderedCursorY == 0) //Move the file cursor if the rendered cursor is at the top of the screen
+		++mView->rowOffset;
+		if (mView->fileCursorY < mBuffer->fileRows.size() && mView->renderedCursorY == 0) //Move the file cursor if the rendered cursor is at the top of the screen
 		{
 			moveCursor(KeyActions::KeyAction::ArrowDown);
 		}
 	}
 	else if (key == KeyActions::KeyAction::CtrlArrowUp)
 	{
-		if (mWindow->rowOffset == 0) return; //A negative row offset would wrap and break the viewport so don't allow it to go negative
+		if (mView->rowOffset == 0) return; //A negative row offset would wrap and break the viewport so don't allow it to go negative
 
-		--mWindow->rowOffset;
-		if (mWindow->renderedCursorY == mWindow->rows - 1) //Move the file cursor if the rendered cursor is at the bottom of the screen
+		--mView->rowOffset;
+		if (mView->renderedCursorY == mView->rows - 1) //Move the file cursor if the rendered cursor is at the bottom of the screen
 		{
 			moveCursor(KeyActions::KeyAction::ArrowUp);
 		}
@@ -467,27 +688,33 @@ void Console::addRow()
 {
 	addUndoHistory();
 
-	FileHandler::Row& row = mWindow->fileRows.at(mWindow->fileCursorY);
+	const auto rowsLock = lockRows();
+	FileHandler::Row& row = mBuffer->fileRows.at(mView->fileCursorY);
 
-	if (mWindow->fileCursorX == row.line.length())
+	if (mView->fileCursorX == row.line.length())
 	{
-		mWindow->fileRows.insert(mWindow->fileRows.begin() + mWindow->fileCursorY + 1, FileHandler::Row());
+		mBuffer->fileRows.insert(mBuffer->fileRows.begin() + mView->fileCursorY + 1, FileHandler::Row());
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowInserted(mView->fileCursorY + 1);
 	}
-	else if (mWindow->fileCursorX == 0)
+	else if (mView->fileCursorX == 0)
 	{
-		mWindow->fileRows.insert(mWindow->fileRows.begin() + mWindow->fileCursorY, FileHandler::Row());
+		mBuffer->fileRows.insert(mBuffer->fileRows.begin() + mView->fileCursorY, FileHandler::Row());
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowInserted(mView->fileCursorY);
 	}
 	else
 	{
 		FileHandler::Row newRow;
-		newRow.line = row.line.substr(mWindow->fileCursorX);
-		row.line.erase(row.line.begin() + mWindow->fileCursorX, row.line.end());
-		mWindow->fileRows.insert(mWindow->fileRows.begin() + mWindow->fileCursorY + 1, newRow);
+		newRow.line = row.line.substr(mView->fileCursorX);
+		row.line.erase(mView->fileCursorX);
+		mBuffer->fileRows.insert(mBuffer->fileRows.begin() + mView->fileCursorY + 1, newRow);
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowInserted(mView->fileCursorY + 1);
 	}
 
-	mWindow->fileCursorX = 0; ++mWindow->fileCursorY;
-	mWindow->dirty = true;
-	mWindow->updateSavedPos = true;
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, mView->fileCursorY); //The cursor moves below the edited row
+	mBuffer->rowsReplaced(mView->fileCursorY, 1, 2);
+	mView->fileCursorX = 0; ++mView->fileCursorY;
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
 }
 
 /// <summary>
@@ -496,115 +723,121 @@ void Console::addRow()
 /// <param name="key"></param>
 void Console::deleteChar(const KeyActions::KeyAction key)
 {
-	FileHandler::Row& row = mWindow->fileRows.at(mWindow->fileCursorY);
+	const bool atFileStart = mView->fileCursorX == 0 && mView->fileCursorY == 0;
+	const bool atFileEnd = mView->fileCursorY == mBuffer->fileRows.size() - 1 && mView->fileCursorX == mBuffer->fileRows.at(mView->fileCursorY).line.length();
+	if (atFileStart && (key == KeyActions::KeyAction::Backspace || key == KeyActions::KeyAction::CtrlBackspace)) return; //Nothing to delete
+	if (atFileEnd && (key == KeyActions::KeyAction::Delete || key == KeyActions::KeyAction::CtrlDelete)) return;
+
 	addUndoHistory();
+	const auto rowsLock = lockRows();
+	const size_t oldRowCount = mBuffer->fileRows.size();
+	FileHandler::Row& row = mBuffer->fileRows.at(mView->fileCursorY);
+	const size_t oldLength = row.line.length();
 	switch (key)
 	{
 	case KeyActions::KeyAction::Backspace:
-		if (mWindow->fileCursorX == 0 && mWindow->fileCursorY == 0)
-		{
-			mUndoHistory.pop();
-			return;
-		}
 
-		if (mWindow->fileCursorX == 0)
+		if (mView->fileCursorX == 0)
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY - 1).line.length();
-			mWindow->fileRows.at(mWindow->fileCursorY - 1).line.append(row.line);
-			deleteRow(mWindow->fileCursorY);
-			--mWindow->fileCursorY;
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY - 1).line.length();
+			mBuffer->fileRows.at(mView->fileCursorY - 1).line.append(row.line);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY - 1, mView->fileCursorX);
+			deleteRow(mView->fileCursorY);
+			--mView->fileCursorY;
 		}
 		else
 		{
-			row.line.erase(row.line.begin() + mWindow->fileCursorX - 1);
-			--mWindow->fileCursorX;
+			const size_t start = Unicode::previousCharacter(row.line, mView->fileCursorX); //Characters made of several bytes are deleted whole
+			row.line.erase(start, mView->fileCursorX - start);
+			mView->fileCursorX = start;
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX, mView->fileCursorX);
 		}
 		break;
 
 	case KeyActions::KeyAction::Delete:
-		if (mWindow->fileCursorY == mWindow->fileRows.size() - 1 && mWindow->fileCursorX == row.line.length())
-		{
-			mUndoHistory.pop();
-			return;
-		}
 
-		if (mWindow->fileCursorX == row.line.length())
+		if (mView->fileCursorX == row.line.length())
 		{
-			row.line.append(mWindow->fileRows.at(mWindow->fileCursorY + 1).line);
-			deleteRow(mWindow->fileCursorY + 1);
+			row.line.append(mBuffer->fileRows.at(mView->fileCursorY + 1).line);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX);
+			deleteRow(mView->fileCursorY + 1);
 		}
 		else
 		{
-			row.line.erase(row.line.begin() + mWindow->fileCursorX);
+			row.line.erase(mView->fileCursorX, Unicode::nextCharacter(row.line, mView->fileCursorX) - mView->fileCursorX);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX, mView->fileCursorX);
 		}
 		break;
 
 	case KeyActions::KeyAction::CtrlBackspace:
-		if (mWindow->fileCursorX == 0 && mWindow->fileCursorY == 0)
-		{
-			mUndoHistory.pop();
-			return;
-		}
 
-		if (mWindow->fileCursorX == 0)
+		if (mView->fileCursorX == 0)
 		{
-			mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY - 1).line.length();
-			mWindow->fileRows.at(mWindow->fileCursorY - 1).line.append(row.line);
-			deleteRow(mWindow->fileCursorY);
-			--mWindow->fileCursorY; 
+			mView->fileCursorX = mBuffer->fileRows.at(mView->fileCursorY - 1).line.length();
+			mBuffer->fileRows.at(mView->fileCursorY - 1).line.append(row.line);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY - 1, mView->fileCursorX);
+			deleteRow(mView->fileCursorY);
+			--mView->fileCursorY; 
 		}
 		else
 		{
 			size_t findPos;
-			if ((findPos = row.line.substr(0, mWindow->fileCursorX).find_last_of(separators)) == std::string::npos) //Delete everything in the row to the beginning
+			if ((findPos = row.line.substr(0, mView->fileCursorX).find_last_of(separators)) == std::string::npos) //Delete everything in the row to the beginning
 			{
-				row.line.erase(row.line.begin(), row.line.begin() + mWindow->fileCursorX);
-				mWindow->fileCursorX = 0;
+				row.line.erase(0, mView->fileCursorX);
+				mView->fileCursorX = 0;
 			}
-			else if (findPos == mWindow->fileCursorX - 1)
+			else if (findPos == mView->fileCursorX - 1) //Delete just the separator
 			{
-				deleteChar(KeyActions::KeyAction::Backspace); //Delete just the separator
+				row.line.erase(mView->fileCursorX - 1, 1);
+				--mView->fileCursorX;
 			}
 			else
 			{
-				row.line.erase(row.line.begin() + findPos + 1, row.line.begin() + mWindow->fileCursorX);
-				mWindow->fileCursorX = findPos + 1;
+				row.line.erase(findPos + 1, mView->fileCursorX - findPos - 1);
+				mView->fileCursorX = findPos + 1;
 			}
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX, mView->fileCursorX);
 		}
 		break;
 
 	case KeyActions::KeyAction::CtrlDelete:
-		if (mWindow->fileCursorY == mWindow->fileRows.size() - 1 && mWindow->fileCursorX == row.line.length())
-		{
-			mUndoHistory.pop();
-			return;
-		}
 
-		if (mWindow->fileCursorX == row.line.length())
+		if (mView->fileCursorX == row.line.length())
 		{
-			row.line.append(mWindow->fileRows.at(mWindow->fileCursorY + 1).line);
-			deleteRow(mWindow->fileCursorY + 1);
+			row.line.append(mBuffer->fileRows.at(mView->fileCursorY + 1).line);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX);
+			deleteRow(mView->fileCursorY + 1);
 		}
 		else
 		{
 			size_t findPos;
-			if ((findPos = row.line.substr(mWindow->fileCursorX).find_first_of(separators)) == std::string::npos) //Delete everything in the row to the beginning
+			if ((findPos = row.line.substr(mView->fileCursorX).find_first_of(separators)) == std::string::npos) //Delete everything in the row to the beginning
 			{
-				row.line.erase(row.line.begin() + mWindow->fileCursorX, row.line.end());
+				row.line.erase(mView->fileCursorX);
 			}
-			else if (findPos == 0)
+			else if (findPos == 0) //Delete just the separator
 			{
-				deleteChar(KeyActions::KeyAction::Delete); //Delete just the separator
+				row.line.erase(mView->fileCursorX, 1);
 			}
 			else
 			{
-				row.line.erase(row.line.begin() + mWindow->fileCursorX, row.line.begin() + findPos + mWindow->fileCursorX);
+				row.line.erase(mView->fileCursorX, findPos);
 			}
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX, mView->fileCursorX);
 		}
 		break;
 	}
-	mWindow->dirty = true;
-	mWindow->updateSavedPos = true;
+	if (mBuffer->fileRows.size() == oldRowCount) //Every delete within a row leaves the cursor where the deleted text was
+	{
+		mBuffer->rowEdited(mView->fileCursorY, mView->fileCursorX, oldLength - mBuffer->fileRows.at(mView->fileCursorY).line.length(), 0);
+	}
+	else
+	{
+		rowsEdited(mView->fileCursorY, mView->fileCursorY + 1 + oldRowCount - mBuffer->fileRows.size(), oldRowCount); //Joining rows leaves the cursor on the first of them
+	}
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
 }
 
 /// <summary>
@@ -613,14 +846,17 @@ void Console::deleteChar(const KeyActions::KeyAction key)
 /// <param name="c">The character to insert</param>
 void Console::insertChar(const unsigned char c)
 {
-	FileHandler::Row& row = mWindow->fileRows.at(mWindow->fileCursorY);
-
 	addUndoHistory();
 
-	row.line.insert(row.line.begin() + mWindow->fileCursorX, c);
-	++mWindow->fileCursorX;
-	mWindow->dirty = true;
-	mWindow->updateSavedPos = true;
+	const auto rowsLock = lockRows();
+	FileHandler::Row& row = mBuffer->fileRows.at(mView->fileCursorY);
+
+	row.line.insert(mView->fileCursorX, static_cast<char>(c));
+	if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(mView->fileCursorY, mView->fileCursorX, mView->fileCursorX + 1);
+	mBuffer->rowEdited(mView->fileCursorY, mView->fileCursorX, 0, 1);
+	++mView->fileCursorX;
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
 }
 
 /// <summary>
@@ -629,14 +865,25 @@ void Console::insertChar(const unsigned char c)
 /// </summary>
 void Console::addUndoHistory()
 {
+	TRACE_SCOPE("addUndoHistory");
+	//Every edit starts here, so remember the first row that needs to be highlighted again. Backspace may edit the row above the cursor.
+	//Edits away from the cursor lower it themselves
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, mView->fileCursorY > 0 ? mView->fileCursorY - 1 : 0);
+	if (mBatchDepth > 0)
+	{
+		if (mBatchHasSnapshot) return;
+		mBatchHasSnapshot = true;
+	}
+	Memory::Scope memoryScope(Memory::Subsystem::Undo);
+
 	FileHistory history;
-	history.rows = mWindow->fileRows;
-	history.fileCursorX = mWindow->fileCursorX;
-	history.fileCursorY = mWindow->fileCursorY;
-	history.colOffset = mWindow->colOffset;
-	history.rowOffset = mWindow->rowOffset;
+	history.rows = mBuffer->fileRows;
+	history.fileCursorX = mView->fileCursorX;
+	history.fileCursorY = mView->fileCursorY;
+	history.colOffset = mView->colOffset;
+	history.rowOffset = mView->rowOffset;
 
-	mUndoHistory.push(history);
+	mBuffer->undoHistory.push(history);
 }
 
 /// <summary>
@@ -644,14 +891,16 @@ void Console::addUndoHistory()
 /// </summary>
 void Console::addRedoHistory()
 {
+	TRACE_SCOPE("addRedoHistory");
+	Memory::Scope memoryScope(Memory::Subsystem::Redo);
 	FileHistory history;
-	history.rows = mWindow->fileRows;
-	history.fileCursorX = mWindow->fileCursorX;
-	history.fileCursorY = mWindow->fileCursorY;
-	history.colOffset = mWindow->colOffset;
-	history.rowOffset = mWindow->rowOffset;
+	history.rows = mBuffer->fileRows;
+	history.fileCursorX = mView->fileCursorX;
+	history.fileCursorY = mView->fileCursorY;
+	history.colOffset = mView->colOffset;
+	history.rowOffset = mView->rowOffset;
 
-	mRedoHistory.push(history);
+	mBuffer->redoHistory.push(history);
 }
 
 /// <summary>
@@ -659,17 +908,21 @@ void Console::addRedoHistory()
 /// </summary>
 void Console::undoChange()
 {
-	if (mUndoHistory.size() == 0) return;
+	TRACE_SCOPE("undoChange");
+	if (mBuffer->undoHistory.size() == 0) return;
 
 	addRedoHistory();
+	mBatchHasSnapshot = false; //The batch's snapshot is being undone, so the next edit in the batch needs a new one
 
-	mWindow->fileRows = mUndoHistory.top().rows;
-	mWindow->fileCursorX = mUndoHistory.top().fileCursorX;
-	mWindow->fileCursorY = mUndoHistory.top().fileCursorY;
-	mWindow->colOffset = mUndoHistory.top().colOffset;
-	mWindow->rowOffset = mUndoHistory.top().rowOffset;
+	replaceRows(mBuffer->undoHistory.top().rows);
+	mView->fileCursorX = mBuffer->undoHistory.top().fileCursorX;
+	mView->fileCursorY = mBuffer->undoHistory.top().fileCursorY;
+	mView->colOffset = mBuffer->undoHistory.top().colOffset;
+	mView->rowOffset = mBuffer->undoHistory.top().rowOffset;
+	mView->wrapOffset = 0;
+	mView->extraCursors.clear(); //Secondary cursors aren't part of the history, and may no longer be valid
 
-	mUndoHistory.pop();
+	mBuffer->undoHistory.pop();
 }
 
 /// <summary>
@@ -677,49 +930,110 @@ void Console::undoChange()
 /// </summary>
 void Console::redoChange()
 {
-	if (mRedoHistory.size() == 0) return;
+	TRACE_SCOPE("redoChange");
+	if (mBuffer->redoHistory.size() == 0) return;
 
 	addUndoHistory();
 
-	mWindow->fileRows = mRedoHistory.top().rows;
-	mWindow->fileCursorX = mRedoHistory.top().fileCursorX;
-	mWindow->fileCursorY = mRedoHistory.top().fileCursorY;
-	mWindow->colOffset = mRedoHistory.top().colOffset;
-	mWindow->rowOffset = mRedoHistory.top().rowOffset;
+	replaceRows(mBuffer->redoHistory.top().rows);
+	mView->fileCursorX = mBuffer->redoHistory.top().fileCursorX;
+	mView->fileCursorY = mBuffer->redoHistory.top().fileCursorY;
+	mView->colOffset = mBuffer->redoHistory.top().colOffset;
+	mView->rowOffset = mBuffer->redoHistory.top().rowOffset;
+	mView->wrapOffset = 0;
+	mView->extraCursors.clear(); //Secondary cursors aren't part of the history, and may no longer be valid
+
+	mBuffer->redoHistory.pop();
+}
+
+/// <summary>
+/// Replaces the active buffer's rows with a snapshot from the undo/redo history. Only the rows between the first and the last that differ
+/// are replaced and reported, so the wrap indexes, gutter, search index and swap file only have to catch up on that span, and the other rows
+/// keep what they have cached
+/// </summary>
+void Console::replaceRows(const std::vector<FileHandler::Row>& rows)
+{
+	std::vector<FileHandler::Row>& fileRows = mBuffer->fileRows;
+	const auto sameRow = [](const FileHandler::Row& a, const FileHandler::Row& b) //Rows the edit didn't touch still point at the same text
+		{
+			return (a.line.data() == b.line.data() && a.line.length() == b.line.length()) || a.line == std::string_view(b.line);
+		};
+	const size_t shorter = std::min(fileRows.size(), rows.size());
+	size_t prefix = 0, suffix = 0;
+	while (prefix < shorter && sameRow(fileRows[prefix], rows[prefix])) ++prefix;
+	while (suffix < shorter - prefix && sameRow(fileRows[fileRows.size() - 1 - suffix], rows[rows.size() - 1 - suffix])) ++suffix;
+	spliceRows(prefix, fileRows.size() - prefix - suffix, std::span(rows).subspan(prefix, rows.size() - prefix - suffix));
+}
 
-	mRedoHistory.pop();
+/// <summary>
+/// Replaces 'removed' rows of the active buffer at 'first' with 'added', and tells everything that caches rows about it
+/// </summary>
+void Console::spliceRows(const size_t first, const size_t removed, const std::span<const FileHandler::Row> added)
+{
+	std::vector<FileHandler::Row>& fileRows = mBuffer->fileRows;
+	const auto rowsLock = lockRows();
+	fileRows.erase(fileRows.begin() + first, fileRows.begin() + first + removed);
+	fileRows.insert(fileRows.begin() + first, added.begin(), added.end());
+	mBuffer->rowsReplaced(first, removed, added.size());
+	if (mBuffer->searchIndex)
+	{
+		mBuffer->searchIndex->rowsErased(first, removed);
+		mBuffer->searchIndex->rowsInserted(first, added.size());
+	}
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, first);
 }
 
 bool Console::isRawMode()
 {
-	return mWindow->rawModeEnabled;
+	return mRawModeEnabled;
 }
 
 bool Console::isDirty()
 {
-	return mWindow->dirty;
+	return mBuffer->dirty;
 }
 
 /// <summary>
 /// Saves the file and sets dirty = false
 /// Appends a newline character to the end of each row, assuming it's not the last row so that when written to the file the contents are saved properly
 /// </summary>
-void Console::save()
+/// <param name="force">Save even if another program changed the file since it was read (:w!)</param>
+/// <returns>False if the file wasn't saved, as another program changed it</returns>
+bool Console::save(const bool force)
 {
+	TRACE_SCOPE("save");
+	FileHandler::FileStamp stamp;
+	std::unique_ptr<std::string> text;
+	if (!force && !mBuffer->follower && (mBuffer->changedOnDisk || mBuffer->fileChanged(stamp, text)))
+	{
+		mBuffer->changedOnDisk = true;
+		return false;
+	}
+
 	std::string output;
-	for (size_t i = 0; i < mWindow->fileRows.size(); ++i)
+	for (size_t i = 0; i < mBuffer->fileRows.size(); ++i)
 	{
-		if (i == mWindow->fileRows.size() - 1)
+		if (i == mBuffer->fileRows.size() - 1)
 		{
-			output.append(mWindow->fileRows.at(i).line);
+			output.append(mBuffer->fileRows.at(i).line);
 		}
 		else
 		{
-			output.append(mWindow->fileRows.at(i).line + "\n");
+			output.append(mBuffer->fileRows.at(i).line).push_back('\n');
 		}
 	}
-	FileHandler::saveFile(output);
-	mWindow->dirty = false;
+	FileHandler::saveFile(mBuffer->fileName, output);
+	mBuffer->dirty = false;
+	mBuffer->fileBytes = output.size();
+	if (mBuffer->follower) mBuffer->follower = std::make_unique<Follower>(mBuffer->fileName, mBuffer->fileBytes); //What was saved isn't read back as appended
+	mBuffer->diskStamp = FileHandler::fileStamp(mBuffer->fileName);
+	mBuffer->diskHash = FileHandler::hashText(output);
+	mBuffer->changedOnDisk = false;
+	mBuffer->lineChanges.reset(std::make_unique<const std::string>(std::move(output))); //The rows are compared with what was written from now on
+	mBuffer->changedRows = EditedRows();
+	if (mBuffer->journal) mBuffer->journal->restart(mBuffer->diskStamp);
+	mBuffer->journalRows = EditedRows();
+	return true;
 }
 
 /// <summary>
@@ -727,10 +1041,10 @@ void Console::save()
 /// </summary>
 void Console::enableCommandMode()
 {
-	disableRawInput();
-	mWindow->renderedCursorX = 0; mWindow->renderedCursorY = mWindow->rows + 2;
 	mMode = Mode::CommandMode;
+	if (mBatchDepth > 0) return; //A replayed command doesn't need the prompt shown
 
+	disableRawInput();
 	prepRenderedString();
 	refreshScreen();
 }
@@ -740,562 +1054,2165 @@ void Console::enableCommandMode()
 /// </summary>
 void Console::enableEditMode()
 {
-	if (mWindow->fileRows.size() == 0)
+	if (mBuffer->fileRows.size() == 0)
 	{
-		mWindow->fileRows.push_back(FileHandler::Row());
+		const auto rowsLock = lockRows();
+		mBuffer->fileRows.push_back(FileHandler::Row());
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowInserted(0);
+		mBuffer->rowsReplaced(0, 0, 1);
 	}
 	mMode = Mode::EditMode;
 }
 
 /// <summary>
-/// Deletes a row when the last character in the row is removed
+/// Moves the rendered cursor to the command mode area and enables find mode
 /// </summary>
-/// <param name="rowNum"></param>
-void Console::deleteRow(const size_t rowNum)
+void Console::enableFindMode()
 {
-	if (rowNum > mWindow->fileRows.size()) return;
-	mWindow->fileRows.erase(mWindow->fileRows.begin() + rowNum);
-	mWindow->dirty = true;
+	mMode = Mode::FindMode;
+	if (mBatchDepth > 0) return;
+
+	disableRawInput();
+	prepRenderedString();
+	refreshScreen();
 }
 
 /// <summary>
-/// Allows for smooth movement of the cursor when moving up/down
-/// Compares the last value since the cursor was moved left/right (either by inserting/deleting character or moving left/right manually)
-/// Finds the closest position to the last saved value without going past it
+/// Sets the active search pattern and jumps to the first match after the cursor
 /// </summary>
-void Console::setCursorLinePosition()
+/// <param name="pattern">A literal pattern, or a regex if prefixed with \v</param>
+void Console::find(const std::string_view& pattern)
 {
-	if (mWindow->renderedCursorX > mWindow->fileRows.at(mWindow->fileCursorY).renderedLine.length())
-	{
-		mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
-		return;
-	}
-	mWindow->fileCursorX = 0;
-	size_t spaces = getRenderedCursorTabSpaces(mWindow->fileRows.at(mWindow->fileCursorY));
-	while (mWindow->fileCursorX + spaces < mWindow->savedRenderedCursorXPos)
-	{
-		++mWindow->fileCursorX;
-		spaces = getRenderedCursorTabSpaces(mWindow->fileRows.at(mWindow->fileCursorY));
-	}
-	if (mWindow->fileCursorX + spaces > mWindow->savedRenderedCursorXPos)
-	{
-		--mWindow->fileCursorX;
-	}
-	if (mWindow->fileCursorX > mWindow->fileRows.at(mWindow->fileCursorY).line.length())
-	{
-		mWindow->fileCursorX = mWindow->fileRows.at(mWindow->fileCursorY).line.length();
-	}
+	if (pattern.empty()) return;
+	mSearchQuery = Search::compile(pattern);
+	findNext(true);
 }
 
 /// <summary>
-/// Fixes the rendered cursor x/y and row/column offset positions
+/// Moves the cursor to the next/previous match of the active search pattern, wrapping around the file.
+/// If the search index is built, only the rows it reports as candidates are run through the matcher
 /// </summary>
-/// <param name="row">The row we are currently on</param>
-void Console::fixRenderedCursorPosition(const FileHandler::Row& row)
+/// <param name="forward">Search forwards (n) or backwards (N)</param>
+void Console::findNext(const bool forward)
 {
-	//Fixing rendered X/Col position
-	mWindow->renderedCursorX = mWindow->fileCursorX;
-	mWindow->renderedCursorX += getRenderedCursorTabSpaces(row);
-	mWindow->colNumberToDisplay = mWindow->renderedCursorX;
+	if (mBuffer->fileRows.empty() || mSearchQuery.pattern.empty()) return;
 
-	while (mWindow->renderedCursorX - mWindow->colOffset >= mWindow->cols && mWindow->renderedCursorX >= mWindow->colOffset)
-	{
-		++mWindow->colOffset;
-	}
-	while (mWindow->renderedCursorX < mWindow->colOffset)
+	const size_t startRow = mView->fileCursorY;
+	const size_t rowCount = mBuffer->fileRows.size();
+	auto checkRow = [&](const size_t r, const bool wrapped)
+		{
+			const bool onStartRow = r == startRow && !wrapped;
+			const std::string_view line = mBuffer->fileRows.at(r).line;
+			size_t matchCol, matchLength;
+			const bool found = forward ? Search::findInRow(mSearchQuery, line, onStartRow ? mView->fileCursorX + 1 : 0, matchCol, matchLength)
+				: Search::findLastInRow(mSearchQuery, line, onStartRow ? mView->fileCursorX : std::string::npos, matchCol, matchLength);
+			if (found)
+			{
+				mView->fileCursorY = r;
+				mView->fileCursorX = matchCol;
+				mView->updateSavedPos = true;
+			}
+			return found;
+		};
+
+	std::vector<size_t> candidates;
+	if (mBuffer->searchIndex && mBuffer->searchIndex->candidateRows(mSearchQuery.requiredLiterals, candidates))
 	{
-		--mWindow->colOffset;
+		if (forward)
+		{
+			for (auto it = std::lower_bound(candidates.begin(), candidates.end(), startRow); it != candidates.end(); ++it)
+			{
+				if (checkRow(*it, false)) return;
+			}
+			for (auto it = candidates.begin(); it != candidates.end() && *it <= startRow; ++it)
+			{
+				if (checkRow(*it, true)) return;
+			}
+		}
+		else
+		{
+			for (auto it = std::lower_bound(candidates.rbegin(), candidates.rend(), startRow, std::greater<size_t>()); it != candidates.rend(); ++it)
+			{
+				if (checkRow(*it, false)) return;
+			}
+			for (auto it = candidates.rbegin(); it != candidates.rend() && *it >= startRow; ++it)
+			{
+				if (checkRow(*it, true)) return;
+			}
+		}
+		return;
 	}
-	mWindow->renderedCursorX = mWindow->renderedCursorX - mWindow->colOffset;
-	if (mWindow->renderedCursorX == mWindow->cols)
+
+	for (size_t i = 0; i <= rowCount; ++i) //Visits every row once, plus the start row again after wrapping
 	{
-		--mWindow->renderedCursorX;
+		const size_t r = forward ? (startRow + i) % rowCount : (startRow + rowCount - i) % rowCount;
+		if (checkRow(r, i > 0 && r == startRow)) return;
 	}
-	//Fixing rendered Y/Row position
-	while (mWindow->fileCursorY - mWindow->rowOffset >= mWindow->rows && mWindow->fileCursorY >= mWindow->rowOffset)
+}
+
+/// <summary>
+/// Builds the trigram search index in the background, or drops it if it already exists
+/// </summary>
+void Console::toggleSearchIndex()
+{
+	if (mBuffer->searchIndex)
 	{
-		++mWindow->rowOffset;
+		mBuffer->searchIndex.reset();
 	}
-	while (mWindow->fileCursorY < mWindow->rowOffset)
+	else
 	{
-		--mWindow->rowOffset;
+		mBuffer->searchIndex = std::make_unique<TrigramIndex>(mBuffer->fileRows, mBuffer->rowsMutex);
 	}
-	mWindow->renderedCursorY = mWindow->fileCursorY - mWindow->rowOffset;
+}
 
-	if (mWindow->renderedCursorY == mWindow->rows) //renderedCursorY might be 1 too many rows down, so just bring it back one row if it is
+/// <summary>
+/// Starts or stops following the active buffer's file. While a file is followed, what is written to the end of it is added to its buffer
+/// </summary>
+void Console::toggleFollow()
+{
+	if (mBuffer->follower)
 	{
-		--mWindow->renderedCursorY;
+		mBuffer->follower.reset();
 	}
-
-	if (mWindow->updateSavedPos)
+	else
 	{
-		mWindow->savedRenderedCursorXPos = mWindow->renderedCursorX;
-		mWindow->updateSavedPos = false;
+		mBuffer->follower = std::make_unique<Follower>(mBuffer->fileName, mBuffer->fileBytes);
 	}
 }
 
+/// <summary>
+/// True if the file of any open buffer is followed
+/// </summary>
+bool Console::isFollowing()
+{
+	return std::any_of(mBuffers.begin(), mBuffers.end(), [](const std::shared_ptr<Buffer>& buffer) { return buffer->follower != nullptr; });
+}
 
 /// <summary>
-/// This function needs work
+/// Brings the buffers up to date with their files: adds what was appended to followed files, and reloads the buffers
+/// whose file another program changed
 /// </summary>
-/// <param name="renderedLine"></param>
-/// <param name="offset"></param>
-void Console::replaceRenderedStringTabs(std::string& renderedLine)
+/// <returns>True if anything on screen may have changed</returns>
+bool Console::syncFiles()
 {
-	size_t lineLength = renderedLine.length();
-	for (size_t i = 0; i < lineLength; ++i)
+	bool changed = ingestAppended();
+	std::vector<std::string> fileNames;
+	mWatcher->changed(fileNames);
+	for (const std::shared_ptr<Buffer>& buffer : mBuffers)
 	{
-		if (i >= renderedLine.length()) return;
-		if (renderedLine[i] != static_cast<uint8_t>(KeyActions::KeyAction::Tab)) continue;
-
-		renderedLine[i] = ' '; //Replace the tab character with a space
-		uint8_t t = 7 - (i % 8);
-		while (t > 0)
-		{
-			renderedLine.insert(renderedLine.begin() + (i), ' '); //Add spaces until we reach a multiple of 8
-			--t;
-			++i;
-		}
-		if (renderedLine.length() > lineLength)
-		{
-			lineLength = renderedLine.length();
-		}
+		if (std::find(fileNames.begin(), fileNames.end(), buffer->fileName) == fileNames.end()) continue;
+		if (reloadChangedFile(*buffer)) changed = true;
 	}
+	return changed;
 }
 
 /// <summary>
-/// Gets the amount of spaces the rendered cursor needs to be adjusted to account for tabs
+/// Records the rows edited since the last call in the swap files of the buffers with changes. The swap file of a buffer is started
+/// by its first edit. Followed buffers aren't journaled, as their rows keep changing along with the file
 /// </summary>
-/// <param name="row">Row to check</param>
-/// <returns>The amount of spaces to add</returns>
-size_t Console::getRenderedCursorTabSpaces(const FileHandler::Row& row)
+void Console::journalEdits()
 {
-	size_t spacesToAdd = 0;
-	for (size_t i = 0; i < mWindow->fileCursorX; ++i)
+	for (const std::shared_ptr<Buffer>& buffer : mBuffers)
 	{
-		if (i > row.line.length()) return 0;
-
-		if (row.line[i] != static_cast<uint8_t>(KeyActions::KeyAction::Tab)) continue;
-
-		spacesToAdd += 7 - ((i + spacesToAdd) % 8); //Tabs are replaced with up to 8 spaces, depending on how close to a multiple of 8 the tab is
+		const EditedRows& edited = buffer->journalRows;
+		if (edited.empty() || !buffer->dirty || buffer->follower || buffer->swapFound) continue; //Edits to a buffer without changes (adding the first row of an empty file) are recorded along with the next ones
+		if (!buffer->journal) buffer->journal = std::make_unique<Journal>(buffer->fileName, buffer->diskStamp);
+		buffer->journal->record(edited.first, edited.oldEnd - edited.first, buffer->fileRows, edited.newEnd);
+		buffer->journalRows = EditedRows();
 	}
-	return spacesToAdd;
 }
 
 /// <summary>
-/// Sets the rendered color of the current row based on what setHighlight() does
+/// Replays the edits in the active buffer's swap file on the file as it was loaded, as one change that can be undone,
+/// and carries on journaling into the swap file
 /// </summary>
-/// <param name="renderString">The string being prepped for render</param>
-/// <param name="row">The current row number</param>
-/// <param name="colOffset">The current colOffset to know if a certain highlight is off-screen or needs to be rendered</param>
-void Console::updateRenderedColor(const size_t rowOffset, const size_t colOffset)
+/// <param name="error">Set to why the edits couldn't be recovered</param>
+/// <returns>False if they couldn't be</returns>
+bool Console::recoverSwap(std::string& error)
 {
-	std::string normalColorMode = "\x1b[0m";
-	size_t charactersToAdjust = 0; //The amount of characters to adjust for in the string position based on how many color code escape sequences have been added
-	size_t prevRow = 0;
-	for (const auto& highlight : mHighlights)
+	if (mBuffer->dirty || !mBuffer->journalRows.empty()) //The edits are replayed on the rows as they were loaded
 	{
-		if (highlight.startRow == highlight.endRow && (highlight.endCol < colOffset || highlight.startCol > colOffset + mWindow->cols)) continue;
-		if (highlight.startRow > mWindow->rowOffset + mWindow->rows) return;
-
-		std::string* renderString = &mWindow->fileRows.at(highlight.startRow).renderedLine;
-		if (prevRow != highlight.startRow) charactersToAdjust = 0;
-
-		const uint8_t color = SyntaxHighlight::color(highlight.colorType);
-		std::string colorFormat = std::format("\x1b[38;5;{}m", std::to_string(color));
-		if (rowOffset > highlight.startRow)
-		{
-			renderString = &mWindow->fileRows.at(rowOffset).renderedLine;
-			renderString->insert(0, colorFormat);
-			charactersToAdjust += colorFormat.length();
-			prevRow = rowOffset;
-		}
-		else
-		{
-			size_t insertPos = highlight.startCol;
-			//Need to make sure the insert position is in within the rendered string
-			if (insertPos < colOffset) insertPos = 0;
-			else if (insertPos >= colOffset) insertPos -= colOffset;
-			if (insertPos >= mWindow->cols) insertPos = mWindow->cols;
-
-			renderString->insert(insertPos + charactersToAdjust, colorFormat);
-			charactersToAdjust += colorFormat.length();
-			prevRow = highlight.startRow;
-		}
+		error = "The buffer has changes. Recover before editing it";
+		return false;
+	}
+	Journal::Recovered recovered;
+	error = Journal::recover(mBuffer->fileName, mBuffer->diskStamp, mBuffer->fileRows, recovered);
+	if (!error.empty()) return false;
 
-		size_t insertPos = highlight.endCol;
-		if (insertPos >= colOffset) insertPos -= colOffset;
-		if (insertPos >= mWindow->cols) insertPos = mWindow->cols;
-		renderString = &mWindow->fileRows.at(highlight.endRow).renderedLine;
+	addUndoHistory();
+	spliceRows(recovered.first, recovered.removed, recovered.rows);
+	mBuffer->dirty = recovered.edits > 0;
+	mBuffer->swapFound = false;
+	mBuffer->journal = std::make_unique<Journal>(mBuffer->fileName, recovered.text->substr(0, recovered.length));
+	mBuffer->journalRows = EditedRows(); //The swap file already holds the recovered edits
+	mBuffer->loadedText.push_back(std::move(recovered.text));
+	mView->extraCursors.clear();
+	clampCursor(*mView);
+	setStatusMessage(std::format("Recovered {} edits of {}. :w saves them", recovered.edits, mBuffer->fileName));
+	return true;
+}
 
-		if (prevRow != highlight.endRow) charactersToAdjust = 0;
-		renderString->insert(insertPos + charactersToAdjust, normalColorMode);
-		charactersToAdjust += normalColorMode.length();
+/// <summary>
+/// Deletes the swap file the active buffer's file was opened with, without replaying it, so the buffer's edits are journaled into a new one
+/// </summary>
+/// <returns>False if the buffer had no swap file</returns>
+bool Console::dropSwap()
+{
+	if (!mBuffer->swapFound) return false;
+	std::error_code error;
+	std::filesystem::remove(Journal::path(mBuffer->fileName), error);
+	mBuffer->swapFound = false;
+	return true;
+}
 
-		prevRow = highlight.endRow;
+/// <summary>
+/// Tells which open files have a swap file left by an earlier session, which may hold edits that were never saved
+/// </summary>
+void Console::reportSwapFiles()
+{
+	std::string fileNames;
+	for (const std::shared_ptr<Buffer>& buffer : mBuffers)
+	{
+		if (buffer->swapFound) fileNames += (fileNames.empty() ? "" : ", ") + buffer->fileName;
 	}
+	if (!fileNames.empty()) setStatusMessage(std::format("Found a swap file for {} (nve exited without saving, or is editing it elsewhere). :recover replays it, :dropswap deletes it", fileNames));
 }
 
 /// <summary>
-/// Tries to find the end marker, denoted as strToFind
-/// Either runs until the max row count is reached or until it is found
+/// Adds what has been read from the followed files since the last call to their buffers
 /// </summary>
-/// <param name="currentWord"></param>
-/// <param name="row"></param>
-/// <param name="posOffset"></param>
-/// <param name="findPos"></param>
-/// <param name="strToFind"></param>
-/// <param name="hlType"></param>
-void Console::findEndMarker(std::string& currentWord, size_t& row, size_t& posOffset, size_t& findPos, size_t startRow, size_t startCol, const std::string& strToFind, const SyntaxHighlight::HighlightType hlType, bool addHighlight)
-{
-	size_t endPos;
-	uint8_t offset = strToFind.length(); //Offsets by the opening marker length while on the same row as the opening marker. 
-	while ((endPos = currentWord.find(strToFind, offset)) == std::string::npos)
-	{
-		offset = 0; //If on a new row, no need to offset the check position
-		findPos = 0;
-		posOffset = 0;
-		++row;
-		if (row >= mWindow->fileRows.size())
-		{
-			mHighlights.emplace_back(hlType, startRow, startCol, row - 1, mWindow->fileRows.at(row - 1).renderedLine.length());
-			currentWord.clear();
-			return;
-		}
-		currentWord = mWindow->fileRows.at(row).renderedLine;
-	}
-	if (endPos > 0)
+/// <returns>True if any buffer changed</returns>
+bool Console::ingestAppended()
+{
+	bool changed = false;
+	for (const std::shared_ptr<Buffer>& buffer : mBuffers)
 	{
-		if (currentWord[endPos - 1] == mWindow->syntax->escapeChar && !(endPos > 1 && currentWord.substr(endPos - 2, 2) == (std::string() + mWindow->syntax->escapeChar + mWindow->syntax->escapeChar)))
-		{
-			currentWord = currentWord.substr(endPos);
-			posOffset += endPos;
-			findEndMarker(currentWord, row, posOffset, findPos, startRow, startCol, strToFind, hlType);
-		}
-		else
+		Follower::Appended appended;
+		while (buffer->follower && buffer->follower->take(appended))
 		{
-			addHighlight = true;
+			appendRows(*buffer, appended);
+			changed = true;
 		}
 	}
-	else
-	{
-		addHighlight = true;
-	}
+	return changed;
+}
 
-	if (addHighlight)
+/// <summary>
+/// Throws away every buffer's row states, so they are lexed again from the top
+/// </summary>
+void Console::rehighlight()
+{
+	for (const auto& buffer : mBuffers)
 	{
-		mHighlights.emplace_back(hlType, startRow, startCol, row, posOffset + endPos + strToFind.length());
-		currentWord = currentWord.substr(endPos + strToFind.length());
-		posOffset += endPos + strToFind.length();
+		buffer->highlightDirtyRow = 0;
 	}
 }
 
 /// <summary>
-/// Sets the highlight points of the rendered string if a syntax is given
-/// The stored format is (HighlightType, startRow, startCol, endRow, endCol)
-/// Needs to be optimized.
+/// Adds secondary cursors, skipping the positions a cursor is already at. The secondary cursors are kept sorted by position,
+/// so a repeated :mcmatch or :mccol doesn't stack cursors on the same character
 /// </summary>
-void Console::setHighlight()
+void Console::addExtraCursors(const std::vector<Cursor>& positions)
 {
-	if (mWindow->syntax == nullptr) return; //Can't highlight if there is no syntax
-
-	for (int64_t i = 0; i < mHighlights.size(); ++i)
+	std::vector<Cursor>& cursors = mView->extraCursors;
+	for (const Cursor& cursor : positions)
 	{
-		if (mHighlights[i].startRow >= mWindow->fileCursorY)
+		if (cursor.fileCursorX != mView->fileCursorX || cursor.fileCursorY != mView->fileCursorY) cursors.emplace_back(cursor.fileCursorX, cursor.fileCursorY);
+	}
+	std::sort(cursors.begin(), cursors.end(), [](const Cursor& a, const Cursor& b)
 		{
-			mHighlights.erase(mHighlights.begin() + i, mHighlights.end());
-			break;
-		}
-		if (mHighlights[i].endRow < mWindow->rowOffset)
+			return a.fileCursorY != b.fileCursorY ? a.fileCursorY < b.fileCursorY : a.fileCursorX < b.fileCursorX;
+		});
+	cursors.erase(std::unique(cursors.begin(), cursors.end(), [](const Cursor& a, const Cursor& b) { return a.fileCursorX == b.fileCursorX && a.fileCursorY == b.fileCursorY; }), cursors.end());
+}
+
+/// <summary>
+/// Puts cursors on the given positions. If the primary cursor isn't on one of them it moves to the first, so it doesn't edit
+/// a position that wasn't asked for
+/// </summary>
+/// <param name="positions">In the order the cursors were found, which is top to bottom</param>
+void Console::addCursorsAt(const std::vector<Cursor>& positions)
+{
+	if (positions.empty()) return;
+	const bool onPosition = std::any_of(positions.begin(), positions.end(), [](const Cursor& cursor) { return cursor.fileCursorX == mView->fileCursorX && cursor.fileCursorY == mView->fileCursorY; });
+	if (!onPosition)
+	{
+		mView->fileCursorX = positions.front().fileCursorX;
+		mView->fileCursorY = positions.front().fileCursorY;
+		mView->updateSavedPos = true;
+		std::erase_if(mView->extraCursors, [](const Cursor& cursor) { return cursor.fileCursorX == mView->fileCursorX && cursor.fileCursorY == mView->fileCursorY; });
+	}
+	addExtraCursors(positions);
+}
+
+/// <summary>
+/// Adds a cursor at the start of every match of the last search pattern
+/// </summary>
+void Console::addCursorsAtMatches()
+{
+	if (mSearchQuery.pattern.empty()) return;
+
+	std::vector<Cursor> positions;
+	auto addMatches = [&](const size_t r)
 		{
-			mHighlights.erase(mHighlights.begin() + i);
-			--i;
-		}
+			const std::string_view line = mBuffer->fileRows.at(r).line;
+			size_t startCol = 0, matchCol, matchLength;
+			while (Search::findInRow(mSearchQuery, line, startCol, matchCol, matchLength))
+			{
+				positions.push_back(Cursor{ matchCol, r });
+				startCol = matchCol + std::max<size_t>(matchLength, 1);
+			}
+		};
+
+	std::vector<size_t> candidates;
+	if (mBuffer->searchIndex && mBuffer->searchIndex->candidateRows(mSearchQuery.requiredLiterals, candidates))
+	{
+		for (const size_t r : candidates) addMatches(r);
+	}
+	else
+	{
+		for (size_t r = 0; r < mBuffer->fileRows.size(); ++r) addMatches(r);
+	}
+	addCursorsAt(positions);
+}
+
+/// <summary>
+/// Adds a cursor at the end of every row in the given range
+/// </summary>
+/// <param name="firstRow">0-based first row</param>
+/// <param name="lastRow">0-based last row, inclusive</param>
+void Console::addCursorsOnLines(const size_t firstRow, const size_t lastRow)
+{
+	std::vector<Cursor> positions;
+	for (size_t r = firstRow; r <= lastRow && r < mBuffer->fileRows.size(); ++r)
+	{
+		positions.push_back(Cursor{ mBuffer->fileRows.at(r).line.length(), r });
+	}
+	addCursorsAt(positions);
+}
+
+/// <summary>
+/// Adds cursors at the primary cursor's rendered column on the given amount of rows below it.
+/// Rows that are too short to reach the column are skipped, like a block selection
+/// </summary>
+/// <param name="count"></param>
+void Console::addColumnCursors(const size_t count)
+{
+	const size_t renderedCol = Unicode::column(mBuffer->fileRows.at(mView->fileCursorY).line, mView->fileCursorX);
+	std::vector<Cursor> positions;
+	for (size_t r = mView->fileCursorY + 1; r <= mView->fileCursorY + count && r < mBuffer->fileRows.size(); ++r)
+	{
+		const Line& line = mBuffer->fileRows.at(r).line;
+		if (Unicode::column(line, line.length()) < renderedCol) continue;
+		positions.push_back(Cursor{ Unicode::indexAtColumn(line, renderedCol), r });
 	}
-	size_t i = mWindow->fileCursorY;
-	size_t startOffset = 0;
-	for (const auto& highlight : mHighlights)
+	addExtraCursors(positions);
+}
+
+/// <summary>
+/// Removes all secondary cursors
+/// </summary>
+void Console::clearCursors()
+{
+	mView->extraCursors.clear();
+}
+
+bool Console::hasMultipleCursors()
+{
+	return !mView->extraCursors.empty();
+}
+
+/// <summary>
+/// Moves the secondary cursors along with the primary cursor.
+/// Left/right stay within the cursor's row
+/// </summary>
+/// <param name="key"></param>
+void Console::moveExtraCursors(const KeyActions::KeyAction key)
+{
+	for (Cursor& cursor : mView->extraCursors)
 	{
-		if (i >= highlight.startRow && i <= highlight.endRow)
+		const Line& line = mBuffer->fileRows.at(cursor.fileCursorY).line;
+		const size_t rowLength = line.length();
+		switch (key)
 		{
-			i = highlight.endRow;
-			startOffset = highlight.endCol;
+		case KeyActions::KeyAction::ArrowLeft:
+			cursor.fileCursorX = Unicode::previousCharacter(line, cursor.fileCursorX);
+			break;
+		case KeyActions::KeyAction::ArrowRight:
+			cursor.fileCursorX = Unicode::nextCharacter(line, cursor.fileCursorX);
+			break;
+		case KeyActions::KeyAction::ArrowUp:
+			if (cursor.fileCursorY > 0) --cursor.fileCursorY;
+			cursor.fileCursorX = std::min(cursor.fileCursorX, mBuffer->fileRows.at(cursor.fileCursorY).line.length());
+			break;
+		case KeyActions::KeyAction::ArrowDown:
+			if (cursor.fileCursorY < mBuffer->fileRows.size() - 1) ++cursor.fileCursorY;
+			cursor.fileCursorX = std::min(cursor.fileCursorX, mBuffer->fileRows.at(cursor.fileCursorY).line.length());
+			break;
+		case KeyActions::KeyAction::Home:
+			cursor.fileCursorX = 0;
+			break;
+		case KeyActions::KeyAction::End:
+			cursor.fileCursorX = rowLength;
 			break;
 		}
 	}
+}
 
-	for (; i < mWindow->fileRows.size(); ++i)
+/// <summary>
+/// Applies an edit at every cursor as one batch.
+/// The cursors are sorted, and each affected row is rebuilt once with the cursor offsets adjusted for the characters inserted/removed before them.
+/// The whole batch is a single undo entry
+/// </summary>
+/// <param name="key">The key to apply. Backspace/Delete (and their Ctrl variants) remove one character, Enter splits rows, anything else is inserted</param>
+void Console::multiCursorEdit(const KeyActions::KeyAction key)
+{
+	std::vector<Cursor> cursors = std::move(mView->extraCursors);
+	cursors.emplace_back(mView->fileCursorX, mView->fileCursorY, true);
+	std::sort(cursors.begin(), cursors.end(), [](const Cursor& a, const Cursor& b)
+		{
+			return a.fileCursorY != b.fileCursorY ? a.fileCursorY < b.fileCursorY : a.fileCursorX < b.fileCursorX;
+		});
+	auto samePosition = [](const Cursor& a, const Cursor& b) { return a.fileCursorX == b.fileCursorX && a.fileCursorY == b.fileCursorY; };
+	for (size_t c = cursors.size() - 1; c > 0; --c) //Duplicate cursors would apply the edit twice. Merge them, keeping the primary
 	{
-		if (i > mWindow->rowOffset + mWindow->rows) return;
-
-		FileHandler::Row* row = &mWindow->fileRows.at(i); //The starting row
+		if (samePosition(cursors[c], cursors[c - 1])) cursors[c - 1].primary |= cursors[c].primary;
+	}
+	cursors.erase(std::unique(cursors.begin(), cursors.end(), samePosition), cursors.end());
 
-		std::string currentWord = row->renderedLine.substr(startOffset);
-		startOffset = 0;
-		size_t findPos, posOffset = 0; //posOffset keeps track of how far into the string we are, since findPos depends on currentWord, which progressively gets smaller
-		const uint8_t singlelineCommentLength = mWindow->syntax->singlelineComment.length();
-		const uint8_t multilineCommentLength = mWindow->syntax->multilineCommentStart.length();
+	addUndoHistory();
+	const size_t oldRowCount = mBuffer->fileRows.size();
+	std::vector<Cursor> newCursors;
+	newCursors.reserve(cursors.size());
 
-		while ((findPos = currentWord.find_first_of(separators)) != std::string::npos)
+	if (key == KeyActions::KeyAction::Enter)
+	{
+		if (mBuffer->searchIndex) mBuffer->searchIndex->stopBuild();
 		{
-			row = &mWindow->fileRows.at(i); //Makes sure the correct row is always being used
-
-			std::string wordToCheck = currentWord.substr(0, findPos); //The word/character sequence before the separator character
+			const auto rowsLock = lockRows();
+			splitRowsAtCursors(cursors, newCursors);
+		}
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rebuild();
+	}
+	else
+	{
+		const bool backspace = key == KeyActions::KeyAction::Backspace || key == KeyActions::KeyAction::CtrlBackspace;
+		const bool del = key == KeyActions::KeyAction::Delete || key == KeyActions::KeyAction::CtrlDelete;
+		const auto rowsLock = lockRows();
 
-			if (!wordToCheck.empty() && wordToCheck.find_first_not_of("0123456789") == std::string::npos)
-			{
-				mHighlights.emplace_back(SyntaxHighlight::HighlightType::Number, i, posOffset, i, posOffset + wordToCheck.length());
-			}
-			else if (!wordToCheck.empty())
+		for (size_t first = 0, last = 0; first < cursors.size(); first = last)
+		{
+			const size_t r = cursors[first].fileCursorY;
+			while (last < cursors.size() && cursors[last].fileCursorY == r) ++last;
+
+			Line& line = mBuffer->fileRows.at(r).line;
+			std::string newLine;
+			newLine.reserve(line.length() + (last - first));
+			size_t copiedTo = 0; //Everything in line before this has been handled
+			size_t removed = 0;
+			for (size_t c = first; c < last; ++c)
 			{
-				for (const auto& type : mWindow->syntax->builtInTypeKeywords)
+				Cursor cursor = cursors[c];
+				if (backspace || del)
 				{
-					if (type == wordToCheck)
+					//The character behind/ahead of the cursor, which may be several bytes long
+					const size_t removeFrom = backspace ? Unicode::previousCharacter(line, cursor.fileCursorX) : cursor.fileCursorX;
+					const size_t removeTo = backspace ? cursor.fileCursorX : Unicode::nextCharacter(line, cursor.fileCursorX);
+					if (removeFrom == removeTo || removeFrom < copiedTo) //Nothing to remove, or another cursor already removed it
 					{
-						mHighlights.emplace_back(SyntaxHighlight::HighlightType::KeywordBuiltInType, i, posOffset, i, posOffset + wordToCheck.length());
-						goto commentcheck;
+						cursor.fileCursorX -= removed;
 					}
-				}
-				for (const auto& control : mWindow->syntax->loopKeywords)
-				{
-					if (control == wordToCheck)
+					else
 					{
-						mHighlights.emplace_back(SyntaxHighlight::HighlightType::KeywordControl, i, posOffset, i, posOffset + wordToCheck.length());
-						goto commentcheck;
+						newLine.append(line, copiedTo, removeFrom - copiedTo);
+						copiedTo = removeTo;
+						if (backspace) removed += removeTo - removeFrom;
+						cursor.fileCursorX -= removed;
+						if (del) removed += removeTo - removeFrom;
 					}
 				}
-				for (const auto& other : mWindow->syntax->otherKeywords)
+				else
 				{
-					if (other == wordToCheck)
-					{
-						mHighlights.emplace_back(SyntaxHighlight::HighlightType::KeywordOther, i, posOffset, i, posOffset + wordToCheck.length());
-						goto commentcheck;
-					}
+					newLine.append(line, copiedTo, cursor.fileCursorX - copiedTo);
+					newLine.push_back(static_cast<char>(key));
+					copiedTo = cursor.fileCursorX;
+					cursor.fileCursorX += c - first + 1;
+				}
+				if (newCursors.empty() || newCursors.back().fileCursorY != cursor.fileCursorY || newCursors.back().fileCursorX != cursor.fileCursorX)
+				{
+					newCursors.push_back(cursor);
+				}
+				else if (cursor.primary) //Cursors that collapsed onto the same position merge, keeping the primary
+				{
+					newCursors.back().primary = true;
 				}
 			}
+			newLine.append(line, copiedTo);
+			line = std::move(newLine);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(r);
+		}
+	}
 
-		commentcheck: //Skip the remaining for-loop checks
-			if (currentWord[findPos] == '"' || currentWord[findPos] == '\'') //String highlights are open until the next string marker of the same type is found
-			{
-				posOffset += findPos;
-				size_t startCol = posOffset;
-				size_t startRow = i;
-				currentWord = currentWord.substr(findPos);
-				findEndMarker(currentWord, i, posOffset, findPos, startRow, startCol, std::string() + currentWord[findPos], SyntaxHighlight::HighlightType::String);
-			}
-			else if (findPos + multilineCommentLength - 1 < currentWord.length() //Multiline comments stay open until the closing marker is found
-				&& currentWord.substr(findPos, multilineCommentLength) == mWindow->syntax->multilineCommentStart)
-			{
-				posOffset += findPos;
-				size_t startCol = posOffset;
-				size_t startRow = i;
-				currentWord = currentWord.substr(findPos);
-				findEndMarker(currentWord, i, posOffset, findPos, startRow, startCol, mWindow->syntax->multilineCommentEnd, SyntaxHighlight::HighlightType::MultilineComment);
-			}
-			else if (findPos + singlelineCommentLength - 1 < currentWord.length() //Singleline comments take the rest of the row
-				&& currentWord.substr(findPos, singlelineCommentLength) == mWindow->syntax->singlelineComment)
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, cursors.front().fileCursorY);
+	rowsEdited(cursors.front().fileCursorY, cursors.back().fileCursorY + 1, oldRowCount);
+	for (const Cursor& cursor : newCursors)
+	{
+		if (cursor.primary)
+		{
+			mView->fileCursorX = cursor.fileCursorX;
+			mView->fileCursorY = cursor.fileCursorY;
+		}
+		else
+		{
+			mView->extraCursors.push_back(cursor);
+		}
+	}
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
+}
+
+/// <summary>
+/// Splits every row that has a cursor at each cursor's position.
+/// The rows are rebuilt in one pass, moving the untouched rows instead of shifting them once per new row
+/// </summary>
+/// <param name="cursors">The cursors, sorted by position</param>
+/// <param name="newCursors">The cursors after the split, each at the start of its new row</param>
+void Console::splitRowsAtCursors(const std::vector<Cursor>& cursors, std::vector<Cursor>& newCursors)
+{
+	std::vector<FileHandler::Row> rows;
+	rows.reserve(mBuffer->fileRows.size() + cursors.size());
+
+	size_t c = 0;
+	for (size_t r = 0; r < mBuffer->fileRows.size(); ++r)
+	{
+		FileHandler::Row& row = mBuffer->fileRows[r];
+		if (c >= cursors.size() || cursors[c].fileCursorY != r)
+		{
+			rows.push_back(std::move(row));
+			continue;
+		}
+
+		size_t splitFrom = 0;
+		for (; c < cursors.size() && cursors[c].fileCursorY == r; ++c)
+		{
+			const size_t splitAt = cursors[c].fileCursorX;
+			FileHandler::Row piece;
+			piece.line = row.line.substr(splitFrom, splitAt - splitFrom);
+			rows.push_back(std::move(piece));
+			newCursors.emplace_back(0, rows.size(), cursors[c].primary);
+			splitFrom = splitAt;
+		}
+		FileHandler::Row rest;
+		rest.line = row.line.substr(splitFrom);
+		rows.push_back(std::move(rest));
+	}
+	mBuffer->fileRows = std::move(rows);
+}
+
+/// <summary>
+/// Starts a visual selection at the cursor
+/// </summary>
+/// <param name="type">Character (v), line (V) or block (Ctrl+V) selection</param>
+void Console::enableVisualMode(const Registers::SelectionType type)
+{
+	if (mBuffer->fileRows.empty()) return;
+	mView->selectionType = type;
+	mView->selectionAnchorX = mView->fileCursorX;
+	mView->selectionAnchorY = mView->fileCursorY;
+	mMode = Mode::VisualMode;
+}
+
+/// <summary>
+/// Gets the selection as a half-open range of file positions, [start, end).
+/// For block selections the X values are the left and right (exclusive) rendered columns of the block, as rows with tabs or wide characters
+/// have their characters at different positions. getBlockRange() finds the part of each row inside them
+/// </summary>
+void Console::getSelectionBounds(size_t& startX, size_t& startY, size_t& endX, size_t& endY)
+{
+	const size_t anchorX = mView->selectionAnchorX, anchorY = mView->selectionAnchorY;
+	const size_t cursorX = mView->fileCursorX, cursorY = mView->fileCursorY;
+	startY = std::min(anchorY, cursorY);
+	endY = std::max(anchorY, cursorY);
+
+	switch (mView->selectionType)
+	{
+	case Registers::SelectionType::Line:
+		startX = 0; endX = mBuffer->fileRows.at(endY).line.length();
+		break;
+	case Registers::SelectionType::Block:
+	{
+		const auto columns = [&](const size_t x, const size_t y, size_t& left, size_t& right) //The columns the character at (x, y) is drawn over
 			{
-				mHighlights.emplace_back(SyntaxHighlight::HighlightType::Comment, i, findPos + posOffset, i, row->renderedLine.length());
-				goto nextrow;
-			}
-			else
+				const Line& line = mBuffer->fileRows.at(y).line;
+				left = mBuffer->column(y, x);
+				right = x < line.length() ? mBuffer->column(y, Unicode::nextCharacter(line, x)) : left + 1;
+				right = std::max(right, left + 1);
+			};
+		size_t anchorLeft, anchorRight, cursorLeft, cursorRight;
+		columns(anchorX, anchorY, anchorLeft, anchorRight);
+		columns(cursorX, cursorY, cursorLeft, cursorRight);
+		startX = std::min(anchorLeft, cursorLeft); endX = std::max(anchorRight, cursorRight);
+		break;
+	}
+	case Registers::SelectionType::Character:
+	{
+		const auto pastCharacter = [&](const size_t x) //The selection includes the whole character at its end
 			{
-			nextword:
-				posOffset += findPos + 1;
-				currentWord = currentWord.substr(findPos + 1);
-				continue;
-			}
+				const Line& line = mBuffer->fileRows.at(endY).line;
+				return x < line.length() ? Unicode::nextCharacter(line, x) : x + 1;
+			};
+		if (anchorY < cursorY || (anchorY == cursorY && anchorX <= cursorX))
+		{
+			startX = anchorX; endX = pastCharacter(cursorX);
+		}
+		else
+		{
+			startX = cursorX; endX = pastCharacter(anchorX);
 		}
-		if (!currentWord.empty()) //If the last character in the string isn't a separator character/comment/string
+		if (endX > mBuffer->fileRows.at(endY).line.length()) //The selection includes the end of the row, so it takes the newline with it
 		{
-			if (currentWord.find_first_not_of("0123456789") == std::string::npos)
+			if (endY + 1 < mBuffer->fileRows.size())
 			{
-				mHighlights.emplace_back(SyntaxHighlight::HighlightType::Number, i, posOffset, i, posOffset + currentWord.length());
-				continue;
+				++endY; endX = 0;
 			}
 			else
 			{
-				for (const auto& type : mWindow->syntax->builtInTypeKeywords)
-				{
-					if (type == currentWord)
-					{
-						mHighlights.emplace_back(SyntaxHighlight::HighlightType::KeywordBuiltInType, i, posOffset, i, posOffset + currentWord.length());
-						goto nextrow;
-					}
-				}
-				for (const auto& control : mWindow->syntax->loopKeywords)
-				{
-					if (control == currentWord)
-					{
-						mHighlights.emplace_back(SyntaxHighlight::HighlightType::KeywordControl, i, posOffset, i, posOffset + currentWord.length());
-						goto nextrow;
-					}
-				}
-				for (const auto& other : mWindow->syntax->otherKeywords)
-				{
-					if (other == currentWord)
-					{
-						mHighlights.emplace_back(SyntaxHighlight::HighlightType::KeywordOther, i, posOffset, i, posOffset + currentWord.length());
-						goto nextrow;
-					}
-				}
+				endX = mBuffer->fileRows.at(endY).line.length();
 			}
-		nextrow: //Nothing left to do on this row
-			continue;
 		}
+		break;
+	}
 	}
 }
 
-//=================================================================== OS-SPECIFIC FUNCTIONS =============================================================================\\
-
-#ifdef _WIN32
-DWORD defaultMode;
-#elif defined(__linux__) || defined(__APPLE__)
-static termios defaultMode;
-#endif
-
 /// <summary>
-/// Initializes the window and all other dependencies
+/// Finds the part of a row inside a block selection's columns. A character only partly inside them is included
 /// </summary>
-/// <param name="fileName">The filename grabbed from argv[1]</param>
-void Console::initConsole(const std::string_view& fName)
+/// <param name="line"></param>
+/// <param name="leftColumn"></param>
+/// <param name="rightColumn">One past the last column of the block</param>
+/// <param name="fromX">Set to the first file position inside the block, or the row length if the row ends before it</param>
+/// <param name="toX">Set to one past the last file position inside the block</param>
+void Console::getBlockRange(const Line& line, const size_t leftColumn, const size_t rightColumn, size_t& fromX, size_t& toX)
 {
-	FileHandler::fileName(fName);
-	SyntaxHighlight::initSyntax(fName);
+	fromX = Unicode::indexAtColumn(line, leftColumn);
+	toX = rightColumn > leftColumn ? Unicode::nextCharacter(line, Unicode::indexAtColumn(line, rightColumn - 1)) : fromX;
+	toX = std::max(toX, fromX);
+}
 
-	mWindow = std::make_unique<Window>(Window());
-	setWindowSize();
+/// <summary>
+/// Redraws the visible part of the selection in inverse color mode over the rendered rows
+/// </summary>
+/// <param name="renderBuffer"></param>
+void Console::appendSelectionOverlay(std::string& renderBuffer)
+{
+	size_t startX, startY, endX, endY;
+	getSelectionBounds(startX, startY, endX, endY);
+	const bool block = mView->selectionType == Registers::SelectionType::Block;
 
-#ifdef _WIN32
-	if (!GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), &defaultMode)) //Try to get the default terminal settings
+	for (size_t y = std::max(startY, mView->rowOffset); y <= endY && y < mView->rowOffset + mView->rows; ++y)
 	{
-		std::cerr << "Error retrieving current console mode";
-		exit(EXIT_FAILURE);
+		const FileHandler::Row& row = mBuffer->fileRows.at(y);
+		size_t fromX = y == startY ? std::min(startX, row.line.length()) : 0;
+		size_t toX = y == endY ? std::min(endX, row.line.length()) : row.line.length();
+		if (block) getBlockRange(row.line, startX, endX, fromX, toX);
+		if (!block && y == endY && toX == 0 && y != startY) continue; //Only the newline of the previous row is selected
+
+		size_t renderedX = mBuffer->column(y, fromX);
+		size_t renderedEnd = mBuffer->column(y, toX);
+		const size_t rowColumns = toX == row.line.length() ? renderedEnd : mBuffer->column(y, row.line.length());
+		if (!block && y != endY) ++renderedEnd; //Show the selected newline
+		if (!mView->wrap)
+		{
+			renderedX = std::max(renderedX, mView->colOffset);
+			renderedEnd = std::min(renderedEnd, mView->colOffset + mView->cols);
+		}
+		if (renderedX >= renderedEnd) continue;
+
+		std::string text;
+		for (size_t from = renderedX; from < renderedEnd;) //A wrapped row is drawn a display line at a time
+		{
+			size_t screenY, screenX, lineEnd;
+			const bool visible = screenPosition(*mView, y, from, screenY, screenX, lineEnd);
+			const size_t to = std::min(renderedEnd, lineEnd);
+			if (to <= from) break;
+			if (visible)
+			{
+				renderColumns(*mBuffer, y, from, to - from, text);
+				if (to > rowColumns) text.append(to - std::max(from, rowColumns), ' '); //The newline
+				renderBuffer.append(std::format("\x1b[{};{}H\x1b[7m{}\x1b[0m", mView->top + screenY + 1, mView->left + screenX + 1, text));
+			}
+			from = to;
+		}
 	}
-#elif defined(__linux__) || defined(__APPLE__)
-	if (tcgetattr(STDOUT_FILENO, &defaultMode) == -1)
+}
+
+/// <summary>
+/// Copies the selection into a register and goes back to read mode
+/// </summary>
+/// <param name="registerName"></param>
+void Console::yankSelection(const char registerName)
+{
+	size_t startX, startY, endX, endY;
+	getSelectionBounds(startX, startY, endX, endY);
+	Memory::Scope memoryScope(Memory::Subsystem::Registers);
+
+	auto lines = std::make_shared<std::vector<Line>>();
+	lines->reserve(endY - startY + 1);
+	for (size_t y = startY; y <= endY; ++y)
 	{
-		std::cerr << "Error retrieving current console mode";
-		exit(EXIT_FAILURE);
+		const Line& line = mBuffer->fileRows.at(y).line;
+		switch (mView->selectionType)
+		{
+		case Registers::SelectionType::Line:
+			lines->push_back(line); //Unedited rows are copied as pointers into the file's text
+			break;
+		case Registers::SelectionType::Block:
+		{
+			size_t fromX, toX;
+			getBlockRange(line, startX, endX, fromX, toX);
+			lines->push_back(fromX < line.length() ? line.slice(fromX, toX - fromX) : Line());
+			break;
+		}
+		case Registers::SelectionType::Character:
+		{
+			const size_t fromX = y == startY ? startX : 0;
+			const size_t toX = y == endY ? endX : line.length();
+			lines->push_back(line.slice(fromX, toX - fromX));
+			break;
+		}
+		}
 	}
-	signal(SIGWINCH, nullptr);
-#endif
+	Registers::store(registerName, { mView->selectionType, std::move(lines), mBuffer->texts() });
 
-	if (!(mWindow->rawModeEnabled = enableRawInput())) //Try to enable raw mode
+	if (mView->selectionType == Registers::SelectionType::Block)
 	{
-		std::cerr << "Error enabling raw input mode";
-		exit(EXIT_FAILURE);
+		size_t toX;
+		getBlockRange(mBuffer->fileRows.at(startY).line, startX, endX, startX, toX); //Back to a file position
 	}
-
-	prepRenderedString();
+	mView->fileCursorX = mView->selectionType == Registers::SelectionType::Line ? mView->fileCursorX : startX;
+	mView->fileCursorY = startY;
+	clampCursor(*mView); //A line selection keeps the column, which the first row may be too short for
+	mView->updateSavedPos = true;
+	mMode = Mode::ReadMode;
 }
 
 /// <summary>
-/// Sets the window's row/column count
+/// Moves the selection into a register, removing it from the file, and goes back to read mode.
+/// Whole rows are erased in one go
 /// </summary>
-/// <param name="window"></param>
-/// <returns>True if size has changed, false otherwise</returns>
-bool Console::setWindowSize()
+/// <param name="registerName"></param>
+void Console::deleteSelection(const char registerName)
 {
-	const size_t prevRows = mWindow->rows;
-	const size_t prevCols = mWindow->cols;
-#ifdef _WIN32
-	CONSOLE_SCREEN_BUFFER_INFO screenInfo;
-	if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &screenInfo))
+	size_t startX, startY, endX, endY;
+	getSelectionBounds(startX, startY, endX, endY);
+	addUndoHistory();
+	mView->extraCursors.clear();
+
+	const auto rowsLock = lockRows();
+	std::vector<FileHandler::Row>& rows = mBuffer->fileRows;
+	const size_t oldRowCount = rows.size();
+	const bool block = mView->selectionType == Registers::SelectionType::Block;
+
+	auto lines = std::make_shared<std::vector<Line>>();
 	{
-		std::cerr << "Error getting console screen buffer info";
-		exit(EXIT_FAILURE);
+		Memory::Scope memoryScope(Memory::Subsystem::Registers); //Only the register's copy. The edited rows stay charged to the text
+		lines->reserve(endY - startY + 1);
+		for (size_t y = startY; y <= endY; ++y)
+		{
+			Line& line = rows[y].line;
+			size_t fromX = 0, toX = line.length();
+			if (block) getBlockRange(line, startX, endX, fromX, toX);
+			else if (mView->selectionType == Registers::SelectionType::Character)
+			{
+				fromX = y == startY ? startX : 0;
+				toX = y == endY ? endX : line.length();
+			}
+			const bool erased = mView->selectionType == Registers::SelectionType::Line || (!block && y > startY && y < endY);
+			if (erased) lines->push_back(std::move(line)); //Rows erased below are moved, not copied
+			else lines->push_back(fromX < line.length() ? line.slice(fromX, toX - fromX) : Line());
+		}
 	}
-	mWindow->rows = static_cast<size_t>(screenInfo.srWindow.Bottom - screenInfo.srWindow.Top) + 1;
-	mWindow->cols = static_cast<size_t>(screenInfo.srWindow.Right - screenInfo.srWindow.Left) + 1;
 
-#elif defined(__linux__) || defined(__APPLE__)
-	winsize ws;
-	int rows, cols;
-	if (ioctl(1, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) //If getting the window size from ioctl fails
+	switch (mView->selectionType)
 	{
-		std::cout.write("\x1b[999C\x1b[999B", 12); //Move to the bottom-right corner of the screen
-		std::cout.write("\x1b[6n", 4); //Report cursor position - Gets reported as ESC[rows;colsR
+	case Registers::SelectionType::Line:
+		rows.erase(rows.begin() + startY, rows.begin() + endY + 1);
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowsErased(startY, endY - startY + 1);
+		if (rows.empty()) //Keep one row for the cursor to be on
+		{
+			rows.push_back(FileHandler::Row());
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowInserted(0);
+		}
+		mView->fileCursorY = std::min(startY, rows.size() - 1);
+		mView->fileCursorX = 0;
+		break;
 
-		std::string buf; buf.resize(32);
-		uint8_t i = 0;
-		while (i < buf.size())
+	case Registers::SelectionType::Block:
+		for (size_t y = startY; y <= endY; ++y)
 		{
-			std::cin.read(buf.data(), 1);
-			if (buf[i] == 'R') break;
-			++i;
+			Line& line = rows[y].line;
+			size_t fromX, toX;
+			getBlockRange(line, startX, endX, fromX, toX);
+			if (fromX >= line.length()) continue;
+			line.erase(fromX, toX - fromX);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(y, fromX, fromX);
 		}
+		mView->fileCursorY = startY;
+		mView->fileCursorX = std::min(Unicode::indexAtColumn(rows[startY].line, startX), rows[startY].line.length());
+		break;
 
-		if (buf[0] != static_cast<uint8_t>(KeyActions::KeyAction::Esc) || buf[1] != '[')
+	case Registers::SelectionType::Character:
+		if (startY == endY)
 		{
-			std::cerr << "Error getting window size";
-			exit(EXIT_FAILURE);
+			rows[startY].line.erase(startX, endX - startX);
 		}
-		if (sscanf(buf.data() + 2, "%d;%d", &rows, &cols) != 2) //If the rows/cols data wasn't reported
+		else
 		{
-			std::cerr << "Error getting window size";
-			exit(EXIT_FAILURE);
+			rows[startY].line.erase(startX);
+			rows[startY].line.append(std::string_view(rows[endY].line).substr(endX));
+			rows.erase(rows.begin() + startY + 1, rows.begin() + endY + 1);
+			if (mBuffer->searchIndex) mBuffer->searchIndex->rowsErased(startY + 1, endY - startY);
 		}
-		mWindow->rows = rows; mWindow->cols = cols;
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(startY, startX, startX);
+		mView->fileCursorY = startY;
+		mView->fileCursorX = startX;
+		break;
 	}
-	else
+	Registers::store(registerName, { mView->selectionType, std::move(lines), mBuffer->texts() });
+
+	rowsEdited(startY, endY + 1, oldRowCount);
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, startY);
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
+	mMode = Mode::ReadMode;
+}
+
+/// <summary>
+/// Puts the contents of a register after (p) or before (P) the cursor as a single bulk insert and a single undo entry
+/// Linewise registers go below/above the cursor row, blockwise registers go in a column starting at the cursor
+/// </summary>
+/// <param name="registerName"></param>
+/// <param name="before">True for P, false for p</param>
+void Console::putRegister(const char registerName, const bool before)
+{
+	const Registers::Register* reg = Registers::load(registerName);
+	if (reg == nullptr || reg->lines->empty()) return;
+	const std::vector<Line>& lines = *reg->lines;
+
+	addUndoHistory();
+	mView->extraCursors.clear();
+	mBuffer->keepTexts(reg->texts); //The put rows may point into them
+	const auto rowsLock = lockRows();
+	std::vector<FileHandler::Row>& rows = mBuffer->fileRows;
+	const size_t oldRowCount = rows.size(), cursorRow = mView->fileCursorY;
+	if (rows.empty())
 	{
-		mWindow->cols = ws.ws_col;
-		mWindow->rows = ws.ws_row;
+		rows.push_back(FileHandler::Row());
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowInserted(0);
 	}
-#endif
-	constexpr uint8_t statusMessageRows = 2;
-	mWindow->rows -= statusMessageRows;
 
-	if (prevRows != mWindow->rows || prevCols != mWindow->cols) return true; //Checks if the window size has changed
+	const size_t rowLength = rows.at(mView->fileCursorY).line.length();
+	const size_t col = before ? mView->fileCursorX : std::min(Unicode::nextCharacter(rows.at(mView->fileCursorY).line, mView->fileCursorX), rowLength);
+	switch (reg->type)
+	{
+	case Registers::SelectionType::Line:
+	{
+		const size_t insertAt = before ? mView->fileCursorY : mView->fileCursorY + 1;
+		std::vector<FileHandler::Row> newRows(lines.size());
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			newRows[i].line = lines[i];
+		}
+		rows.insert(rows.begin() + insertAt, std::make_move_iterator(newRows.begin()), std::make_move_iterator(newRows.end()));
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowsInserted(insertAt, lines.size());
+		mView->fileCursorY = insertAt;
+		mView->fileCursorX = 0;
+		break;
+	}
+	case Registers::SelectionType::Block:
+		putBlock(lines, mView->fileCursorY, col);
+		mView->fileCursorX = col;
+		break;
+	case Registers::SelectionType::Character:
+		putCharacters(lines, mView->fileCursorY, col);
+		mView->fileCursorY += lines.size() - 1;
+		mView->fileCursorX = (lines.size() == 1 ? col : 0) + lines.back().length();
+		mView->fileCursorX = Unicode::previousCharacter(rows.at(mView->fileCursorY).line, mView->fileCursorX); //Like VIM, end up on the last put character
+		break;
+	}
 
-	return false;
+	rowsEdited(cursorRow, std::min(cursorRow + lines.size(), oldRowCount), oldRowCount);
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, mView->fileCursorY);
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
 }
 
 /// <summary>
-/// Enables raw input mode by disabling specific flags
+/// Inserts characterwise text at the given position. Rows in the middle of the text are inserted with a single vector insert.
+/// The search index lock must already be held
 /// </summary>
-/// <returns></returns>
-bool Console::enableRawInput()
+void Console::putCharacters(const std::vector<Line>& lines, const size_t row, const size_t col)
 {
-	if (mWindow->rawModeEnabled) return true;
-#ifdef _WIN32
-	DWORD rawMode = ENABLE_EXTENDED_FLAGS | (defaultMode & ~ENABLE_LINE_INPUT & ~ENABLE_PROCESSED_INPUT
-		& ~ENABLE_ECHO_INPUT & ~ENABLE_PROCESSED_OUTPUT & ~ENABLE_WRAP_AT_EOL_OUTPUT); //Disabling certain input/output modes to enable raw mode
+	std::vector<FileHandler::Row>& rows = mBuffer->fileRows;
+	Line& line = rows.at(row).line;
+	if (lines.size() == 1)
+	{
+		line.insert(col, lines.front());
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(row, col, col + lines.front().length());
+		return;
+	}
 
-	if (SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), rawMode))
+	std::vector<FileHandler::Row> newRows(lines.size() - 1);
+	for (size_t i = 1; i + 1 < lines.size(); ++i)
 	{
-		atexit(disableRawInput); //Make sure raw input mode gets disabled if the program exits due to an error
-		return true;
+		newRows[i - 1].line = lines[i];
 	}
-	return false;
-#elif defined(__linux__) || defined(__APPLE__)
-	termios raw;
-	raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
-	raw.c_oflag &= ~(OPOST);
-	raw.c_cflag |= (CS8);
-	raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
-	raw.c_cc[VMIN] = 0;
-	raw.c_cc[VTIME] = 1;
+	newRows.back().line = lines.back();
+	newRows.back().line.append(std::string_view(line).substr(col));
+	line.erase(col);
+	line.append(lines.front());
+	if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(row, col);
+
+	rows.insert(rows.begin() + row + 1, std::make_move_iterator(newRows.begin()), std::make_move_iterator(newRows.end()));
+	if (mBuffer->searchIndex) mBuffer->searchIndex->rowsInserted(row + 1, newRows.size());
+}
 
-	if (tcsetattr(STDOUT_FILENO, TCSAFLUSH, &raw) < 0)
+/// <summary>
+/// Inserts blockwise text as a column starting at the given position. Each row gets it at the rendered column the position is drawn at.
+/// Short rows are padded with spaces, and rows are added past the end of the file if needed.
+/// The search index lock must already be held
+/// </summary>
+void Console::putBlock(const std::vector<Line>& lines, const size_t row, const size_t col)
+{
+	std::vector<FileHandler::Row>& rows = mBuffer->fileRows;
+	const size_t renderedCol = row < rows.size() ? Unicode::column(rows[row].line, col) : col;
+	if (row + lines.size() > rows.size())
 	{
-		return false;
+		const size_t oldSize = rows.size();
+		rows.resize(row + lines.size());
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowsInserted(oldSize, rows.size() - oldSize);
+	}
+	for (size_t i = 0; i < lines.size(); ++i)
+	{
+		Line& line = rows[row + i].line;
+		const size_t rowColumns = Unicode::column(line, line.length());
+		if (rowColumns < renderedCol) line.append(std::string(renderedCol - rowColumns, ' '));
+		const size_t insertAt = Unicode::indexAtColumn(line, renderedCol);
+		line.insert(insertAt, lines[i]);
+		if (mBuffer->searchIndex) mBuffer->searchIndex->rowChanged(row + i, insertAt, insertAt + lines[i].length());
 	}
-	atexit(disableRawInput); //Make sure raw input mode gets disabled if the program exits due to an error
-	return true;
-#endif
 }
 
 /// <summary>
-/// Disabled raw input mode by setting the terminal back to the default mode
+/// Starts a batch of edits, such as a macro replay or a counted command.
+/// Until the matching endBatch(), nothing is rendered or highlighted and only the first edit adds an undo snapshot, so the whole batch is undone at once.
+/// Batches can be nested
 /// </summary>
-void Console::disableRawInput()
+void Console::beginBatch()
+{
+	++mBatchDepth;
+}
+
+/// <summary>
+/// Ends a batch of edits. Rendering resumes when the outermost batch ends
+/// </summary>
+void Console::endBatch()
+{
+	if (mBatchDepth == 0) return;
+	if (--mBatchDepth == 0)
+	{
+		mBatchHasSnapshot = false;
+	}
+}
+
+/// <summary>
+/// Returns true if the cursor is at (or past) the end of its row
+/// </summary>
+/// <returns></returns>
+bool Console::isCursorAtRowEnd()
 {
-#ifdef _WIN32
-	SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), defaultMode);
-#elif defined(__linux__) || defined(__APPLE__)
-	tcsetattr(STDOUT_FILENO, TCSAFLUSH, &defaultMode);
-#endif
-	mWindow->rawModeEnabled = false;
-}
\ No newline at end of file
+	return mBuffer->fileRows.empty() || mView->fileCursorX >= mBuffer->fileRows.at(mView->fileCursorY).line.length();
+}
+
+/// <summary>
+/// Sets a message shown in the status bar after the file name, such as the macro being recorded
+/// </summary>
+/// <param name="message"></param>
+void Console::setStatusMessage(const std::string_view& message)
+{
+	mStatusMessage = message;
+}
+
+/// <summary>
+/// Returns the row the cursor is on
+/// </summary>
+size_t Console::cursorRow()
+{
+	return mView->fileCursorY;
+}
+
+size_t Console::rowCount()
+{
+	return mBuffer->fileRows.size();
+}
+
+/// <summary>
+/// Moves the cursor to the start of a row
+/// </summary>
+/// <param name="row"></param>
+void Console::goToRow(const size_t row)
+{
+	if (mBuffer->fileRows.empty()) return;
+	mView->fileCursorY = std::min(row, mBuffer->fileRows.size() - 1);
+	mView->fileCursorX = 0;
+	mView->updateSavedPos = true;
+}
+
+/// <summary>
+/// Sets mark a-z to a row. Marks are row numbers, so they don't follow their row when rows above it are added or removed
+/// </summary>
+void Console::setMark(const char name, const size_t row)
+{
+	if (name < 'a' || name > 'z') return;
+	mBuffer->marks[name - 'a'] = row;
+}
+
+/// <summary>
+/// Gets the row of mark a-z
+/// </summary>
+/// <returns>False if the mark isn't set or its row no longer exists</returns>
+bool Console::getMark(const char name, size_t& row)
+{
+	if (name < 'a' || name > 'z') return false;
+	row = mBuffer->marks[name - 'a'];
+	return row < mBuffer->fileRows.size();
+}
+
+/// <summary>
+/// Finds the next/previous row containing a match, starting after/before startRow and wrapping around the file
+/// </summary>
+/// <returns>False if no row matches</returns>
+bool Console::findRow(const Search::Query& query, const size_t startRow, const bool forward, size_t& row)
+{
+	const size_t rowCount = mBuffer->fileRows.size();
+	for (size_t i = 1; i <= rowCount; ++i)
+	{
+		const size_t r = forward ? (startRow + i) % rowCount : (startRow + rowCount - i % rowCount) % rowCount;
+		size_t matchCol, matchLength;
+		if (Search::findInRow(query, mBuffer->fileRows[r].line, 0, matchCol, matchLength))
+		{
+			row = r;
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Marks every row from firstRow to lastRow that contains a match. This is the filter step of :g/:v.
+/// If the search index is built, only its candidate rows are run through the matcher
+/// </summary>
+/// <param name="selected">One flag per row. Matching rows are set to true, other rows are left alone</param>
+void Console::matchRows(const Search::Query& query, const size_t firstRow, const size_t lastRow, std::vector<bool>& selected)
+{
+	auto checkRow = [&](const size_t r)
+		{
+			size_t matchCol, matchLength;
+			if (Search::findInRow(query, mBuffer->fileRows[r].line, 0, matchCol, matchLength)) selected[r] = true;
+		};
+
+	std::vector<size_t> candidates;
+	if (mBuffer->searchIndex && mBuffer->searchIndex->candidateRows(query.requiredLiterals, candidates))
+	{
+		for (auto it = std::lower_bound(candidates.begin(), candidates.end(), firstRow); it != candidates.end() && *it <= lastRow; ++it)
+		{
+			checkRow(*it);
+		}
+		return;
+	}
+
+	for (size_t r = firstRow; r <= lastRow && r < mBuffer->fileRows.size(); ++r)
+	{
+		checkRow(r);
+	}
+}
+
+/// <summary>
+/// Deletes every selected row into a register as one linewise block.
+/// The remaining rows are compacted in place in a single pass, so deleting any number of rows moves each row at most once
+/// </summary>
+/// <param name="selected">One flag per row</param>
+/// <param name="registerName"></param>
+void Console::deleteRows(const std::vector<bool>& selected, const char registerName)
+{
+	std::vector<FileHandler::Row>& rows = mBuffer->fileRows;
+	const auto firstSelected = std::find(selected.begin(), selected.end(), true);
+	if (firstSelected == selected.end()) return;
+	const size_t firstRow = firstSelected - selected.begin();
+
+	addUndoHistory();
+	mView->extraCursors.clear();
+	if (mBuffer->searchIndex) mBuffer->searchIndex->stopBuild();
+
+	auto lines = std::make_shared<std::vector<Line>>();
+	auto rowsLock = lockRows();
+	{
+		Memory::Scope memoryScope(Memory::Subsystem::Registers); //Only the register itself. The kept rows stay charged to the text
+		for (size_t r = firstRow; r < rows.size(); ++r)
+		{
+			if (selected[r]) lines->push_back(std::move(rows[r].line)); //The row is dropped below, so its text is moved rather than copied
+		}
+	}
+	const size_t oldRowCount = rows.size();
+	size_t kept = firstRow;
+	for (size_t r = firstRow; r < rows.size(); ++r)
+	{
+		if (!selected[r]) rows[kept++] = std::move(rows[r]);
+	}
+	rows.erase(rows.begin() + kept, rows.end());
+	if (rows.empty()) rows.push_back(FileHandler::Row()); //Keep one row for the cursor to be on
+	rowsEdited(firstRow, oldRowCount, oldRowCount);
+	rowsLock.unlock();
+	Registers::store(registerName, { Registers::SelectionType::Line, std::move(lines), mBuffer->texts() });
+
+	if (mBuffer->searchIndex) mBuffer->searchIndex->rebuild();
+	mView->fileCursorY = std::min(firstRow, rows.size() - 1);
+	mView->fileCursorX = 0;
+	mBuffer->highlightDirtyRow = std::min(mBuffer->highlightDirtyRow, mView->fileCursorY);
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
+}
+
+/// <summary>
+/// Moves (:m) or copies (:t) every selected row so they end up together before row insertAt.
+/// Moved rows are taken out and the rest are compacted in one pass, then the block is inserted with a single vector insert
+/// </summary>
+/// <param name="selected">One flag per row</param>
+/// <param name="insertAt">The row the block goes in front of, in the numbering before the change. 0 is the top of the file, rowCount() is the end</param>
+/// <param name="copy">Copy the rows instead of moving them</param>
+/// <param name="reverse">Insert the block in reverse order, which is what moving the rows one at a time after a fixed row does</param>
+void Console::transferRows(const std::vector<bool>& selected, const size_t insertAt, const bool copy, const bool reverse)
+{
+	std::vector<FileHandler::Row>& rows = mBuffer->fileRows;
+	const auto firstSelected = std::find(selected.begin(), selected.end(), true);
+	if (firstSelected == selected.end() || insertAt > rows.size()) return;
+	const size_t firstRow = firstSelected - selected.begin();
+
+	addUndoHistory();
+	mView->extraCursors.clear();
+	if (mBuffer->searchIndex) mBuffer->searchIndex->stopBuild();
+
+	std::vector<FileHandler::Row> block;
+	size_t insertPos = insertAt; //Where the block goes once moved rows are taken out
+	auto rowsLock = lockRows();
+	const size_t oldRowCount = rows.size();
+	size_t kept = firstRow;
+	for (size_t r = firstRow; r < rows.size(); ++r)
+	{
+		if (!selected[r])
+		{
+			if (!copy) rows[kept] = std::move(rows[r]);
+			++kept;
+		}
+		else if (copy)
+		{
+			block.push_back(rows[r]);
+			++kept;
+		}
+		else
+		{
+			block.push_back(std::move(rows[r]));
+			if (r < insertAt) --insertPos;
+		}
+	}
+	rows.erase(rows.begin() + kept, rows.end());
+	if (reverse) std::reverse(block.begin(), block.end());
+	rows.insert(rows.begin() + insertPos, std::make_move_iterator(block.begin()), std::make_move_iterator(block.end()));
+	rowsEdited(std::min(firstRow, insertAt), oldRowCount, oldRowCount);
+	rowsLock.unlock();
+
+	if (mBuffer->searchIndex) mBuffer->searchIndex->rebuild();
+	mView->fileCursorY = insertPos + block.size() - 1; //Like VIM, end up on the last moved row
+	mView->fileCursorX = 0;
+	mBuffer->highlightDirtyRow = std::min({ mBuffer->highlightDirtyRow, firstRow, insertPos });
+	mBuffer->dirty = true;
+	mView->updateSavedPos = true;
+}
+
+/// <summary>
+/// Locks the active buffer's rows so the background highlighter and search index build don't read them while they are being edited
+/// </summary>
+/// <returns></returns>
+std::unique_lock<std::mutex> Console::lockRows()
+{
+	return std::unique_lock<std::mutex>(mBuffer->rowsMutex);
+}
+
+/// <summary>
+/// Opens a file in the active view. If the file is already open its buffer is shown instead of loading it again
+/// </summary>
+/// <param name="fileName"></param>
+void Console::openBuffer(const std::string_view& fileName)
+{
+	for (const std::shared_ptr<Buffer>& buffer : mBuffers)
+	{
+		if (buffer->fileName == fileName)
+		{
+			showBuffer(buffer);
+			return;
+		}
+	}
+	mBuffers.push_back(std::make_shared<Buffer>(fileName));
+	mWatcher->watch(fileName);
+	showBuffer(mBuffers.back());
+	if (mBuffers.back()->swapFound) reportSwapFiles();
+}
+
+/// <summary>
+/// Shows buffer number 'number' (1-based, as listed by :ls) in the active view
+/// </summary>
+/// <returns>False if there is no such buffer</returns>
+bool Console::switchBuffer(const size_t number)
+{
+	if (number == 0 || number > mBuffers.size()) return false;
+	showBuffer(mBuffers.at(number - 1));
+	return true;
+}
+
+/// <summary>
+/// Shows the next/previous buffer in the active view, wrapping around the buffer list
+/// </summary>
+/// <param name="forward"></param>
+void Console::cycleBuffer(const bool forward)
+{
+	size_t current = 0;
+	while (current < mBuffers.size() && mBuffers.at(current).get() != mBuffer) ++current;
+	const size_t next = forward ? (current + 1) % mBuffers.size() : (current + mBuffers.size() - 1) % mBuffers.size();
+	showBuffer(mBuffers.at(next));
+}
+
+/// <summary>
+/// Lists the open buffers for the status row, e.g. "[1] main.cpp* [2] notes.txt"
+/// The shown buffer is marked with '*', modified ones with '+'
+/// </summary>
+std::string Console::bufferList()
+{
+	std::string list;
+	for (size_t i = 0; i < mBuffers.size(); ++i)
+	{
+		const Buffer& buffer = *mBuffers.at(i);
+		if (!list.empty()) list.push_back(' ');
+		list.append(std::format("[{}] {}{}{}", i + 1, buffer.fileName, &buffer == mBuffer ? "*" : "", buffer.dirty ? "+" : ""));
+	}
+	return list;
+}
+
+/// <summary>
+/// Splits the active view in two. The new view takes the top/left half and gets focus
+/// </summary>
+/// <param name="vertical">True to put the views side by side, false to stack them</param>
+/// <param name="fileName">The file to show in the new view. If empty, the new view shows the same buffer at the same position</param>
+/// <returns>False if the view is too small to split</returns>
+bool Console::splitView(const bool vertical, const std::string_view& fileName)
+{
+	constexpr size_t minRows = 4, minCols = 3; //Each half needs at least one text row and its status row
+	if (vertical ? mView->cols < minCols : mView->rows + 1 < minRows) return false;
+
+	SplitNode* leaf = findLeaf(*mLayout, mView);
+	std::unique_ptr<View> newView = std::make_unique<View>(*mView);
+	newView->extraCursors.clear();
+
+	leaf->vertical = vertical;
+	leaf->second = std::make_unique<SplitNode>();
+	leaf->second->view = std::move(leaf->view);
+	leaf->second->parent = leaf;
+	leaf->first = std::make_unique<SplitNode>();
+	leaf->first->view = std::move(newView);
+	leaf->first->parent = leaf;
+
+	setActiveView(leaf->first->view.get());
+	if (!fileName.empty()) openBuffer(fileName);
+	layoutViews(*mLayout, 0, 0, mScreenRows - 1, mScreenCols);
+	return true;
+}
+
+/// <summary>
+/// Closes the active view. Closing the last view exits the editor
+/// </summary>
+/// <param name="force">Close even if unsaved changes would no longer be shown anywhere</param>
+/// <returns>False if the view wasn't closed because of unsaved changes</returns>
+bool Console::closeView(const bool force)
+{
+	SplitNode* leaf = findLeaf(*mLayout, mView);
+	if (leaf->parent == nullptr) return quitAll(force);
+
+	if (!force && mBuffer->dirty)
+	{
+		std::vector<View*> views;
+		collectViews(*mLayout, views);
+		if (std::count_if(views.begin(), views.end(), [](const View* view) { return view->buffer.get() == mBuffer; }) == 1) return false;
+	}
+
+	SplitNode* parent = leaf->parent;
+	std::unique_ptr<SplitNode> sibling = std::move(leaf == parent->first.get() ? parent->second : parent->first);
+	SplitNode* grandparent = parent->parent;
+	parent->view = std::move(sibling->view); //The parent takes the sibling's place, so the sibling's children are moved up into it
+	parent->first = std::move(sibling->first);
+	parent->second = std::move(sibling->second);
+	parent->vertical = sibling->vertical;
+	parent->parent = grandparent;
+	if (parent->first) parent->first->parent = parent;
+	if (parent->second) parent->second->parent = parent;
+
+	SplitNode* node = parent;
+	while (!node->view) node = node->first.get();
+	setActiveView(node->view.get());
+	layoutViews(*mLayout, 0, 0, mScreenRows - 1, mScreenCols);
+	return true;
+}
+
+/// <summary>
+/// Exits the editor
+/// </summary>
+/// <param name="force">Exit even if a buffer has unsaved changes</param>
+/// <returns>False if a buffer has unsaved changes and force isn't set</returns>
+bool Console::quitAll(const bool force)
+{
+	if (!force)
+	{
+		for (const std::shared_ptr<Buffer>& buffer : mBuffers)
+		{
+			if (buffer->dirty) return false;
+		}
+	}
+	mMode = Mode::ExitMode;
+	return true;
+}
+
+/// <summary>
+/// Moves focus to the next/previous view in layout order, wrapping around
+/// </summary>
+/// <param name="forward"></param>
+void Console::focusNextView(const bool forward)
+{
+	std::vector<View*> views;
+	collectViews(*mLayout, views);
+	const size_t current = std::find(views.begin(), views.end(), mView) - views.begin();
+	setActiveView(views.at(forward ? (current + 1) % views.size() : (current + views.size() - 1) % views.size()));
+}
+
+/// <summary>
+/// Moves focus to the closest view in a direction (h/j/k/l, or the arrow keys)
+/// </summary>
+/// <param name="direction"></param>
+void Console::focusViewInDirection(const KeyActions::KeyAction direction)
+{
+	std::vector<View*> views;
+	collectViews(*mLayout, views);
+
+	const size_t cursorY = mView->top + mView->renderedCursorY, cursorX = mView->left + mView->renderedCursorX;
+	View* best = nullptr;
+	size_t bestDistance = SIZE_MAX;
+	for (View* view : views)
+	{
+		bool inDirection = false;
+		size_t distance = 0;
+		switch (direction)
+		{
+		case static_cast<KeyActions::KeyAction>('h'):
+		case KeyActions::KeyAction::ArrowLeft:
+			inDirection = view->left + view->cols <= mView->left && cursorY >= view->top && cursorY <= view->top + view->rows;
+			distance = mView->left - view->left;
+			break;
+		case static_cast<KeyActions::KeyAction>('l'):
+		case KeyActions::KeyAction::ArrowRight:
+			inDirection = view->left >= mView->left + mView->cols && cursorY >= view->top && cursorY <= view->top + view->rows;
+			distance = view->left - mView->left;
+			break;
+		case static_cast<KeyActions::KeyAction>('k'):
+		case KeyActions::KeyAction::ArrowUp:
+			inDirection = view->top + view->rows < mView->top && cursorX >= view->left && cursorX < view->left + view->cols;
+			distance = mView->top - view->top;
+			break;
+		case static_cast<KeyActions::KeyAction>('j'):
+		case KeyActions::KeyAction::ArrowDown:
+			inDirection = view->top > mView->top + mView->rows && cursorX >= view->left && cursorX < view->left + view->cols;
+			distance = view->top - mView->top;
+			break;
+		default:
+			return;
+		}
+		if (inDirection && distance < bestDistance)
+		{
+			best = view;
+			bestDistance = distance;
+		}
+	}
+	if (best != nullptr) setActiveView(best);
+}
+
+/// <summary>
+/// Makes a view the one input goes to
+/// </summary>
+void Console::setActiveView(View* view)
+{
+	mView = view;
+	mBuffer = view->buffer.get();
+	clampCursor(*mView);
+}
+
+/// <summary>
+/// Turns soft wrapping of the active view on or off. While it is on, rows longer than the view continue on the screen rows below
+/// instead of being scrolled sideways
+/// </summary>
+void Console::setWrap(const bool wrap)
+{
+	if (wrap == isWrapping()) return;
+	if (wrap) mView->wrap.emplace(); //Built when the view is next drawn
+	else mView->wrap.reset();
+	mView->colOffset = 0;
+	mView->wrapOffset = 0;
+	mView->drawnValid = false;
+}
+
+bool Console::isWrapping()
+{
+	return mView->wrap.has_value();
+}
+
+/// <summary>
+/// Shows or hides the column in front of every view that marks the rows added (+), changed (~) or deleted (_) since the file was loaded or saved
+/// </summary>
+void Console::setGutter(const bool show)
+{
+	if (show == mShowGutter) return;
+	mShowGutter = show;
+	constexpr uint8_t commandRows = 1;
+	layoutViews(*mLayout, 0, 0, mScreenRows - commandRows, mScreenCols);
+}
+
+bool Console::isShowingGutter()
+{
+	return mShowGutter;
+}
+
+/// <summary>
+/// Shows a buffer in the active view. The view's position in the old buffer is kept so switching back restores it
+/// </summary>
+/// <param name="buffer"></param>
+void Console::showBuffer(const std::shared_ptr<Buffer>& buffer)
+{
+	if (buffer.get() == mBuffer) return;
+	mBuffer->lastCursorX = mView->fileCursorX;
+	mBuffer->lastCursorY = mView->fileCursorY;
+	mBuffer->lastRowOffset = mView->rowOffset;
+
+	mView->buffer = buffer;
+	mView->fileCursorX = buffer->lastCursorX;
+	mView->fileCursorY = buffer->lastCursorY;
+	mView->rowOffset = buffer->lastRowOffset;
+	mView->colOffset = 0;
+	mView->wrapOffset = 0;
+	if (mView->wrap) mView->wrap->clear(); //Built again for the new buffer's rows
+	mView->updateSavedPos = true;
+	mView->extraCursors.clear();
+	setActiveView(mView);
+}
+
+/// <summary>
+/// Keeps a view's cursor inside its buffer, which may have been shortened through another view
+/// </summary>
+/// <param name="view"></param>
+void Console::clampCursor(View& view)
+{
+	const std::vector<FileHandler::Row>& fileRows = view.buffer->fileRows;
+	if (fileRows.empty())
+	{
+		view.fileCursorX = view.fileCursorY = view.rowOffset = 0;
+		return;
+	}
+	if (view.fileCursorY >= fileRows.size()) view.fileCursorY = fileRows.size() - 1;
+	if (view.fileCursorX > fileRows.at(view.fileCursorY).line.length()) view.fileCursorX = fileRows.at(view.fileCursorY).line.length();
+	if (view.rowOffset > view.fileCursorY) view.rowOffset = view.fileCursorY;
+}
+
+/// <summary>
+/// Gives each view in the layout its part of the screen
+/// Vertical splits put a one column separator between the two halves
+/// </summary>
+/// <param name="node"></param>
+/// <param name="top"></param>
+/// <param name="left"></param>
+/// <param name="height">The height including each view's status row</param>
+/// <param name="width"></param>
+void Console::layoutViews(SplitNode& node, const size_t top, const size_t left, const size_t height, const size_t width)
+{
+	if (node.view)
+	{
+		node.view->top = top;
+		node.view->gutter = mShowGutter && width > 1 ? 1 : 0;
+		node.view->left = left + node.view->gutter;
+		node.view->rows = height > 1 ? height - 1 : 1;
+		node.view->cols = width > node.view->gutter ? width - node.view->gutter : 1;
+		node.view->drawnValid = false;
+		return;
+	}
+	if (node.vertical)
+	{
+		const size_t available = width > 0 ? width - 1 : 0; //One column goes to the separator
+		const size_t firstWidth = available - available / 2;
+		layoutViews(*node.first, top, left, height, firstWidth);
+		layoutViews(*node.second, top, left + firstWidth + 1, height, available / 2);
+	}
+	else
+	{
+		const size_t firstHeight = height - height / 2;
+		layoutViews(*node.first, top, left, firstHeight, width);
+		layoutViews(*node.second, top + firstHeight, left, height / 2, width);
+	}
+}
+
+/// <summary>
+/// Finds the layout leaf holding a view
+/// </summary>
+/// <returns>nullptr if the view isn't in the layout</returns>
+Console::SplitNode* Console::findLeaf(SplitNode& node, const View* view)
+{
+	if (node.view) return node.view.get() == view ? &node : nullptr;
+	SplitNode* leaf = findLeaf(*node.first, view);
+	return leaf != nullptr ? leaf : findLeaf(*node.second, view);
+}
+
+/// <summary>
+/// Collects every view in layout order (top/left first)
+/// </summary>
+void Console::collectViews(SplitNode& node, std::vector<View*>& views)
+{
+	if (node.view)
+	{
+		views.push_back(node.view.get());
+		return;
+	}
+	collectViews(*node.first, views);
+	collectViews(*node.second, views);
+}
+
+/// <summary>
+/// Deletes a row when the last character in the row is removed
+/// The search index lock must already be held
+/// </summary>
+/// <param name="rowNum"></param>
+void Console::deleteRow(const size_t rowNum)
+{
+	if (rowNum > mBuffer->fileRows.size()) return;
+	mBuffer->fileRows.erase(mBuffer->fileRows.begin() + rowNum);
+	if (mBuffer->searchIndex) mBuffer->searchIndex->rowErased(rowNum);
+	mBuffer->dirty = true;
+}
+
+/// <summary>
+/// Records an edit to the active buffer for the wrap indexes of its views: rows [first, end) were changed, and rows added or removed
+/// among them took the row count from oldRowCount to what it is now
+/// </summary>
+void Console::rowsEdited(const size_t first, const size_t end, const size_t oldRowCount)
+{
+	mBuffer->rowsReplaced(first, end - first, end - first + mBuffer->fileRows.size() - oldRowCount);
+}
+
+/// <summary>
+/// Adds a read from a followed file to its buffer. The first row read finishes the buffer's last row, as the file may have been read
+/// in the middle of a line. Views whose cursor was on the last row move to the new last row, so they scroll along with the file like tail -f,
+/// except the active view while it is being edited. A read from the start of a truncated or replaced file replaces the rows instead,
+/// unless the buffer has changes that would be lost, in which case following stops
+/// </summary>
+void Console::appendRows(Buffer& buffer, Follower::Appended& appended)
+{
+	TRACE_SCOPE("appendRows");
+	Memory::Scope memoryScope(Memory::Subsystem::Text);
+	std::vector<View*> views;
+	collectViews(*mLayout, views);
+
+	if (appended.reload)
+	{
+		if (buffer.dirty)
+		{
+			buffer.follower.reset();
+			setStatusMessage(std::format("{} was truncated or replaced. Stopped following it, as the buffer has changes", buffer.fileName));
+			return;
+		}
+		if (buffer.searchIndex) buffer.searchIndex->stopBuild();
+		{
+			const std::lock_guard<std::mutex> rowsLock(buffer.rowsMutex);
+			buffer.rowsReplaced(0, buffer.fileRows.size(), appended.rows.size());
+			buffer.fileRows = std::move(appended.rows);
+		}
+		if (buffer.undoHistory.empty() && buffer.redoHistory.empty()) buffer.loadedText.clear(); //No rows point into the earlier reads any more
+		buffer.loadedText.push_back(std::move(appended.text));
+		buffer.lineChanges.reset(*buffer.loadedText.back());
+		buffer.changedRows = EditedRows();
+		buffer.fileBytes = appended.end;
+		buffer.highlightDirtyRow = 0; //The rows were replaced wholesale
+		for (View* view : views)
+		{
+			if (view->buffer.get() != &buffer) continue;
+			view->extraCursors.clear();
+			view->wrapOffset = 0;
+			clampCursor(*view);
+		}
+		if (buffer.searchIndex) buffer.searchIndex->rebuild();
+		return;
+	}
+
+	const size_t oldRowCount = buffer.fileRows.size();
+	const size_t lastRow = oldRowCount > 0 ? oldRowCount - 1 : 0;
+	{
+		const std::lock_guard<std::mutex> rowsLock(buffer.rowsMutex);
+		if (oldRowCount == 0)
+		{
+			buffer.rowsReplaced(0, 0, appended.rows.size());
+			buffer.fileRows = std::move(appended.rows);
+			if (buffer.searchIndex) buffer.searchIndex->rowsAppended(buffer.fileRows.size());
+		}
+		else
+		{
+			Line& line = buffer.fileRows.back().line;
+			const size_t oldLength = line.length();
+			if (line.empty()) line = std::move(appended.rows.front().line); //Nothing to join, so it points into the read like the rows after it
+			else line.append(appended.rows.front().line);
+			buffer.rowsReplaced(lastRow, 1, appended.rows.size());
+			buffer.fileRows.insert(buffer.fileRows.end(), std::make_move_iterator(appended.rows.begin() + 1), std::make_move_iterator(appended.rows.end()));
+			if (buffer.searchIndex)
+			{
+				buffer.searchIndex->rowChanged(lastRow, oldLength);
+				buffer.searchIndex->rowsAppended(appended.rows.size() - 1);
+			}
+		}
+	}
+	buffer.loadedText.push_back(std::move(appended.text));
+	buffer.fileBytes = appended.end;
+	buffer.highlightDirtyRow = std::min(buffer.highlightDirtyRow, lastRow);
+	for (View* view : views)
+	{
+		if (view->buffer.get() != &buffer || view->fileCursorY + 1 < oldRowCount || (view == mView && mMode != Mode::ReadMode)) continue;
+		view->fileCursorY = buffer.fileRows.size() - 1;
+		view->fileCursorX = 0;
+	}
+}
+
+/// <summary>
+/// Reloads a buffer whose file another program changed. Only the hunks that differ are replaced, as one edit that undo takes back,
+/// so the rows around them keep their highlighting and the cursors and marks stay on the same lines. A buffer with changes isn't
+/// reloaded, as they would be lost. It is marked instead, so :w doesn't save over what the other program wrote
+/// </summary>
+/// <returns>True if the buffer or the status message changed</returns>
+bool Console::reloadChangedFile(Buffer& buffer)
+{
+	if (buffer.follower || buffer.changedOnDisk) return false; //A followed file is read as it changes
+	FileHandler::FileStamp stamp;
+	std::unique_ptr<std::string> text;
+	if (!buffer.fileChanged(stamp, text)) return false;
+	if (buffer.dirty)
+	{
+		buffer.changedOnDisk = true;
+		setStatusMessage(std::format("{} was changed by another program. :w! saves over it", buffer.fileName));
+		return true;
+	}
+
+	TRACE_SCOPE("reloadChangedFile");
+	Memory::Scope memoryScope(Memory::Subsystem::Text);
+	buffer.diskStamp = stamp;
+	buffer.diskHash = FileHandler::hashText(*text);
+	std::vector<FileHandler::Row> rows = FileHandler::loadRows(*text);
+	std::vector<FileHandler::Row>& fileRows = buffer.fileRows;
+
+	//Only the rows between the first and last difference are hashed and searched
+	size_t prefix = 0, suffix = 0;
+	while (prefix < fileRows.size() && prefix < rows.size() && fileRows[prefix].line == rows[prefix].line) ++prefix;
+	while (suffix < std::min(fileRows.size(), rows.size()) - prefix && fileRows[fileRows.size() - 1 - suffix].line == rows[rows.size() - 1 - suffix].line) ++suffix;
+	std::vector<uint64_t> oldLines, newLines;
+	for (size_t r = prefix; r < fileRows.size() - suffix; ++r) oldLines.push_back(Diff::hashLine(fileRows[r].line));
+	for (size_t r = prefix; r < rows.size() - suffix; ++r) newLines.push_back(Diff::hashLine(rows[r].line));
+	std::vector<Diff::Hunk> hunks = Diff::compare(oldLines, newLines);
+	if (hunks.empty()) return false;
+	for (Diff::Hunk& hunk : hunks)
+	{
+		hunk.oldStart += prefix;
+		hunk.newStart += prefix;
+	}
+
+	{
+		Memory::Scope undoMemory(Memory::Subsystem::Undo);
+		const bool active = &buffer == mBuffer;
+		buffer.undoHistory.push(FileHistory{ fileRows, active ? mView->fileCursorX : buffer.lastCursorX, active ? mView->fileCursorY : buffer.lastCursorY,
+			active ? mView->colOffset : 0, active ? mView->rowOffset : buffer.lastRowOffset });
+		buffer.redoHistory = std::stack<FileHistory>();
+	}
+	{
+		const std::lock_guard<std::mutex> rowsLock(buffer.rowsMutex);
+		std::vector<FileHandler::Row> reloaded;
+		reloaded.reserve(rows.size());
+		size_t oldRow = 0;
+		for (const Diff::Hunk& hunk : hunks) //The rows between hunks are kept, with whatever they have cached
+		{
+			reloaded.insert(reloaded.end(), std::make_move_iterator(fileRows.begin() + oldRow), std::make_move_iterator(fileRows.begin() + hunk.oldStart));
+			reloaded.insert(reloaded.end(), std::make_move_iterator(rows.begin() + hunk.newStart), std::make_move_iterator(rows.begin() + hunk.newStart + hunk.newCount));
+			oldRow = hunk.oldStart + hunk.oldCount;
+		}
+		reloaded.insert(reloaded.end(), std::make_move_iterator(fileRows.begin() + oldRow), std::make_move_iterator(fileRows.end()));
+		fileRows = std::move(reloaded);
+
+		for (const Diff::Hunk& hunk : hunks) //In order, each hunk starts at newStart once the ones before it are applied
+		{
+			buffer.rowsReplaced(hunk.newStart, hunk.oldCount, hunk.newCount);
+			if (!buffer.searchIndex) continue;
+			buffer.searchIndex->rowsErased(hunk.newStart, hunk.oldCount);
+			buffer.searchIndex->rowsInserted(hunk.newStart, hunk.newCount);
+		}
+	}
+	buffer.loadedText.push_back(std::move(text));
+	buffer.lineChanges.reset(*buffer.loadedText.back());
+	buffer.changedRows = EditedRows();
+	if (buffer.journal) buffer.journal->restart(buffer.diskStamp);
+	buffer.journalRows = EditedRows();
+	buffer.highlightDirtyRow = std::min(buffer.highlightDirtyRow, hunks.front().newStart);
+
+	//Rows after a hunk move by how many rows it added or removed. Rows in a hunk go to the same row of what replaced it, or its last row
+	const auto moveRow = [&hunks](size_t& row)
+	{
+		const Diff::Hunk* before = nullptr;
+		for (const Diff::Hunk& hunk : hunks)
+		{
+			if (row < hunk.oldStart) break;
+			if (row < hunk.oldStart + hunk.oldCount)
+			{
+				row = hunk.newStart + std::min(row - hunk.oldStart, hunk.newCount > 0 ? hunk.newCount - 1 : 0);
+				return;
+			}
+			before = &hunk;
+		}
+		if (before != nullptr) row = row - (before->oldStart + before->oldCount) + before->newStart + before->newCount;
+	};
+	std::vector<View*> views;
+	collectViews(*mLayout, views);
+	for (View* view : views)
+	{
+		if (view->buffer.get() != &buffer) continue;
+		moveRow(view->fileCursorY);
+		moveRow(view->rowOffset);
+		view->wrapOffset = 0;
+		view->extraCursors.clear();
+		clampCursor(*view);
+	}
+	moveRow(buffer.lastCursorY);
+	moveRow(buffer.lastRowOffset);
+	for (size_t& mark : buffer.marks)
+	{
+		if (mark != SIZE_MAX) moveRow(mark);
+	}
+	setStatusMessage(std::format("{} was changed by another program and has been reloaded", buffer.fileName));
+	return true;
+}
+
+/// <summary>
+/// Brings the wrap indexes of every view of a view's buffer up to date with the rows edited since they were last updated,
+/// and wraps this view's index at the view's current width
+/// </summary>
+void Console::updateWrap(View& view)
+{
+	Buffer& buffer = *view.buffer;
+	if (!buffer.editedRows.empty())
+	{
+		std::vector<View*> views;
+		collectViews(*mLayout, views);
+		for (View* other : views)
+		{
+			if (other->buffer.get() == &buffer && other->wrap) other->wrap->update(buffer.fileRows, buffer.editedRows.first, buffer.editedRows.oldEnd, buffer.editedRows.newEnd);
+		}
+		buffer.editedRows = EditedRows();
+	}
+	if (!view.wrap) return;
+	if (view.wrap->rowCount() != buffer.fileRows.size()) view.wrap->build(buffer.fileRows, view.cols); //Wrapping was just turned on, or the view shows another buffer
+	else view.wrap->resize(buffer.fileRows, view.cols);
+}
+
+/// <summary>
+/// The first display line a view shows. Without wrapping this is the row offset
+/// </summary>
+size_t Console::topLine(const View& view)
+{
+	if (!view.wrap) return view.rowOffset;
+	return view.wrap->linesBefore(view.rowOffset) + std::min(view.wrapOffset, view.wrap->rowLines(view.rowOffset) - 1);
+}
+
+/// <summary>
+/// Finds which of a wrapped row's display lines a column is drawn on
+/// </summary>
+/// <param name="view">A wrapping view, whose index is up to date</param>
+/// <param name="row"></param>
+/// <param name="column">A column of the row, up to its end</param>
+/// <param name="start">Set to the column the display line starts at</param>
+/// <param name="end">Set to the column the next display line starts at</param>
+/// <returns>The display line, counted from the row's first</returns>
+size_t Console::wrapLine(const View& view, const size_t row, const size_t column, size_t& start, size_t& end)
+{
+	const Line& line = view.buffer->fileRows.at(row).line;
+	size_t part;
+	if (line.isAscii()) //Every display line but the last is full
+	{
+		part = std::min(column / view.cols, view.wrap->rowLines(row) - 1);
+		start = part * view.cols;
+		end = start + view.cols;
+		return part;
+	}
+	std::vector<size_t> starts;
+	Unicode::wrapStarts(line, view.cols, starts);
+	part = std::upper_bound(starts.begin(), starts.end(), column) - starts.begin() - 1;
+	start = starts[part];
+	end = part + 1 < starts.size() ? starts[part + 1] : start + view.cols;
+	return part;
+}
+
+/// <summary>
+/// Finds where a column of a row is drawn in a view
+/// </summary>
+/// <param name="screenY">Set to the screen row, counted from the top of the view</param>
+/// <param name="screenX">Set to the screen column, counted from the left of the view</param>
+/// <param name="lineEnd">Set to the column of the row the screen row ends at, even if the column isn't shown</param>
+/// <returns>False if the column is outside the view</returns>
+bool Console::screenPosition(const View& view, const size_t row, const size_t column, size_t& screenY, size_t& screenX, size_t& lineEnd)
+{
+	if (!view.wrap)
+	{
+		lineEnd = view.colOffset + view.cols;
+		if (row < view.rowOffset || row - view.rowOffset >= view.rows || column < view.colOffset || column >= lineEnd) return false;
+		screenY = row - view.rowOffset;
+		screenX = column - view.colOffset;
+		return true;
+	}
+
+	size_t start;
+	const size_t line = view.wrap->linesBefore(row) + wrapLine(view, row, column, start, lineEnd);
+	const size_t top = topLine(view);
+	if (line < top || line - top >= view.rows || column - start >= view.cols) return false;
+	screenY = line - top;
+	screenX = column - start;
+	return true;
+}
+
+/// <summary>
+/// Finds the display line the cursor of a wrapping view is on
+/// </summary>
+/// <param name="x">Set to the cursor's column in the display line</param>
+size_t Console::cursorLine(View& view, size_t& x)
+{
+	updateWrap(view);
+	const size_t column = view.buffer->column(view.fileCursorY, view.fileCursorX);
+	size_t start, end;
+	const size_t part = wrapLine(view, view.fileCursorY, column, start, end);
+	x = column - start;
+	return view.wrap->linesBefore(view.fileCursorY) + part;
+}
+
+/// <summary>
+/// Puts the cursor of a wrapping view on a display line, at column x of it or at the end of the line if it is shorter
+/// </summary>
+void Console::moveCursorToLine(View& view, const size_t line, const size_t x)
+{
+	size_t part;
+	view.fileCursorY = view.wrap->rowAtLine(line, part);
+	const Line& text = view.buffer->fileRows.at(view.fileCursorY).line;
+	size_t start = part * view.cols, end = start + view.cols;
+	if (!text.isAscii())
+	{
+		std::vector<size_t> starts;
+		Unicode::wrapStarts(text, view.cols, starts);
+		start = starts[std::min(part, starts.size() - 1)];
+		end = part + 1 < starts.size() ? starts[part + 1] : start + view.cols;
+	}
+	view.fileCursorX = view.buffer->indexAtColumn(view.fileCursorY, std::min(start + x, end - 1));
+	if (view.fileCursorX > 0 && view.fileCursorX < text.length() && view.buffer->column(view.fileCursorY, view.fileCursorX) >= end) //A wide character moved down to the next line
+	{
+		view.fileCursorX = Unicode::previousCharacter(text, view.fileCursorX);
+	}
+}
+
+/// <summary>
+/// Allows for smooth movement of the cursor when moving up/down
+/// Compares the last value since the cursor was moved left/right (either by inserting/deleting character or moving left/right manually)
+/// Finds the closest position to the last saved value without going past it
+/// </summary>
+void Console::setCursorLinePosition()
+{
+	//Measured from the row itself rather than renderedLine, which only changes when a frame is drawn
+	const FileHandler::Row& row = mBuffer->fileRows.at(mView->fileCursorY);
+	if (!mView->wrap && mView->renderedCursorX + mView->colOffset > mBuffer->column(mView->fileCursorY, row.line.length()))
+	{
+		mView->fileCursorX = row.line.length();
+		return;
+	}
+	mView->fileCursorX = mBuffer->indexAtColumn(mView->fileCursorY, mView->savedRenderedCursorXPos);
+}
+
+/// <summary>
+/// Fixes the rendered cursor x/y and row/column offset positions
+/// </summary>
+/// <param name="view">The view whose cursor is being fixed</param>
+void Console::fixRenderedCursorPosition(View& view)
+{
+	const FileHandler::Row& row = view.buffer->fileRows.at(view.fileCursorY);
+	//Moves that keep the file position while changing rows (page up/down, undo, edits through other views) can leave it inside a character
+	if (!row.line.isAscii()) view.fileCursorX = Unicode::characterStart(row.line, view.fileCursorX);
+	if (view.wrap) //Rows are never scrolled sideways. The view scrolls by display lines instead, just far enough to show the cursor's
+	{
+		view.colOffset = 0;
+		size_t x;
+		const size_t line = cursorLine(view, x);
+		view.colNumberToDisplay = view.buffer->column(view.fileCursorY, view.fileCursorX);
+		view.renderedCursorX = std::min(x, view.cols - 1); //The end of a row that fills its last line is drawn on that line's last column
+
+		size_t top = topLine(view);
+		if (line < top) top = line;
+		else if (line - top >= view.rows) top = line - view.rows + 1;
+		view.rowOffset = view.wrap->rowAtLine(top, view.wrapOffset);
+		view.renderedCursorY = line - top;
+		if (view.updateSavedPos)
+		{
+			view.savedRenderedCursorXPos = view.colNumberToDisplay; //Moving up/down a row keeps the column in the row
+			view.updateSavedPos = false;
+		}
+		return;
+	}
+	//Fixing rendered X/Col position
+	view.renderedCursorX = view.buffer->column(view.fileCursorY, view.fileCursorX);
+	view.colNumberToDisplay = view.renderedCursorX;
+
+	//A wide character under the cursor has to fit in the view, not just its first column
+	size_t lastCursorColumn = view.renderedCursorX;
+	if (view.fileCursorX < row.line.length() && !row.line.isAscii())
+	{
+		const size_t width = Unicode::characterWidth(row.line, view.fileCursorX, Unicode::nextCharacter(row.line, view.fileCursorX));
+		if (width > 1) lastCursorColumn += width - 1;
+	}
+	if (lastCursorColumn - view.colOffset >= view.cols && view.renderedCursorX >= view.colOffset) //Scrolled in one step, as the cursor may be millions of columns along a long row
+	{
+		view.colOffset = std::min(lastCursorColumn - view.cols + 1, view.renderedCursorX);
+	}
+	if (view.renderedCursorX < view.colOffset)
+	{
+		view.colOffset = view.renderedCursorX;
+	}
+	view.renderedCursorX = view.renderedCursorX - view.colOffset;
+	if (view.renderedCursorX == view.cols)
+	{
+		--view.renderedCursorX;
+	}
+	//Fixing rendered Y/Row position
+	while (view.fileCursorY - view.rowOffset >= view.rows && view.fileCursorY >= view.rowOffset)
+	{
+		++view.rowOffset;
+	}
+	while (view.fileCursorY < view.rowOffset)
+	{
+		--view.rowOffset;
+	}
+	view.renderedCursorY = view.fileCursorY - view.rowOffset;
+
+	if (view.renderedCursorY == view.rows) //renderedCursorY might be 1 too many rows down, so just bring it back one row if it is
+	{
+		--view.renderedCursorY;
+	}
+
+	if (view.updateSavedPos)
+	{
+		view.savedRenderedCursorXPos = view.renderedCursorX;
+		view.updateSavedPos = false;
+	}
+}
+
+
+/// <summary>
+/// Sets the rendered color of the view's rows based on what setHighlight() does
+/// </summary>
+/// <param name="view">The view being drawn</param>
+/// <param name="lines">The view's screen rows, already cut down to the columns they show</param>
+/// <param name="lineRows">The file row each screen row is a part of</param>
+/// <param name="clips">Where each screen row was cut from its file row</param>
+void Console::updateRenderedColor(View& view, std::vector<std::string>& lines, const std::vector<size_t>& lineRows, const std::vector<Unicode::Clip>& clips)
+{
+	TRACE_SCOPE("updateRenderedColor");
+	Buffer& buffer = *view.buffer;
+	const std::string_view normalColorMode = "\x1b[0m";
+	std::vector<size_t> charactersToAdjust(lines.size(), 0); //The amount of characters to adjust for in each line's positions based on how many color code escape sequences have been added
+	size_t firstLine = 0;
+	for (const auto& highlight : buffer.highlights) //Every highlight is on a single row, in row and column order
+	{
+		while (firstLine < lines.size() && lineRows[firstLine] < highlight.startRow) ++firstLine;
+		for (size_t l = firstLine; l < lines.size() && lineRows[l] == highlight.startRow; ++l) //A wrapped row may show a highlight over several lines
+		{
+			const Unicode::Clip& clip = clips[l];
+			if (highlight.endCol <= clip.start || highlight.startCol >= clip.end) continue;
+			std::string& renderString = lines[l];
+
+			//Highlights are positions in the uncut row, so they're moved to where that part of the row ended up
+			const std::string colorFormat = std::format("\x1b[38;5;{}m", SyntaxHighlight::color(highlight.colorType));
+			const size_t startPos = highlight.startCol > clip.start ? highlight.startCol - clip.start + clip.spacesBefore : 0;
+			renderString.insert(std::min(startPos + charactersToAdjust[l], renderString.length()), colorFormat);
+			charactersToAdjust[l] += colorFormat.length();
+
+			const size_t endPos = std::min(highlight.endCol, clip.end) - clip.start + clip.spacesBefore;
+			renderString.insert(std::min(endPos + charactersToAdjust[l], renderString.length()), normalColorMode);
+			charactersToAdjust[l] += normalColorMode.length();
+		}
+	}
+}
+
+/// <summary>
+/// Sets the highlight points of the view's rows if a syntax is given.
+/// The stored format is (HighlightType, startRow, startCol, endRow, endCol), one row per highlight.
+/// Only the view's rows are lexed here, within the highlighter's time budget. What they start in comes from the buffer's highlighter,
+/// which lexes the whole file in the background
+/// </summary>
+/// <param name="view">The view being drawn. Rows past the bottom of it are not highlighted</param>
+void Console::setHighlight(View& view)
+{
+	TRACE_SCOPE("setHighlight");
+	Buffer& buffer = *view.buffer;
+	buffer.highlights.clear();
+	if (buffer.highlighter == nullptr) return; //Can't highlight if there is no syntax
+
+	buffer.highlighter->invalidate(buffer.highlightDirtyRow);
+	buffer.highlightDirtyRow = SIZE_MAX;
+	if (!view.wrap) //Rows over the line length limit were only rendered from the view's first column
+	{
+		buffer.highlighter->highlightRows(view.rowOffset, view.rowOffset + view.rows, 0, view.cols, buffer.highlights);
+		return;
+	}
+
+	//Wrapped rows show at most a view's worth of columns, from their start. Only the first row can be scrolled part way through,
+	//to a display line that starts at least wrapOffset * (cols - 1) columns in, as a wide character that doesn't fit moves to the next line
+	const size_t columns = view.rows * view.cols;
+	size_t firstRow = view.rowOffset;
+	if (view.wrapOffset > 0)
+	{
+		const size_t firstCol = view.wrapOffset * (view.cols - 1);
+		buffer.highlighter->highlightRows(firstRow, firstRow + 1, firstCol, (view.wrapOffset + view.rows) * view.cols - firstCol, buffer.highlights);
+		++firstRow;
+	}
+	buffer.highlighter->highlightRows(firstRow, view.rowOffset + view.rows, 0, columns, buffer.highlights);
+}
+
+//=================================================================== TERMINAL FUNCTIONS =============================================================================\\
+
+/// <summary>
+/// Initializes the window and all other dependencies
+/// </summary>
+/// <param name="fileNames">The filenames grabbed from argv. The first one is shown, the rest are opened as hidden buffers</param>
+/// <param name="terminal">Where output is drawn and input is read from</param>
+void Console::initConsole(const std::vector<std::string_view>& fileNames, std::unique_ptr<Terminal> terminal)
+{
+	initTerminal(std::move(terminal));
+	const std::string syntaxError = SyntaxHighlight::initSyntax();
+	mWatcher = std::make_unique<FileWatcher>();
+	for (const std::string_view& fName : fileNames)
+	{
+		mBuffers.push_back(std::make_shared<Buffer>(fName));
+		mWatcher->watch(fName);
+	}
+
+	mLayout = std::make_unique<SplitNode>();
+	mLayout->view = std::make_unique<View>(mBuffers.front());
+	setActiveView(mLayout->view.get());
+	setWindowSize();
+
+	if (!syntaxError.empty()) setStatusMessage(syntaxError);
+	reportSwapFiles();
+	prepRenderedString();
+}
+
+/// <summary>
+/// Closes every view and buffer, which stops and joins their background workers (highlighter, search index, follower, swap file writer)
+/// and deletes their swap files. Called before main returns, so no worker is still reading a buffer while static objects are destroyed
+/// </summary>
+void Console::closeConsole()
+{
+	mView = nullptr;
+	mBuffer = nullptr;
+	mLayout.reset();
+	mBuffers.clear();
+	mWatcher.reset();
+}
+
+/// <summary>
+/// Takes over the terminal and puts it in raw mode, without opening any files. The pager reads its keys through it too
+/// </summary>
+/// <param name="terminal">Where output is drawn and input is read from</param>
+void Console::initTerminal(std::unique_ptr<Terminal> terminal)
+{
+	mTerminal = std::move(terminal);
+	if (!mTerminal->init()) //Try to get the default terminal settings
+	{
+		std::cerr << "Error retrieving current console mode";
+		exit(EXIT_FAILURE);
+	}
+	if (!enableRawInput()) //Try to enable raw mode
+	{
+		std::cerr << "Error enabling raw input mode";
+		exit(EXIT_FAILURE);
+	}
+	atexit(disableRawInput); //Make sure raw input mode gets disabled if the program exits due to an error
+}
+
+/// <summary>
+/// The terminal output is drawn to and input is read from
+/// </summary>
+Terminal& Console::terminal()
+{
+	return *mTerminal;
+}
+
+/// <summary>
+/// Sets the screen's row/column count and lays the views out over it
+/// </summary>
+/// <returns>True if size has changed, false otherwise</returns>
+bool Console::setWindowSize()
+{
+	size_t rows = 0, cols = 0;
+	if (!mTerminal->getSize(rows, cols))
+	{
+		std::cerr << "Error getting window size";
+		exit(EXIT_FAILURE);
+	}
+	if (rows == mScreenRows && cols == mScreenCols) return false; //Checks if the window size has changed
+
+	mScreenRows = rows;
+	mScreenCols = cols;
+	constexpr uint8_t commandRows = 1;
+	layoutViews(*mLayout, 0, 0, mScreenRows - commandRows, mScreenCols); //Each view keeps its own status row, the bottom row is shared for commands
+	return true;
+}
+
+/// <summary>
+/// Enables raw input mode
+/// </summary>
+/// <returns></returns>
+bool Console::enableRawInput()
+{
+	if (mRawModeEnabled || mBatchDepth > 0) return true; //The terminal mode is never switched while running a batch
+	if (mLayout) //Whatever was typed while raw mode was off has been echoed over the views
+	{
+		std::vector<View*> views;
+		collectViews(*mLayout, views);
+		for (View* view : views) view->drawnValid = false;
+	}
+	return mRawModeEnabled = mTerminal->enableRawInput();
+}
+
+/// <summary>
+/// Disables raw input mode by setting the terminal back to the default mode
+/// </summary>
+void Console::disableRawInput()
+{
+	if (mTerminal) mTerminal->disableRawInput();
+	mRawModeEnabled = false;
+}
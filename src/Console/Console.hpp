@@ -26,11 +26,20 @@ SOFTWARE.
 #include "SyntaxHighlight/SyntaxHighlight.hpp"
 #include "KeyActions/KeyActions.hh"
 #include "File/File.hpp"
+#include "Search/Search.hpp"
+#include "Registers/Registers.hpp"
+#include "Buffer/Buffer.hpp"
+#include "View/View.hpp"
+#include "Terminal/Terminal.hpp"
+#include "File/FileWatcher.hpp"
+#include "Unicode/Unicode.hpp"
 
 #include <vector>
 #include <string>
 #include <memory>
-#include <stack>
+#include <mutex>
+#include <array>
+#include <span>
 
 enum class Mode
 {
@@ -38,12 +47,15 @@ enum class Mode
 	EditMode,
 	FindMode,
 	ReadMode,
+	VisualMode,
 	ExitMode,
 	None
 };
 
 class Console
 {
+	friend class Bench; //Times the private rendering/undo stages directly
+
 public:
 	static Mode& mode(Mode = Mode::None);
 	static void prepRenderedString();
@@ -57,64 +69,134 @@ public:
 	static void redoChange();
 	static bool isRawMode();
 	static bool isDirty();
-	static void save();
+	static bool save(const bool force = false);
 	static void enableCommandMode();
 	static void enableEditMode();
-
-	//OS Specific Functions
-	static void initConsole(const std::string_view&);
+	static void enableFindMode();
+	static void find(const std::string_view& pattern);
+	static void findNext(const bool forward = true);
+	static void toggleSearchIndex();
+	static void toggleFollow();
+	static bool isFollowing();
+	static bool syncFiles();
+	static void journalEdits();
+	static bool recoverSwap(std::string& error);
+	static bool dropSwap();
+	static void rehighlight();
+	static void addCursorsAtMatches();
+	static void addCursorsOnLines(const size_t firstRow, const size_t lastRow);
+	static void addColumnCursors(const size_t count);
+	static void clearCursors();
+	static bool hasMultipleCursors();
+	static void moveExtraCursors(const KeyActions::KeyAction key);
+	static void multiCursorEdit(const KeyActions::KeyAction key);
+	static void enableVisualMode(const Registers::SelectionType type);
+	static void yankSelection(const char registerName);
+	static void deleteSelection(const char registerName);
+	static void putRegister(const char registerName, const bool before);
+	static void beginBatch();
+	static void endBatch();
+	static bool isCursorAtRowEnd();
+	static void setStatusMessage(const std::string_view& message);
+	static size_t cursorRow();
+	static size_t rowCount();
+	static void goToRow(const size_t row);
+	static void setMark(const char name, const size_t row);
+	static bool getMark(const char name, size_t& row);
+	static bool findRow(const Search::Query& query, const size_t startRow, const bool forward, size_t& row);
+	static void matchRows(const Search::Query& query, const size_t firstRow, const size_t lastRow, std::vector<bool>& selected);
+	static void deleteRows(const std::vector<bool>& selected, const char registerName);
+	static void transferRows(const std::vector<bool>& selected, const size_t insertAt, const bool copy, const bool reverse);
+	static void openBuffer(const std::string_view& fileName);
+	static bool switchBuffer(const size_t number);
+	static void cycleBuffer(const bool forward);
+	static std::string bufferList();
+	static bool splitView(const bool vertical, const std::string_view& fileName = "");
+	static bool closeView(const bool force);
+	static bool quitAll(const bool force);
+	static void focusNextView(const bool forward);
+	static void focusViewInDirection(const KeyActions::KeyAction direction);
+	static void setWrap(const bool wrap);
+	static bool isWrapping();
+	static void setGutter(const bool show);
+	static bool isShowingGutter();
+
+	//Terminal Functions
+	static void initConsole(const std::vector<std::string_view>& fileNames, std::unique_ptr<Terminal> terminal);
+	static void closeConsole();
+	static void initTerminal(std::unique_ptr<Terminal> terminal);
+	static Terminal& terminal();
 	static bool setWindowSize();
 	static bool enableRawInput();
 	static void disableRawInput();
 
 private:
-	struct Window
-	{
-		Window();
-		size_t fileCursorX, fileCursorY;
-		size_t renderedCursorX, renderedCursorY;
-		size_t savedRenderedCursorXPos; bool updateSavedPos = true;
-		size_t colNumberToDisplay;
-		size_t rowOffset, colOffset;
-		size_t rows, cols;
-
-		std::vector<FileHandler::Row> fileRows;
-
-		bool dirty;
-		bool rawModeEnabled;
-		SyntaxHighlight::EditorSyntax* syntax;
-	};
-
-	struct HighlightLocations
-	{
-		SyntaxHighlight::HighlightType colorType;
-		size_t startRow, startCol, endRow, endCol;
-	};
-
-	struct FileHistory
+	/// <summary>
+	/// A node of the split layout. Leaves hold a view, other nodes split their area between two children
+	/// </summary>
+	struct SplitNode
 	{
-		std::vector<FileHandler::Row> rows;
-		size_t fileCursorX, fileCursorY;
-		size_t colOffset, rowOffset;
+		std::unique_ptr<View> view;
+		std::unique_ptr<SplitNode> first, second;
+		bool vertical = false; //True if the children are side by side (:vs), false if one is above the other (:sp)
+		SplitNode* parent = nullptr;
 	};
 
 	static void addUndoHistory();
 	static void addRedoHistory();
-	static void setRenderedString();
+	static void replaceRows(const std::vector<FileHandler::Row>& rows);
+	static void spliceRows(const size_t first, const size_t removed, const std::span<const FileHandler::Row> added);
+	static void setRenderedString(View& view);
+	static void renderColumns(Buffer& buffer, const size_t row, const size_t firstColumn, const size_t columns, std::string& rendered);
 	static void deleteRow(const size_t rowNum);
+	static bool ingestAppended();
+	static void appendRows(Buffer& buffer, Follower::Appended& appended);
+	static bool reloadChangedFile(Buffer& buffer);
+	static void reportSwapFiles();
+	static void rowsEdited(const size_t first, const size_t end, const size_t oldRowCount);
+	static void updateWrap(View& view);
+	static size_t topLine(const View& view);
+	static size_t wrapLine(const View& view, const size_t row, const size_t column, size_t& start, size_t& end);
+	static bool screenPosition(const View& view, const size_t row, const size_t column, size_t& screenY, size_t& screenX, size_t& lineEnd);
+	static size_t cursorLine(View& view, size_t& x);
+	static void moveCursorToLine(View& view, const size_t line, const size_t x);
 	static void setCursorLinePosition();
-	static void fixRenderedCursorPosition(const FileHandler::Row&);
-	static void replaceRenderedStringTabs(std::string&);
-	static size_t getRenderedCursorTabSpaces(const FileHandler::Row&);
-	static void updateRenderedColor(const size_t rowOffset, const size_t colOffset);
-	static void findEndMarker(std::string& currentWord, size_t& row, size_t& posOffset, size_t& findPos, size_t startRow, size_t startCol, const std::string& strToFind, const SyntaxHighlight::HighlightType, bool = false);
-	static void setHighlight();
+	static void fixRenderedCursorPosition(View& view);
+	static void addExtraCursors(const std::vector<Cursor>& positions);
+	static void addCursorsAt(const std::vector<Cursor>& positions);
+	static void splitRowsAtCursors(const std::vector<Cursor>& cursors, std::vector<Cursor>& newCursors);
+	static void getSelectionBounds(size_t& startX, size_t& startY, size_t& endX, size_t& endY);
+	static void getBlockRange(const Line& line, const size_t leftColumn, const size_t rightColumn, size_t& fromX, size_t& toX);
+	static void appendSelectionOverlay(std::string& renderBuffer);
+	static void appendView(std::string& renderBuffer, View& view, const bool active);
+	static void appendStatusRow(std::string& renderBuffer, const View& view, const bool active);
+	static void putCharacters(const std::vector<Line>& lines, const size_t row, const size_t col);
+	static void putBlock(const std::vector<Line>& lines, const size_t row, const size_t col);
+	static void updateRenderedColor(View& view, std::vector<std::string>& lines, const std::vector<size_t>& lineRows, const std::vector<Unicode::Clip>& clips);
+	static void setHighlight(View& view);
+	static std::unique_lock<std::mutex> lockRows();
+	static void setActiveView(View* view);
+	static void showBuffer(const std::shared_ptr<Buffer>& buffer);
+	static void clampCursor(View& view);
+	static void layoutViews(SplitNode& node, const size_t top, const size_t left, const size_t height, const size_t width);
+	static SplitNode* findLeaf(SplitNode& node, const View* view);
+	static void collectViews(SplitNode& node, std::vector<View*>& views);
 
 private:
-	inline static std::unique_ptr<Window> mWindow;
-	inline static std::vector<HighlightLocations> mHighlights;
-	inline static std::stack<FileHistory> mRedoHistory;
-	inline static std::stack<FileHistory> mUndoHistory;
+	inline static std::unique_ptr<Terminal> mTerminal;
+	inline static std::vector<std::shared_ptr<Buffer>> mBuffers; //Every open file. Views hold a reference to the buffer they show
+	inline static std::unique_ptr<SplitNode> mLayout;
+	inline static std::unique_ptr<FileWatcher> mWatcher; //Watches every open file for changes made by other programs
+	inline static View* mView = nullptr; //The active view, which input goes to
+	inline static Buffer* mBuffer = nullptr; //The active view's buffer
+	inline static size_t mScreenRows = 0, mScreenCols = 0;
+	inline static bool mRawModeEnabled = false;
+	inline static bool mShowGutter = true; //Every view shows which rows changed since its file was saved (:set gutter / nogutter)
+	inline static Search::Query mSearchQuery;
 	inline static Mode mMode = Mode::ReadMode;
+	inline static size_t mBatchDepth = 0; //While above 0, rendering/highlighting is skipped and only the first edit takes an undo snapshot
+	inline static bool mBatchHasSnapshot = false;
+	inline static std::string mStatusMessage;
 	inline static const std::string separators = " \"',.()+-/*=~%;:[]{}<>";
+	inline static constexpr size_t maxScrollFraction = 2; //Scrolls of more than 1/maxScrollFraction of a view redraw it instead of using the terminal's scroll region
 };
\ No newline at end of file
@@ -0,0 +1,120 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Diff.hpp"
+#include "Trace/Trace.hpp"
+#include <functional>
+#include <algorithm>
+
+namespace Diff
+{
+	/// <summary>
+	/// The hash lines are compared by
+	/// </summary>
+	uint64_t hashLine(const std::string_view& line)
+	{
+		return std::hash<std::string_view>()(line);
+	}
+
+	/// <summary>
+	/// Finds the hunks that turn the old lines into the new ones, with Myers' O(ND) greedy search for the fewest lines added and deleted.
+	/// The lines the two versions start and end with are skipped first, so an edit costs about the same however big the file is
+	/// </summary>
+	/// <param name="oldLines">The hash of each line of the old version</param>
+	/// <param name="newLines">The hash of each line of the new version</param>
+	/// <param name="maxEdits">How many added and deleted lines to search for before giving up, as the search takes O(D^2) memory to go back over</param>
+	/// <returns>The hunks in order</returns>
+	std::vector<Hunk> compare(const std::vector<uint64_t>& oldLines, const std::vector<uint64_t>& newLines, const size_t maxEdits)
+	{
+		TRACE_SCOPE("Diff::compare");
+		size_t prefix = 0, suffix = 0;
+		while (prefix < oldLines.size() && prefix < newLines.size() && oldLines[prefix] == newLines[prefix]) ++prefix;
+		while (suffix < oldLines.size() - prefix && suffix < newLines.size() - prefix
+			&& oldLines[oldLines.size() - 1 - suffix] == newLines[newLines.size() - 1 - suffix]) ++suffix;
+
+		const int64_t n = static_cast<int64_t>(oldLines.size() - prefix - suffix), m = static_cast<int64_t>(newLines.size() - prefix - suffix);
+		std::vector<Hunk> hunks;
+		if (n == 0 && m == 0) return hunks;
+		const Hunk whole{ prefix, static_cast<size_t>(n), prefix, static_cast<size_t>(m) };
+		if (n == 0 || m == 0) return { whole };
+
+		//v[k] is how far along the old lines the furthest path on diagonal k (x - y = k) got. Each step keeps a copy of the diagonals it reached,
+		//which is what the path is traced back through
+		const int64_t maxD = std::min<int64_t>(n + m, static_cast<int64_t>(maxEdits));
+		std::vector<int64_t> v(2 * maxD + 3, 0);
+		const int64_t offset = maxD + 1;
+		std::vector<std::vector<int64_t>> trace;
+		const auto same = [&](const int64_t x, const int64_t y) { return oldLines[prefix + x] == newLines[prefix + y]; };
+		for (int64_t d = 0; d <= maxD; ++d)
+		{
+			for (int64_t k = -d; k <= d; k += 2)
+			{
+				int64_t x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+				int64_t y = x - k;
+				while (x < n && y < m && same(x, y))
+				{
+					++x;
+					++y;
+				}
+				v[offset + k] = x;
+				if (x < n || y < m) continue;
+
+				//Trace the path back from the end. Each step back is a line added or deleted, and runs of them next to each other make a hunk
+				Hunk hunk{ SIZE_MAX, 0, 0, 0 };
+				for (int64_t step = d; step > 0; --step)
+				{
+					const std::vector<int64_t>& before = trace[step - 1]; //Diagonals -(step - 1) to step - 1
+					const auto reached = [&](const int64_t diagonal) { return before[diagonal + step - 1]; };
+					const int64_t diagonal = x - y;
+					const bool added = diagonal == -step || (diagonal != step && reached(diagonal - 1) < reached(diagonal + 1));
+					const int64_t fromX = reached(added ? diagonal + 1 : diagonal - 1), fromY = fromX - (added ? diagonal + 1 : diagonal - 1);
+					const size_t oldLine = prefix + fromX, newLine = prefix + fromY; //The line deleted or added, and where it goes in the other version
+					if (hunk.oldStart != SIZE_MAX && (hunk.oldStart != oldLine + (added ? 0 : 1) || hunk.newStart != newLine + (added ? 1 : 0)))
+					{
+						hunks.push_back(hunk);
+						hunk.oldStart = SIZE_MAX;
+					}
+					if (hunk.oldStart == SIZE_MAX) hunk = Hunk{ oldLine + (added ? 0 : 1), 0, newLine + (added ? 1 : 0), 0 };
+					if (added)
+					{
+						hunk.newStart = newLine;
+						++hunk.newCount;
+					}
+					else
+					{
+						hunk.oldStart = oldLine;
+						++hunk.oldCount;
+					}
+					x = fromX;
+					y = fromY;
+				}
+				if (hunk.oldStart != SIZE_MAX) hunks.push_back(hunk);
+				std::reverse(hunks.begin(), hunks.end());
+				return hunks;
+			}
+			trace.emplace_back(v.begin() + offset - d, v.begin() + offset + d + 1);
+		}
+		return { whole }; //Too different to be worth the search
+	}
+}
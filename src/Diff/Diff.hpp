@@ -0,0 +1,49 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <vector>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Line diffs. Lines are compared by hash, so each line is read once however many times the search compares it
+/// </summary>
+namespace Diff
+{
+	/// <summary>
+	/// A run of lines that differs: lines [oldStart, oldStart + oldCount) of the old version became lines [newStart, newStart + newCount) of the new one.
+	/// One of the counts is 0 for a run that was only added or only deleted
+	/// </summary>
+	struct Hunk
+	{
+		size_t oldStart, oldCount, newStart, newCount;
+	};
+
+	inline constexpr size_t defaultMaxEdits = 2048; //Past this many added and deleted lines, the lines between the first and last difference become one hunk
+
+	uint64_t hashLine(const std::string_view& line);
+	std::vector<Hunk> compare(const std::vector<uint64_t>& oldLines, const std::vector<uint64_t>& newLines, const size_t maxEdits = defaultMaxEdits);
+}
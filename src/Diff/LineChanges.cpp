@@ -0,0 +1,140 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "LineChanges.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include <algorithm>
+
+/// <summary>
+/// Takes text the buffer keeps (its copy of the file, or text read when it was reloaded) as what the rows are compared with
+/// </summary>
+/// <param name="text">Must outlive the rows compared with it or be reset first</param>
+void LineChanges::reset(const std::string_view& text)
+{
+	mOwnedText.reset();
+	mText = text;
+	mSaved.clear();
+	mSplit = false;
+	mHunks.clear();
+}
+
+/// <summary>
+/// Takes what a save wrote as what the rows are compared with
+/// </summary>
+void LineChanges::reset(std::unique_ptr<const std::string> text)
+{
+	reset(std::string_view(*text));
+	mOwnedText = std::move(text);
+}
+
+/// <summary>
+/// Works the hunks out again after an edit: rows [first, oldEnd) as they were at the last update were replaced by rows [first, newEnd).
+/// The hunks overlapping or touching the edited rows are diffed again along with them, so changes next to each other merge
+/// </summary>
+void LineChanges::update(const std::vector<FileHandler::Row>& rows, const size_t first, const size_t oldEnd, const size_t newEnd)
+{
+	TRACE_SCOPE("LineChanges::update");
+	Memory::Scope memoryScope(Memory::Subsystem::Text);
+	splitSaved();
+
+	size_t low = first, high = oldEnd;
+	auto begin = std::lower_bound(mHunks.begin(), mHunks.end(), low, [](const Diff::Hunk& hunk, const size_t row) { return hunk.newStart + hunk.newCount < row; });
+	auto end = begin;
+	for (; end != mHunks.end() && end->newStart <= high; ++end)
+	{
+		low = std::min(low, end->newStart);
+		high = std::max(high, end->newStart + end->newCount);
+	}
+
+	//Rows outside the hunks are the same as the saved lines, so the ends of the range map straight to saved lines
+	const auto savedLine = [](const size_t row, const Diff::Hunk* before) { return before == nullptr ? row : row - (before->newStart + before->newCount) + before->oldStart + before->oldCount; };
+	const Diff::Hunk* beforeLow = begin != mHunks.begin() ? &*(begin - 1) : nullptr;
+	const Diff::Hunk* beforeHigh = end != begin ? &*(end - 1) : beforeLow;
+	size_t savedLow = std::min(savedLine(low, beforeLow), mSaved.size()), savedHigh = std::min(savedLine(high, beforeHigh), mSaved.size());
+	size_t rowLow = std::min(low, rows.size()), rowHigh = std::min(high + newEnd - oldEnd, rows.size());
+
+	while (savedLow < savedHigh && rowLow < rowHigh && mSaved[savedLow] == std::string_view(rows[rowLow].line))
+	{
+		++savedLow;
+		++rowLow;
+	}
+	while (savedLow < savedHigh && rowLow < rowHigh && mSaved[savedHigh - 1] == std::string_view(rows[rowHigh - 1].line))
+	{
+		--savedHigh;
+		--rowHigh;
+	}
+	std::vector<uint64_t> savedLines, rowLines;
+	savedLines.reserve(savedHigh - savedLow);
+	rowLines.reserve(rowHigh - rowLow);
+	for (size_t line = savedLow; line < savedHigh; ++line) savedLines.push_back(Diff::hashLine(mSaved[line]));
+	for (size_t row = rowLow; row < rowHigh; ++row) rowLines.push_back(Diff::hashLine(rows[row].line));
+	std::vector<Diff::Hunk> hunks = Diff::compare(savedLines, rowLines);
+	for (Diff::Hunk& hunk : hunks)
+	{
+		hunk.oldStart += savedLow;
+		hunk.newStart += rowLow;
+	}
+
+	for (auto after = end; after != mHunks.end(); ++after)
+	{
+		after->newStart = after->newStart + newEnd - oldEnd;
+	}
+	const auto at = mHunks.erase(begin, end);
+	mHunks.insert(at, hunks.begin(), hunks.end());
+}
+
+/// <summary>
+/// The gutter sign of a row
+/// </summary>
+LineChanges::Sign LineChanges::sign(const size_t row) const
+{
+	const auto after = std::upper_bound(mHunks.begin(), mHunks.end(), row, [](const size_t r, const Diff::Hunk& hunk) { return r < hunk.newStart; });
+	if (after != mHunks.begin())
+	{
+		const Diff::Hunk& hunk = *(after - 1);
+		if (row < hunk.newStart + hunk.newCount) return hunk.oldCount == 0 ? Sign::Added : Sign::Modified;
+	}
+	if (after != mHunks.end() && after->newStart == row + 1 && after->newCount == 0) return Sign::DeletedBelow;
+	if (row == 0 && !mHunks.empty() && mHunks.front().newStart == 0 && mHunks.front().newCount == 0) return Sign::DeletedAbove;
+	return Sign::None;
+}
+
+/// <summary>
+/// Splits the saved text into lines the way the rows were split, the first time they are compared
+/// </summary>
+void LineChanges::splitSaved()
+{
+	if (mSplit) return;
+	mSplit = true;
+	if (mText.empty()) return;
+	mSaved.reserve(std::count(mText.begin(), mText.end(), '\n') + 1);
+	size_t lineStart = 0, lineBreak = 0;
+	while ((lineBreak = mText.find('\n', lineStart)) != std::string_view::npos)
+	{
+		mSaved.push_back(mText.substr(lineStart, lineBreak - lineStart));
+		lineStart = lineBreak + 1;
+	}
+	mSaved.push_back(mText.substr(lineStart));
+}
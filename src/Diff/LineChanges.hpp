@@ -0,0 +1,67 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "Diff.hpp"
+#include "File/File.hpp"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstdint>
+
+/// <summary>
+/// The rows of a buffer that differ from its file as it was last loaded or saved, for the gutter. The saved lines point into the text
+/// they were read from (the buffer's copy of the file, or what was written by a save) rather than being copied, and are only split
+/// once the buffer is first edited. Each edit only diffs the rows it touched, along with the hunks next to them, so keeping the hunks
+/// up to date costs about the size of the edit however big the file is
+/// </summary>
+class LineChanges
+{
+public:
+	enum class Sign : uint8_t
+	{
+		None,
+		Added,
+		Modified,
+		DeletedBelow, //Lines after this row were deleted
+		DeletedAbove //Lines before the first row were deleted
+	};
+
+	void reset(const std::string_view& text);
+	void reset(std::unique_ptr<const std::string> text);
+	void update(const std::vector<FileHandler::Row>& rows, const size_t first, const size_t oldEnd, const size_t newEnd);
+	Sign sign(const size_t row) const;
+
+private:
+	void splitSaved();
+
+private:
+	std::string_view mText; //The file as it was loaded or saved
+	std::unique_ptr<const std::string> mOwnedText; //Set if mText is a copy written by a save, which no rows point into
+	std::vector<std::string_view> mSaved; //The lines of mText, once they are needed
+	bool mSplit = false;
+	std::vector<Diff::Hunk> mHunks; //How the rows differ from mSaved, in order
+};
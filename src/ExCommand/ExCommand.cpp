@@ -0,0 +1,560 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ExCommand.hpp"
+#include "Console/Console.hpp"
+#include "Input/Input.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Memory/Memory.hpp"
+#include "SyntaxHighlight/Highlighter.hpp"
+#include <cctype>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <format>
+
+using KeyActions::KeyAction;
+
+namespace ExCommand
+{
+	/// <summary>
+	/// The command line being parsed, and how far into it the parser has read
+	/// </summary>
+	struct Parser
+	{
+		std::string_view text;
+		size_t pos = 0;
+		std::string error;
+
+		explicit Parser(const std::string_view& commandLine) : text(commandLine) {}
+
+		bool atEnd() const { return pos >= text.length(); }
+		char peek() const { return atEnd() ? '\0' : text[pos]; }
+		void skipSpaces() { while (peek() == ' ' || peek() == '\t') ++pos; }
+	};
+
+	/// <summary>
+	/// A range of lines. Lines are numbered from 1 like VIM, and line 0 is the (empty) spot before the first line, which is only useful as a :m/:t target
+	/// </summary>
+	struct Range
+	{
+		size_t first = 0, last = 0;
+		bool given = false; //False if the command line didn't have a range and the default (the current line) is being used
+	};
+
+	static bool fail(Parser& parser, const std::string_view& message)
+	{
+		parser.error = message;
+		return false;
+	}
+
+	static bool readNumber(Parser& parser, size_t& number)
+	{
+		if (!std::isdigit(static_cast<unsigned char>(parser.peek()))) return false;
+		number = 0;
+		while (std::isdigit(static_cast<unsigned char>(parser.peek())))
+		{
+			number = number * 10 + (parser.text[parser.pos++] - '0');
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Reads a command name. Names are letters only, so in :m0 or :d a the name is just the m or d
+	/// </summary>
+	static std::string readName(Parser& parser)
+	{
+		parser.skipSpaces();
+		std::string name;
+		while (std::isalpha(static_cast<unsigned char>(parser.peek())))
+		{
+			name.push_back(parser.text[parser.pos++]);
+		}
+		return name;
+	}
+
+	/// <summary>
+	/// Returns true if name is the command or an abbreviation of it at least minLength long, like VIM's d[elete] or norm[al]
+	/// </summary>
+	static bool isCommand(const std::string& name, const std::string_view& command, const size_t minLength)
+	{
+		return name.length() >= minLength && command.starts_with(name);
+	}
+
+	/// <summary>
+	/// Reads a pattern up to the closing delimiter, which can be left out at the end of the line.
+	/// \ followed by the delimiter is the delimiter itself, other escapes are kept for the regex
+	/// </summary>
+	static std::string readPattern(Parser& parser, const char delimiter)
+	{
+		std::string pattern;
+		while (!parser.atEnd() && parser.peek() != delimiter)
+		{
+			char c = parser.text[parser.pos++];
+			if (c == '\\' && parser.peek() == delimiter) c = parser.text[parser.pos++];
+			pattern.push_back(c);
+		}
+		if (!parser.atEnd()) ++parser.pos;
+		return pattern;
+	}
+
+	/// <summary>
+	/// Parses a line address: a number, . (the current line), $ (the last line), 'x (mark x), /pattern/ or ?pattern? (the next/previous line that matches),
+	/// followed by any number of +n/-n offsets. An offset on its own is relative to the current line
+	/// </summary>
+	/// <param name="currentLine">The line . refers to, and the line pattern searches start from</param>
+	/// <param name="line">The parsed line</param>
+	/// <param name="found">Set to false if there is no address at the parser's position</param>
+	/// <returns>False if the address is invalid</returns>
+	static bool parseAddress(Parser& parser, const size_t currentLine, size_t& line, bool& found)
+	{
+		parser.skipSpaces();
+		found = true;
+		const char c = parser.peek();
+		if (std::isdigit(static_cast<unsigned char>(c)))
+		{
+			readNumber(parser, line);
+		}
+		else if (c == '.' || c == '$')
+		{
+			++parser.pos;
+			line = c == '.' ? currentLine : Console::rowCount();
+		}
+		else if (c == '\'')
+		{
+			++parser.pos;
+			size_t row;
+			if (parser.atEnd() || !Console::getMark(parser.text[parser.pos++], row)) return fail(parser, "Mark not set");
+			line = row + 1;
+		}
+		else if (c == '/' || c == '?')
+		{
+			++parser.pos;
+			const std::string pattern = readPattern(parser, c);
+			if (pattern.empty()) return fail(parser, "No pattern given");
+			const size_t startRow = currentLine > 0 ? currentLine - 1 : Console::rowCount() - 1;
+			size_t row;
+			if (!Console::findRow(Search::compile(pattern), startRow, c == '/', row)) return fail(parser, std::format("Pattern not found: {}", pattern));
+			line = row + 1;
+		}
+		else if (c == '+' || c == '-')
+		{
+			line = currentLine;
+		}
+		else
+		{
+			found = false;
+			return true;
+		}
+
+		while (parser.peek() == '+' || parser.peek() == '-')
+		{
+			const bool add = parser.text[parser.pos++] == '+';
+			size_t offset = 1;
+			readNumber(parser, offset);
+			if (!add && offset > line) return fail(parser, "Invalid range");
+			line = add ? line + offset : line - offset;
+		}
+		if (line > Console::rowCount()) return fail(parser, "Invalid range");
+		return true;
+	}
+
+	/// <summary>
+	/// Parses the range in front of a command: % (the whole file), one address, or two addresses separated by , or ;
+	/// With ; the second address is relative to the first instead of the current line
+	/// </summary>
+	static bool parseRange(Parser& parser, Range& range)
+	{
+		const size_t currentLine = Console::cursorRow() + 1;
+		parser.skipSpaces();
+		if (parser.peek() == '%')
+		{
+			++parser.pos;
+			range = { 1, Console::rowCount(), true };
+			return true;
+		}
+
+		bool found;
+		if (!parseAddress(parser, currentLine, range.first, found)) return false;
+		if (!found)
+		{
+			range = { currentLine, currentLine, false };
+			return true;
+		}
+		range.last = range.first;
+		range.given = true;
+
+		parser.skipSpaces();
+		if (parser.peek() == ',' || parser.peek() == ';')
+		{
+			const size_t relativeTo = parser.text[parser.pos++] == ';' ? range.first : currentLine;
+			if (!parseAddress(parser, relativeTo, range.last, found)) return false;
+			if (!found) range.last = relativeTo;
+		}
+		if (range.first > range.last) std::swap(range.first, range.last);
+		return true;
+	}
+
+	static bool checkTrailing(Parser& parser)
+	{
+		parser.skipSpaces();
+		return parser.atEnd() || fail(parser, std::format("Trailing characters: {}", parser.text.substr(parser.pos)));
+	}
+
+	/// <summary>
+	/// Reads a file name argument, which is the rest of the line without the surrounding spaces
+	/// </summary>
+	static std::string readFileName(Parser& parser)
+	{
+		parser.skipSpaces();
+		std::string fileName(parser.text.substr(parser.pos));
+		while (!fileName.empty() && (fileName.back() == ' ' || fileName.back() == '\t')) fileName.pop_back();
+		parser.pos = parser.text.length();
+		return fileName;
+	}
+
+	/// <summary>
+	/// Runs keys as read mode commands at the start of each selected row, all in one batch.
+	/// The rows are visited top to bottom, and rows added or removed by the keys shift the rows still to be visited
+	/// </summary>
+	static void runNormal(const std::vector<bool>& selected, const std::string_view& keys)
+	{
+		if (keys.empty()) return;
+		std::vector<KeyAction> replayKeys;
+		replayKeys.reserve(keys.length() + 1);
+		for (const char c : keys)
+		{
+			replayKeys.push_back(static_cast<KeyAction>(static_cast<unsigned char>(c)));
+		}
+		replayKeys.push_back(KeyAction::Esc); //Like VIM, an unfinished insert is ended once the keys have run
+
+		Console::beginBatch();
+		std::ptrdiff_t shift = 0;
+		for (size_t r = 0; r < selected.size(); ++r)
+		{
+			if (!selected[r]) continue;
+			const size_t rowCount = Console::rowCount();
+			const std::ptrdiff_t row = static_cast<std::ptrdiff_t>(r) + shift;
+			if (row < 0) continue;
+			if (static_cast<size_t>(row) >= rowCount) break;
+
+			Console::mode(Mode::ReadMode);
+			Console::goToRow(row);
+			InputHandler::replay(replayKeys, 1);
+			if (Console::mode() == Mode::ExitMode) break;
+			shift += static_cast<std::ptrdiff_t>(Console::rowCount()) - static_cast<std::ptrdiff_t>(rowCount);
+		}
+		Console::endBatch();
+	}
+
+	/// <summary>
+	/// Runs a command that works on a set of rows:
+	/// d[elete] [x] deletes them into register x, m[ove] {address} / t or co[py] {address} move/copy them below address, norm[al] {keys} runs keys on each of them
+	/// </summary>
+	/// <param name="selected">One flag per row</param>
+	/// <param name="range">The range the rows were selected from</param>
+	/// <param name="fromGlobal">True if the rows were picked by :g/:v. VIM runs the command once per row then, which for :m/:t reverses the rows unless they go to the end</param>
+	static bool runRowCommand(Parser& parser, const std::string& name, const std::vector<bool>& selected, const Range& range, const bool fromGlobal)
+	{
+		if (isCommand(name, "delete", 1))
+		{
+			parser.skipSpaces();
+			char registerName = Registers::unnamedRegister;
+			if (!parser.atEnd())
+			{
+				registerName = parser.text[parser.pos++];
+				if (!Registers::isValidName(registerName)) return fail(parser, "Invalid register name");
+			}
+			if (!checkTrailing(parser)) return false;
+			Console::deleteRows(selected, registerName);
+		}
+		else if (isCommand(name, "move", 1) || name == "t" || isCommand(name, "copy", 2))
+		{
+			const bool copy = !isCommand(name, "move", 1);
+			size_t target;
+			bool found;
+			if (!parseAddress(parser, Console::cursorRow() + 1, target, found)) return false;
+			if (!found) return fail(parser, "Missing destination address");
+			if (!checkTrailing(parser)) return false;
+			if (!copy && !fromGlobal && target >= range.first && target < range.last) return fail(parser, "Cannot move a range of lines into itself");
+			Console::transferRows(selected, target, copy, fromGlobal && target != Console::rowCount());
+		}
+		else if (isCommand(name, "normal", 4))
+		{
+			parser.skipSpaces();
+			runNormal(selected, parser.text.substr(parser.pos));
+		}
+		else
+		{
+			return fail(parser, std::format("Not an editor command: {}", name));
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// :g/pattern/command runs command on the rows in the range (the whole file by default) that match pattern. :g! and :v run it on the rows that don't match.
+	/// Any character other than a letter, digit or space can be used instead of /
+	/// The rows are filtered first, then the command transforms all of them at once instead of one row at a time
+	/// </summary>
+	static bool runGlobal(Parser& parser, Range range, const bool invert)
+	{
+		if (!range.given) range = { 1, Console::rowCount(), true };
+		if (Console::rowCount() == 0) return true;
+		if (range.first == 0) return fail(parser, "Invalid range");
+
+		const char delimiter = parser.peek();
+		if (parser.atEnd() || std::isalnum(static_cast<unsigned char>(delimiter)) || delimiter == ' ' || delimiter == '\\') return fail(parser, "Invalid pattern delimiter");
+		++parser.pos;
+		const std::string pattern = readPattern(parser, delimiter);
+		if (pattern.empty()) return fail(parser, "No pattern given");
+
+		std::vector<bool> selected(Console::rowCount(), false);
+		Console::matchRows(Search::compile(pattern), range.first - 1, range.last - 1, selected);
+		if (invert)
+		{
+			for (size_t r = range.first - 1; r < range.last; ++r)
+			{
+				selected[r] = !selected[r];
+			}
+		}
+
+		const std::string name = readName(parser);
+		if (parser.peek() == '!') ++parser.pos; //Only :normal! takes a !, and as there are no mappings it is the same as :normal
+		if (name.empty()) return fail(parser, "Missing command after the pattern");
+		return runRowCommand(parser, name, selected, range, true);
+	}
+
+	/// <summary>
+	/// Sets options given as name=value. Sizes can end in K, M or G. Without any options, shows their values
+	/// - synmaxcol: Rows longer than this only have their visible columns drawn and highlighted
+	/// - hlmaxsize: Files opened above this size are only highlighted where they are drawn
+	/// - redrawtime: The milliseconds a view may spend highlighting per frame
+	/// - wrap/nowrap: Soft wrap the rows of the active view, or scroll them sideways
+	/// - gutter/nogutter: Show or hide the column marking the rows changed since the file was saved. These take no value
+	/// </summary>
+	static bool runSet(Parser& parser)
+	{
+		Highlighter::Limits& limits = Highlighter::limits();
+		parser.skipSpaces();
+		if (parser.atEnd())
+		{
+			Console::setStatusMessage(std::format("synmaxcol={} hlmaxsize={} redrawtime={} {} {}", limits.maxLineLength.load(), limits.maxFileSize, limits.frameBudget.count(),
+				Console::isWrapping() ? "wrap" : "nowrap", Console::isShowingGutter() ? "gutter" : "nogutter"));
+			return true;
+		}
+
+		while (!parser.atEnd())
+		{
+			const std::string option = readName(parser);
+			if (option == "wrap" || option == "nowrap")
+			{
+				Console::setWrap(option == "wrap");
+				parser.skipSpaces();
+				continue;
+			}
+			if (option == "gutter" || option == "nogutter")
+			{
+				Console::setGutter(option == "gutter");
+				parser.skipSpaces();
+				continue;
+			}
+
+			size_t value = 0;
+			if (option.empty() || parser.peek() != '=') return fail(parser, "Usage: set <option>=<number>");
+			++parser.pos;
+			if (!readNumber(parser, value)) return fail(parser, std::format("{} needs a number", option));
+			const char unit = static_cast<char>(std::toupper(static_cast<unsigned char>(parser.peek())));
+			if (unit == 'K' || unit == 'M' || unit == 'G')
+			{
+				value <<= unit == 'K' ? 10 : unit == 'M' ? 20 : 30;
+				++parser.pos;
+			}
+
+			if (option == "synmaxcol")
+			{
+				limits.maxLineLength = value;
+				Console::rehighlight(); //Rows that crossed the limit carry different states now
+			}
+			else if (option == "hlmaxsize") limits.maxFileSize = value;
+			else if (option == "redrawtime") limits.frameBudget = std::chrono::milliseconds(value);
+			else return fail(parser, std::format("Unknown option: {}", option));
+			parser.skipSpaces();
+		}
+		return true;
+	}
+
+	static bool runCommand(Parser& parser)
+	{
+		Range range;
+		if (!parseRange(parser, range)) return false;
+		const std::string name = readName(parser);
+		const bool force = parser.peek() == '!';
+		if (force) ++parser.pos;
+
+		if (name.empty()) //A range on its own goes to the last line of the range
+		{
+			if (!checkTrailing(parser)) return false;
+			if (range.given) Console::goToRow(range.last > 0 ? range.last - 1 : 0);
+		}
+		else if (isCommand(name, "quit", 1)) //Close the view, or quit if it is the last one. Changes must be saved, unless forced with q!
+		{
+			if (!Console::closeView(force)) return fail(parser, "No write since last change (add ! to override)");
+		}
+		else if (isCommand(name, "qall", 2) || name == "quitall")
+		{
+			if (!Console::quitAll(force)) return fail(parser, "No write since last change (add ! to override)");
+		}
+		else if (isCommand(name, "write", 1) || name == "s") //[W]rite / [S]ave. Another program's changes to the file are only saved over with w!
+		{
+			if (!Console::save(force)) return fail(parser, "The file was changed by another program since it was read (add ! to save over it)");
+		}
+		else if (name == "wq" || name == "sq")
+		{
+			if (!Console::save(force)) return fail(parser, "The file was changed by another program since it was read (add ! to save over it)");
+			if (!Console::closeView(force)) return fail(parser, "Another buffer has unsaved changes (add ! to override)");
+		}
+		else if (isCommand(name, "edit", 1)) //Open a file in this view. The buffer it replaces stays open
+		{
+			const std::string fileName = readFileName(parser);
+			if (fileName.empty()) return fail(parser, "Usage: e <file>");
+			Console::openBuffer(fileName);
+		}
+		else if (isCommand(name, "split", 2) || isCommand(name, "vsplit", 2)) //Split the view, optionally opening a file in the new half
+		{
+			if (!Console::splitView(name.front() == 'v', readFileName(parser))) return fail(parser, "Not enough room");
+		}
+		else if (name == "ls" || name == "buffers")
+		{
+			Console::setStatusMessage(Console::bufferList());
+		}
+		else if (isCommand(name, "bnext", 2))
+		{
+			Console::cycleBuffer(true);
+		}
+		else if (isCommand(name, "bprevious", 2) || isCommand(name, "bNext", 2))
+		{
+			Console::cycleBuffer(false);
+		}
+		else if (isCommand(name, "buffer", 1)) //Show buffer N, as numbered by :ls
+		{
+			size_t number = 0;
+			parser.skipSpaces();
+			if (!readNumber(parser, number)) return fail(parser, "Usage: b <number>");
+			if (!checkTrailing(parser)) return false;
+			if (!Console::switchBuffer(number)) return fail(parser, std::format("Buffer {} does not exist", number));
+		}
+		else if (name == "perf") //Toggle the performance overlay in the status bar
+		{
+			Profiler::enable(!Profiler::isEnabled());
+		}
+		else if (name == "mem") //Show the live heap bytes of each subsystem
+		{
+			Console::setStatusMessage(Memory::summary());
+		}
+		else if (isCommand(name, "set", 2)) //Change the highlighting limits or wrapping
+		{
+			return runSet(parser);
+		}
+		else if (name == "index") //Toggle the background-built search index
+		{
+			Console::toggleSearchIndex();
+		}
+		else if (name == "follow") //Toggle adding what is written to the end of the file to the buffer, like tail -f
+		{
+			Console::toggleFollow();
+		}
+		else if (name == "recover") //Replay the edits in the swap file an earlier session left
+		{
+			std::string error;
+			if (!Console::recoverSwap(error)) return fail(parser, error);
+		}
+		else if (name == "dropswap") //Delete the swap file an earlier session left, without replaying it
+		{
+			if (!Console::dropSwap()) return fail(parser, "The file has no swap file from an earlier session");
+		}
+		else if (name == "mcmatch") //Add a cursor at every match of the last search
+		{
+			Console::addCursorsAtMatches();
+		}
+		else if (name == "mclines") //Add a cursor at the end of every line in a range: :mclines <first> <last> or :<first>,<last>mclines
+		{
+			if (!range.given)
+			{
+				parser.skipSpaces();
+				const bool hasFirst = readNumber(parser, range.first);
+				parser.skipSpaces();
+				if (!hasFirst || !readNumber(parser, range.last)) return fail(parser, "Usage: mclines <first> <last>");
+			}
+			if (range.first == 0 || range.last < range.first) return fail(parser, "Invalid range");
+			Console::addCursorsOnLines(range.first - 1, range.last - 1);
+		}
+		else if (name == "mccol") //Add column-aligned cursors on the next rows: :mccol <count>
+		{
+			size_t cursorCount = 0;
+			parser.skipSpaces();
+			if (!readNumber(parser, cursorCount)) return fail(parser, "Usage: mccol <count>");
+			Console::addColumnCursors(cursorCount);
+		}
+		else if (name == "mcclear")
+		{
+			Console::clearCursors();
+		}
+		else if (isCommand(name, "mark", 2) || name == "k") //Set a mark on the last line of the range
+		{
+			parser.skipSpaces();
+			const char markName = parser.peek();
+			if (markName < 'a' || markName > 'z') return fail(parser, "Marks are a-z");
+			++parser.pos;
+			if (!checkTrailing(parser)) return false;
+			if (range.last == 0) return fail(parser, "Invalid range");
+			Console::setMark(markName, range.last - 1);
+		}
+		else if (isCommand(name, "global", 1) || isCommand(name, "vglobal", 1))
+		{
+			return runGlobal(parser, range, force || name.front() == 'v');
+		}
+		else
+		{
+			if (Console::rowCount() == 0) return true;
+			if (range.first == 0) return fail(parser, "Invalid range");
+			std::vector<bool> selected(Console::rowCount(), false);
+			std::fill(selected.begin() + range.first - 1, selected.begin() + range.last, true);
+			return runRowCommand(parser, name, selected, range, false);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Parses and runs a command line. If the command is invalid nothing is changed and the error is shown in the status bar
+	/// </summary>
+	/// <param name="commandLine">The text typed after :</param>
+	/// <returns>False if the command failed</returns>
+	bool execute(const std::string_view& commandLine)
+	{
+		Parser parser{ commandLine };
+		if (runCommand(parser)) return true;
+		Console::setStatusMessage(parser.error);
+		return false;
+	}
+}
@@ -0,0 +1,295 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ColumnIndex.hpp"
+#include "Unicode/Unicode.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+/// <summary>
+/// The tab stop a tab at 'column' moves to
+/// </summary>
+static size_t nextTabStop(const size_t column)
+{
+	return (column / Unicode::tabWidth + 1) * Unicode::tabWidth;
+}
+
+/// <summary>
+/// Where the first tab in text that starts a character is, or npos. A tab after a zero width joiner is part of the character before it
+/// </summary>
+static size_t findTab(const std::string_view& text)
+{
+	for (size_t pos = 0; pos < text.length(); ++pos)
+	{
+		const char* tab = static_cast<const char*>(std::memchr(text.data() + pos, '\t', text.length() - pos));
+		if (tab == nullptr) break;
+		pos = tab - text.data();
+		if (pos < 3 || text.substr(pos - 3, 3) != "\xE2\x80\x8D") return pos;
+	}
+	return std::string_view::npos;
+}
+
+/// <summary>
+/// Measures a row from scratch
+/// </summary>
+void ColumnIndex::build(const std::string_view& text)
+{
+	TRACE_SCOPE("ColumnIndex::build");
+	Memory::Scope memoryScope(Memory::Subsystem::Rendered);
+	std::vector<Span> chunks;
+	chunks.reserve(text.length() / chunkBytes + 1);
+	split(text, 0, text.length(), chunks);
+	buildTree(chunks);
+}
+
+/// <summary>
+/// Updates the index after 'erased' bytes at pos were replaced by 'inserted' bytes. Only the chunks the edit touched are measured again,
+/// along with the chunk before them if the edit was at its end, as the characters on either side of it may have joined or split
+/// </summary>
+/// <param name="text">The row after the edit</param>
+void ColumnIndex::edit(const std::string_view& text, const size_t pos, const size_t erased, const size_t inserted)
+{
+	if (mChunks == 0 || pos + erased > length() || length() - erased + inserted != text.length()) //The index doesn't match the row the edit was made to
+	{
+		build(text);
+		return;
+	}
+
+	Memory::Scope memoryScope(Memory::Subsystem::Rendered);
+	size_t start, lastStart;
+	size_t first = chunkAt(pos, start);
+	if (first > 0 && pos == start)
+	{
+		--first;
+		start -= mTree[mLeaves + first].bytes;
+	}
+	const size_t last = chunkAt(pos + erased, lastStart);
+	const size_t end = lastStart + mTree[mLeaves + last].bytes - erased + inserted;
+
+	std::vector<Span> chunks;
+	split(text, start, end, chunks);
+	if (chunks.size() == last - first + 1)
+	{
+		for (size_t chunk = first; chunk <= last; ++chunk)
+		{
+			setChunk(chunk, chunks[chunk - first]);
+		}
+		return;
+	}
+
+	//The edit changed how many chunks the text around it takes, so the leaves are spliced and the tree summed again in O(n)
+	std::vector<Span> leaves(mTree.begin() + mLeaves, mTree.begin() + mLeaves + mChunks);
+	leaves.erase(leaves.begin() + first, leaves.begin() + last + 1);
+	leaves.insert(leaves.begin() + first, chunks.begin(), chunks.end());
+	buildTree(leaves);
+}
+
+/// <summary>
+/// The length of the row the index was built for
+/// </summary>
+size_t ColumnIndex::length() const
+{
+	return mTree.empty() ? 0 : mTree[1].bytes;
+}
+
+/// <summary>
+/// The column the character at byte 'pos' is drawn at, as Unicode::column() finds it
+/// </summary>
+size_t ColumnIndex::column(const std::string_view& text, const size_t pos) const
+{
+	if (mChunks == 0) return Unicode::column(text, pos);
+	size_t node = 1, start = 0, col = 0;
+	const size_t target = std::min(pos, length());
+	while (node < mLeaves)
+	{
+		const Span& left = mTree[2 * node];
+		if (target - start < left.bytes)
+		{
+			node = 2 * node;
+		}
+		else
+		{
+			col = advance(col, left);
+			start += left.bytes;
+			node = 2 * node + 1;
+		}
+	}
+
+	const std::string_view chunk = text.substr(start, mTree[node].bytes);
+	const size_t offset = target - start;
+	const size_t tab = findTab(chunk.substr(0, offset));
+	if (tab == std::string_view::npos) return col + Unicode::column(chunk, offset);
+	if (offset < Unicode::nextCharacter(chunk, tab)) return col + Unicode::column(chunk, tab); //Inside the tab, or something joined onto it
+	return nextTabStop(col + Unicode::column(chunk, tab)) + Unicode::column(chunk.substr(tab + 1), offset - tab - 1);
+}
+
+/// <summary>
+/// Finds the character drawn over 'targetColumn', as Unicode::indexAtColumn() finds it
+/// </summary>
+/// <returns>Where the character starts, or the length of the text if it ends before the column</returns>
+size_t ColumnIndex::indexAtColumn(const std::string_view& text, const size_t targetColumn) const
+{
+	if (mChunks == 0) return Unicode::indexAtColumn(text, targetColumn);
+	if (advance(0, mTree[1]) <= targetColumn) return text.length();
+	size_t node = 1, start = 0, col = 0;
+	while (node < mLeaves)
+	{
+		const Span& left = mTree[2 * node];
+		const size_t leftEnd = advance(col, left);
+		if (leftEnd > targetColumn)
+		{
+			node = 2 * node;
+		}
+		else
+		{
+			col = leftEnd;
+			start += left.bytes;
+			node = 2 * node + 1;
+		}
+	}
+
+	//The character is in this chunk, which starts at or before the column
+	const std::string_view chunk = text.substr(start, mTree[node].bytes);
+	const size_t tab = findTab(chunk);
+	if (tab == std::string_view::npos) return start + Unicode::indexAtColumn(chunk, targetColumn - col);
+	const size_t beforeTab = Unicode::column(chunk, tab);
+	if (col + beforeTab > targetColumn) return start + Unicode::indexAtColumn(chunk.substr(0, tab), targetColumn - col);
+	const size_t tabStop = nextTabStop(col + beforeTab);
+	if (tabStop > targetColumn) return start + tab;
+	return start + tab + 1 + Unicode::indexAtColumn(chunk.substr(tab + 1), targetColumn - tabStop);
+}
+
+/// <summary>
+/// The span of two runs of text, one after the other
+/// </summary>
+ColumnIndex::Span ColumnIndex::combine(const Span& left, const Span& right)
+{
+	Span span;
+	span.bytes = left.bytes + right.bytes;
+	span.tab = left.tab || right.tab;
+	if (!left.tab)
+	{
+		span.width = left.width + right.width;
+		span.afterTab = right.afterTab;
+	}
+	else
+	{
+		span.width = left.width;
+		span.afterTab = right.tab ? nextTabStop(left.afterTab + right.width) + right.afterTab : left.afterTab + right.width; //The left run ends a tab stop plus afterTab in
+	}
+	return span;
+}
+
+/// <summary>
+/// The column a run of text starting at 'column' ends at
+/// </summary>
+size_t ColumnIndex::advance(const size_t column, const Span& span)
+{
+	return span.tab ? nextTabStop(column + span.width) + span.afterTab : column + span.width;
+}
+
+ColumnIndex::Span ColumnIndex::measure(const std::string_view& text)
+{
+	Span span;
+	span.bytes = text.length();
+	const size_t tab = findTab(text);
+	span.tab = tab != std::string_view::npos;
+	span.width = Unicode::column(text, span.tab ? tab : text.length());
+	if (span.tab) span.afterTab = Unicode::column(text.substr(tab + 1), text.length() - tab - 1);
+	return span;
+}
+
+/// <summary>
+/// Splits text[start, end) into chunks of about chunkBytes, cut at the start of a character, and measures them
+/// </summary>
+void ColumnIndex::split(const std::string_view& text, const size_t start, const size_t end, std::vector<Span>& chunks)
+{
+	const size_t count = std::max<size_t>(1, (end - start + chunkBytes / 2) / chunkBytes);
+	size_t chunkStart = start;
+	for (size_t i = 1; i <= count; ++i)
+	{
+		size_t chunkEnd = i == count ? end : Unicode::characterStart(text, start + (end - start) * i / count);
+		if (chunkEnd <= chunkStart) chunkEnd = std::min(Unicode::nextCharacter(text, chunkStart), end); //A character longer than a chunk
+		if (chunkEnd == chunkStart) continue;
+		chunks.push_back(measure(text.substr(chunkStart, chunkEnd - chunkStart)));
+		chunkStart = chunkEnd;
+	}
+	if (chunks.empty()) chunks.push_back(Span()); //An empty row still has a chunk to edit
+}
+
+/// <summary>
+/// Finds the chunk holding byte 'pos'. The end of the row is in the last chunk
+/// </summary>
+/// <param name="start">Set to where the chunk starts</param>
+size_t ColumnIndex::chunkAt(const size_t pos, size_t& start) const
+{
+	size_t node = 1;
+	start = 0;
+	while (node < mLeaves)
+	{
+		const Span& left = mTree[2 * node];
+		if (pos - start < left.bytes || mTree[2 * node + 1].bytes == 0) //Padding leaves past the last chunk are empty
+		{
+			node = 2 * node;
+		}
+		else
+		{
+			start += left.bytes;
+			node = 2 * node + 1;
+		}
+	}
+	return node - mLeaves;
+}
+
+/// <summary>
+/// Sums the chunks into the tree in O(n), from the leaves up
+/// </summary>
+void ColumnIndex::buildTree(const std::vector<Span>& chunks)
+{
+	mChunks = chunks.size();
+	mLeaves = std::bit_ceil(std::max<size_t>(mChunks, 1));
+	mTree.assign(2 * mLeaves, Span());
+	std::copy(chunks.begin(), chunks.end(), mTree.begin() + mLeaves);
+	for (size_t node = mLeaves - 1; node > 0; --node)
+	{
+		mTree[node] = combine(mTree[2 * node], mTree[2 * node + 1]);
+	}
+}
+
+/// <summary>
+/// Replaces one chunk and sums its ancestors again in O(log n)
+/// </summary>
+void ColumnIndex::setChunk(const size_t chunk, const Span& span)
+{
+	size_t node = mLeaves + chunk;
+	mTree[node] = span;
+	for (node /= 2; node > 0; node /= 2)
+	{
+		mTree[node] = combine(mTree[2 * node], mTree[2 * node + 1]);
+	}
+}
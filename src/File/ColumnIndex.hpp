@@ -0,0 +1,73 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/// <summary>
+/// Finds columns in a very long row without measuring it from the start. The row is split into chunks of about chunkBytes, each starting
+/// at a character, and a segment tree keeps how many bytes and columns each run of chunks covers. Looking up the column of a byte, or the byte
+/// at a column, walks down the tree and then measures part of one chunk. An edit measures the chunks it touched again and updates their
+/// ancestors in O(log n). Tabs make a chunk's width depend on the column it starts at, so a chunk with a tab keeps the width before its first tab
+/// and the width after it, which starts on a tab stop
+/// </summary>
+class ColumnIndex
+{
+public:
+	static constexpr size_t minLineLength = 64 << 10; //Shorter rows are measured from their start, which is as fast as keeping an index of them
+
+	void build(const std::string_view& text);
+	void edit(const std::string_view& text, const size_t pos, const size_t erased, const size_t inserted);
+	size_t length() const;
+	size_t column(const std::string_view& text, const size_t pos) const;
+	size_t indexAtColumn(const std::string_view& text, const size_t targetColumn) const;
+
+private:
+	/// <summary>
+	/// The bytes and columns of a run of text
+	/// </summary>
+	struct Span
+	{
+		size_t bytes = 0;
+		size_t width = 0; //The columns before the first tab, or of the whole run if it has none
+		size_t afterTab = 0; //The columns after the first tab
+		bool tab = false;
+	};
+
+	static Span combine(const Span& left, const Span& right);
+	static size_t advance(const size_t column, const Span& span);
+	static Span measure(const std::string_view& text);
+	static void split(const std::string_view& text, const size_t start, const size_t end, std::vector<Span>& chunks);
+	size_t chunkAt(const size_t pos, size_t& start) const;
+	void buildTree(const std::vector<Span>& chunks);
+	void setChunk(const size_t chunk, const Span& span);
+
+private:
+	static constexpr size_t chunkBytes = 4096;
+
+	std::vector<Span> mTree; //mTree[1] is the root and node n has children 2n and 2n + 1. The chunks are the leaves from mLeaves on
+	size_t mLeaves = 0, mChunks = 0;
+};
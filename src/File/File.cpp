@@ -23,59 +23,82 @@ SOFTWARE.
 */
 
 #include "File.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <functional>
 
 namespace FileHandler
 {
-	std::string _fileName = "";
-
 	/// <summary>
-	/// Gets and sets the _fileName property
+	/// Reads the whole file. Returns an empty string if it doesn't exist yet
 	/// </summary>
-	/// <param name="fName"></param>
+	/// <param name="fileName">The file to load, relative to the current directory</param>
 	/// <returns></returns>
-	std::string& fileName(const std::string_view& fName)
+	std::string loadFileContents(const std::string_view& fileName)
 	{
-		if (!fName.empty())
-		{
-			_fileName = fName;
-		}
-		return _fileName;
+		TRACE_SCOPE("loadFileContents");
+		Memory::Scope memoryScope(Memory::Subsystem::Text);
+		std::filesystem::path path = std::filesystem::current_path() / fileName;
+		std::ifstream file(path);
+		std::string contents;
+		if (!file) return contents;
+
+		file.seekg(0, std::ios::end);
+		contents.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0, std::ios::beg);
+		file.read(contents.data(), contents.length());
+		contents.resize(static_cast<size_t>(file.gcount())); //Fewer characters are read than the file size if line endings are converted
+		return contents;
 	}
 
 	/// <summary>
-	/// Loads a stringstream with file contents and returns the vector of rows built from the file
+	/// Gets the modification time and size of the file
 	/// </summary>
-	/// <returns></returns>
-	std::vector<Row> loadFileContents()
+	/// <param name="fileName">The file, relative to the current directory</param>
+	/// <returns>A stamp with exists = false if the file doesn't exist</returns>
+	FileStamp fileStamp(const std::string_view& fileName)
 	{
-		std::filesystem::path path = std::filesystem::current_path() / _fileName;
-		std::ifstream file(path);
-		std::stringstream ss;
-		ss << file.rdbuf();
-		file.close();
+		const std::filesystem::path path = std::filesystem::current_path() / fileName;
+		std::error_code error;
+		FileStamp stamp;
+		stamp.modified = std::filesystem::last_write_time(path, error);
+		if (error) return FileStamp();
+		stamp.size = std::filesystem::file_size(path, error);
+		stamp.exists = !error;
+		return stamp;
+	}
 
-		return loadRows(std::move(ss.str()));
+	/// <summary>
+	/// Hashes a file's contents, to tell a file that was rewritten with what it held before from one that changed
+	/// </summary>
+	uint64_t hashText(const std::string_view& text)
+	{
+		TRACE_SCOPE("hashText");
+		return std::hash<std::string_view>()(text);
 	}
 
 	/// <summary>
-	/// Builds a vector of rows from the file
+	/// Splits text into rows. The rows point into the text rather than copying it, so it must outlive them and never change
 	/// </summary>
-	/// <param name="str"></param>
-	std::vector<Row> loadRows(std::string&& str)
+	/// <param name="text"></param>
+	std::vector<Row> loadRows(const std::string_view& text)
 	{
+		TRACE_SCOPE("loadRows");
+		Memory::Scope memoryScope(Memory::Subsystem::Text);
 		std::vector<Row> contents;
-		if (str.length() > 0)
+		if (text.length() > 0)
 		{
-			size_t lineBreak = 0;
-			while ((lineBreak = str.find('\n')) != std::string::npos)
+			contents.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+			size_t lineStart = 0, lineBreak = 0;
+			while ((lineBreak = text.find('\n', lineStart)) != std::string_view::npos)
 			{
-				contents.emplace_back(str.substr(0, lineBreak));
-				str.erase(str.begin(), str.begin() + lineBreak + 1);
+				contents.emplace_back(Line::borrow(text.substr(lineStart, lineBreak - lineStart)));
+				lineStart = lineBreak + 1;
 			}
-			contents.emplace_back(str.substr(0, str.length()));
-			str.clear();
+			contents.emplace_back(Line::borrow(text.substr(lineStart)));
 		}
 		return contents;
 	}
@@ -83,10 +106,12 @@ namespace FileHandler
 	/// <summary>
 	/// Writes the current contents to the file
 	/// </summary>
+	/// <param name="fileName">The file to write, relative to the current directory</param>
 	/// <param name="newContents"></param>
-	void saveFile(const std::string_view& newContents)
+	void saveFile(const std::string_view& fileName, const std::string_view& newContents)
 	{
-		std::filesystem::path path = std::filesystem::current_path() / _fileName;
+		TRACE_SCOPE("saveFile");
+		std::filesystem::path path = std::filesystem::current_path() / fileName;
 		std::ofstream file(path);
 		file << newContents;
 	}
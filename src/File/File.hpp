@@ -23,20 +23,37 @@ SOFTWARE.
 */
 
 #pragma once
+#include "Line.hpp"
+
 #include <string>
 #include <vector>
+#include <filesystem>
+#include <cstdint>
 
 namespace FileHandler
 {
 	struct Row
 	{
-		std::string line;
+		Line line;
 		std::string renderedLine;
 	};
 
-	std::string& fileName(const std::string_view& fName = "");
-	std::vector<Row> loadFileContents();
-	std::vector<Row> loadRows(std::string&&);
-	void saveFile(const std::string_view& newContents);
+	/// <summary>
+	/// What a file looked like on disk when it was read or written, so a change by another program can be noticed without reading it
+	/// </summary>
+	struct FileStamp
+	{
+		std::filesystem::file_time_type modified{};
+		uintmax_t size = 0;
+		bool exists = false;
+
+		bool operator==(const FileStamp& other) const = default;
+	};
+
+	std::string loadFileContents(const std::string_view& fileName);
+	FileStamp fileStamp(const std::string_view& fileName);
+	uint64_t hashText(const std::string_view& text);
+	std::vector<Row> loadRows(const std::string_view& text);
+	void saveFile(const std::string_view& fileName, const std::string_view& newContents);
 
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "FileWatcher.hpp"
+#include <filesystem>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher() : mLastPoll(std::chrono::steady_clock::now())
+{
+#ifdef __linux__
+	mNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (mNotify >= 0) close(mNotify);
+#endif
+}
+
+/// <summary>
+/// Starts watching a file. Its directory is watched rather than the file, so the file being replaced or created is seen too
+/// </summary>
+/// <param name="fileName">The file, relative to the current directory. It doesn't have to exist yet</param>
+void FileWatcher::watch(const std::string_view& fileName)
+{
+	if (std::any_of(mFiles.begin(), mFiles.end(), [&](const Watched& watched) { return watched.fileName == fileName; })) return;
+	const std::filesystem::path path = std::filesystem::current_path() / fileName;
+	Watched watched{ std::string(fileName), path.parent_path().string(), path.filename().string() };
+#ifdef __linux__
+	if (mNotify >= 0) //Directories already watched get the same watch back
+	{
+		watched.watch = inotify_add_watch(mNotify, watched.directory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+	}
+#endif
+	mFiles.push_back(std::move(watched));
+}
+
+/// <summary>
+/// Gets the files that may have changed since the last call. They still have to be checked, as a directory's events don't say much
+/// </summary>
+/// <param name="fileNames">Set to the names of the files, as they were given to watch()</param>
+void FileWatcher::changed(std::vector<std::string>& fileNames)
+{
+	fileNames.clear();
+	const auto now = std::chrono::steady_clock::now();
+	if (now - mLastPoll >= pollInterval)
+	{
+		mLastPoll = now;
+		for (const Watched& watched : mFiles) fileNames.push_back(watched.fileName);
+	}
+
+#ifdef __linux__
+	if (mNotify < 0) return;
+	alignas(inotify_event) char events[4096];
+	ssize_t length;
+	while ((length = read(mNotify, events, sizeof(events))) > 0)
+	{
+		for (ssize_t pos = 0; pos < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(events + pos);
+			pos += sizeof(inotify_event) + event->len;
+			const std::string_view name = event->len > 0 ? std::string_view(event->name) : std::string_view();
+			for (const Watched& watched : mFiles)
+			{
+				if (watched.watch != event->wd || watched.name != name) continue;
+				if (std::find(fileNames.begin(), fileNames.end(), watched.fileName) == fileNames.end()) fileNames.push_back(watched.fileName);
+			}
+		}
+	}
+#endif
+}
@@ -0,0 +1,61 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+#include <string_view>
+#include <chrono>
+
+/// <summary>
+/// Tells which open files another program may have changed. On Linux their directories are watched with inotify, whose events are
+/// read without blocking, so the files are only looked at once something happened to them. Every file is also reported once per
+/// pollInterval, which is all other platforms get, and catches changes inotify can't see (through a symbolic link, or on a network drive)
+/// </summary>
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void watch(const std::string_view& fileName);
+	void changed(std::vector<std::string>& fileNames);
+
+private:
+	struct Watched
+	{
+		std::string fileName; //As it was opened
+		std::string directory, name; //Where it is, as inotify reports it
+		int watch = -1;
+	};
+
+private:
+	static constexpr std::chrono::milliseconds pollInterval{ 1000 };
+
+	std::vector<Watched> mFiles;
+	int mNotify = -1;
+	std::chrono::steady_clock::time_point mLastPoll;
+};
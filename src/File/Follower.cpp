@@ -0,0 +1,208 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Follower.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <system_error>
+#else
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Starts following the file
+/// </summary>
+/// <param name="fileName">The file to follow, relative to the current directory</param>
+/// <param name="offset">How much of the file has been read already. Only what comes after it is read</param>
+Follower::Follower(const std::string_view& fileName, const uint64_t offset)
+	: mFileName((std::filesystem::current_path() / fileName).string()), mOffset(offset)
+{
+	uint64_t size = 0;
+	mMissing = !fileStatus(mFileName, size, mIdentity);
+	mWorker = std::thread(&Follower::worker, this);
+}
+
+Follower::~Follower()
+{
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		mStop = true;
+	}
+	mChanged.notify_all();
+	if (mWorker.joinable()) mWorker.join();
+}
+
+/// <summary>
+/// Takes the oldest read that hasn't been taken yet
+/// </summary>
+/// <param name="appended">Set to the read</param>
+/// <returns>False if nothing new has been read</returns>
+bool Follower::take(Appended& appended)
+{
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		if (mQueue.empty()) return false;
+		appended = std::move(mQueue.front());
+		mQueue.pop_front();
+	}
+	mChanged.notify_all();
+	return true;
+}
+
+/// <summary>
+/// Reads until it has caught up with the file, then waits for the file to change. On Linux the file's directory is watched with inotify,
+/// which also sees the file being replaced. Elsewhere, or if the watch can't be set up, the file is checked every pollInterval
+/// </summary>
+void Follower::worker()
+{
+#ifdef __linux__
+	int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (notify >= 0 && inotify_add_watch(notify, std::filesystem::path(mFileName).parent_path().c_str(),
+		IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0)
+	{
+		close(notify);
+		notify = -1;
+	}
+#endif
+
+	while (!mStop)
+	{
+		while (!mStop && readAppended()) {}
+
+#ifdef __linux__
+		if (notify >= 0)
+		{
+			//Times out now and then so a stop is noticed, and so a file the watch can't see (through a symbolic link, say) is still checked
+			pollfd events{ notify, POLLIN, 0 };
+			if (poll(&events, 1, static_cast<int>(pollInterval.count())) > 0)
+			{
+				char buffer[4096];
+				while (read(notify, buffer, sizeof(buffer)) > 0) {} //Every event means the same thing: check the file again
+			}
+			continue;
+		}
+#endif
+		std::unique_lock<std::mutex> lock(mMutex);
+		mChanged.wait_for(lock, pollInterval, [this]() { return mStop.load(); });
+	}
+
+#ifdef __linux__
+	if (notify >= 0) close(notify);
+#endif
+}
+
+/// <summary>
+/// Reads up to bytesPerRead of what was appended to the file since the last read, and queues it split into rows.
+/// If the file shrank or was replaced, it is read from the start instead
+/// </summary>
+/// <returns>True if anything was read, so there may be more to read</returns>
+bool Follower::readAppended()
+{
+	uint64_t size = 0;
+	Identity identity;
+	if (!fileStatus(mFileName, size, identity))
+	{
+		mMissing = true; //Removed or renamed, and not recreated yet
+		return false;
+	}
+	const bool reload = mMissing || identity != mIdentity || size < mOffset;
+	if (reload)
+	{
+		mOffset = 0;
+		mIdentity = identity;
+		mMissing = false;
+	}
+	else if (size == mOffset) return false;
+
+	TRACE_SCOPE("Follower::read");
+	Memory::Scope memoryScope(Memory::Subsystem::Text);
+	std::ifstream file(mFileName, std::ios::binary);
+	if (!file) return false;
+	file.seekg(static_cast<std::streamoff>(mOffset));
+	auto text = std::make_unique<std::string>(static_cast<size_t>(std::min<uint64_t>(bytesPerRead, size - mOffset)), '\0');
+	file.read(text->data(), static_cast<std::streamsize>(text->size()));
+	text->resize(static_cast<size_t>(file.gcount()));
+	if (text->empty() && !reload) return false;
+	mOffset += text->size();
+
+	//Split like loadRows, except that the piece before the first line ending is always kept, as it finishes the last row read before
+	Appended appended;
+	appended.end = mOffset;
+	appended.reload = reload;
+	const std::string_view view(*text);
+	appended.rows.reserve(std::count(view.begin(), view.end(), '\n') + 1);
+	size_t lineStart = 0;
+	for (const char* lineBreak = view.data(); (lineBreak = static_cast<const char*>(std::memchr(lineBreak, '\n', view.data() + view.length() - lineBreak))) != nullptr; ++lineBreak)
+	{
+		const size_t end = lineBreak - view.data();
+		appended.rows.push_back(FileHandler::Row{ Line::borrow(view.substr(lineStart, end - lineStart)), std::string() });
+		lineStart = end + 1;
+	}
+	appended.rows.push_back(FileHandler::Row{ Line::borrow(view.substr(lineStart)), std::string() });
+	appended.text = std::move(text);
+	return queue(std::move(appended));
+}
+
+/// <summary>
+/// Adds a read to the queue, waiting for room if the editor hasn't taken the earlier ones yet
+/// </summary>
+/// <returns>False if the follower was stopped while waiting</returns>
+bool Follower::queue(Appended&& appended)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mChanged.wait(lock, [this]() { return mStop || mQueue.size() < maxQueued; });
+	if (mStop) return false;
+	mQueue.push_back(std::move(appended));
+	return true;
+}
+
+/// <summary>
+/// Gets the size of the file, and what identifies it so a replacement is noticed
+/// </summary>
+/// <returns>False if the file doesn't exist</returns>
+bool Follower::fileStatus(const std::string& fileName, uint64_t& size, Identity& identity)
+{
+#ifdef _WIN32
+	std::error_code error;
+	size = std::filesystem::file_size(fileName, error); //A replaced file is only noticed if it is smaller than the part already read
+	return !error;
+#else
+	struct stat status;
+	if (stat(fileName.c_str(), &status) != 0) return false;
+	size = static_cast<uint64_t>(status.st_size);
+	identity = Identity{ static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino) };
+	return true;
+#endif
+}
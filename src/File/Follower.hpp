@@ -0,0 +1,92 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File.hpp"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// <summary>
+/// Watches a file that is being written to (a log, say) and reads whatever is appended to it in the background, the way tail -f does.
+/// Only the bytes after the part already read are ever read, and they are split into rows on the worker, so the editor only has to
+/// append them. If the file is truncated or replaced (log rotation), it is read again from the start
+/// </summary>
+class Follower
+{
+public:
+	/// <summary>
+	/// Text read from the file and split into rows
+	/// </summary>
+	struct Appended
+	{
+		std::unique_ptr<const std::string> text; //What was read. The rows point into it, so it must be kept for as long as they are
+		std::vector<FileHandler::Row> rows; //The first row continues the last row read before, which may have been written without its line ending yet
+		uint64_t end = 0; //How much of the file has been read, up to the end of this read
+		bool reload = false; //The file was truncated or replaced, so these rows replace the rows read before rather than following them
+	};
+
+	Follower(const std::string_view& fileName, const uint64_t offset);
+	~Follower();
+	Follower(const Follower&) = delete;
+	Follower& operator=(const Follower&) = delete;
+
+	bool take(Appended& appended);
+
+private:
+	struct Identity
+	{
+		uint64_t device = 0, inode = 0;
+		bool operator!=(const Identity& other) const { return device != other.device || inode != other.inode; }
+	};
+
+	void worker();
+	bool readAppended();
+	bool queue(Appended&& appended);
+	static bool fileStatus(const std::string& fileName, uint64_t& size, Identity& identity);
+
+private:
+	static constexpr size_t bytesPerRead = 4 << 20; //The most read at once, so a burst of writes is picked up in several steps rather than one stall
+	static constexpr size_t maxQueued = 16; //Reads waiting to be taken. The worker waits when the editor falls this far behind
+	static constexpr std::chrono::milliseconds pollInterval{ 100 }; //How often the file is checked without notifications, and how long a wait for one lasts
+
+	const std::string mFileName;
+	uint64_t mOffset; //How much of the file has been read
+	Identity mIdentity;
+	bool mMissing = false; //The file went away, so when it is there again it is read from the start
+	std::deque<Appended> mQueue;
+	std::mutex mMutex; //Guards mQueue
+	std::condition_variable mChanged; //Signalled when a read is taken from the queue or the follower is stopped
+	std::atomic<bool> mStop = false;
+	std::thread mWorker;
+};
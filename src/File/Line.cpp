@@ -0,0 +1,303 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Line.hpp"
+#include "Memory/Memory.hpp"
+#include "Unicode/Unicode.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+static constexpr size_t minChunkBytes = 16;
+static constexpr uint8_t slabClasses = 9; //Lines of up to 4KB get their chunks from slabs, longer ones straight from operator new
+static constexpr size_t slabBytes = 64 * 1024;
+
+struct FreeChunk
+{
+	FreeChunk* next;
+};
+
+/// <summary>
+/// The slabs of one size class. Chunks given back are kept on a free list and handed out before the slab grows
+/// </summary>
+struct SlabClass
+{
+	FreeChunk* freeChunks;
+	char* slabPos; //The unused part of the newest slab
+	char* slabEnd;
+};
+
+//Each thread carves its own slabs, one set per memory subsystem so the slabs are charged to it. Slabs are never freed,
+//so a chunk given back on another thread (or after its thread has exited) only moves to that thread's free list
+static thread_local std::array<std::array<SlabClass, slabClasses>, static_cast<size_t>(Memory::Subsystem::EnumCount)> slabs;
+
+/// <summary>
+/// The smallest size class holding 'capacity' bytes
+/// </summary>
+static uint8_t sizeClassFor(const size_t capacity)
+{
+	if (capacity > UINT32_MAX) throw std::length_error("Line is longer than 4GB");
+	return capacity <= minChunkBytes ? 0 : static_cast<uint8_t>(std::bit_width(capacity - 1) - std::bit_width(minChunkBytes - 1));
+}
+
+static char* allocateChunk(const uint8_t sizeClass, const Memory::Subsystem subsystem)
+{
+	const size_t chunkBytes = minChunkBytes << sizeClass;
+	if (sizeClass >= slabClasses) return static_cast<char*>(operator new(chunkBytes));
+
+	SlabClass& slab = slabs[static_cast<size_t>(subsystem)][sizeClass];
+	if (slab.freeChunks != nullptr)
+	{
+		FreeChunk* chunk = slab.freeChunks;
+		slab.freeChunks = chunk->next;
+		return reinterpret_cast<char*>(chunk);
+	}
+	if (slab.slabPos == slab.slabEnd)
+	{
+		slab.slabPos = static_cast<char*>(operator new(slabBytes)); //Charged to the subsystem being allocated for, as it is the current one
+		slab.slabEnd = slab.slabPos + slabBytes;
+	}
+	char* chunk = slab.slabPos;
+	slab.slabPos += chunkBytes;
+	return chunk;
+}
+
+static void freeChunk(char* chunk, const uint8_t sizeClass, const Memory::Subsystem subsystem)
+{
+	if (sizeClass >= slabClasses)
+	{
+		operator delete(chunk);
+		return;
+	}
+	SlabClass& slab = slabs[static_cast<size_t>(subsystem)][sizeClass];
+	FreeChunk* freed = reinterpret_cast<FreeChunk*>(chunk);
+	freed->next = slab.freeChunks;
+	slab.freeChunks = freed;
+}
+
+/// <summary>
+/// Copies text into a chunk owned by this line
+/// </summary>
+Line::Line(const std::string_view& text)
+{
+	if (text.empty()) return;
+	reserve(text.length());
+	std::memcpy(mData, text.data(), text.length());
+	mLength = static_cast<uint32_t>(text.length());
+}
+
+/// <summary>
+/// Copies a line. Borrowed text is shared rather than copied
+/// </summary>
+Line::Line(const Line& other)
+{
+	if (other.mSizeClass == borrowedClass)
+	{
+		mData = other.mData;
+		mLength = other.mLength;
+		mTextKind = other.mTextKind;
+		return;
+	}
+	*this = std::string_view(other);
+	mTextKind = other.mTextKind;
+}
+
+Line::Line(Line&& other) noexcept : mData(other.mData), mLength(other.mLength), mSizeClass(other.mSizeClass), mSubsystem(other.mSubsystem), mTextKind(other.mTextKind)
+{
+	other.mData = nullptr;
+	other.mLength = 0;
+	other.mSizeClass = borrowedClass;
+}
+
+Line::~Line()
+{
+	release();
+}
+
+Line& Line::operator=(const Line& other)
+{
+	if (this == &other) return *this;
+	if (other.mSizeClass == borrowedClass)
+	{
+		release();
+		mData = other.mData;
+		mLength = other.mLength;
+		mTextKind = other.mTextKind;
+		return *this;
+	}
+	*this = std::string_view(other);
+	mTextKind = other.mTextKind;
+	return *this;
+}
+
+Line& Line::operator=(Line&& other) noexcept
+{
+	if (this == &other) return *this;
+	release();
+	mData = other.mData;
+	mLength = other.mLength;
+	mSizeClass = other.mSizeClass;
+	mSubsystem = other.mSubsystem;
+	mTextKind = other.mTextKind;
+	other.mData = nullptr;
+	other.mLength = 0;
+	other.mSizeClass = borrowedClass;
+	return *this;
+}
+
+/// <summary>
+/// Replaces the text with a copy of 'text', reusing the chunk if it is big enough
+/// </summary>
+Line& Line::operator=(const std::string_view& text)
+{
+	if (mSizeClass != borrowedClass && text.length() <= (minChunkBytes << mSizeClass))
+	{
+		std::memmove(mData, text.data(), text.length()); //The text may be part of this line
+		mLength = static_cast<uint32_t>(text.length());
+		mTextKind = unknownText;
+		return *this;
+	}
+	Line copy(text);
+	return *this = std::move(copy);
+}
+
+/// <summary>
+/// Makes a line pointing into text owned by someone else, which must outlive every copy of the line and never change
+/// </summary>
+Line Line::borrow(const std::string_view& text)
+{
+	Line line;
+	line.mData = const_cast<char*>(text.data()); //Never written through: the first edit copies the text into a chunk
+	line.mLength = static_cast<uint32_t>(text.length());
+	return line;
+}
+
+/// <summary>
+/// Copies part of the line. Part of borrowed text is borrowed as well, so it costs nothing however long it is
+/// </summary>
+Line Line::slice(const size_t pos, const size_t count) const
+{
+	const std::string_view text = std::string_view(*this).substr(pos, count);
+	if (mSizeClass == borrowedClass) return borrow(text);
+	return Line(text);
+}
+
+void Line::insert(const size_t pos, const char c)
+{
+	insert(pos, std::string_view(&c, 1));
+}
+
+void Line::insert(const size_t pos, const std::string_view& text)
+{
+	if (pos > mLength) throw std::out_of_range("Line::insert");
+	if (text.data() >= mData && text.data() < mData + mLength) //Growing may free the text before it is copied
+	{
+		insert(pos, std::string_view(std::string(text)));
+		return;
+	}
+	reserve(mLength + text.length());
+	std::memmove(mData + pos + text.length(), mData + pos, mLength - pos);
+	std::memcpy(mData + pos, text.data(), text.length());
+	mLength += static_cast<uint32_t>(text.length());
+	if (mTextKind == asciiText && !Unicode::isAscii(text)) mTextKind = unicodeText;
+}
+
+/// <summary>
+/// Removes up to 'count' characters from pos. Cutting the start or end off borrowed text only moves the view of it
+/// </summary>
+void Line::erase(const size_t pos, const size_t count)
+{
+	if (pos > mLength) throw std::out_of_range("Line::erase");
+	const size_t erased = std::min(count, mLength - pos);
+	if (erased == 0) return;
+	if (mTextKind == unicodeText) mTextKind = unknownText; //The non-ASCII text may have been erased
+	if (mSizeClass == borrowedClass && (pos == 0 || pos + erased == mLength))
+	{
+		if (pos == 0) mData += erased;
+		mLength -= static_cast<uint32_t>(erased);
+		return;
+	}
+	reserve(mLength);
+	std::memmove(mData + pos, mData + pos + erased, mLength - pos - erased);
+	mLength -= static_cast<uint32_t>(erased);
+}
+
+void Line::append(const std::string_view& text)
+{
+	insert(mLength, text);
+}
+
+void Line::push_back(const char c)
+{
+	insert(mLength, c);
+}
+
+/// <summary>
+/// Empties the line. An owned chunk is kept for the next edit
+/// </summary>
+void Line::clear()
+{
+	if (mSizeClass == borrowedClass) mData = nullptr;
+	mLength = 0;
+	mTextKind = asciiText;
+}
+
+/// <summary>
+/// True if every byte of the text is ASCII, so each one is a character taking one column (besides tabs)
+/// </summary>
+bool Line::isAscii() const
+{
+	if (mTextKind == unknownText) mTextKind = Unicode::isAscii(*this) ? asciiText : unicodeText;
+	return mTextKind == asciiText;
+}
+
+/// <summary>
+/// Makes sure the line owns a chunk of at least 'capacity' bytes, copying borrowed text into it
+/// </summary>
+void Line::reserve(const size_t capacity)
+{
+	if (mSizeClass != borrowedClass && capacity <= (minChunkBytes << mSizeClass)) return;
+
+	const uint8_t sizeClass = sizeClassFor(capacity);
+	const Memory::Subsystem subsystem = Memory::current();
+	char* chunk = allocateChunk(sizeClass, subsystem);
+	if (mLength > 0) std::memcpy(chunk, mData, mLength);
+	release();
+	mData = chunk;
+	mSizeClass = sizeClass;
+	mSubsystem = static_cast<uint8_t>(subsystem);
+}
+
+/// <summary>
+/// Gives an owned chunk back to its slab. The length is left for the caller to set
+/// </summary>
+void Line::release()
+{
+	if (mSizeClass != borrowedClass) freeChunk(mData, mSizeClass, static_cast<Memory::Subsystem>(mSubsystem));
+	mData = nullptr;
+	mSizeClass = borrowedClass;
+}
@@ -0,0 +1,92 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// The text of a row. A loaded row points into the buffer's copy of the file instead of owning its text, so loading
+/// and copying unedited rows (e.g. for an undo snapshot) never allocates. The first edit copies the text into a chunk
+/// of a size class slab, and freed chunks are reused by the next line of the same size class.
+/// Reads go through std::string_view, and edits take column positions rather than iterators.
+/// Whether the text is all ASCII is worked out the first time it is asked and kept until an edit could change it
+/// </summary>
+class Line
+{
+public:
+	static constexpr size_t npos = std::string_view::npos;
+
+	Line() = default;
+	Line(const std::string_view& text);
+	Line(const Line& other);
+	Line(Line&& other) noexcept;
+	~Line();
+	Line& operator=(const Line& other);
+	Line& operator=(Line&& other) noexcept;
+	Line& operator=(const std::string_view& text);
+
+	static Line borrow(const std::string_view& text);
+
+	size_t length() const { return mLength; }
+	size_t size() const { return mLength; }
+	bool empty() const { return mLength == 0; }
+	const char* data() const { return mData; }
+	const char* begin() const { return mData; }
+	const char* end() const { return mData + mLength; }
+	char operator[](const size_t pos) const { return mData[pos]; }
+	operator std::string_view() const { return std::string_view(mData, mLength); }
+	std::string str() const { return std::string(mData, mLength); }
+	std::string substr(const size_t pos, const size_t count = npos) const { return std::string(std::string_view(*this).substr(pos, count)); }
+	Line slice(const size_t pos, const size_t count = npos) const;
+	bool isAscii() const;
+
+	void insert(const size_t pos, const char c);
+	void insert(const size_t pos, const std::string_view& text);
+	void erase(const size_t pos, const size_t count = npos);
+	void append(const std::string_view& text);
+	void push_back(const char c);
+	void clear();
+
+private:
+	void reserve(const size_t capacity);
+	void release();
+
+private:
+	static constexpr uint8_t borrowedClass = UINT8_MAX; //The text isn't owned: it is empty or points into a loaded file
+	enum TextKind : uint8_t { unknownText, asciiText, unicodeText };
+
+	char* mData = nullptr;
+	uint32_t mLength = 0;
+	uint8_t mSizeClass = borrowedClass; //Owned text has a capacity of 16 << mSizeClass
+	uint8_t mSubsystem = 0; //The Memory::Subsystem whose slabs the chunk came from
+	mutable TextKind mTextKind = unknownText; //Fits in the padding after the fields above, so rows don't grow
+};
+
+inline bool operator==(const Line& line, const std::string_view& text)
+{
+	return std::string_view(line) == text;
+}
@@ -0,0 +1,129 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MappedFile.hpp"
+#include "Trace/Trace.hpp"
+#include <filesystem>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static constexpr uint64_t windowAlignment = 64 << 10; //Windows maps views at multiples of its 64KB allocation granularity, which is also a multiple of the page size
+
+MappedFile::~MappedFile()
+{
+	unmap();
+#ifdef _WIN32
+	if (mMapping != nullptr) CloseHandle(mMapping);
+	if (mFile != nullptr) CloseHandle(mFile);
+#else
+	if (mFile != -1) close(mFile);
+#endif
+}
+
+/// <summary>
+/// Opens the file for reading. Nothing is mapped until the first view() of it
+/// </summary>
+/// <param name="fileName">The file to open, relative to the current directory</param>
+/// <returns>False if the file couldn't be opened</returns>
+bool MappedFile::open(const std::string_view& fileName)
+{
+	const std::filesystem::path path = std::filesystem::current_path() / fileName;
+#ifdef _WIN32
+	mFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		mFile = nullptr;
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size)) return false;
+	mSize = static_cast<uint64_t>(size.QuadPart);
+	if (mSize > 0) mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	return mSize == 0 || mMapping != nullptr;
+#else
+	mFile = ::open(path.c_str(), O_RDONLY);
+	if (mFile == -1) return false;
+	struct stat status;
+	if (fstat(mFile, &status) == -1) return false;
+	mSize = static_cast<uint64_t>(status.st_size);
+	return true;
+#endif
+}
+
+/// <summary>
+/// The size of the file when it was opened
+/// </summary>
+uint64_t MappedFile::size() const
+{
+	return mSize;
+}
+
+/// <summary>
+/// Returns the bytes [offset, offset + length) of the file, cut short at the end of the file. The window is moved if they aren't all in it,
+/// which invalidates every view returned before
+/// </summary>
+/// <param name="length">At most maxViewBytes</param>
+std::string_view MappedFile::view(const uint64_t offset, const size_t length)
+{
+	if (offset >= mSize) return std::string_view();
+	const size_t wanted = static_cast<size_t>(std::min<uint64_t>(std::min<size_t>(length, maxViewBytes), mSize - offset));
+	if (mWindow == nullptr || offset < mWindowStart || offset + wanted > mWindowStart + mWindowLength)
+	{
+		TRACE_SCOPE("MappedFile::view");
+		unmap();
+		const uint64_t slack = (windowBytes - wanted) / 2; //The run goes in the middle of the window, so reading either forwards or backwards from it moves the window rarely
+		mWindowStart = (offset > slack ? offset - slack : 0) / windowAlignment * windowAlignment;
+		mWindowLength = static_cast<size_t>(std::min<uint64_t>(windowBytes, mSize - mWindowStart));
+#ifdef _WIN32
+		mWindow = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, static_cast<DWORD>(mWindowStart >> 32), static_cast<DWORD>(mWindowStart), mWindowLength));
+#else
+		void* window = mmap(nullptr, mWindowLength, PROT_READ, MAP_SHARED, mFile, static_cast<off_t>(mWindowStart));
+		mWindow = window == MAP_FAILED ? nullptr : static_cast<const char*>(window);
+#endif
+		if (mWindow == nullptr) return std::string_view();
+	}
+	return std::string_view(mWindow + (offset - mWindowStart), wanted);
+}
+
+/// <summary>
+/// Unmaps the current window
+/// </summary>
+void MappedFile::unmap()
+{
+	if (mWindow == nullptr) return;
+#ifdef _WIN32
+	UnmapViewOfFile(mWindow);
+#else
+	munmap(const_cast<char*>(mWindow), mWindowLength);
+#endif
+	mWindow = nullptr;
+}
@@ -0,0 +1,64 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// A read-only file that is mapped into memory a window at a time, so a file of any size can be read
+/// without loading it or keeping more than one window of it mapped
+/// </summary>
+class MappedFile
+{
+public:
+	static constexpr size_t windowBytes = 64 << 20; //How much of the file is mapped at once
+	static constexpr size_t maxViewBytes = windowBytes / 2; //The longest run of the file view() can return, so any run fits in a window
+
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string_view& fileName);
+	uint64_t size() const;
+	std::string_view view(const uint64_t offset, const size_t length);
+
+private:
+	void unmap();
+
+private:
+#ifdef _WIN32
+	void* mFile = nullptr; //HANDLEs, kept as void* so Windows.h isn't needed here
+	void* mMapping = nullptr;
+#else
+	int mFile = -1;
+#endif
+	uint64_t mSize = 0;
+	const char* mWindow = nullptr;
+	uint64_t mWindowStart = 0;
+	size_t mWindowLength = 0;
+};
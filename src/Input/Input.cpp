@@ -24,11 +24,17 @@ SOFTWARE.
 
 #include "Input.hpp"
 #include "Console/Console.hpp"
+#include "ExCommand/ExCommand.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Trace/Trace.hpp"
 #include <iostream>
 #include <string>
+#include <vector>
+#include <array>
+#include <format>
 
 #ifdef _WIN32
-#include <conio.h>
+uint8_t _getch();
 #elif defined(__linux__) || defined(__APPLE__)
 KeyActions::KeyAction _getch();
 #endif
@@ -37,11 +43,209 @@ using KeyActions::KeyAction;
 
 namespace InputHandler
 {
+	char pendingRegister = Registers::unnamedRegister; //The register selected with "x for the next yank/delete/put
+
 	/// <summary>
-	/// Filters through some sequences to determine which key was pressed
+	/// Returns the register selected for the next yank/delete/put, and resets the selection back to the unnamed register
+	/// </summary>
+	/// <returns></returns>
+	char takeRegister()
+	{
+		const char name = pendingRegister;
+		pendingRegister = Registers::unnamedRegister;
+		return name;
+	}
+
+	/// <summary>
+	/// Reads the register name following a " key
+	/// </summary>
+	void selectRegister()
+	{
+		const KeyAction key = getInput();
+		if (static_cast<int>(key) < 128 && Registers::isValidName(static_cast<char>(key)))
+		{
+			pendingRegister = static_cast<char>(key);
+		}
+	}
+
+	size_t pendingCount = 0; //The count typed before a command, e.g. the 10 in 10j. 0 if no count was typed
+
+	std::array<std::vector<KeyAction>, 26> macros; //Macro registers a-z
+	std::vector<KeyAction> recording;
+	char recordingRegister = 0; //The register being recorded into with q, or 0 if not recording
+	char lastMacro = 0; //The last macro executed, for @@
+
+	std::vector<KeyAction> lastChange; //The keys of the last change, for dot-repeat
+	std::vector<KeyAction> changeBeingCaptured;
+	size_t lastChangeCount = 1;
+	bool capturingChange = false; //True while an insert is being captured as the last change
+	bool repeatingChange = false; //True while . is replaying the last change, so the replay doesn't overwrite it
+
+	const std::vector<KeyAction>* replayKeys = nullptr; //The keys currently being replayed, or nullptr if reading from the terminal
+	size_t replayPos = 0;
+	size_t replayDepth = 0;
+	static constexpr size_t maxReplayDepth = 64; //Stops a macro that calls itself from recursing forever
+
+	const KeyAction readKey();
+
+	/// <summary>
+	/// Returns the count typed before the current command (at least 1), and resets it
+	/// </summary>
+	/// <returns></returns>
+	size_t takeCount()
+	{
+		const size_t count = pendingCount > 0 ? pendingCount : 1;
+		pendingCount = 0;
+		return count;
+	}
+
+	/// <summary>
+	/// Gets the next key, either from the keys being replayed or from the terminal.
+	/// Keys read from the terminal are added to the macro being recorded
 	/// </summary>
 	/// <returns></returns>
 	const KeyAction getInput()
+	{
+		if (replayKeys != nullptr)
+		{
+			return replayPos < replayKeys->size() ? (*replayKeys)[replayPos++] : KeyAction::None;
+		}
+
+		const KeyAction key = readKey();
+		if (recordingRegister != 0 && key != KeyAction::None)
+		{
+			recording.push_back(key);
+		}
+		return key;
+	}
+
+	/// <summary>
+	/// Reads a line of text for the command/find prompt.
+	/// While replaying, the text comes from the replayed keys. While recording, the text gets recorded as keys
+	/// </summary>
+	/// <returns></returns>
+	std::string readPromptLine()
+	{
+		std::string line;
+		if (replayKeys != nullptr)
+		{
+			KeyAction key;
+			while ((key = getInput()) != KeyAction::Enter && key != KeyAction::None)
+			{
+				line.push_back(static_cast<char>(key));
+			}
+			return line;
+		}
+
+		Console::terminal().readLine(line);
+		if (recordingRegister != 0)
+		{
+			for (const char c : line)
+			{
+				recording.push_back(static_cast<KeyAction>(static_cast<unsigned char>(c)));
+			}
+			recording.push_back(KeyAction::Enter);
+		}
+		return line;
+	}
+
+	/// <summary>
+	/// Sends a key to the handler for the current mode
+	/// </summary>
+	/// <param name="key"></param>
+	void dispatch(const KeyAction key)
+	{
+		switch (Console::mode())
+		{
+		case Mode::EditMode:
+			handleInput(key);
+			break;
+		case Mode::VisualMode:
+			handleVisualInput(key);
+			break;
+		default:
+			doCommand(key);
+			break;
+		}
+	}
+
+	/// <summary>
+	/// Runs a recorded key sequence the given number of times without rendering.
+	/// The console is put in batch mode, so screen refreshes and highlighting are skipped and the whole replay is a single undo entry
+	/// </summary>
+	/// <param name="keys">The keys to replay</param>
+	/// <param name="times">How many times to run them</param>
+	void replay(const std::vector<KeyAction>& keys, const size_t times)
+	{
+		if (keys.empty() || replayDepth >= maxReplayDepth) return;
+
+		const std::vector<KeyAction> keysToReplay = keys; //The source may change while replaying, e.g. if the macro records or repeats a change
+		const std::vector<KeyAction>* savedKeys = replayKeys;
+		const size_t savedPos = replayPos;
+		++replayDepth;
+		Console::beginBatch();
+
+		for (size_t n = 0; n < times && Console::mode() != Mode::ExitMode; ++n)
+		{
+			replayKeys = &keysToReplay;
+			replayPos = 0;
+			while (replayPos < keysToReplay.size() && Console::mode() != Mode::ExitMode)
+			{
+				dispatch(getInput());
+				Console::prepRenderedString();
+			}
+		}
+
+		Console::endBatch();
+		--replayDepth;
+		replayKeys = savedKeys;
+		replayPos = savedPos;
+	}
+
+	/// <summary>
+	/// Starts recording into a macro register, or stops the recording in progress
+	/// </summary>
+	void toggleRecording()
+	{
+		if (recordingRegister != 0)
+		{
+			recording.pop_back(); //Don't record the q that stopped the recording
+			macros[recordingRegister - 'a'] = std::move(recording);
+			recording.clear();
+			recordingRegister = 0;
+			Console::setStatusMessage("");
+			return;
+		}
+
+		const KeyAction key = getInput();
+		if (key >= static_cast<KeyAction>('a') && key <= static_cast<KeyAction>('z'))
+		{
+			recordingRegister = static_cast<char>(key);
+			recording.clear();
+			Console::setStatusMessage(std::format("recording @{}", recordingRegister));
+		}
+	}
+
+	/// <summary>
+	/// Runs the macro in the register following the @ key. @@ runs the last macro again
+	/// </summary>
+	/// <param name="count"></param>
+	void runMacro(const size_t count)
+	{
+		const KeyAction key = getInput();
+		char name = static_cast<char>(key);
+		if (key == static_cast<KeyAction>('@')) name = lastMacro;
+		if (name < 'a' || name > 'z') return;
+
+		lastMacro = name;
+		replay(macros[name - 'a'], count);
+	}
+
+	/// <summary>
+	/// Filters through some sequences to determine which key was pressed
+	/// </summary>
+	/// <returns></returns>
+	const KeyAction readKey()
 	{
 #ifdef _WIN32
 		uint8_t input;
@@ -52,6 +256,7 @@ namespace InputHandler
 		input = _getch();
 
 #ifdef _WIN32
+		TRACE_SCOPE("decodeKey");
 		static constexpr uint8_t specialKeyCode = 224;
 		static constexpr bool functionKeyCode = 0;
 		if (input == functionKeyCode)
@@ -91,52 +296,176 @@ namespace InputHandler
 
 		return static_cast<KeyAction>(input);
 	}
+	/// <summary>
+	/// Maps VIM's h/j/k/l movement keys to the arrow keys
+	/// </summary>
+	/// <param name="key"></param>
+	/// <returns>The arrow key, or the key itself if it isn't a movement key</returns>
+	KeyAction mapMovementKey(const KeyAction key)
+	{
+		switch (key)
+		{
+		case static_cast<KeyAction>('h'): return KeyAction::ArrowLeft;
+		case static_cast<KeyAction>('j'): return KeyAction::ArrowDown;
+		case static_cast<KeyAction>('k'): return KeyAction::ArrowUp;
+		case static_cast<KeyAction>('l'): return KeyAction::ArrowRight;
+		default: return key;
+		}
+	}
+
 	/// <summary>
 	/// Handles commands while in command/read mode
 	/// i = Enter edit mode (like VIM)
 	/// : = Enter command mode (like VIM)
+	/// / = Search for a pattern, n/N = Go to the next/previous match (like VIM)
+	/// Commands can be prefixed with a count (10j, 500x). . repeats the last change, q/@ record and run macros
+	/// m{a-z} sets a mark on the current row, '{a-z} goes back to it
 	/// </summary>
-	void doCommand(const KeyAction key)
+	void doCommand(const KeyAction keyPressed)
 	{
+		const KeyAction key = mapMovementKey(keyPressed);
+		if ((key >= static_cast<KeyAction>('1') && key <= static_cast<KeyAction>('9')) || (key == static_cast<KeyAction>('0') && pendingCount > 0))
+		{
+			pendingCount = pendingCount * 10 + (static_cast<size_t>(key) - '0');
+			return;
+		}
+
 		std::string command;
+		const bool hasCount = pendingCount > 0;
+		const size_t count = takeCount();
 		switch (key)
 		{
 		case static_cast<KeyAction>('i'):
 			Console::enableRawInput();
 			Console::enableEditMode();
+			if (!repeatingChange) //Everything typed until Esc is one change for dot-repeat
+			{
+				capturingChange = true;
+				changeBeingCaptured = { key };
+			}
 			break;
 		case static_cast<KeyAction>(':'):
 			Console::enableCommandMode();
-			std::cout << ":";
-			std::cin >> command;
+			if (replayKeys == nullptr) Console::terminal().write(":");
+			command = readPromptLine(); //Commands can take arguments and patterns with spaces, so read the whole line
+			Profiler::beginSample(true); //The time spent typing the command isn't latency
+			Console::setStatusMessage(recordingRegister != 0 ? std::format("recording @{}", recordingRegister) : ""); //Clear the last command's error
 
-			if (command == "q" && Console::isDirty()) //Quit command - requires changes to be saved
-			{
-				break;
-			}
-			else if (command == "q")
+			ExCommand::execute(command);
+			if (Console::mode() == Mode::ExitMode) break;
+			Console::mode(Mode::ReadMode); //Go back to read mode after executing a command
+			Console::enableRawInput();
+			break;
+
+		case static_cast<KeyAction>('/'):
+			Console::enableFindMode();
+			if (replayKeys == nullptr) Console::terminal().write("/");
+			command = readPromptLine(); //Search patterns may contain spaces, so read the whole line
+			Profiler::beginSample(true);
+
+			Console::find(command);
+			Console::mode(Mode::ReadMode);
+			Console::enableRawInput();
+			break;
+		case static_cast<KeyAction>('n'):
+		case static_cast<KeyAction>('N'):
+			for (size_t i = 0; i < count; ++i)
 			{
-				Console::mode(Mode::ExitMode);
-				break;
+				Console::findNext(key == static_cast<KeyAction>('n'));
 			}
-			else if (command == "q!") //Force quit. Don't bother checking anything
+			break;
+
+		case static_cast<KeyAction>('v'):
+			Console::enableVisualMode(Registers::SelectionType::Character);
+			break;
+		case static_cast<KeyAction>('V'):
+			Console::enableVisualMode(Registers::SelectionType::Line);
+			break;
+		case KeyAction::CtrlV:
+			Console::enableVisualMode(Registers::SelectionType::Block);
+			break;
+		case static_cast<KeyAction>('"'):
+			selectRegister();
+			break;
+
+		case static_cast<KeyAction>('x'): //Delete the characters under the cursor, without joining rows
+		case static_cast<KeyAction>('p'):
+		case static_cast<KeyAction>('P'):
+		{
+			const char registerName = takeRegister();
+			Console::beginBatch(); //A counted change is a single undo entry
+			for (size_t i = 0; i < count; ++i)
 			{
-				Console::mode(Mode::ExitMode);
-				break;
+				if (key == static_cast<KeyAction>('x'))
+				{
+					if (!Console::isCursorAtRowEnd()) Console::deleteChar(KeyAction::Delete);
+				}
+				else
+				{
+					Console::putRegister(registerName, key == static_cast<KeyAction>('P'));
+				}
 			}
-			else if (command == "w" || command == "s") //Save commands ([w]rite / [s]ave)
+			Console::endBatch();
+			if (!repeatingChange)
 			{
-				Console::save();
+				lastChange = { key };
+				if (registerName != Registers::unnamedRegister) lastChange.insert(lastChange.begin(), { static_cast<KeyAction>('"'), static_cast<KeyAction>(registerName) }); //So . puts the same register
+				lastChangeCount = count;
 			}
-			else if (command == "wq" || command == "sq") //Save and quit commands ([w]rite [q]uit / [s]ave [q]uit)
+			break;
+		}
+
+		case static_cast<KeyAction>('.'):
+			repeatingChange = true;
+			replay(lastChange, hasCount ? count : lastChangeCount); //A count given to . replaces the count of the original change
+			repeatingChange = false;
+			break;
+		case static_cast<KeyAction>('q'):
+			toggleRecording();
+			break;
+		case static_cast<KeyAction>('@'):
+			runMacro(count);
+			break;
+
+		case static_cast<KeyAction>('0'):
+			Console::moveCursor(KeyAction::Home);
+			break;
+		case static_cast<KeyAction>('m'): //Set a mark on the current row, for use in command ranges like :'a,'bd
+			Console::setMark(static_cast<char>(getInput()), Console::cursorRow());
+			break;
+		case static_cast<KeyAction>('\''): //Go to the row of a mark
+		{
+			size_t row;
+			if (Console::getMark(static_cast<char>(getInput()), row)) Console::goToRow(row);
+			break;
+		}
+
+		case KeyAction::CtrlW: //Window commands: Ctrl+W followed by w/W (next/previous view), h/j/k/l (view in that direction), s/v (split) or c/q (close)
+		{
+			const KeyAction windowKey = getInput();
+			switch (windowKey)
 			{
-				Console::save();
-				Console::mode(Mode::ExitMode);
+			case static_cast<KeyAction>('w'):
+			case KeyAction::CtrlW:
+				Console::focusNextView(true);
+				break;
+			case static_cast<KeyAction>('W'):
+				Console::focusNextView(false);
+				break;
+			case static_cast<KeyAction>('s'):
+			case static_cast<KeyAction>('v'):
+				Console::splitView(windowKey == static_cast<KeyAction>('v'));
+				break;
+			case static_cast<KeyAction>('c'):
+			case static_cast<KeyAction>('q'):
+				if (!Console::closeView(false)) Console::setStatusMessage("No write since last change (add ! to override)");
+				break;
+			default:
+				Console::focusViewInDirection(windowKey);
 				break;
 			}
-			Console::mode(Mode::ReadMode); //Go back to read mode after executing a command
-			Console::enableRawInput();
 			break;
+		}
 
 		case KeyAction::ArrowDown:
 		case KeyAction::ArrowUp:
@@ -152,12 +481,18 @@ namespace InputHandler
 		case KeyAction::PageUp:
 		case KeyAction::CtrlPageDown:
 		case KeyAction::CtrlPageUp:
-			Console::moveCursor(key);
+			for (size_t i = 0; i < count; ++i)
+			{
+				Console::moveCursor(key);
+			}
 			break;
 
 		case KeyAction::CtrlArrowDown:
 		case KeyAction::CtrlArrowUp:
-			Console::shiftRowOffset(key);
+			for (size_t i = 0; i < count; ++i)
+			{
+				Console::shiftRowOffset(key);
+			}
 			break;
 
 		default: //Unknown command. Just go back to read mode
@@ -166,13 +501,106 @@ namespace InputHandler
 		}
 	}
 
+	/// <summary>
+	/// Handles the input while in visual mode
+	/// y = Yank the selection, d/x = Delete the selection, "x = Use register x, Esc = Cancel the selection
+	/// </summary>
+	void handleVisualInput(const KeyAction keyPressed)
+	{
+		const KeyAction key = mapMovementKey(keyPressed);
+		switch (key)
+		{
+		case KeyAction::Esc:
+			pendingRegister = Registers::unnamedRegister;
+			Console::mode(Mode::ReadMode);
+			break;
+		case static_cast<KeyAction>('y'):
+			Console::yankSelection(takeRegister());
+			break;
+		case static_cast<KeyAction>('d'):
+		case static_cast<KeyAction>('x'):
+		case KeyAction::Delete:
+			Console::deleteSelection(takeRegister());
+			break;
+		case static_cast<KeyAction>('"'):
+			selectRegister();
+			break;
+		case KeyAction::ArrowDown:
+		case KeyAction::ArrowUp:
+		case KeyAction::ArrowLeft:
+		case KeyAction::ArrowRight:
+		case KeyAction::CtrlArrowLeft:
+		case KeyAction::CtrlArrowRight:
+		case KeyAction::Home:
+		case KeyAction::End:
+		case KeyAction::CtrlHome:
+		case KeyAction::CtrlEnd:
+		case KeyAction::PageDown:
+		case KeyAction::PageUp:
+		case KeyAction::CtrlPageDown:
+		case KeyAction::CtrlPageUp:
+			Console::moveCursor(key);
+			break;
+		case KeyAction::CtrlArrowDown:
+		case KeyAction::CtrlArrowUp:
+			Console::shiftRowOffset(key);
+			break;
+		default:
+			break;
+		}
+	}
+
 	/// <summary>
 	/// Handles the input while in edit mode.
-	/// Windows uses the _getch() function from <conio.h>.
-	/// Linux uses a custom _getch() function
 	/// </summary>
 	void handleInput(KeyAction key)
 	{
+		if (capturingChange)
+		{
+			changeBeingCaptured.push_back(key);
+			if (key == KeyAction::Esc) //The insert is finished, so it becomes the change . repeats
+			{
+				lastChange = std::move(changeBeingCaptured);
+				lastChangeCount = 1;
+				capturingChange = false;
+			}
+		}
+
+		if (Console::hasMultipleCursors()) //Edits get applied at every cursor in a single batch
+		{
+			switch (key)
+			{
+			case KeyAction::Esc:
+				Console::clearCursors();
+				Console::mode(Mode::ReadMode);
+				return;
+			case KeyAction::ArrowDown:
+			case KeyAction::ArrowUp:
+			case KeyAction::ArrowLeft:
+			case KeyAction::ArrowRight:
+			case KeyAction::Home:
+			case KeyAction::End:
+				Console::moveCursor(key);
+				Console::moveExtraCursors(key);
+				return;
+			case KeyAction::Delete:
+			case KeyAction::Backspace:
+			case KeyAction::CtrlBackspace:
+			case KeyAction::CtrlDelete:
+			case KeyAction::Enter:
+			case KeyAction::Tab:
+				Console::multiCursorEdit(key);
+				return;
+			default:
+				if (static_cast<int>(key) >= ' ' && static_cast<int>(key) < 256) //Bytes over 127 are parts of UTF-8 characters
+				{
+					Console::multiCursorEdit(key);
+					return;
+				}
+				break;
+			}
+		}
+
 		switch (key)
 		{
 		case KeyAction::Esc:
@@ -222,22 +650,53 @@ namespace InputHandler
 	}
 }
 
-#if defined(__linux__) || defined(__APPLE__)
+#ifdef _WIN32
 /// <summary>
-/// A custom implementation of the _getch function
+/// Reads a key code from the terminal. The console terminal gets these from the _getch function in conio.h
+/// </summary>
+/// <returns></returns>
+uint8_t _getch()
+{
+	char c = 0;
+	Console::terminal().read(&c, 1);
+	return static_cast<uint8_t>(c);
+}
+#elif defined(__linux__) || defined(__APPLE__)
+/// <summary>
+/// A custom implementation of the _getch function, reading from the terminal
 /// </summary>
 /// <returns></returns>
 KeyAction _getch()
 {
-	int8_t nread;
+	static int pushedBack = -1; //A byte read after Esc that turned out to start the next key
+	Terminal& terminal = Console::terminal();
 	char c;
-	while (nread = read(fileno(stdin), &c, 1) == 0);
-	if (nread == -1) exit(EXIT_FAILURE);
+	if (pushedBack != -1)
+	{
+		c = static_cast<char>(pushedBack);
+		pushedBack = -1;
+	}
+	else
+	{
+		while (terminal.read(&c, 1) == 0)
+		{
+			if (terminal.atEnd()) return KeyAction::None; //Only a headless terminal runs out of input
+		}
+	}
+	TRACE_SCOPE("decodeKey"); //Started after the first byte, so waiting for a key isn't traced
 
 	if (c == static_cast<char>(KeyAction::Esc))
 	{
-		char seq[3];
-		if (read(fileno(stdin), seq, 3) < 2) return KeyAction::Esc;
+		//Sequences are read a byte at a time, so keys that are already waiting behind this one aren't swallowed with it
+		char seq[3] = {};
+		if (terminal.read(seq, 1) < 1) return KeyAction::Esc;
+		if (seq[0] != '[' && seq[0] != 'O')
+		{
+			pushedBack = static_cast<unsigned char>(seq[0]);
+			return KeyAction::Esc;
+		}
+		if (terminal.read(seq + 1, 1) < 1) return KeyAction::Esc;
+		if (seq[0] == '[' && seq[1] >= '0' && seq[1] <= '9' && terminal.read(seq + 2, 1) < 1) return KeyAction::Esc;
 		if (seq[0] == '[')
 		{
 			if (seq[2] == static_cast<char>(KeyAction::None)) //If 3 characters weren't read in
@@ -268,7 +727,7 @@ KeyAction _getch()
 					switch (seq[1])
 					{
 					case '1':
-						if (read(fileno(stdin), seq, 2) < 2) return KeyAction::Esc;
+						if (terminal.read(seq, 2) < 2) return KeyAction::Esc;
 						if (seq[0] == '5')
 						{
 							switch (seq[1])
@@ -281,12 +740,15 @@ KeyAction _getch()
 							case 'F': return KeyAction::CtrlEnd;
 							}
 						}
-					case '3': return KeyAction::CtrlDelete;
+						return KeyAction::None; //Other modifier combinations are ignored
+					case '3':
+						if (terminal.read(seq, 2) < 2) return KeyAction::Esc;
+						return KeyAction::CtrlDelete;
 					case '5':
-						if (read(fileno(stdin), seq, 2) < 2) return KeyAction::Esc;
+						if (terminal.read(seq, 2) < 2) return KeyAction::Esc;
 						return KeyAction::CtrlPageUp;
 					case '6':
-						if (read(fileno(stdin), seq, 2) < 2) return KeyAction::Esc;
+						if (terminal.read(seq, 2) < 2) return KeyAction::Esc;
 						return KeyAction::CtrlPageDown;
 					}
 				}
@@ -301,6 +763,6 @@ KeyAction _getch()
 			}
 		}
 	}
-	return static_cast<KeyAction>(c);
+	return static_cast<KeyAction>(static_cast<unsigned char>(c)); //The bytes of UTF-8 characters are over 127, and are inserted one at a time
 }
 #endif
@@ -24,10 +24,18 @@ SOFTWARE.
 
 #pragma once
 #include "KeyActions/KeyActions.hh"
+#include <vector>
+#include <string>
+#include <cstddef>
 
 namespace InputHandler
 {
 	const KeyActions::KeyAction getInput();
+	std::string readPromptLine();
+	KeyActions::KeyAction mapMovementKey(const KeyActions::KeyAction key);
 	void handleInput(const KeyActions::KeyAction);
 	void doCommand(const KeyActions::KeyAction);
+	void handleVisualInput(const KeyActions::KeyAction);
+	void dispatch(const KeyActions::KeyAction);
+	void replay(const std::vector<KeyActions::KeyAction>& keys, const size_t times);
 }
\ No newline at end of file
@@ -0,0 +1,433 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Journal.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <format>
+#include <cstring>
+#include <random>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	template<typename T>
+	void put(std::string& out, const T value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	/// <summary>
+	/// Reads a value at pos and moves past it
+	/// </summary>
+	/// <returns>False if the text ends before it does</returns>
+	template<typename T>
+	bool get(const std::string_view& text, size_t& pos, T& value)
+	{
+		if (text.length() - pos < sizeof(T)) return false;
+		std::memcpy(&value, text.data() + pos, sizeof(T));
+		pos += sizeof(T);
+		return true;
+	}
+
+	/// <summary>
+	/// The rows of a file being replayed, as a sequence of pieces that are each a run of the file's own rows or of rows read from the swap file.
+	/// The pieces are kept in a treap ordered by position, so an edit anywhere in the file splits and joins a few pieces, however big the file is
+	/// </summary>
+	class PieceTree
+	{
+	public:
+		struct Piece
+		{
+			bool journaled; //The rows were read from the swap file rather than the file
+			size_t start, count;
+		};
+
+		explicit PieceTree(const size_t rowCount)
+		{
+			if (rowCount > 0) mRoot = make(Piece{ false, 0, rowCount });
+		}
+
+		/// <summary>
+		/// Replaces rows [first, first + removed) with 'added' rows read from the swap file, starting at journalStart
+		/// </summary>
+		void replace(const size_t first, const size_t removed, const size_t journalStart, const size_t added)
+		{
+			int32_t before, rest, replaced, after;
+			split(mRoot, first, before, rest);
+			split(rest, removed, replaced, after);
+			mRoot = merge(merge(before, added > 0 ? make(Piece{ true, journalStart, added }) : -1), after);
+		}
+
+		/// <summary>
+		/// Lists the pieces in order
+		/// </summary>
+		void pieces(std::vector<Piece>& ordered) const
+		{
+			std::vector<int32_t> path;
+			for (int32_t node = mRoot; node >= 0 || !path.empty();)
+			{
+				if (node >= 0)
+				{
+					path.push_back(node);
+					node = mNodes[node].left;
+					continue;
+				}
+				node = path.back();
+				path.pop_back();
+				ordered.push_back(mNodes[node].piece);
+				node = mNodes[node].right;
+			}
+		}
+
+	private:
+		struct Node
+		{
+			Piece piece;
+			size_t rows; //In the piece and its subtree
+			uint32_t priority;
+			int32_t left = -1, right = -1;
+		};
+
+		size_t rows(const int32_t node) const
+		{
+			return node < 0 ? 0 : mNodes[node].rows;
+		}
+
+		void update(const int32_t node)
+		{
+			mNodes[node].rows = rows(mNodes[node].left) + mNodes[node].piece.count + rows(mNodes[node].right);
+		}
+
+		int32_t make(const Piece& piece)
+		{
+			mNodes.push_back(Node{ piece, piece.count, static_cast<uint32_t>(mRandom()) });
+			return static_cast<int32_t>(mNodes.size() - 1);
+		}
+
+		/// <summary>
+		/// Splits a subtree into its first 'count' rows and the rest, splitting the piece the boundary falls in
+		/// </summary>
+		void split(const int32_t node, const size_t count, int32_t& left, int32_t& right)
+		{
+			if (node < 0)
+			{
+				left = right = -1;
+				return;
+			}
+			const size_t leftRows = rows(mNodes[node].left);
+			if (count <= leftRows)
+			{
+				int32_t subtreeRight;
+				split(mNodes[node].left, count, left, subtreeRight);
+				mNodes[node].left = subtreeRight;
+				update(node);
+				right = node;
+			}
+			else if (count >= leftRows + mNodes[node].piece.count)
+			{
+				int32_t subtreeLeft;
+				split(mNodes[node].right, count - leftRows - mNodes[node].piece.count, subtreeLeft, right);
+				mNodes[node].right = subtreeLeft;
+				update(node);
+				left = node;
+			}
+			else
+			{
+				const size_t kept = count - leftRows;
+				const Piece tail{ mNodes[node].piece.journaled, mNodes[node].piece.start + kept, mNodes[node].piece.count - kept };
+				const int32_t subtreeRight = mNodes[node].right;
+				mNodes[node].piece.count = kept;
+				mNodes[node].right = -1;
+				update(node);
+				left = node;
+				right = merge(make(tail), subtreeRight);
+			}
+		}
+
+		int32_t merge(const int32_t left, const int32_t right)
+		{
+			if (left < 0) return right;
+			if (right < 0) return left;
+			if (mNodes[left].priority > mNodes[right].priority)
+			{
+				const int32_t merged = merge(mNodes[left].right, right);
+				mNodes[left].right = merged;
+				update(left);
+				return left;
+			}
+			const int32_t merged = merge(left, mNodes[right].left);
+			mNodes[right].left = merged;
+			update(right);
+			return right;
+		}
+
+	private:
+		std::vector<Node> mNodes; //Nodes are never freed, as there are at most a few per edit
+		int32_t mRoot = -1;
+		std::mt19937 mRandom;
+	};
+
+	/// <summary>
+	/// FNV-1a, which is enough to tell an edit that was only partly written when the editor died from a whole one
+	/// </summary>
+	uint32_t checksum(const std::string_view& bytes)
+	{
+		uint32_t hash = 2166136261u;
+		for (const char c : bytes)
+		{
+			hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+		}
+		return hash;
+	}
+}
+
+/// <summary>
+/// Starts a new swap file for a file, replacing any that was there
+/// </summary>
+/// <param name="fileName">The file the edits are made to, relative to the current directory</param>
+/// <param name="base">The file as it was last read or written. Recovery refuses to replay the edits over any other version of it</param>
+Journal::Journal(const std::string_view& fileName, const FileHandler::FileStamp& base) : mPath(path(fileName)), mPending(header(base))
+{
+	mWorker = std::thread(&Journal::worker, this);
+}
+
+/// <summary>
+/// Carries on with a swap file whose edits were recovered. It is written again with only the whole edits, so new ones don't follow a torn one
+/// </summary>
+/// <param name="recovered">The header and whole edits of the recovered swap file</param>
+Journal::Journal(const std::string_view& fileName, std::string&& recovered) : mPath(path(fileName)), mPending(std::move(recovered))
+{
+	mWorker = std::thread(&Journal::worker, this);
+}
+
+Journal::~Journal()
+{
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		mStop = true;
+	}
+	mChanged.notify_all();
+	if (mWorker.joinable()) mWorker.join();
+	std::error_code error;
+	std::filesystem::remove(mPath, error);
+}
+
+/// <summary>
+/// Starts the swap file over once the file has been saved or reloaded, as the edits before that are in the file now
+/// </summary>
+/// <param name="base">The file as it was just written or read</param>
+void Journal::restart(const FileHandler::FileStamp& base)
+{
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		mPending = header(base);
+		mTruncate = true;
+	}
+	mChanged.notify_all();
+}
+
+/// <summary>
+/// Adds an edit that replaced rows [first, first + removed) with what are now rows [first, newEnd). Only the new rows are copied,
+/// and the worker writes them later
+/// </summary>
+void Journal::record(const size_t first, const size_t removed, const std::vector<FileHandler::Row>& rows, const size_t newEnd)
+{
+	std::string edit;
+	put(edit, editMagic);
+	put<uint64_t>(edit, first);
+	put<uint64_t>(edit, removed);
+	put<uint64_t>(edit, newEnd - first);
+	for (size_t row = first; row < newEnd; ++row)
+	{
+		const std::string_view line = rows[row].line;
+		put<uint64_t>(edit, line.length());
+		edit.append(line);
+	}
+	put(edit, checksum(edit));
+
+	std::lock_guard<std::mutex> guard(mMutex);
+	mPending.append(edit);
+}
+
+/// <summary>
+/// The swap file of a file: a hidden file next to it
+/// </summary>
+/// <param name="fileName">The file, relative to the current directory</param>
+std::string Journal::path(const std::string_view& fileName)
+{
+	const std::filesystem::path file = std::filesystem::current_path() / fileName;
+	return (file.parent_path() / ("." + file.filename().string() + ".nve-swp")).string();
+}
+
+/// <summary>
+/// True if a file has a swap file, left by an editor that didn't exit cleanly or is still editing it
+/// </summary>
+bool Journal::exists(const std::string_view& fileName)
+{
+	std::error_code error;
+	return std::filesystem::exists(path(fileName), error);
+}
+
+/// <summary>
+/// Reads a file's swap file back and replays its edits on the file's rows. Only the swap file is read, and the edits are replayed on a tree
+/// of pieces of the file rather than on its rows, so the work done depends on the number and size of the edits rather than the size of the file
+/// </summary>
+/// <param name="base">The file as the rows were read from it. It must be the version the swap file was started from</param>
+/// <param name="rows">The rows of the file as it was read. Only the rows between the first and last edited ones are copied</param>
+/// <param name="recovered">Set to the span of rows the edits replaced, what replaced it, and the swap file the new rows point into</param>
+/// <returns>Why the edits couldn't be recovered, or an empty string if they were</returns>
+std::string Journal::recover(const std::string_view& fileName, const FileHandler::FileStamp& base, const std::vector<FileHandler::Row>& rows, Recovered& recovered)
+{
+	TRACE_SCOPE("Journal::recover");
+	Memory::Scope memoryScope(Memory::Subsystem::Text);
+	std::ifstream file(path(fileName), std::ios::binary);
+	if (!file) return std::format("{} has no swap file", fileName);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	auto text = std::make_unique<const std::string>(contents.str());
+	const std::string_view journal(*text);
+
+	const std::string expected = header(base);
+	if (journal.substr(0, sizeof(magic)) != std::string_view(magic, sizeof(magic))) return std::format("{} isn't a swap file", path(fileName));
+	if (journal.substr(0, expected.length()) != expected) return std::format("The swap file of {} was made for a different version of it", fileName);
+
+	//Each edit is applied once it has been read whole. The first that isn't (cut short by the crash) ends the replay
+	PieceTree pieces(rows.size());
+	std::vector<FileHandler::Row> journalRows;
+	size_t pos = expected.length(), rowCount = rows.size();
+	recovered.length = pos;
+	while (true)
+	{
+		const size_t start = pos;
+		uint32_t editStart = 0, sum = 0;
+		uint64_t first = 0, removed = 0, added = 0;
+		if (!get(journal, pos, editStart) || editStart != editMagic || !get(journal, pos, first) || !get(journal, pos, removed) || !get(journal, pos, added)) break;
+		if (first > rowCount || removed > rowCount - first) break;
+		const size_t journalStart = journalRows.size();
+		bool whole = true;
+		for (uint64_t row = 0; row < added && whole; ++row)
+		{
+			uint64_t length = 0;
+			whole = get(journal, pos, length) && length <= journal.length() - pos;
+			if (!whole) break;
+			journalRows.push_back(FileHandler::Row{ Line::borrow(journal.substr(pos, static_cast<size_t>(length))), std::string() });
+			pos += static_cast<size_t>(length);
+		}
+		const size_t end = pos;
+		if (!whole || !get(journal, pos, sum) || sum != checksum(journal.substr(start, end - start)))
+		{
+			journalRows.resize(journalStart);
+			break;
+		}
+		pieces.replace(static_cast<size_t>(first), static_cast<size_t>(removed), journalStart, static_cast<size_t>(added));
+		rowCount = rowCount - static_cast<size_t>(removed) + static_cast<size_t>(added);
+		++recovered.edits;
+		recovered.length = pos;
+	}
+
+	//The file's own rows at either end weren't edited, so only the rows between them are put together
+	std::vector<PieceTree::Piece> ordered;
+	pieces.pieces(ordered);
+	size_t firstPiece = 0, endPiece = ordered.size(), unchangedEnd = 0;
+	if (firstPiece < endPiece && !ordered[firstPiece].journaled && ordered[firstPiece].start == 0) recovered.first = ordered[firstPiece++].count;
+	if (firstPiece < endPiece && !ordered[endPiece - 1].journaled && ordered[endPiece - 1].start + ordered[endPiece - 1].count == rows.size()) unchangedEnd = ordered[--endPiece].count;
+	recovered.removed = rows.size() - recovered.first - unchangedEnd;
+	for (size_t i = firstPiece; i < endPiece; ++i)
+	{
+		const PieceTree::Piece& piece = ordered[i];
+		const std::vector<FileHandler::Row>& source = piece.journaled ? journalRows : rows;
+		recovered.rows.insert(recovered.rows.end(), source.begin() + piece.start, source.begin() + piece.start + piece.count);
+	}
+	recovered.text = std::move(text);
+	return std::string();
+}
+
+/// <summary>
+/// Writes what was queued every flushInterval, and syncs it to disk at most every syncInterval, until the journal is stopped
+/// </summary>
+void Journal::worker()
+{
+	auto lastSync = std::chrono::steady_clock::now();
+	bool unsynced = false;
+	while (true)
+	{
+		std::string writing;
+		bool truncate = false;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mChanged.wait_for(lock, flushInterval, [this]() { return mStop || mTruncate; });
+			if (mStop) break; //Only a clean exit stops the journal, and then the swap file is removed
+			writing.swap(mPending);
+			truncate = mTruncate;
+			mTruncate = false;
+		}
+
+		if (truncate)
+		{
+			if (mFile != nullptr) std::fclose(mFile);
+			mFile = std::fopen(mPath.c_str(), "wb");
+		}
+		if (mFile == nullptr) continue; //The directory can't be written to, so there is no swap file
+		if (!writing.empty())
+		{
+			TRACE_SCOPE("Journal::write");
+			std::fwrite(writing.data(), 1, writing.size(), mFile);
+			std::fflush(mFile);
+			unsynced = true;
+		}
+		const auto now = std::chrono::steady_clock::now();
+		if (unsynced && now - lastSync >= syncInterval)
+		{
+			TRACE_SCOPE("Journal::sync");
+#ifdef _WIN32
+			_commit(_fileno(mFile));
+#else
+			fsync(fileno(mFile));
+#endif
+			unsynced = false;
+			lastSync = now;
+		}
+	}
+	if (mFile != nullptr) std::fclose(mFile);
+}
+
+/// <summary>
+/// What a swap file starts with: which version of the file its edits were made to
+/// </summary>
+std::string Journal::header(const FileHandler::FileStamp& base)
+{
+	std::string bytes(magic, sizeof(magic));
+	put<uint64_t>(bytes, base.size);
+	put<int64_t>(bytes, static_cast<int64_t>(base.modified.time_since_epoch().count()));
+	return bytes;
+}
@@ -0,0 +1,92 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File/File.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+/// <summary>
+/// The swap file of a buffer: an append-only journal of its edits since the file was last loaded or saved, so they can be replayed
+/// after a crash. Each edit is encoded on the editor's thread, which only appends it to a queue. A worker writes the queue in batches
+/// and syncs it to disk now and then, so a keystroke never waits on the disk. The swap file is removed when the journal is destroyed,
+/// which only happens when the editor exits cleanly
+/// </summary>
+class Journal
+{
+public:
+	/// <summary>
+	/// The edits read back from a swap file
+	/// </summary>
+	struct Recovered
+	{
+		std::unique_ptr<const std::string> text; //The swap file. The replayed rows point into it, so it must be kept for as long as they are
+		size_t first = 0, removed = 0; //Every edit together replaces rows [first, first + removed) of the file...
+		std::vector<FileHandler::Row> rows; //...with these rows
+		size_t edits = 0;
+		size_t length = 0; //How much of the swap file holds whole edits. An edit cut short by the crash is dropped
+	};
+
+	Journal(const std::string_view& fileName, const FileHandler::FileStamp& base);
+	Journal(const std::string_view& fileName, std::string&& recovered);
+	~Journal();
+	Journal(const Journal&) = delete;
+	Journal& operator=(const Journal&) = delete;
+
+	void restart(const FileHandler::FileStamp& base);
+	void record(const size_t first, const size_t removed, const std::vector<FileHandler::Row>& rows, const size_t newEnd);
+
+	static std::string path(const std::string_view& fileName);
+	static bool exists(const std::string_view& fileName);
+	static std::string recover(const std::string_view& fileName, const FileHandler::FileStamp& base, const std::vector<FileHandler::Row>& rows, Recovered& recovered);
+
+private:
+	void worker();
+	static std::string header(const FileHandler::FileStamp& base);
+
+private:
+	static constexpr std::chrono::milliseconds flushInterval{ 200 }; //How long edits wait to be written, so bursts of keys are written together
+	static constexpr std::chrono::milliseconds syncInterval{ 1000 }; //How often what was written is synced to disk, at most
+	static constexpr char magic[8] = { 'N', 'V', 'E', 'S', 'W', 'A', 'P', '1' };
+	static constexpr uint32_t editMagic = 0x54494445; //"EDIT", which starts every edit
+
+	const std::string mPath;
+	std::string mPending; //Encoded edits that haven't been written yet
+	bool mTruncate = true; //The swap file is started over with mPending, which begins with a header
+	std::FILE* mFile = nullptr; //Only used by the worker
+	std::mutex mMutex; //Guards mPending and mTruncate
+	std::condition_variable mChanged; //Signalled when the journal is started over or stopped
+	std::atomic<bool> mStop = false;
+	std::thread mWorker;
+};
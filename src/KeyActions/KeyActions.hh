@@ -29,6 +29,8 @@ namespace KeyActions
 	{
 		None = 0,
 		CtrlC = 3,
+		CtrlV = 22,
+		CtrlW = 23,
 		CtrlX = 24,
 		CtrlY = 25,
 		CtrlZ = 26,
@@ -0,0 +1,192 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Memory.hpp"
+
+#include <array>
+#include <atomic>
+#include <format>
+#include <new>
+#include <cstdlib>
+
+namespace Memory
+{
+	/// <summary>
+	/// Stored in front of every block so freeing it knows how much to give back, and to which subsystem.
+	/// Its size keeps the memory after it aligned like malloc's
+	/// </summary>
+	struct alignas(alignof(std::max_align_t)) BlockHeader
+	{
+		size_t size;
+		Subsystem subsystem;
+	};
+
+	struct Counters
+	{
+		std::atomic<size_t> bytes = 0;
+		std::atomic<size_t> blocks = 0;
+		std::atomic<size_t> peakBytes = 0;
+	};
+
+	constexpr size_t subsystemCount = static_cast<size_t>(Subsystem::EnumCount);
+	std::array<Counters, subsystemCount> counters;
+	std::atomic<size_t> allocations = 0; //Every allocation ever made, on any thread
+	thread_local Subsystem currentSubsystem = Subsystem::Other;
+
+	constexpr std::array<std::string_view, subsystemCount> subsystemNames = { "other", "text", "rendered", "undo", "redo", "highlights", "search index", "registers" };
+
+	Scope::Scope(const Subsystem subsystem) : previous(currentSubsystem)
+	{
+		currentSubsystem = subsystem;
+	}
+
+	Scope::~Scope()
+	{
+		currentSubsystem = previous;
+	}
+
+	/// <summary>
+	/// Allocates a block charged to the current subsystem of this thread
+	/// </summary>
+	static void* allocate(const size_t size)
+	{
+		BlockHeader* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+		if (header == nullptr) throw std::bad_alloc();
+		header->size = size;
+		header->subsystem = currentSubsystem;
+
+		Counters& counter = counters[static_cast<size_t>(header->subsystem)];
+		const size_t bytes = counter.bytes.fetch_add(size, std::memory_order_relaxed) + size;
+		counter.blocks.fetch_add(1, std::memory_order_relaxed);
+		size_t peak = counter.peakBytes.load(std::memory_order_relaxed);
+		while (bytes > peak && !counter.peakBytes.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {}
+		allocations.fetch_add(1, std::memory_order_relaxed);
+		return header + 1;
+	}
+
+	static void deallocate(void* memory)
+	{
+		if (memory == nullptr) return;
+		BlockHeader* header = static_cast<BlockHeader*>(memory) - 1;
+		Counters& counter = counters[static_cast<size_t>(header->subsystem)];
+		counter.bytes.fetch_sub(header->size, std::memory_order_relaxed);
+		counter.blocks.fetch_sub(1, std::memory_order_relaxed);
+		std::free(header);
+	}
+
+	/// <summary>
+	/// The subsystem allocations on this thread are charged to
+	/// </summary>
+	Subsystem current()
+	{
+		return currentSubsystem;
+	}
+
+	size_t liveBytes(const Subsystem subsystem)
+	{
+		return counters[static_cast<size_t>(subsystem)].bytes.load(std::memory_order_relaxed);
+	}
+
+	size_t allocationCount()
+	{
+		return allocations.load(std::memory_order_relaxed);
+	}
+
+	static std::string formatBytes(const size_t bytes)
+	{
+		if (bytes >= 1024 * 1024 * 1024) return std::format("{:.2f}GB", bytes / (1024.0 * 1024.0 * 1024.0));
+		if (bytes >= 1024 * 1024) return std::format("{:.1f}MB", bytes / (1024.0 * 1024.0));
+		if (bytes >= 1024) return std::format("{:.1f}KB", bytes / 1024.0);
+		return std::format("{}B", bytes);
+	}
+
+	/// <summary>
+	/// The total live bytes and those of every subsystem holding any, on one line for the status bar
+	/// </summary>
+	std::string summary()
+	{
+		size_t totalBytes = 0;
+		std::string subsystems;
+		for (size_t i = 0; i < subsystemCount; ++i)
+		{
+			const size_t bytes = counters[i].bytes.load(std::memory_order_relaxed);
+			if (bytes == 0) continue;
+			subsystems.append(std::format(" {} {}", subsystemNames[i], formatBytes(bytes)));
+			totalBytes += bytes;
+		}
+		return std::format("mem {}:{}", formatBytes(totalBytes), subsystems);
+	}
+
+	/// <summary>
+	/// Builds a table of the live bytes, live blocks and peak bytes of every subsystem.
+	/// Sizes are what was asked for; the block headers and malloc's own overhead come on top
+	/// </summary>
+	std::string report()
+	{
+		std::string output = std::format("{:<14}{:>12}{:>12}{:>12}\n", "subsystem", "live", "blocks", "peak");
+		size_t totalBytes = 0, totalBlocks = 0;
+		for (size_t i = 0; i < subsystemCount; ++i)
+		{
+			const size_t bytes = counters[i].bytes.load(std::memory_order_relaxed);
+			const size_t blocks = counters[i].blocks.load(std::memory_order_relaxed);
+			output.append(std::format("{:<14}{:>12}{:>12}{:>12}\n", subsystemNames[i], formatBytes(bytes), blocks, formatBytes(counters[i].peakBytes.load(std::memory_order_relaxed))));
+			totalBytes += bytes;
+			totalBlocks += blocks;
+		}
+		output.append(std::format("{:<14}{:>12}{:>12}\n", "total", formatBytes(totalBytes), totalBlocks));
+		output.append(std::format("{} in block headers, {} allocations made\n", formatBytes(totalBlocks * sizeof(BlockHeader)), allocationCount()));
+		return output;
+	}
+}
+
+//Every allocation goes through here so it can be charged to a subsystem. Aligned allocations keep the standard versions and aren't counted
+void* operator new(const size_t size)
+{
+	return Memory::allocate(size);
+}
+
+void* operator new[](const size_t size)
+{
+	return Memory::allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	Memory::deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	Memory::deallocate(memory);
+}
+
+void operator delete(void* memory, const size_t) noexcept
+{
+	Memory::deallocate(memory);
+}
+
+void operator delete[](void* memory, const size_t) noexcept
+{
+	Memory::deallocate(memory);
+}
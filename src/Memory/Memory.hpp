@@ -0,0 +1,69 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Counts the heap memory held by each part of the editor. Every allocation made through operator new is charged to the subsystem
+/// of the innermost Scope on the allocating thread (Other if there is none), and given back to the same subsystem when it is freed.
+/// A block stays charged to the subsystem that allocated it even if it changes hands afterwards. Line text comes from per-subsystem slabs,
+/// which are charged as a whole when they are carved
+/// </summary>
+namespace Memory
+{
+	enum class Subsystem : uint8_t
+	{
+		Other,
+		Text, //The rows of every buffer
+		Rendered, //The rendered copies of the rows and the frame being built
+		Undo,
+		Redo,
+		Highlights,
+		SearchIndex,
+		Registers,
+		EnumCount
+	};
+
+	/// <summary>
+	/// Charges the allocations made on this thread to a subsystem for as long as it is in scope
+	/// </summary>
+	class Scope
+	{
+	public:
+		Scope(const Subsystem subsystem);
+		~Scope();
+
+	private:
+		Subsystem previous;
+	};
+
+	Subsystem current();
+	size_t liveBytes(const Subsystem subsystem);
+	size_t allocationCount();
+	std::string summary();
+	std::string report();
+}
@@ -0,0 +1,189 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "LineIndex.hpp"
+#include "Trace/Trace.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Keeps the scan from slowing down the pager's keys, which matters most on a machine with few cores
+/// </summary>
+static void lowerThreadPriority()
+{
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+	setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+/// <summary>
+/// Starts scanning the file in the background
+/// </summary>
+/// <param name="fileName">The file to index. The worker maps it on its own, so it never moves the window of the caller's MappedFile</param>
+LineIndex::LineIndex(const std::string_view& fileName)
+	: mWorker(&LineIndex::worker, this, std::string(fileName))
+{
+}
+
+LineIndex::~LineIndex()
+{
+	mStop = true;
+	if (mWorker.joinable()) mWorker.join();
+}
+
+/// <summary>
+/// Finds where a line starts, reading forward from the checkpoint before it
+/// </summary>
+/// <param name="line">The line to find, counted from 0</param>
+/// <param name="file">The file the index was built for, read to get from the checkpoint to the line</param>
+/// <param name="offset">Set to where the line starts</param>
+/// <returns>False if the scan hasn't reached the line yet, or the file doesn't have that many lines</returns>
+bool LineIndex::findLine(const uint64_t line, MappedFile& file, uint64_t& offset) const
+{
+	Checkpoint checkpoint;
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		if (line >= mLines) return false;
+		checkpoint = *(std::upper_bound(mCheckpoints.begin(), mCheckpoints.end(), line, [](const uint64_t l, const Checkpoint& c) { return l < c.line; }) - 1);
+	}
+
+	offset = checkpoint.offset;
+	for (uint64_t remaining = line - checkpoint.line; remaining > 0;)
+	{
+		const std::string_view text = file.view(offset, bytesPerStep);
+		if (text.empty()) return false;
+		const char* lineBreak = static_cast<const char*>(std::memchr(text.data(), '\n', text.length()));
+		if (lineBreak == nullptr)
+		{
+			offset += text.length();
+			continue;
+		}
+		offset += lineBreak - text.data() + 1;
+		--remaining;
+	}
+	return true;
+}
+
+/// <summary>
+/// Finds the number of the line holding byte 'offset', counting the line endings after the checkpoint before it
+/// </summary>
+/// <param name="file">The file the index was built for</param>
+/// <param name="line">Set to the line number, counted from 0</param>
+/// <returns>False if the scan hasn't reached the offset yet</returns>
+bool LineIndex::lineNumber(const uint64_t offset, MappedFile& file, uint64_t& line) const
+{
+	Checkpoint checkpoint;
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		if (offset > mScanned) return false;
+		checkpoint = *(std::upper_bound(mCheckpoints.begin(), mCheckpoints.end(), offset, [](const uint64_t o, const Checkpoint& c) { return o < c.offset; }) - 1);
+	}
+
+	line = checkpoint.line;
+	for (uint64_t pos = checkpoint.offset; pos < offset;)
+	{
+		const std::string_view text = file.view(pos, static_cast<size_t>(std::min<uint64_t>(bytesPerStep, offset - pos)));
+		if (text.empty()) return false;
+		line += std::count(text.begin(), text.end(), '\n');
+		pos += text.length();
+	}
+	return true;
+}
+
+/// <summary>
+/// True once the whole file has been scanned
+/// </summary>
+bool LineIndex::finished() const
+{
+	return mFinished;
+}
+
+/// <summary>
+/// How many lines the file has, once it has been scanned. Before that, how many have been found so far
+/// </summary>
+uint64_t LineIndex::lineCount() const
+{
+	std::lock_guard<std::mutex> guard(mMutex);
+	return mLines;
+}
+
+/// <summary>
+/// How many bytes from the start of the file have been scanned
+/// </summary>
+uint64_t LineIndex::scannedBytes() const
+{
+	return mScanned;
+}
+
+/// <summary>
+/// Scans the file for line endings a step at a time, publishing the checkpoints found after each step
+/// </summary>
+void LineIndex::worker(const std::string fileName)
+{
+	lowerThreadPriority();
+	MappedFile file;
+	if (!file.open(fileName))
+	{
+		mFinished = true;
+		return;
+	}
+
+	std::vector<Checkpoint> found;
+	uint64_t offset = 0, line = 0; //The line that holds 'offset'
+	Checkpoint last = mCheckpoints.front();
+	while (offset < file.size() && !mStop)
+	{
+		TRACE_SCOPE("LineIndex::scan");
+		const std::string_view text = file.view(offset, bytesPerStep);
+		if (text.empty()) break; //The window couldn't be mapped
+		for (const char* pos = text.data(); (pos = static_cast<const char*>(std::memchr(pos, '\n', text.data() + text.length() - pos))) != nullptr; ++pos)
+		{
+			++line;
+			const uint64_t lineStart = offset + (pos - text.data()) + 1;
+			if (line - last.line >= linesPerCheckpoint || lineStart - last.offset >= bytesPerCheckpoint)
+			{
+				last = Checkpoint{ lineStart, line };
+				found.push_back(last);
+			}
+		}
+		offset += text.length();
+
+		std::lock_guard<std::mutex> guard(mMutex);
+		mCheckpoints.insert(mCheckpoints.end(), found.begin(), found.end());
+		mLines = line + 1;
+		mScanned = offset;
+		found.clear();
+	}
+	mFinished = !mStop;
+}
@@ -0,0 +1,74 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File/MappedFile.hpp"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// A sparse index of where the lines of a file start, for files too big to split into rows. A worker scans the file in the background
+/// and keeps a checkpoint every linesPerCheckpoint lines, so any line or line number is found by reading forward from the checkpoint before it.
+/// Only the checkpoints are kept, so the index stays small however big the file is
+/// </summary>
+class LineIndex
+{
+public:
+	static constexpr uint64_t linesPerCheckpoint = 4096;
+	static constexpr uint64_t bytesPerCheckpoint = 16 << 20; //Files with long lines also get a checkpoint at the first line after this many bytes
+
+	LineIndex(const std::string_view& fileName);
+	~LineIndex();
+
+	bool findLine(const uint64_t line, MappedFile& file, uint64_t& offset) const;
+	bool lineNumber(const uint64_t offset, MappedFile& file, uint64_t& line) const;
+	bool finished() const;
+	uint64_t lineCount() const;
+	uint64_t scannedBytes() const;
+
+private:
+	struct Checkpoint
+	{
+		uint64_t offset, line; //Where the line starts, and its number
+	};
+
+	void worker(const std::string fileName);
+
+private:
+	static constexpr size_t bytesPerStep = 1 << 20; //How much of the file the worker scans between publishing what it found
+
+	std::vector<Checkpoint> mCheckpoints{ Checkpoint{ 0, 0 } };
+	uint64_t mLines = 1; //How many lines start in the part of the file scanned so far. Like loaded rows, a line ending starts another line
+	std::atomic<uint64_t> mScanned = 0; //How many bytes from the start of the file have been scanned
+	std::atomic<bool> mFinished = false;
+	std::atomic<bool> mStop = false;
+	mutable std::mutex mMutex; //Guards mCheckpoints and mLines
+	std::thread mWorker;
+};
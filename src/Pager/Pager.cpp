@@ -0,0 +1,514 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Pager.hpp"
+#include "Console/Console.hpp"
+#include "Input/Input.hpp"
+#include "Unicode/Unicode.hpp"
+#include "Trace/Trace.hpp"
+
+#include <iostream>
+#include <filesystem>
+#include <format>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+
+using KeyActions::KeyAction;
+
+/// <summary>
+/// True if the file is too big to load into rows, so it should be paged instead
+/// </summary>
+bool Pager::isTooBig(const std::string_view& fileName)
+{
+	std::error_code error;
+	const uintmax_t size = std::filesystem::file_size(std::filesystem::current_path() / fileName, error);
+	return !error && size > autoPageSize;
+}
+
+/// <summary>
+/// Shows the file until :q. While the file is still being scanned, the status row is redrawn every so often to show how far it got
+/// </summary>
+/// <param name="fileName">The file to page, relative to the current directory</param>
+/// <param name="terminal">Where output is drawn and input is read from</param>
+int Pager::run(const std::string_view& fileName, std::unique_ptr<Terminal> terminal)
+{
+	mFileName = fileName;
+	if (!mFile.open(fileName))
+	{
+		std::cerr << "ERROR: Could not open " << fileName << "\n";
+		return EXIT_FAILURE;
+	}
+	Console::initTerminal(std::move(terminal));
+	mIndex = std::make_unique<LineIndex>(fileName);
+
+	Terminal& input = Console::terminal();
+	constexpr std::chrono::milliseconds progressInterval(250);
+	while (!mQuit && !input.atEnd())
+	{
+		refreshScreen();
+		if (!input.waitForInput(progressInterval) && !mIndex->finished()) continue;
+		handleKey(InputHandler::getInput());
+	}
+	mIndex.reset();
+	Console::disableRawInput();
+	return EXIT_SUCCESS;
+}
+
+/// <summary>
+/// The line starting at 'start', without its line ending. Only the first maxLineBytes of a longer line are returned.
+/// The text is in the file's mapping, so it is only valid until the file is read again
+/// </summary>
+std::string_view Pager::lineAt(const uint64_t start)
+{
+	const std::string_view text = mFile.view(start, maxLineBytes);
+	return text.substr(0, text.find('\n'));
+}
+
+/// <summary>
+/// Finds where the line after the one starting at 'start' starts
+/// </summary>
+/// <returns>False if the line is the last one</returns>
+bool Pager::nextLine(const uint64_t start, uint64_t& next)
+{
+	for (uint64_t pos = start; pos < mFile.size();)
+	{
+		const std::string_view text = mFile.view(pos, searchBytes);
+		if (text.empty()) return false;
+		const size_t lineBreak = text.find('\n');
+		if (lineBreak != std::string_view::npos)
+		{
+			next = pos + lineBreak + 1;
+			return true;
+		}
+		pos += text.length();
+	}
+	return false;
+}
+
+/// <summary>
+/// Finds where the line holding byte 'offset' starts, reading back from it
+/// </summary>
+uint64_t Pager::lineStart(const uint64_t offset)
+{
+	for (uint64_t end = std::min(offset, mFile.size()); end > 0;)
+	{
+		const uint64_t start = end - std::min<uint64_t>(end, searchBytes);
+		const std::string_view text = mFile.view(start, static_cast<size_t>(end - start));
+		if (text.empty()) return end;
+		const size_t lineBreak = text.rfind('\n');
+		if (lineBreak != std::string_view::npos) return start + lineBreak + 1;
+		end = start;
+	}
+	return 0;
+}
+
+/// <summary>
+/// Moves the screen over the file. Up and down move the top line, left and right scroll sideways a column at a time
+/// </summary>
+void Pager::scroll(const KeyAction key, const size_t count)
+{
+	const size_t textRows = mScreenRows > 2 ? mScreenRows - 2 : 1;
+	uint64_t next;
+	switch (key)
+	{
+	case KeyAction::ArrowDown:
+	case KeyAction::CtrlArrowDown:
+	case KeyAction::PageDown:
+	case KeyAction::CtrlPageDown:
+	{
+		const size_t lines = key == KeyAction::PageDown || key == KeyAction::CtrlPageDown ? count * textRows : count;
+		for (size_t i = 0; i < lines && nextLine(mTop, next); ++i) mTop = next;
+		break;
+	}
+	case KeyAction::ArrowUp:
+	case KeyAction::CtrlArrowUp:
+	case KeyAction::PageUp:
+	case KeyAction::CtrlPageUp:
+	{
+		const size_t lines = key == KeyAction::PageUp || key == KeyAction::CtrlPageUp ? count * textRows : count;
+		for (size_t i = 0; i < lines && mTop > 0; ++i) mTop = lineStart(mTop - 1);
+		break;
+	}
+	case KeyAction::CtrlHome:
+		mTop = 0;
+		break;
+	case KeyAction::CtrlEnd: //The last line goes at the bottom of the screen
+		mTop = lineStart(mFile.size());
+		for (size_t i = 1; i < textRows && mTop > 0; ++i) mTop = lineStart(mTop - 1);
+		break;
+	case KeyAction::ArrowLeft:
+	case KeyAction::CtrlArrowLeft:
+		mColOffset -= std::min(count, mColOffset);
+		break;
+	case KeyAction::ArrowRight:
+	case KeyAction::CtrlArrowRight:
+		mColOffset += count;
+		break;
+	case KeyAction::Home:
+		mColOffset = 0;
+		break;
+	case KeyAction::End: //Scrolls to the end of the longest line on the screen
+	{
+		size_t width = 0;
+		uint64_t start = mTop;
+		for (size_t y = 0; y < textRows; ++y)
+		{
+			const std::string_view line = lineAt(start);
+			width = std::max(width, Unicode::column(line, line.length()));
+			if (!nextLine(start, start)) break;
+		}
+		mColOffset = width >= mScreenCols ? width - mScreenCols + 1 : 0;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+/// <summary>
+/// Puts a line at the top of the screen. Lines the scan hasn't reached yet can't be found by number
+/// </summary>
+/// <param name="line">The line, counted from 0</param>
+void Pager::goToLine(const uint64_t line)
+{
+	uint64_t offset;
+	if (mIndex->findLine(line, mFile, offset))
+	{
+		mTop = offset;
+	}
+	else if (mIndex->finished())
+	{
+		mIndex->findLine(mIndex->lineCount() - 1, mFile, mTop);
+	}
+	else
+	{
+		mStatusMessage = std::format("Line {} hasn't been scanned yet", line + 1);
+	}
+}
+
+/// <summary>
+/// Runs a command typed after : The pager only knows :{line} and the ways of quitting
+/// </summary>
+void Pager::command(const std::string_view& command)
+{
+	const size_t first = command.find_first_not_of(' '), last = command.find_last_not_of(' ');
+	if (first == std::string_view::npos) return;
+	const std::string_view name = command.substr(first, last - first + 1);
+
+	uint64_t line;
+	const auto [end, error] = std::from_chars(name.data(), name.data() + name.length(), line);
+	if (error == std::errc() && end == name.data() + name.length())
+	{
+		goToLine(line > 0 ? line - 1 : 0);
+	}
+	else if (name == "q" || name == "q!" || name == "qa" || name == "qa!")
+	{
+		mQuit = true;
+	}
+	else
+	{
+		mStatusMessage = std::format("Not a pager command: {}", name);
+	}
+}
+
+/// <summary>
+/// Sets the active search pattern and goes to its first match from the top of the screen
+/// </summary>
+/// <param name="pattern">A literal pattern, or a regex if prefixed with \v</param>
+void Pager::find(const std::string_view& pattern)
+{
+	if (pattern.empty()) return;
+	mSearchQuery = Search::compile(pattern);
+	mMatch.reset();
+	findNext(true);
+}
+
+/// <summary>
+/// Goes to the next/previous match of the active search pattern, wrapping around the file. The match is put at the top of the screen.
+/// Searching starts after the last match if it is still on the top line, and from the top line otherwise
+/// </summary>
+/// <param name="forward">Search forwards (n) or backwards (N)</param>
+void Pager::findNext(const bool forward)
+{
+	if (mSearchQuery.pattern.empty()) return;
+	TRACE_SCOPE("Pager::findNext");
+
+	const bool fromMatch = mMatch.has_value() && lineStart(*mMatch) == mTop;
+	const uint64_t from = fromMatch && forward ? *mMatch + 1 : fromMatch ? *mMatch : mTop;
+	auto search = [&](const uint64_t first, const uint64_t end, uint64_t& match, size_t& matchLength)
+		{
+			if (mSearchQuery.isRegex) return findRegex(first, end, forward, match, matchLength);
+			matchLength = mSearchQuery.pattern.length();
+			return findLiteral(mSearchQuery.pattern, first, end, forward, match);
+		};
+
+	uint64_t match;
+	size_t matchLength;
+	const bool found = forward ? search(from, mFile.size(), match, matchLength) || search(0, from, match, matchLength)
+		: search(0, from, match, matchLength) || search(from, mFile.size(), match, matchLength);
+	if (!found)
+	{
+		mStatusMessage = std::format("Pattern not found: {}", mSearchQuery.pattern);
+		return;
+	}
+
+	mMatch = match;
+	mMatchLength = matchLength;
+	mTop = lineStart(match);
+	if (match - mTop <= maxLineBytes) //Scroll sideways to the match if it's off the screen
+	{
+		const size_t column = Unicode::column(lineAt(mTop), static_cast<size_t>(match - mTop));
+		if (column < mColOffset || column >= mColOffset + mScreenCols) mColOffset = column > mScreenCols / 2 ? column - mScreenCols / 2 : 0;
+	}
+}
+
+/// <summary>
+/// Finds a literal pattern in the file, a step at a time straight from the mapping
+/// </summary>
+/// <param name="first">The first byte a match may start at</param>
+/// <param name="end">Matches start before this byte</param>
+/// <param name="forward">Find the first match in the range if true, the last one if false</param>
+/// <param name="match">Set to where the match starts</param>
+/// <returns>True if a match was found</returns>
+bool Pager::findLiteral(const std::string_view& pattern, const uint64_t first, const uint64_t end, const bool forward, uint64_t& match)
+{
+	const size_t overlap = pattern.length() - 1; //Each step reads this much past its end, so matches across two steps are found
+	if (forward)
+	{
+		for (uint64_t pos = first; pos < end;)
+		{
+			const std::string_view text = mFile.view(pos, static_cast<size_t>(std::min<uint64_t>(searchBytes, end - pos) + overlap));
+			if (text.length() < pattern.length()) return false;
+			const size_t found = text.find(pattern);
+			if (found != std::string_view::npos)
+			{
+				match = pos + found;
+				return true;
+			}
+			pos += text.length() - overlap;
+		}
+		return false;
+	}
+
+	for (uint64_t stepEnd = end; stepEnd > first;)
+	{
+		const uint64_t pos = stepEnd - std::min<uint64_t>(searchBytes, stepEnd - first);
+		const size_t found = mFile.view(pos, static_cast<size_t>(stepEnd - pos) + overlap).rfind(pattern);
+		if (found != std::string_view::npos)
+		{
+			match = pos + found;
+			return true;
+		}
+		stepEnd = pos;
+	}
+	return false;
+}
+
+/// <summary>
+/// Finds a regex in the file a line at a time. If the regex has a literal every match contains, it is found first with findLiteral(),
+/// which skips the lines the regex can't match without running it on them
+/// </summary>
+/// <param name="first">The first byte a match may start at</param>
+/// <param name="end">Matches start before this byte</param>
+/// <param name="forward">Find the first match in the range if true, the last one if false</param>
+/// <param name="match">Set to where the match starts</param>
+/// <param name="matchLength">Set to the length of the match</param>
+/// <returns>True if a match was found</returns>
+bool Pager::findRegex(const uint64_t first, const uint64_t end, const bool forward, uint64_t& match, size_t& matchLength)
+{
+	if (first >= end) return false;
+	const std::string* literal = mSearchQuery.requiredLiterals.empty() ? nullptr : &mSearchQuery.requiredLiterals.front();
+	const uint64_t firstLine = lineStart(first);
+	uint64_t start = forward ? firstLine : lineStart(end - 1);
+	while (true)
+	{
+		uint64_t literalPos;
+		if (literal != nullptr) //Skip to the nearest line holding the literal
+		{
+			const bool found = forward ? findLiteral(*literal, start, mFile.size(), true, literalPos) : findLiteral(*literal, firstLine, start + lineAt(start).length(), false, literalPos);
+			if (!found) return false;
+			const uint64_t literalLine = lineStart(literalPos);
+			if (forward && literalLine >= end) return false;
+			start = forward ? std::max(start, literalLine) : std::min(start, literalLine);
+		}
+
+		const std::string_view line = lineAt(start);
+		size_t col, length;
+		if (forward)
+		{
+			const size_t startCol = first > start ? static_cast<size_t>(first - start) : 0;
+			if (start >= end) return false;
+			if (startCol <= line.length() && Search::findInRow(mSearchQuery, line, startCol, col, length) && start + col < end)
+			{
+				match = start + col;
+				matchLength = length;
+				return true;
+			}
+			if (!nextLine(start, start)) return false;
+		}
+		else
+		{
+			const size_t endCol = end - start < line.length() ? static_cast<size_t>(end - start) : std::string_view::npos;
+			if (Search::findLastInRow(mSearchQuery, line, endCol, col, length) && start + col >= first)
+			{
+				match = start + col;
+				matchLength = length;
+				return true;
+			}
+			if (start <= firstLine) return false;
+			start = lineStart(start - 1);
+		}
+	}
+}
+
+/// <summary>
+/// Handles a key. The read mode motions can be given a count, like in the editor
+/// </summary>
+void Pager::handleKey(const KeyAction keyPressed)
+{
+	const KeyAction key = InputHandler::mapMovementKey(keyPressed);
+	if ((key >= static_cast<KeyAction>('1') && key <= static_cast<KeyAction>('9')) || (key == static_cast<KeyAction>('0') && mPendingCount > 0))
+	{
+		mPendingCount = mPendingCount * 10 + (static_cast<size_t>(key) - '0');
+		return;
+	}
+
+	const size_t count = mPendingCount > 0 ? mPendingCount : 1;
+	mPendingCount = 0;
+	switch (key)
+	{
+	case static_cast<KeyAction>(':'):
+	case static_cast<KeyAction>('/'):
+	{
+		mStatusMessage.clear();
+		Console::terminal().write(std::format("\x1b[{};1H\x1b[0K{}", mScreenRows, static_cast<char>(key))); //The prompt is typed on the bottom row
+		Console::disableRawInput();
+		const std::string line = InputHandler::readPromptLine();
+		Console::enableRawInput();
+		if (key == static_cast<KeyAction>(':')) command(line);
+		else find(line);
+		break;
+	}
+	case static_cast<KeyAction>('n'):
+	case static_cast<KeyAction>('N'):
+		for (size_t i = 0; i < count; ++i)
+		{
+			findNext(key == static_cast<KeyAction>('n'));
+		}
+		break;
+	case static_cast<KeyAction>('q'): //There are no macros to record, so q quits like in other pagers
+		mQuit = true;
+		break;
+	case static_cast<KeyAction>('0'):
+		scroll(KeyAction::Home, 1);
+		break;
+	case KeyAction::Esc:
+		mStatusMessage.clear();
+		break;
+	default:
+		scroll(key, count);
+		break;
+	}
+}
+
+/// <summary>
+/// Draws the lines on the screen straight from the file's mapping, with the last match in inverse colors, then the status row
+/// </summary>
+void Pager::refreshScreen()
+{
+	TRACE_SCOPE("Pager::refreshScreen");
+	Console::terminal().getSize(mScreenRows, mScreenCols);
+	const size_t textRows = mScreenRows > 2 ? mScreenRows - 2 : 0;
+
+	std::string renderBuffer = "\x1b[?2026h"; //Begin a synchronized update
+	std::string rendered;
+	uint64_t start = mTop;
+	bool atEnd = false;
+	for (size_t y = 0; y < textRows; ++y)
+	{
+		renderBuffer.append(std::format("\x1b[{};1H", y + 1));
+		if (atEnd)
+		{
+			renderBuffer.append("~");
+		}
+		else
+		{
+			const std::string_view line = lineAt(start);
+			size_t matchColumn = mColOffset, matchEnd = mColOffset; //The columns of the match on this line, clipped to the screen
+			if (mMatch.has_value() && *mMatch >= start && *mMatch - start <= line.length())
+			{
+				const size_t matchStart = static_cast<size_t>(*mMatch - start);
+				matchColumn = std::clamp(Unicode::column(line, matchStart), mColOffset, mColOffset + mScreenCols);
+				matchEnd = std::clamp(Unicode::column(line, std::min(matchStart + mMatchLength, line.length())), matchColumn, mColOffset + mScreenCols);
+			}
+			renderColumns(line, mColOffset, matchColumn - mColOffset, rendered);
+			renderBuffer.append(rendered);
+			if (matchEnd > matchColumn)
+			{
+				renderColumns(line, matchColumn, matchEnd - matchColumn, rendered);
+				renderBuffer.append("\x1b[7m").append(rendered).append("\x1b[0m");
+			}
+			renderColumns(line, matchEnd, mColOffset + mScreenCols - matchEnd, rendered);
+			renderBuffer.append(rendered);
+			atEnd = !nextLine(start, start);
+		}
+		renderBuffer.append("\x1b[0K");
+	}
+
+	uint64_t line;
+	const bool known = mIndex->lineNumber(mTop, mFile, line);
+	const bool finished = mIndex->finished();
+	const uint64_t scanned = mFile.size() > 0 ? mIndex->scannedBytes() * 100 / mFile.size() : 100;
+	std::string status = std::format("{} - {} {}", mFileName, finished ? std::format("{} lines", mIndex->lineCount()) : std::format("scanning {}%", scanned), mStatusMessage);
+	const std::string rStatus = std::format("PAGER  line {}{}", known ? std::to_string(line + 1) : "?", finished ? std::format("/{}", mIndex->lineCount()) : "");
+	if (status.length() + rStatus.length() + 1 > mScreenCols) status.resize(mScreenCols > rStatus.length() + 1 ? mScreenCols - rStatus.length() - 1 : 0);
+	renderBuffer.append(std::format("\x1b[{};1H\x1b[7m{}{}{}\x1b[0m", textRows + 1, status, std::string(mScreenCols - std::min(mScreenCols, status.length() + rStatus.length()), ' '), rStatus.substr(0, mScreenCols)));
+	renderBuffer.append(std::format("\x1b[{};1H\x1b[0K", mScreenRows)); //Clear the command row
+	renderBuffer.append("\x1b[1;1H");
+	renderBuffer.append("\x1b[?2026l"); //End the synchronized update
+	Console::terminal().write(renderBuffer);
+}
+
+/// <summary>
+/// Renders the columns [firstColumn, firstColumn + columns) of a line. A wide character cut by either edge is replaced by spaces
+/// </summary>
+void Pager::renderColumns(const std::string_view& line, const size_t firstColumn, const size_t columns, std::string& rendered)
+{
+	rendered.clear();
+	const size_t first = Unicode::indexAtColumn(line, firstColumn);
+	if (first >= line.length() || columns == 0) return;
+	const size_t end = Unicode::nextCharacter(line, Unicode::indexAtColumn(line, firstColumn + columns - 1));
+
+	//Tabs are expanded from the tab stop before the first character, so they reach the same stops as in the whole line
+	const size_t startColumn = Unicode::column(line, first), phase = startColumn % Unicode::tabWidth;
+	std::string text(phase, ' ');
+	text.append(line.substr(first, end - first));
+	std::string expanded;
+	Unicode::expandTabs(text, expanded);
+	const Unicode::Clip clip = Unicode::clipColumns(expanded, firstColumn - (startColumn - phase), columns);
+	rendered.assign(clip.spacesBefore, ' ');
+	rendered.append(expanded, clip.start, clip.end - clip.start);
+	rendered.append(clip.spacesAfter, ' ');
+}
@@ -0,0 +1,84 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "LineIndex.hpp"
+#include "File/MappedFile.hpp"
+#include "KeyActions/KeyActions.hh"
+#include "Search/Search.hpp"
+#include "Terminal/Terminal.hpp"
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <optional>
+#include <cstdint>
+
+/// <summary>
+/// A read-only view of a file too big to load, opened with -R or picked automatically above autoPageSize.
+/// The file is mapped a window at a time and the rows on screen are read straight from the mapping, so nothing is
+/// kept per line and opening the file takes the same time and memory at any size. Lines are found by reading back or forward
+/// from the top of the screen, or from the checkpoints of a LineIndex when jumping to a line number.
+/// The read mode motions, counts, :{line}, :q and / n N searches work as in the editor
+/// </summary>
+class Pager
+{
+public:
+	static constexpr uint64_t autoPageSize = 1ull << 30; //Files bigger than this are paged instead of loaded
+	static constexpr size_t maxLineBytes = 1 << 20; //Only this much of a longer line is drawn and searched with a regex
+
+	static bool isTooBig(const std::string_view& fileName);
+	static int run(const std::string_view& fileName, std::unique_ptr<Terminal> terminal);
+
+private:
+	static std::string_view lineAt(const uint64_t start);
+	static bool nextLine(const uint64_t start, uint64_t& next);
+	static uint64_t lineStart(const uint64_t offset);
+	static void scroll(const KeyActions::KeyAction key, const size_t count);
+	static void goToLine(const uint64_t line);
+	static void command(const std::string_view& command);
+	static void find(const std::string_view& pattern);
+	static void findNext(const bool forward);
+	static bool findLiteral(const std::string_view& pattern, const uint64_t first, const uint64_t end, const bool forward, uint64_t& match);
+	static bool findRegex(const uint64_t first, const uint64_t end, const bool forward, uint64_t& match, size_t& matchLength);
+	static void handleKey(const KeyActions::KeyAction key);
+	static void refreshScreen();
+	static void renderColumns(const std::string_view& line, const size_t firstColumn, const size_t columns, std::string& rendered);
+
+private:
+	static constexpr size_t searchBytes = 4 << 20; //How much of the file is read per step when looking for line endings or matches
+
+	inline static MappedFile mFile;
+	inline static std::unique_ptr<LineIndex> mIndex;
+	inline static std::string mFileName;
+	inline static uint64_t mTop = 0; //Where the line at the top of the screen starts
+	inline static size_t mColOffset = 0;
+	inline static size_t mScreenRows = 0, mScreenCols = 0;
+	inline static size_t mPendingCount = 0;
+	inline static Search::Query mSearchQuery;
+	inline static std::optional<uint64_t> mMatch; //Where the match found last starts
+	inline static size_t mMatchLength = 0;
+	inline static std::string mStatusMessage;
+	inline static bool mQuit = false;
+};
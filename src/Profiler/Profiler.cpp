@@ -0,0 +1,240 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Profiler.hpp"
+#include "Memory/Memory.hpp"
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <format>
+#include <span>
+
+namespace Profiler
+{
+	using Clock = std::chrono::steady_clock;
+
+	bool profilingEnabled = false;
+	constexpr Stage noStage = Stage::EnumCount;
+	Stage currentStage = noStage;
+	Clock::time_point stageStart;
+
+	/// <summary>
+	/// The newest maxSamples samples. Older ones are overwritten, so memory stays the same however long profiling runs
+	/// </summary>
+	struct SampleRing
+	{
+		static constexpr size_t maxSamples = 1 << 16;
+
+		std::vector<uint64_t> values; //Sized to maxSamples by the first sample
+		size_t next = 0, count = 0;
+
+		void clear()
+		{
+			next = count = 0;
+		}
+
+		void push(const uint64_t value)
+		{
+			if (values.empty()) values.resize(maxSamples);
+			values[next] = value;
+			next = (next + 1) % maxSamples;
+			count = std::min(count + 1, maxSamples);
+		}
+
+		uint64_t back() const
+		{
+			return values[(next + maxSamples - 1) % maxSamples];
+		}
+
+		/// <summary>
+		/// Copies the newest samples into 'out', as many as fit
+		/// </summary>
+		/// <returns>How many were copied</returns>
+		size_t newest(const std::span<uint64_t> out) const
+		{
+			const size_t copied = std::min(out.size(), count);
+			for (size_t i = 0; i < copied; ++i) out[i] = values[(next + maxSamples - 1 - i) % maxSamples];
+			return copied;
+		}
+	};
+
+	bool sampleOpen = false; //True from a key being read until the frame showing its result is written
+	Clock::time_point keyTime;
+	std::array<uint64_t, static_cast<size_t>(Stage::EnumCount)> sampleTimes{}; //Nanoseconds spent in each stage during the current keystroke
+	std::array<SampleRing, static_cast<size_t>(Stage::EnumCount)> stageSamples; //One entry per keystroke for each stage
+	SampleRing latencySamples; //Key read to frame written, one entry per keystroke
+	size_t keystrokes = 0; //Timed since profiling was turned on, including those whose samples were overwritten
+
+	size_t lastFrameBytes = 0;
+	size_t lastFrameAllocations = 0;
+	size_t allocationsAtLastFrame = 0;
+
+	/// <summary>
+	/// Adds the time since the last stage switch to the stage that was running
+	/// </summary>
+	static void chargeCurrentStage(const Clock::time_point now)
+	{
+		if (currentStage != noStage)
+		{
+			sampleTimes[static_cast<size_t>(currentStage)] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - stageStart).count();
+		}
+		stageStart = now;
+	}
+
+	ScopedStage::ScopedStage(const Stage stage) : previousStage(currentStage), active(profilingEnabled)
+	{
+		if (!active) return;
+		chargeCurrentStage(Clock::now());
+		currentStage = stage;
+	}
+
+	ScopedStage::~ScopedStage()
+	{
+		if (!active) return;
+		chargeCurrentStage(Clock::now());
+		currentStage = previousStage;
+	}
+
+	/// <summary>
+	/// Turns profiling on or off. Turning it on starts with no samples
+	/// </summary>
+	void enable(const bool enabled)
+	{
+		if (enabled && !profilingEnabled)
+		{
+			for (auto& samples : stageSamples) samples.clear();
+			latencySamples.clear();
+			keystrokes = 0;
+			sampleOpen = false;
+		}
+		profilingEnabled = enabled;
+	}
+
+	bool isEnabled()
+	{
+		return profilingEnabled;
+	}
+
+	/// <summary>
+	/// Starts timing a keystroke. Keys handled before the frame that shows them are timed together, from the first one
+	/// </summary>
+	/// <param name="restart">Start the keystroke over if one is being timed, e.g. so the time spent typing a command line isn't counted</param>
+	void beginSample(const bool restart)
+	{
+		if (!profilingEnabled || (sampleOpen && !restart)) return;
+		sampleTimes.fill(0);
+		keyTime = stageStart = Clock::now();
+		sampleOpen = true;
+	}
+
+	/// <summary>
+	/// Stores the times of the keystroke being timed. Does nothing if there isn't one
+	/// </summary>
+	void endSample()
+	{
+		if (!profilingEnabled || !sampleOpen) return;
+		const Clock::time_point now = Clock::now();
+		chargeCurrentStage(now);
+		for (size_t i = 0; i < sampleTimes.size(); ++i)
+		{
+			stageSamples[i].push(sampleTimes[i]);
+		}
+		latencySamples.push(std::chrono::duration_cast<std::chrono::nanoseconds>(now - keyTime).count());
+		++keystrokes;
+		sampleOpen = false;
+	}
+
+	/// <summary>
+	/// Called once a frame has been written to the terminal. Ends the keystroke being timed, since its result is now on screen
+	/// </summary>
+	/// <param name="bytes">The size of the frame</param>
+	void frameWritten(const size_t bytes)
+	{
+		if (!profilingEnabled) return;
+		const size_t allocationsNow = Memory::allocationCount();
+		lastFrameAllocations = allocationsNow - allocationsAtLastFrame;
+		allocationsAtLastFrame = allocationsNow;
+		lastFrameBytes = bytes;
+		endSample();
+	}
+
+	/// <summary>
+	/// Nearest-rank percentile of the newest samples, as many as 'scratch' holds, in microseconds. They are copied into scratch to be ordered
+	/// </summary>
+	static double percentile(const SampleRing& samples, const double fraction, const std::span<uint64_t> scratch)
+	{
+		const size_t count = samples.newest(scratch);
+		if (count == 0) return 0;
+		const size_t rank = std::clamp<size_t>(static_cast<size_t>(fraction * count + 0.999999), 1, count);
+		std::nth_element(scratch.begin(), scratch.begin() + (rank - 1), scratch.begin() + count);
+		return scratch[rank - 1] / 1000.0;
+	}
+
+	/// <summary>
+	/// Formats the p50/p99/max of a set of samples in microseconds
+	/// </summary>
+	static std::string percentileRow(const std::string_view& name, const SampleRing& samples)
+	{
+		if (samples.count == 0) return std::format("{:<10}{:>12}{:>12}{:>12}\n", name, "-", "-", "-");
+		std::vector<uint64_t> scratch(samples.count);
+		return std::format("{:<10}{:>12.1f}{:>12.1f}{:>12.1f}\n", name, percentile(samples, 0.50, scratch), percentile(samples, 0.99, scratch), percentile(samples, 1.0, scratch));
+	}
+
+	/// <summary>
+	/// Builds a table of the latency percentiles of every stage over the keystrokes timed so far, or the newest SampleRing::maxSamples of them
+	/// </summary>
+	std::string report()
+	{
+		static constexpr std::array<std::string_view, static_cast<size_t>(Stage::EnumCount)> stageNames = { "edit", "prep", "highlight", "render" };
+
+		std::string output = keystrokes > latencySamples.count ? std::format("{} keystrokes (percentiles of the newest {}), latency in microseconds\n", keystrokes, latencySamples.count)
+			: std::format("{} keystrokes, latency in microseconds\n", keystrokes);
+		output.append(std::format("{:<10}{:>12}{:>12}{:>12}\n", "stage", "p50", "p99", "max"));
+		for (size_t i = 0; i < stageSamples.size(); ++i)
+		{
+			output.append(percentileRow(stageNames[i], stageSamples[i]));
+		}
+		output.append(percentileRow("total", latencySamples));
+		return output;
+	}
+
+	/// <summary>
+	/// A one line summary of the last keystroke for the status bar: key-to-flush latency (last and p99 of the recent keys),
+	/// the prep/highlight/render times, and the size and allocation count of the last frame
+	/// </summary>
+	std::string overlay()
+	{
+		if (latencySamples.count == 0) return "perf: waiting for a key";
+
+		std::array<uint64_t, 256> recentKeys; //p99 is taken over the recent keys, so it reacts to a slowdown and stays cheap to compute
+		const auto last = [](const SampleRing& samples) { return samples.back() / 1000.0; };
+		return std::format("key {:.2f}ms p99 {:.2f} | prep {:.2f} hl {:.2f} draw {:.2f} | {:.1f}KB {} alloc",
+			last(latencySamples) / 1000.0, percentile(latencySamples, 0.99, recentKeys) / 1000.0,
+			last(stageSamples[static_cast<size_t>(Stage::Prep)]) / 1000.0,
+			last(stageSamples[static_cast<size_t>(Stage::Highlight)]) / 1000.0,
+			last(stageSamples[static_cast<size_t>(Stage::Render)]) / 1000.0,
+			lastFrameBytes / 1024.0, lastFrameAllocations);
+	}
+}
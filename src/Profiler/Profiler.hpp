@@ -0,0 +1,68 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+/// <summary>
+/// Measures how long each keystroke spends in each stage of the editor, and how long it takes from the key being read to the next frame being written.
+/// Stage times are exclusive: while a nested stage runs (e.g. highlighting inside a render), the outer stage's clock is paused.
+/// Everything is compiled in, but while profiling is disabled a stage costs one branch
+/// </summary>
+namespace Profiler
+{
+	enum class Stage : uint8_t
+	{
+		Edit,
+		Prep,
+		Highlight,
+		Render,
+		EnumCount
+	};
+
+	/// <summary>
+	/// Times a stage for as long as it is in scope. Does nothing while profiling is disabled
+	/// </summary>
+	class ScopedStage
+	{
+	public:
+		ScopedStage(const Stage stage);
+		~ScopedStage();
+
+	private:
+		Stage previousStage;
+		bool active;
+	};
+
+	void enable(const bool enabled = true);
+	bool isEnabled();
+	void beginSample(const bool restart = false);
+	void endSample();
+	void frameWritten(const size_t bytes);
+	std::string report();
+	std::string overlay();
+}
@@ -0,0 +1,77 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Registers.hpp"
+#include <array>
+
+namespace Registers
+{
+	std::array<Register, 27> registers; //a-z, plus the unnamed register at the end
+
+	/// <summary>
+	/// Maps a register name to its slot in the registers array
+	/// </summary>
+	/// <param name="name"></param>
+	/// <returns></returns>
+	static size_t registerIndex(const char name)
+	{
+		return name == unnamedRegister ? registers.size() - 1 : static_cast<size_t>(name - 'a');
+	}
+
+	/// <summary>
+	/// Returns true if the name is a register that can be used (a-z, or " for the unnamed register)
+	/// </summary>
+	/// <param name="name"></param>
+	/// <returns></returns>
+	bool isValidName(const char name)
+	{
+		return name == unnamedRegister || (name >= 'a' && name <= 'z');
+	}
+
+	/// <summary>
+	/// Stores a register. Like VIM, the unnamed register always holds the last yank/delete, so it shares the contents
+	/// </summary>
+	/// <param name="name"></param>
+	/// <param name="reg"></param>
+	void store(const char name, Register reg)
+	{
+		if (!isValidName(name)) return;
+		if (name != unnamedRegister)
+		{
+			registers[registerIndex(unnamedRegister)] = reg;
+		}
+		registers[registerIndex(name)] = std::move(reg);
+	}
+
+	/// <summary>
+	/// Returns the register with the given name
+	/// </summary>
+	/// <param name="name"></param>
+	/// <returns>nullptr if the register is empty or invalid</returns>
+	const Register* load(const char name)
+	{
+		if (!isValidName(name) || registers[registerIndex(name)].lines == nullptr) return nullptr;
+		return &registers[registerIndex(name)];
+	}
+}
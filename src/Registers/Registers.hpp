@@ -0,0 +1,59 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File/Line.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace Registers
+{
+	enum class SelectionType
+	{
+		Character,
+		Line,
+		Block
+	};
+
+	/// <summary>
+	/// The contents of a register.
+	/// The lines are immutable and reference counted, so storing them in several registers (the named register and the unnamed register),
+	/// or putting them many times, never copies them again. Lines of unedited rows point into the text of the file they were taken from,
+	/// which the register keeps alive, so yanking or deleting them only copies pointers
+	/// </summary>
+	struct Register
+	{
+		SelectionType type = SelectionType::Character;
+		std::shared_ptr<const std::vector<Line>> lines;
+		std::vector<std::shared_ptr<const std::string>> texts; //The texts the lines may point into
+	};
+
+	static constexpr char unnamedRegister = '"';
+
+	bool isValidName(const char name);
+	void store(const char name, Register reg);
+	const Register* load(const char name);
+}
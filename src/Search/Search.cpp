@@ -0,0 +1,173 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Search.hpp"
+#include <cctype>
+
+namespace Search
+{
+	/// <summary>
+	/// Pulls out the runs of plain characters a regex match is guaranteed to contain.
+	/// This is deliberately conservative: alternations give up entirely, and anything inside groups/classes or followed by an optional quantifier breaks the run
+	/// </summary>
+	/// <param name="regex"></param>
+	/// <returns></returns>
+	static std::vector<std::string> extractRequiredLiterals(const std::string_view& regex)
+	{
+		std::vector<std::string> literals;
+		if (regex.find('|') != std::string::npos) return literals;
+
+		std::string current;
+		auto endRun = [&]()
+			{
+				if (current.length() >= 3) literals.push_back(current);
+				current.clear();
+			};
+
+		size_t depth = 0;
+		for (size_t i = 0; i < regex.length(); ++i)
+		{
+			const char c = regex[i];
+			const char next = i + 1 < regex.length() ? regex[i + 1] : '\0';
+			const bool optional = next == '?' || next == '*' || next == '{';
+			if (c == '\\')
+			{
+				if (i + 1 >= regex.length()) break;
+				const char escaped = regex[++i];
+				const char afterEscape = i + 1 < regex.length() ? regex[i + 1] : '\0';
+				const bool escapedOptional = afterEscape == '?' || afterEscape == '*' || afterEscape == '{';
+				if (depth > 0 || std::isalnum(static_cast<unsigned char>(escaped)) || escapedOptional) //\d, \w, \b etc. are classes/anchors, not literals
+				{
+					endRun();
+					continue;
+				}
+				current += escaped;
+				if (afterEscape == '+') endRun();
+			}
+			else if (c == '(' || c == '[' || c == '{')
+			{
+				endRun();
+				++depth;
+			}
+			else if (c == ')' || c == ']' || c == '}')
+			{
+				if (depth > 0) --depth;
+				endRun();
+			}
+			else if (depth > 0)
+			{
+				continue;
+			}
+			else if (c == '.' || c == '^' || c == '$' || c == '?' || c == '*' || c == '+' || optional)
+			{
+				endRun();
+			}
+			else
+			{
+				current += c;
+				if (next == '+') endRun(); //The character itself is required, but whatever follows may not be adjacent
+			}
+		}
+		endRun();
+		return literals;
+	}
+
+	/// <summary>
+	/// Compiles a search pattern into a query
+	/// </summary>
+	/// <param name="pattern"></param>
+	/// <returns></returns>
+	Query compile(const std::string_view& pattern)
+	{
+		Query query;
+		if (pattern.starts_with("\\v"))
+		{
+			query.pattern = pattern.substr(2);
+			query.isRegex = true;
+			try
+			{
+				query.regex = std::regex(query.pattern, std::regex::ECMAScript | std::regex::optimize);
+			}
+			catch (const std::regex_error&) //An invalid regex is searched for literally instead
+			{
+				query.isRegex = false;
+			}
+		}
+		else
+		{
+			query.pattern = pattern;
+		}
+
+		if (query.isRegex)
+		{
+			query.requiredLiterals = extractRequiredLiterals(query.pattern);
+		}
+		else if (query.pattern.length() >= 3)
+		{
+			query.requiredLiterals.push_back(query.pattern);
+		}
+		return query;
+	}
+
+	/// <summary>
+	/// Finds the first match in the line that starts at or after startCol
+	/// </summary>
+	/// <returns>True if a match was found</returns>
+	bool findInRow(const Query& query, const std::string_view& line, size_t startCol, size_t& matchCol, size_t& matchLength)
+	{
+		if (startCol > line.length() || query.pattern.empty()) return false;
+
+		if (!query.isRegex)
+		{
+			const size_t findPos = line.find(query.pattern, startCol);
+			if (findPos == std::string::npos) return false;
+			matchCol = findPos; matchLength = query.pattern.length();
+			return true;
+		}
+
+		std::cmatch match;
+		const auto flags = startCol > 0 ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+		if (!std::regex_search(line.data() + startCol, line.data() + line.length(), match, query.regex, flags)) return false;
+		matchCol = startCol + match.position(0); matchLength = match.length(0);
+		return true;
+	}
+
+	/// <summary>
+	/// Finds the last match in the line that starts before endCol
+	/// </summary>
+	/// <returns>True if a match was found</returns>
+	bool findLastInRow(const Query& query, const std::string_view& line, size_t endCol, size_t& matchCol, size_t& matchLength)
+	{
+		bool found = false;
+		size_t col = 0, length = 0;
+		size_t startCol = 0;
+		while (findInRow(query, line, startCol, col, length) && col < endCol)
+		{
+			found = true;
+			matchCol = col; matchLength = length;
+			startCol = col + 1;
+		}
+		return found;
+	}
+}
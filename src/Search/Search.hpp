@@ -0,0 +1,48 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <regex>
+
+namespace Search
+{
+	/// <summary>
+	/// A compiled search pattern.
+	/// Patterns are literal by default. Prefixing the pattern with \v (VIM's "very magic") treats the rest as an ECMAScript regex
+	/// </summary>
+	struct Query
+	{
+		std::string pattern;
+		bool isRegex = false;
+		std::regex regex;
+		std::vector<std::string> requiredLiterals; //Literal pieces every match must contain. Used to filter rows through the trigram index
+	};
+
+	Query compile(const std::string_view& pattern);
+	bool findInRow(const Query& query, const std::string_view& line, size_t startCol, size_t& matchCol, size_t& matchLength);
+	bool findLastInRow(const Query& query, const std::string_view& line, size_t endCol, size_t& matchCol, size_t& matchLength);
+}
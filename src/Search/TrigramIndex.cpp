@@ -0,0 +1,309 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TrigramIndex.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include <algorithm>
+#include <numeric>
+
+/// <summary>
+/// Packs three bytes into a single trigram key
+/// </summary>
+static inline uint32_t trigramKey(const unsigned char a, const unsigned char b, const unsigned char c)
+{
+	return (static_cast<uint32_t>(a) << 16) | (static_cast<uint32_t>(b) << 8) | c;
+}
+
+/// <summary>
+/// Constructs the index and starts building it in the background
+/// </summary>
+/// <param name="rows">The rows to index. Must outlive the index</param>
+/// <param name="rowsMutex">Held by every edit to the rows</param>
+TrigramIndex::TrigramIndex(const std::vector<FileHandler::Row>& rows, std::mutex& rowsMutex) : mRows(rows), mMutex(rowsMutex)
+{
+	startBuild();
+}
+
+TrigramIndex::~TrigramIndex()
+{
+	stopBuild();
+}
+
+/// <summary>
+/// Locks the index and the rows. Row edits must happen while this lock is held so the background build never reads a row mid-edit
+/// </summary>
+/// <returns></returns>
+std::unique_lock<std::mutex> TrigramIndex::lock()
+{
+	return std::unique_lock<std::mutex>(mMutex);
+}
+
+/// <summary>
+/// Returns true once every row has been indexed
+/// </summary>
+/// <returns></returns>
+bool TrigramIndex::ready() const
+{
+	return mReady;
+}
+
+/// <summary>
+/// Throws away the current postings and rebuilds the index in the background.
+/// Used when the rows are replaced wholesale (undo/redo)
+/// </summary>
+void TrigramIndex::rebuild()
+{
+	stopBuild();
+	startBuild();
+}
+
+/// <summary>
+/// Resets the index state and launches the build worker
+/// </summary>
+void TrigramIndex::startBuild()
+{
+	Memory::Scope memoryScope(Memory::Subsystem::SearchIndex);
+	auto guard = lock();
+	mPostings.clear();
+	mRowIds.resize(mRows.size());
+	std::iota(mRowIds.begin(), mRowIds.end(), 0);
+	mNextId = static_cast<uint32_t>(mRows.size());
+	mIdToRowDirty = true;
+	mBuildPos = 0;
+	mReady = false;
+	mCancelBuild = false;
+	mWorker = std::thread(&TrigramIndex::buildWorker, this);
+}
+
+/// <summary>
+/// Cancels the build worker if it is running and waits for it to finish.
+/// Must be called before the rows are replaced wholesale, followed by rebuild() once they have been
+/// </summary>
+void TrigramIndex::stopBuild()
+{
+	mCancelBuild = true;
+	if (mWorker.joinable()) mWorker.join();
+}
+
+/// <summary>
+/// Indexes the rows a chunk at a time, releasing the lock between chunks
+/// </summary>
+void TrigramIndex::buildWorker()
+{
+	TRACE_SCOPE("buildSearchIndex");
+	Memory::Scope memoryScope(Memory::Subsystem::SearchIndex);
+	while (!mCancelBuild)
+	{
+		auto guard = lock();
+		if (mCancelBuild) return; //The rows may have been replaced while waiting for the lock
+		const size_t end = std::min(mBuildPos + rowsPerBuildStep, mRows.size());
+		for (; mBuildPos < end; ++mBuildPos)
+		{
+			indexRow(mRowIds[mBuildPos], mRows[mBuildPos].line, 0, std::string::npos);
+		}
+		if (mBuildPos >= mRows.size())
+		{
+			mReady = true;
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// Adds postings for every trigram that overlaps [startCol, endCol) in the line
+/// </summary>
+void TrigramIndex::indexRow(const uint32_t id, const std::string_view& line, const size_t startCol, const size_t endCol)
+{
+	Memory::Scope memoryScope(Memory::Subsystem::SearchIndex);
+	if (line.length() < 3) return;
+
+	const size_t first = startCol >= 2 ? startCol - 2 : 0;
+	const size_t last = std::min(endCol == std::string::npos ? line.length() : endCol + 2, line.length());
+	for (size_t i = first; i + 2 < last; ++i)
+	{
+		addPosting(mPostings[trigramKey(line[i], line[i + 1], line[i + 2])], id);
+	}
+}
+
+/// <summary>
+/// Adds an id to a posting list, keeping the list sorted and free of duplicates
+/// </summary>
+void TrigramIndex::addPosting(std::vector<uint32_t>& postings, const uint32_t id)
+{
+	if (postings.empty() || postings.back() < id)
+	{
+		postings.push_back(id);
+		return;
+	}
+	const auto it = std::lower_bound(postings.begin(), postings.end(), id);
+	if (*it != id) postings.insert(it, id);
+}
+
+/// <summary>
+/// Called after the text of a row changed. Only the trigrams touching the changed columns are added
+/// </summary>
+/// <param name="row">The row position</param>
+/// <param name="startCol">The first changed column</param>
+/// <param name="endCol">One past the last changed column</param>
+void TrigramIndex::rowChanged(const size_t row, const size_t startCol, const size_t endCol)
+{
+	if (row >= mBuildPos) return; //The worker hasn't reached this row yet and will index it when it does
+	indexRow(mRowIds[row], mRows[row].line, startCol, endCol);
+}
+
+/// <summary>
+/// Called after a row was inserted at the given position
+/// </summary>
+/// <param name="row"></param>
+void TrigramIndex::rowInserted(const size_t row)
+{
+	rowsInserted(row, 1);
+}
+
+/// <summary>
+/// Called after the row at the given position was erased. Its postings become stale and are ignored
+/// </summary>
+/// <param name="row"></param>
+void TrigramIndex::rowErased(const size_t row)
+{
+	rowsErased(row, 1);
+}
+
+/// <summary>
+/// Called after a block of rows was inserted at the given position
+/// </summary>
+/// <param name="row">The position of the first inserted row</param>
+/// <param name="count">How many rows were inserted</param>
+void TrigramIndex::rowsInserted(const size_t row, const size_t count)
+{
+	Memory::Scope memoryScope(Memory::Subsystem::SearchIndex);
+	mRowIds.insert(mRowIds.begin() + row, count, 0);
+	std::iota(mRowIds.begin() + row, mRowIds.begin() + row + count, mNextId);
+	mNextId += static_cast<uint32_t>(count);
+	mIdToRowDirty = true;
+	if (row < mBuildPos || (row == mBuildPos && mReady))
+	{
+		mBuildPos += count;
+		for (size_t r = row; r < row + count; ++r)
+		{
+			indexRow(mRowIds[r], mRows[r].line, 0, std::string::npos);
+		}
+	}
+}
+
+/// <summary>
+/// Called after rows were added after the last row. Unlike inserted rows they are left to the worker, which is started again
+/// if it had finished, so a followed file that grows quickly never has megabytes of rows indexed in the editor's thread
+/// </summary>
+/// <param name="count">How many rows were added</param>
+void TrigramIndex::rowsAppended(const size_t count)
+{
+	Memory::Scope memoryScope(Memory::Subsystem::SearchIndex);
+	const size_t row = mRowIds.size();
+	mRowIds.resize(row + count);
+	std::iota(mRowIds.begin() + row, mRowIds.end(), mNextId);
+	mNextId += static_cast<uint32_t>(count);
+	mIdToRowDirty = true;
+	if (!mReady || count == 0) return; //A running worker gets to them
+	if (mWorker.joinable()) mWorker.join(); //It set mReady under the lock held here, so it has already let go of it
+	mReady = false;
+	mCancelBuild = false;
+	mWorker = std::thread(&TrigramIndex::buildWorker, this);
+}
+
+/// <summary>
+/// Called after a block of rows was erased. Their postings become stale and are ignored
+/// </summary>
+/// <param name="row">The position of the first erased row</param>
+/// <param name="count">How many rows were erased</param>
+void TrigramIndex::rowsErased(const size_t row, const size_t count)
+{
+	if (row >= mRowIds.size()) return;
+	const size_t end = std::min(row + count, mRowIds.size());
+	mRowIds.erase(mRowIds.begin() + row, mRowIds.begin() + end);
+	mIdToRowDirty = true;
+	if (row < mBuildPos) mBuildPos -= std::min(end, mBuildPos) - row;
+}
+
+/// <summary>
+/// Finds the rows that may contain all of the given literals
+/// </summary>
+/// <param name="literals">Literal strings a match must contain</param>
+/// <param name="rows">Sorted candidate row positions</param>
+/// <returns>False if the index can't narrow the search down (still building, or no literal of 3+ characters)</returns>
+bool TrigramIndex::candidateRows(const std::vector<std::string>& literals, std::vector<size_t>& rows)
+{
+	Memory::Scope memoryScope(Memory::Subsystem::SearchIndex);
+	if (!mReady) return false;
+	auto guard = lock();
+
+	std::vector<const std::vector<uint32_t>*> lists;
+	for (const auto& literal : literals)
+	{
+		for (size_t i = 0; i + 2 < literal.length(); ++i)
+		{
+			const auto it = mPostings.find(trigramKey(literal[i], literal[i + 1], literal[i + 2]));
+			if (it == mPostings.end())
+			{
+				rows.clear(); //A required trigram appears nowhere, so nothing can match
+				return true;
+			}
+			lists.push_back(&it->second);
+		}
+	}
+	if (lists.empty()) return false;
+
+	std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); }); //Intersect starting from the most selective list
+
+	std::vector<uint32_t> ids = *lists.front();
+	for (size_t l = 1; l < lists.size() && !ids.empty(); ++l)
+	{
+		const std::vector<uint32_t>& other = *lists[l];
+		auto searchFrom = other.begin();
+		std::erase_if(ids, [&](const uint32_t id)
+			{
+				searchFrom = std::lower_bound(searchFrom, other.end(), id);
+				return searchFrom == other.end() || *searchFrom != id;
+			});
+	}
+
+	if (mIdToRowDirty)
+	{
+		mIdToRow.assign(mNextId, invalidRow);
+		for (size_t r = 0; r < mRowIds.size(); ++r)
+		{
+			mIdToRow[mRowIds[r]] = static_cast<uint32_t>(r);
+		}
+		mIdToRowDirty = false;
+	}
+
+	rows.clear();
+	for (const uint32_t id : ids)
+	{
+		if (mIdToRow[id] != invalidRow) rows.push_back(mIdToRow[id]);
+	}
+	std::sort(rows.begin(), rows.end());
+	return true;
+}
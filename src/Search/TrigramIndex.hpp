@@ -0,0 +1,86 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File/File.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// A trigram -> row posting index used to skip rows that cannot contain a search match.
+/// The index is built on a background thread and kept up to date as rows are edited.
+/// Postings are a superset: edited rows only ever gain postings, so stale entries can produce false candidates
+/// (which the matcher rejects) but a row that can match is never skipped.
+/// Rows are tracked by a stable id so that inserting/erasing rows doesn't require rewriting every posting list.
+/// </summary>
+class TrigramIndex
+{
+public:
+	TrigramIndex(const std::vector<FileHandler::Row>& rows, std::mutex& rowsMutex);
+	~TrigramIndex();
+
+	std::unique_lock<std::mutex> lock();
+	bool ready() const;
+	void stopBuild();
+	void rebuild();
+
+	//The notifications below must be called while holding lock(), in the same critical section as the row change
+	void rowChanged(const size_t row, const size_t startCol = 0, const size_t endCol = std::string::npos);
+	void rowInserted(const size_t row);
+	void rowErased(const size_t row);
+	void rowsInserted(const size_t row, const size_t count);
+	void rowsErased(const size_t row, const size_t count);
+	void rowsAppended(const size_t count);
+
+	bool candidateRows(const std::vector<std::string>& literals, std::vector<size_t>& rows);
+
+private:
+	void startBuild();
+	void buildWorker();
+	void indexRow(const uint32_t id, const std::string_view& line, const size_t startCol, const size_t endCol);
+	void addPosting(std::vector<uint32_t>& postings, const uint32_t id);
+
+private:
+	static constexpr size_t rowsPerBuildStep = 4096; //How many rows the worker indexes per lock, so edits are never blocked for long
+	static constexpr uint32_t invalidRow = UINT32_MAX;
+
+	const std::vector<FileHandler::Row>& mRows;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> mPostings;
+	std::vector<uint32_t> mRowIds; //The id of the row at each row position
+	std::vector<uint32_t> mIdToRow; //Reverse of mRowIds, rebuilt lazily after rows shift
+	bool mIdToRowDirty = true;
+	uint32_t mNextId = 0;
+
+	std::mutex& mMutex; //Shared with the buffer's edits and its highlighter
+	std::thread mWorker;
+	size_t mBuildPos = 0; //Rows before this position have been indexed
+	std::atomic<bool> mReady = false;
+	std::atomic<bool> mCancelBuild = false;
+};
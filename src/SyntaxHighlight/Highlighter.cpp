@@ -0,0 +1,197 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Highlighter.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include "Unicode/Unicode.hpp"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Lets the calling thread give way to the UI thread and the rest of the system
+/// </summary>
+static void lowerThreadPriority()
+{
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+	setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10); //Linux threads have their own nice value
+#endif
+}
+
+/// <summary>
+/// Constructs the highlighter and starts lexing the rows in the background
+/// </summary>
+/// <param name="rows">The rows to highlight. Must outlive the highlighter</param>
+/// <param name="rowsMutex">Held by every edit to the rows</param>
+/// <param name="syntax"></param>
+/// <param name="light">Only lex the rows being drawn, for files too big to lex in full</param>
+Highlighter::Highlighter(const std::vector<FileHandler::Row>& rows, std::mutex& rowsMutex, std::shared_ptr<const SyntaxHighlight::EditorSyntax> syntax, const bool light)
+	: mRows(rows), mSyntax(std::move(syntax)), mLight(light), mStates(1, SyntaxHighlight::normalState), mMutex(rowsMutex)
+{
+	if (!mLight) mWorker = std::thread(&Highlighter::worker, this);
+}
+
+Highlighter::~Highlighter()
+{
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		mStop = true;
+	}
+	mWake.notify_one();
+	if (mWorker.joinable()) mWorker.join();
+}
+
+/// <summary>
+/// The limits shared by every highlighter
+/// </summary>
+/// <returns></returns>
+Highlighter::Limits& Highlighter::limits()
+{
+	static Limits limits;
+	return limits;
+}
+
+/// <summary>
+/// Called after rows were edited, inserted or erased. The states after the row are thrown away and the worker starts over from it
+/// </summary>
+/// <param name="row">The first row that changed</param>
+void Highlighter::invalidate(const size_t row)
+{
+	std::lock_guard<std::mutex> guard(mMutex);
+	if (row >= mValidRows) return;
+	mValidRows = row + 1;
+	mWake.notify_one();
+}
+
+/// <summary>
+/// Returns true once the whole file has been lexed
+/// </summary>
+bool Highlighter::ready()
+{
+	std::lock_guard<std::mutex> guard(mMutex);
+	return !mLight && mValidRows > mRows.size();
+}
+
+/// <summary>
+/// Returns the state the row after this one starts in. Rows over the line length limit aren't lexed, and pass the state on as it is
+/// </summary>
+SyntaxHighlight::LineState Highlighter::nextState(const size_t row, const SyntaxHighlight::LineState state) const
+{
+	const Line& line = mRows[row].line;
+	return line.length() > limits().maxLineLength ? state : SyntaxHighlight::lexLine(*mSyntax, line, state);
+}
+
+/// <summary>
+/// Lexes the rows in [firstRow, lastRow) and adds their highlights. The rows' rendered lines are lexed, so the columns match what is drawn.
+/// Stops once the frame budget is spent, leaving the rest of the rows plain. The row states found on the way are kept, so later frames pick up from them
+/// </summary>
+/// <param name="firstRow"></param>
+/// <param name="lastRow">One past the last row</param>
+/// <param name="firstCol">The first column drawn, counted from the start of the rendered lines. Rows over the line length limit are only lexed from here</param>
+/// <param name="cols">How many columns are drawn</param>
+/// <param name="highlights"></param>
+void Highlighter::highlightRows(const size_t firstRow, const size_t lastRow, const size_t firstCol, const size_t cols, std::vector<HighlightLocations>& highlights)
+{
+	TRACE_SCOPE("highlightRows");
+	const auto deadline = std::chrono::steady_clock::now() + limits().frameBudget;
+	std::lock_guard<std::mutex> guard(mMutex);
+	if (firstRow >= mRows.size()) return;
+	mStates.resize(mRows.size() + 1);
+	if (!mLight && firstRow >= mValidRows && firstRow - mValidRows < catchUpRows) //Close enough to lex the gap now rather than wait for the worker
+	{
+		for (; mValidRows <= firstRow && std::chrono::steady_clock::now() < deadline; ++mValidRows)
+		{
+			mStates[mValidRows] = nextState(mValidRows - 1, mStates[mValidRows - 1]);
+		}
+	}
+
+	const bool exact = !mLight && firstRow < mValidRows;
+	SyntaxHighlight::LineState state = exact ? mStates[firstRow] : SyntaxHighlight::normalState; //A guess until the worker gets here
+	for (size_t row = firstRow; row < std::min(lastRow, mRows.size()); ++row)
+	{
+		if (std::chrono::steady_clock::now() >= deadline) return; //Out of time. The rest of the rows are drawn plain this frame
+
+		const std::string_view rendered = mRows[row].renderedLine;
+		if (mRows[row].line.length() > limits().maxLineLength) //Light mode: just the visible columns, from a plain state
+		{
+			const size_t first = highlights.size();
+			const Unicode::Clip clip = Unicode::clipColumns(rendered, firstCol, cols);
+			SyntaxHighlight::lexLine(*mSyntax, rendered.substr(clip.start, clip.end - clip.start), SyntaxHighlight::normalState, row, &highlights);
+			for (size_t h = first; h < highlights.size(); ++h)
+			{
+				highlights[h].startCol += clip.start;
+				highlights[h].endCol += clip.start;
+			}
+		}
+		else
+		{
+			state = SyntaxHighlight::lexLine(*mSyntax, rendered, state, row, &highlights);
+		}
+		if (exact && row + 1 == mValidRows)
+		{
+			mStates[mValidRows++] = state;
+		}
+	}
+}
+
+/// <summary>
+/// Lexes rows a chunk at a time from the first out of date one, then sleeps until an edit makes more rows out of date
+/// </summary>
+void Highlighter::worker()
+{
+	lowerThreadPriority();
+	Memory::Scope memoryScope(Memory::Subsystem::Highlights);
+	std::unique_lock<std::mutex> guard(mMutex);
+	while (!mStop)
+	{
+		if (mValidRows > mRows.size())
+		{
+			mWake.wait(guard);
+			continue;
+		}
+
+		{
+			TRACE_SCOPE("highlightWorker");
+			mStates.resize(mRows.size() + 1);
+			const size_t end = std::min(mValidRows + rowsPerStep, mRows.size() + 1);
+			for (size_t bytes = 0; mValidRows < end && bytes < bytesPerStep; ++mValidRows)
+			{
+				mStates[mValidRows] = nextState(mValidRows - 1, mStates[mValidRows - 1]);
+				bytes += std::min(mRows[mValidRows - 1].line.length(), limits().maxLineLength.load());
+			}
+		}
+		guard.unlock(); //Let edits and frames in between chunks
+		std::this_thread::yield();
+		guard.lock();
+	}
+}
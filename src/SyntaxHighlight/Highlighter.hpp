@@ -0,0 +1,84 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "SyntaxHighlight.hpp"
+#include "File/File.hpp"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+/// <summary>
+/// Keeps the state every row of a buffer starts in (open comment, open string or nothing), so any row can be highlighted
+/// without lexing the rows above it. A low priority worker lexes the file from the first out of date row to the end,
+/// and starts over from the edited row whenever the buffer changes. The view asks for its rows each frame, and never waits on the worker:
+/// it lexes a short gap itself, and otherwise starts from a plain state until the worker catches up.
+/// Highlighting a view stops when its time budget runs out, and rows that are too long or files that are too big are highlighted in light mode
+/// </summary>
+class Highlighter
+{
+public:
+	/// <summary>
+	/// Limits that keep highlighting from slowing the editor down. Set with :set synmaxcol, hlmaxsize and redrawtime
+	/// </summary>
+	struct Limits
+	{
+		std::atomic<size_t> maxLineLength = 3000; //Longer rows only have their visible columns drawn and highlighted, and don't carry comments or strings to the next row
+		size_t maxFileSize = 256 << 20; //Files opened above this are highlighted in light mode: only the view is lexed, starting from a plain state
+		std::chrono::milliseconds frameBudget{ 10 }; //How long a view may spend highlighting per frame. The rows left over are drawn plain
+	};
+
+	Highlighter(const std::vector<FileHandler::Row>& rows, std::mutex& rowsMutex, std::shared_ptr<const SyntaxHighlight::EditorSyntax> syntax, const bool light);
+	~Highlighter();
+
+	static Limits& limits();
+	void invalidate(const size_t row);
+	void highlightRows(const size_t firstRow, const size_t lastRow, const size_t firstCol, const size_t cols, std::vector<HighlightLocations>& highlights);
+	bool ready();
+
+private:
+	void worker();
+	SyntaxHighlight::LineState nextState(const size_t row, const SyntaxHighlight::LineState state) const;
+
+private:
+	static constexpr size_t rowsPerStep = 4096; //How many rows the worker lexes per lock, so edits and frames are never blocked for long
+	static constexpr size_t bytesPerStep = 256 << 10; //Also caps each step at about a millisecond of lexing when rows are long
+	static constexpr size_t catchUpRows = 4096; //How far past the lexed rows a view can start before its first state is guessed instead of lexed while drawing
+
+	const std::vector<FileHandler::Row>& mRows;
+	const std::shared_ptr<const SyntaxHighlight::EditorSyntax> mSyntax; //Shared, so the worker can still read it while the editor shuts down
+	const bool mLight; //No row states are kept, and there is no worker
+	std::vector<SyntaxHighlight::LineState> mStates; //The state each row starts in, plus the state after the last row
+	size_t mValidRows = 1; //How many of mStates are up to date. The first row always starts in the normal state
+
+	std::mutex& mMutex; //Shared with the buffer's edits, so the worker never reads a row mid-edit
+	std::condition_variable mWake;
+	std::thread mWorker;
+	bool mStop = false;
+};
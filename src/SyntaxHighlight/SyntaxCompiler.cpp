@@ -0,0 +1,410 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SyntaxCompiler.hpp"
+#include <fstream>
+#include <sstream>
+#include <format>
+#include <utility>
+#include <cstring>
+
+namespace SyntaxHighlight
+{
+	static constexpr std::string_view cacheMagic = "NVESYNTAX";
+	static constexpr uint32_t cacheVersion = 1; //Bump whenever EditorSyntax or the cache layout changes
+	static constexpr std::string_view defaultSeparators = "\"',.()+-/*=~%;:[]{}<>";
+
+	/// <summary>
+	/// Compiles a list of words into a transition table, one state per trie node
+	/// </summary>
+	/// <param name="words">Each word and what the table accepts for it. If a word is listed twice, the first one wins</param>
+	/// <returns>False if there are too many states to number</returns>
+	static bool buildDfa(const std::vector<std::pair<std::string, uint8_t>>& words, Dfa& dfa)
+	{
+		dfa = Dfa();
+		for (const auto& [word, value] : words) //Every byte used in a word gets its own column
+		{
+			for (const char c : word)
+			{
+				uint8_t& byteClass = dfa.classes[static_cast<unsigned char>(c)];
+				if (byteClass == 0)
+				{
+					if (dfa.classCount == UINT8_MAX) return false;
+					byteClass = static_cast<uint8_t>(dfa.classCount++);
+				}
+			}
+		}
+
+		dfa.next.assign(2 * dfa.classCount, 0);
+		dfa.accept.assign(2, 0);
+		for (const auto& [word, value] : words)
+		{
+			size_t state = 1;
+			for (const char c : word)
+			{
+				const size_t slot = state * dfa.classCount + dfa.classes[static_cast<unsigned char>(c)];
+				if (dfa.next[slot] == 0)
+				{
+					if (dfa.accept.size() == UINT16_MAX) return false;
+					dfa.next[slot] = static_cast<uint16_t>(dfa.accept.size());
+					dfa.next.resize(dfa.next.size() + dfa.classCount, 0);
+					dfa.accept.push_back(0);
+				}
+				state = dfa.next[slot];
+			}
+			if (dfa.accept[state] == 0) dfa.accept[state] = value;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Splits a value into its whitespace separated items
+	/// </summary>
+	static std::vector<std::string> splitList(const std::string_view& value)
+	{
+		std::vector<std::string> items;
+		std::istringstream stream{ std::string(value) };
+		std::string item;
+		while (stream >> item)
+		{
+			items.push_back(std::move(item));
+		}
+		return items;
+	}
+
+	static std::string_view trim(std::string_view text)
+	{
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) text.remove_prefix(1);
+		while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+		return text;
+	}
+
+	/// <summary>
+	/// Parses a definition file and compiles it into lexer tables. The format is described in the README
+	/// </summary>
+	/// <param name="definition">The contents of the definition file</param>
+	/// <param name="syntax">The compiled syntax</param>
+	/// <param name="error">Why the definition is invalid, with its line number</param>
+	/// <returns>False if the definition is invalid</returns>
+	bool compileDefinition(const std::string_view& definition, EditorSyntax& syntax, std::string& error)
+	{
+		syntax = EditorSyntax();
+		std::vector<std::pair<std::string, uint8_t>> keywords, openers;
+		std::string separators(defaultSeparators);
+		const auto addBlock = [&](const std::string& open, const HighlightType type, const std::string& close, const bool multiline, const bool escapes)
+			{
+				syntax.blocks.emplace_back(type, close, multiline, escapes);
+				openers.emplace_back(open, static_cast<uint8_t>(syntax.blocks.size()));
+			};
+
+		size_t lineNumber = 0;
+		std::istringstream stream{ std::string(definition) };
+		std::string rawLine;
+		while (std::getline(stream, rawLine))
+		{
+			++lineNumber;
+			const std::string_view line = trim(rawLine);
+			if (line.empty() || line.front() == '#') continue;
+
+			const size_t equals = line.find('=');
+			if (equals == std::string_view::npos)
+			{
+				error = std::format("line {}: expected key = value", lineNumber);
+				return false;
+			}
+			const std::string_view key = trim(line.substr(0, equals));
+			const std::string_view value = trim(line.substr(equals + 1));
+			const std::vector<std::string> items = splitList(value);
+
+			if (key == "name") syntax.name = value;
+			else if (key == "extensions") syntax.extensions.insert(syntax.extensions.end(), items.begin(), items.end());
+			else if (key == "interpreters") syntax.interpreters.insert(syntax.interpreters.end(), items.begin(), items.end());
+			else if (key == "separators") separators = value;
+			else if (key == "types" || key == "control" || key == "other")
+			{
+				const HighlightType type = key == "types" ? HighlightType::KeywordBuiltInType : key == "control" ? HighlightType::KeywordControl : HighlightType::KeywordOther;
+				for (const auto& keyword : items) keywords.emplace_back(keyword, static_cast<uint8_t>(type));
+			}
+			else if (key == "line_comment")
+			{
+				for (const auto& open : items) addBlock(open, HighlightType::Comment, "", false, false);
+			}
+			else if (key == "block_comment")
+			{
+				if (items.size() % 2 != 0)
+				{
+					error = std::format("line {}: block_comment needs an opening and a closing marker", lineNumber);
+					return false;
+				}
+				for (size_t i = 0; i < items.size(); i += 2) addBlock(items[i], HighlightType::MultilineComment, items[i + 1], true, false);
+			}
+			else if (key == "string" || key == "multiline_string")
+			{
+				for (const auto& delimiter : items) addBlock(delimiter, HighlightType::String, delimiter, key == "multiline_string", true);
+			}
+			else if (key == "escape")
+			{
+				if (value.length() != 1)
+				{
+					error = std::format("line {}: escape must be one character", lineNumber);
+					return false;
+				}
+				syntax.escapeChar = value.front();
+			}
+			else if (key == "numbers")
+			{
+				if (value == "digits") syntax.numbers = NumberRule::Digits;
+				else if (value == "prefix") syntax.numbers = NumberRule::Prefix;
+				else
+				{
+					error = std::format("line {}: numbers must be digits or prefix", lineNumber);
+					return false;
+				}
+			}
+			else
+			{
+				error = std::format("line {}: unknown key '{}'", lineNumber, key);
+				return false;
+			}
+		}
+
+		if (syntax.name.empty())
+		{
+			error = "missing name";
+			return false;
+		}
+		if (syntax.blocks.size() >= UINT8_MAX)
+		{
+			error = "too many comment and string markers";
+			return false;
+		}
+
+		syntax.separators[static_cast<unsigned char>(' ')] = true;
+		syntax.separators[static_cast<unsigned char>('\t')] = true;
+		for (const char c : separators) syntax.separators[static_cast<unsigned char>(c)] = true;
+		for (const auto& [open, block] : openers) syntax.separators[static_cast<unsigned char>(open.front())] = true; //Markers are looked for where words end
+
+		if (!buildDfa(keywords, syntax.keywords) || !buildDfa(openers, syntax.openers))
+		{
+			error = "too many keywords";
+			return false;
+		}
+		return true;
+	}
+
+	//Cache files hold the compiled tables as they are in memory, behind the list of definition files they came from
+
+	/// <summary>
+	/// Appends values to a cache file's contents
+	/// </summary>
+	struct CacheWriter
+	{
+		std::string data;
+
+		template <typename T>
+		void value(const T& value)
+		{
+			data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		void string(const std::string_view& text)
+		{
+			value(static_cast<uint32_t>(text.length()));
+			data.append(text);
+		}
+
+		template <typename T>
+		void vector(const std::vector<T>& values)
+		{
+			value(static_cast<uint32_t>(values.size()));
+			data.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+		}
+	};
+
+	/// <summary>
+	/// Reads values back from a cache file's contents. Once a read runs past the end, every later read fails too
+	/// </summary>
+	struct CacheReader
+	{
+		std::string_view data;
+		bool ok = true;
+
+		template <typename T>
+		bool value(T& value)
+		{
+			if (!ok || data.length() < sizeof(T)) return ok = false;
+			std::memcpy(&value, data.data(), sizeof(T));
+			data.remove_prefix(sizeof(T));
+			return true;
+		}
+
+		bool string(std::string& text)
+		{
+			uint32_t length = 0;
+			if (!value(length) || data.length() < length) return ok = false;
+			text = data.substr(0, length);
+			data.remove_prefix(length);
+			return true;
+		}
+
+		template <typename T>
+		bool vector(std::vector<T>& values)
+		{
+			uint32_t count = 0;
+			if (!value(count) || data.length() / sizeof(T) < count) return ok = false;
+			values.resize(count);
+			std::memcpy(values.data(), data.data(), count * sizeof(T));
+			data.remove_prefix(count * sizeof(T));
+			return true;
+		}
+	};
+
+	static void writeDfa(CacheWriter& writer, const Dfa& dfa)
+	{
+		writer.value(dfa.classes);
+		writer.value(dfa.classCount);
+		writer.vector(dfa.next);
+		writer.vector(dfa.accept);
+	}
+
+	/// <summary>
+	/// Reads a table back, checking it can't send the lexer out of bounds
+	/// </summary>
+	/// <param name="acceptLimit">Accepted values must be below this</param>
+	static bool readDfa(CacheReader& reader, Dfa& dfa, const size_t acceptLimit)
+	{
+		if (!reader.value(dfa.classes) || !reader.value(dfa.classCount) || !reader.vector(dfa.next) || !reader.vector(dfa.accept)) return false;
+		if (dfa.classCount == 0 || dfa.accept.size() < 2 || dfa.next.size() != dfa.accept.size() * dfa.classCount) return false;
+		for (const uint8_t byteClass : dfa.classes)
+		{
+			if (byteClass >= dfa.classCount) return false;
+		}
+		for (const uint16_t state : dfa.next)
+		{
+			if (state >= dfa.accept.size()) return false;
+		}
+		for (const uint8_t value : dfa.accept)
+		{
+			if (value >= acceptLimit) return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Loads the compiled syntaxes from the cache, if it was written for exactly these definition files
+	/// </summary>
+	/// <returns>False if there is no usable cache</returns>
+	bool loadCache(const std::filesystem::path& cacheFile, const std::vector<DefinitionFile>& definitions, std::vector<EditorSyntax>& syntaxes)
+	{
+		std::ifstream file(cacheFile, std::ios::binary);
+		if (!file) return false;
+		const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (!std::string_view(contents).starts_with(cacheMagic)) return false;
+
+		CacheReader reader{ std::string_view(contents).substr(cacheMagic.length()) };
+		uint32_t version = 0, count = 0;
+		if (!reader.value(version) || version != cacheVersion || !reader.value(count) || count != definitions.size()) return false;
+		for (const auto& definition : definitions)
+		{
+			DefinitionFile cached;
+			if (!reader.string(cached.path) || !reader.value(cached.size) || !reader.value(cached.modified) || !(cached == definition)) return false;
+		}
+
+		if (!reader.value(count)) return false;
+		std::vector<EditorSyntax> loaded(count);
+		for (auto& syntax : loaded)
+		{
+			uint32_t listCount = 0, blockCount = 0;
+			if (!reader.string(syntax.name) || !reader.value(listCount)) return false;
+			syntax.extensions.resize(listCount);
+			for (auto& extension : syntax.extensions) reader.string(extension);
+			if (!reader.value(listCount)) return false;
+			syntax.interpreters.resize(listCount);
+			for (auto& interpreter : syntax.interpreters) reader.string(interpreter);
+
+			if (!reader.value(syntax.separators) || !reader.value(blockCount) || blockCount >= UINT8_MAX) return false;
+			syntax.blocks.resize(blockCount);
+			for (auto& block : syntax.blocks)
+			{
+				if (!reader.value(block.type) || block.type >= HighlightType::EnumCount || !reader.string(block.close)
+					|| !reader.value(block.multiline) || !reader.value(block.escapes)) return false;
+			}
+			if (!readDfa(reader, syntax.keywords, static_cast<size_t>(HighlightType::EnumCount)) || !readDfa(reader, syntax.openers, syntax.blocks.size() + 1)
+				|| !reader.value(syntax.numbers) || syntax.numbers > NumberRule::Prefix || !reader.value(syntax.escapeChar)) return false;
+		}
+		if (!reader.ok) return false;
+
+		syntaxes = std::move(loaded);
+		return true;
+	}
+
+	/// <summary>
+	/// Writes the compiled syntaxes to the cache. Failing to write it only means the definitions are compiled again next time
+	/// </summary>
+	void saveCache(const std::filesystem::path& cacheFile, const std::vector<DefinitionFile>& definitions, const std::vector<EditorSyntax>& syntaxes)
+	{
+		CacheWriter writer;
+		writer.data.append(cacheMagic);
+		writer.value(cacheVersion);
+		writer.value(static_cast<uint32_t>(definitions.size()));
+		for (const auto& definition : definitions)
+		{
+			writer.string(definition.path);
+			writer.value(definition.size);
+			writer.value(definition.modified);
+		}
+
+		writer.value(static_cast<uint32_t>(syntaxes.size()));
+		for (const auto& syntax : syntaxes)
+		{
+			writer.string(syntax.name);
+			writer.value(static_cast<uint32_t>(syntax.extensions.size()));
+			for (const auto& extension : syntax.extensions) writer.string(extension);
+			writer.value(static_cast<uint32_t>(syntax.interpreters.size()));
+			for (const auto& interpreter : syntax.interpreters) writer.string(interpreter);
+			writer.value(syntax.separators);
+			writer.value(static_cast<uint32_t>(syntax.blocks.size()));
+			for (const auto& block : syntax.blocks)
+			{
+				writer.value(block.type);
+				writer.string(block.close);
+				writer.value(block.multiline);
+				writer.value(block.escapes);
+			}
+			writeDfa(writer, syntax.keywords);
+			writeDfa(writer, syntax.openers);
+			writer.value(syntax.numbers);
+			writer.value(syntax.escapeChar);
+		}
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheFile.parent_path(), error);
+		const std::filesystem::path temporary = cacheFile.string() + ".tmp"; //Written aside and renamed, so another instance never reads half a cache
+		{
+			std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+			if (!file.write(writer.data.data(), writer.data.size())) return;
+		}
+		std::filesystem::rename(temporary, cacheFile, error);
+	}
+}
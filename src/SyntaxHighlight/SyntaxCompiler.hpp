@@ -0,0 +1,51 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "SyntaxHighlight.hpp"
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <cstdint>
+
+namespace SyntaxHighlight
+{
+	/// <summary>
+	/// A definition file the syntaxes were compiled from. The cache is only used while every one of them is unchanged
+	/// </summary>
+	struct DefinitionFile
+	{
+		std::string path;
+		uint64_t size;
+		int64_t modified;
+
+		bool operator==(const DefinitionFile&) const = default;
+	};
+
+	bool compileDefinition(const std::string_view& definition, EditorSyntax& syntax, std::string& error);
+	bool loadCache(const std::filesystem::path& cacheFile, const std::vector<DefinitionFile>& definitions, std::vector<EditorSyntax>& syntaxes);
+	void saveCache(const std::filesystem::path& cacheFile, const std::vector<DefinitionFile>& definitions, const std::vector<EditorSyntax>& syntaxes);
+}
@@ -23,13 +23,27 @@ SOFTWARE.
 */
 
 #include "SyntaxHighlight.hpp"
+#include "SyntaxCompiler.hpp"
+#include "Trace/Trace.hpp"
+
 #include <array>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <format>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#include <climits>
+#endif
 
 namespace SyntaxHighlight
 {
-	int8_t syntaxIndex = -1;
 	std::array<uint8_t, static_cast<uint8_t>(HighlightType::EnumCount)> colors;
-	std::vector<EditorSyntax> syntaxContents;
+	std::vector<std::shared_ptr<const EditorSyntax>> syntaxContents; //Shared with the highlighters of the files using them
 
 	/// <summary>
 	/// Setting the color values for each type
@@ -48,45 +62,196 @@ namespace SyntaxHighlight
 	}
 
 	/// <summary>
-	/// Initializes the syntax index and vector based on the current filetype
+	/// Returns an environment variable as a path, or an empty path if it isn't set
 	/// </summary>
-	/// <param name="fName"></param>
-	void initSyntax(const std::string_view& fName)
+	static std::filesystem::path environmentPath(const char* name)
 	{
-		syntaxContents.emplace_back(cppFiletypes, cppBuiltInTypes, cppControlKeywords, cppOtherKeywords, "//", "/*", "*/", '\\');
+		const char* value = std::getenv(name);
+		return value != nullptr && *value != '\0' ? std::filesystem::path(value) : std::filesystem::path();
+	}
 
-		std::string extension;
-		size_t extensionIndex;
-		if ((extensionIndex = fName.find('.')) != std::string::npos)
-		{
-			extension = fName.substr(extensionIndex);
-		}
-		else
+	/// <summary>
+	/// The directory the running executable is in, or an empty path if it can't be found
+	/// </summary>
+	static std::filesystem::path executableDirectory()
+	{
+		std::error_code error;
+#ifdef _WIN32
+		char buffer[MAX_PATH];
+		const DWORD length = GetModuleFileNameA(nullptr, buffer, MAX_PATH);
+		if (length == 0 || length == MAX_PATH) return {};
+		return std::filesystem::path(std::string(buffer, length)).parent_path();
+#elif defined(__APPLE__)
+		char buffer[PATH_MAX];
+		uint32_t length = sizeof(buffer);
+		if (_NSGetExecutablePath(buffer, &length) != 0) return {};
+		return std::filesystem::canonical(buffer, error).parent_path();
+#else
+		return std::filesystem::read_symlink("/proc/self/exe", error).parent_path();
+#endif
+	}
+
+	/// <summary>
+	/// The directories definition files are loaded from, in order. A definition replaces any earlier one with the same name
+	/// </summary>
+	static std::vector<std::filesystem::path> definitionDirectories()
+	{
+		std::vector<std::filesystem::path> directories;
+		if (const auto exeDirectory = executableDirectory(); !exeDirectory.empty()) directories.push_back(exeDirectory / "syntax");
+#ifdef _WIN32
+		if (const auto appData = environmentPath("APPDATA"); !appData.empty()) directories.push_back(appData / "nve" / "syntax");
+#else
+		if (const auto config = environmentPath("XDG_CONFIG_HOME"); !config.empty()) directories.push_back(config / "nve" / "syntax");
+		else if (const auto home = environmentPath("HOME"); !home.empty()) directories.push_back(home / ".config" / "nve" / "syntax");
+#endif
+		if (const auto custom = environmentPath("NVE_SYNTAX_DIR"); !custom.empty()) directories.push_back(custom);
+		return directories;
+	}
+
+	/// <summary>
+	/// Where the compiled definitions are cached, or an empty path if there is nowhere to put them
+	/// </summary>
+	static std::filesystem::path cacheFile()
+	{
+#ifdef _WIN32
+		const auto cacheDirectory = environmentPath("LOCALAPPDATA");
+#else
+		auto cacheDirectory = environmentPath("XDG_CACHE_HOME");
+		if (const auto home = environmentPath("HOME"); cacheDirectory.empty() && !home.empty()) cacheDirectory = home / ".cache";
+#endif
+		return cacheDirectory.empty() ? std::filesystem::path() : cacheDirectory / "nve" / "syntax.cache";
+	}
+
+	/// <summary>
+	/// Lists the *.syntax files in each directory, sorted by name within a directory
+	/// </summary>
+	static std::vector<DefinitionFile> findDefinitions(const std::vector<std::filesystem::path>& directories)
+	{
+		std::vector<DefinitionFile> definitions;
+		for (const auto& directory : directories)
 		{
-			return; //There isn't a syntax, so we can't provide syntax highlighting. 
+			std::error_code error;
+			std::vector<DefinitionFile> found;
+			for (std::filesystem::directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error))
+			{
+				if (entry->path().extension() != ".syntax" || !entry->is_regular_file(error)) continue;
+				const uint64_t size = entry->file_size(error);
+				const int64_t modified = entry->last_write_time(error).time_since_epoch().count();
+				if (!error) found.emplace_back(entry->path().string(), size, modified);
+			}
+			std::sort(found.begin(), found.end(), [](const DefinitionFile& a, const DefinitionFile& b) { return a.path < b.path; });
+			definitions.insert(definitions.end(), found.begin(), found.end());
 		}
+		return definitions;
+	}
 
-		for (uint8_t i = 0; i < syntaxContents.size(); ++i)
+	/// <summary>
+	/// Compiles every definition file. A definition replaces any earlier one with the same name
+	/// </summary>
+	/// <returns>An error message for the definitions that couldn't be read, or an empty string</returns>
+	static std::string compileDefinitions(const std::vector<DefinitionFile>& definitions, std::vector<EditorSyntax>& syntaxes)
+	{
+		std::string firstError;
+		size_t errorCount = 0;
+		for (const auto& definition : definitions)
 		{
-			for (const auto& fileType : syntaxContents[i].filematch)
+			std::ifstream file(definition.path, std::ios::binary);
+			const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			EditorSyntax syntax;
+			std::string error;
+			if (!file || !compileDefinition(contents, syntax, error))
 			{
-				if (fileType == extension)
-				{
-					setColors();
-					syntaxIndex = i;
-					return;
-				}
+				if (errorCount++ == 0) firstError = std::format("{}: {}", std::filesystem::path(definition.path).filename().string(), file ? error : "couldn't be read");
+				continue;
 			}
+
+			const auto existing = std::find_if(syntaxes.begin(), syntaxes.end(), [&](const EditorSyntax& other) { return other.name == syntax.name; });
+			if (existing != syntaxes.end()) *existing = std::move(syntax);
+			else syntaxes.push_back(std::move(syntax));
+		}
+
+		if (errorCount == 0) return "";
+		return std::format("Syntax definition error in {}{}", firstError, errorCount > 1 ? std::format(" (and {} more)", errorCount - 1) : "");
+	}
+
+	/// <summary>
+	/// Loads the syntax definitions and sets the highlight colors. Only needs to be called once, however many files are open.
+	/// Definitions are compiled once and cached, and only compiled again when a definition file is added, removed or changed
+	/// </summary>
+	/// <returns>An error message if a definition couldn't be loaded, or an empty string</returns>
+	std::string initSyntax()
+	{
+		TRACE_SCOPE("initSyntax");
+		if (!syntaxContents.empty()) return "";
+		setColors();
+
+		const std::vector<DefinitionFile> definitions = findDefinitions(definitionDirectories());
+		const std::filesystem::path cache = cacheFile();
+		std::vector<EditorSyntax> syntaxes;
+		std::string error;
+		if (cache.empty() || !loadCache(cache, definitions, syntaxes))
+		{
+			error = compileDefinitions(definitions, syntaxes);
+			if (error.empty() && !cache.empty()) saveCache(cache, definitions, syntaxes); //Not cached on errors, so they show again next time
 		}
+		for (EditorSyntax& syntax : syntaxes) syntaxContents.push_back(std::make_shared<const EditorSyntax>(std::move(syntax)));
+		return error;
 	}
 
 	/// <summary>
-	/// Returns a pointer (or nullptr) to the current syntax being used.
+	/// Returns the program a #! row runs, looking through env to the program it starts
 	/// </summary>
-	/// <returns> nullptr if no syntax, or a pointer to the correct syntax </returns>
-	EditorSyntax* syntax()
+	static std::string_view interpreter(std::string_view firstLine)
 	{
-		return syntaxIndex >= 0 ? &syntaxContents[syntaxIndex] : nullptr;
+		if (!firstLine.starts_with("#!")) return "";
+		firstLine.remove_prefix(2);
+
+		bool afterEnv = false;
+		while (!firstLine.empty())
+		{
+			const size_t tokenStart = firstLine.find_first_not_of(" \t\r");
+			if (tokenStart == std::string_view::npos) break;
+			firstLine.remove_prefix(tokenStart);
+			const std::string_view token = firstLine.substr(0, firstLine.find_first_of(" \t\r"));
+			firstLine.remove_prefix(token.length());
+
+			if (afterEnv && (token.front() == '-' || token.find('=') != std::string_view::npos)) continue; //env's options and variables
+			const std::string_view program = token.substr(token.find_last_of('/') + 1);
+			if (afterEnv || program != "env") return program;
+			afterEnv = true;
+		}
+		return "";
+	}
+
+	/// <summary>
+	/// Returns a pointer (or nullptr) to the syntax matching a file's last extension, or else the interpreter on its #! first row.
+	/// When several syntaxes match, the one loaded last wins
+	/// </summary>
+	/// <param name="fName">The file's name</param>
+	/// <param name="firstLine">The file's first row</param>
+	/// <returns> nullptr if no syntax, or the matching syntax, which stays valid for as long as it is held </returns>
+	std::shared_ptr<const EditorSyntax> syntax(const std::string_view& fName, const std::string_view& firstLine)
+	{
+		const std::string extension = std::filesystem::path(fName).extension().string();
+		if (!extension.empty())
+		{
+			for (auto syntax = syntaxContents.rbegin(); syntax != syntaxContents.rend(); ++syntax)
+			{
+				if (std::find((*syntax)->extensions.begin(), (*syntax)->extensions.end(), extension) != (*syntax)->extensions.end()) return *syntax;
+			}
+		}
+
+		const std::string_view program = interpreter(firstLine);
+		if (program.empty()) return nullptr; //There isn't a syntax, so we can't provide syntax highlighting.
+		for (auto syntax = syntaxContents.rbegin(); syntax != syntaxContents.rend(); ++syntax)
+		{
+			for (const auto& name : (*syntax)->interpreters)
+			{
+				//python3.12 runs python3
+				if (program.starts_with(name) && program.find_first_not_of("0123456789.", name.length()) == std::string_view::npos) return *syntax;
+			}
+		}
+		return nullptr;
 	}
 
 	/// <summary>
@@ -98,4 +263,122 @@ namespace SyntaxHighlight
 	{
 		return colors[static_cast<int>(type)];
 	}
-}
\ No newline at end of file
+
+	/// <summary>
+	/// Walks text through a table from its start state
+	/// </summary>
+	/// <returns>The state the text ends on, 0 if no word starts with it</returns>
+	static size_t walk(const Dfa& dfa, const std::string_view& text)
+	{
+		size_t state = 1;
+		for (const char c : text)
+		{
+			state = dfa.next[state * dfa.classCount + dfa.classes[static_cast<unsigned char>(c)]];
+			if (state == 0) break;
+		}
+		return state;
+	}
+
+	/// <summary>
+	/// Finds the longest opening marker at the start of the text
+	/// </summary>
+	/// <returns>1 + the index of the block it opens, or 0 if there is none</returns>
+	static LineState matchOpener(const Dfa& dfa, const std::string_view& text, size_t& length)
+	{
+		LineState block = normalState;
+		size_t state = 1;
+		for (size_t i = 0; i < text.length(); ++i)
+		{
+			state = dfa.next[state * dfa.classCount + dfa.classes[static_cast<unsigned char>(text[i])]];
+			if (state == 0) break;
+			if (dfa.accept[state] != 0)
+			{
+				block = dfa.accept[state];
+				length = i + 1;
+			}
+		}
+		return block;
+	}
+
+	/// <summary>
+	/// Finds the marker that closes a block, skipping markers behind an odd number of escape characters
+	/// </summary>
+	/// <returns>The column just past the marker, or npos if the row doesn't close it</returns>
+	static size_t findEndMarker(const std::string_view& line, size_t from, const std::string_view& marker, const char escapeChar)
+	{
+		const size_t searchStart = from;
+		size_t endPos;
+		while ((endPos = line.find(marker, from)) != std::string_view::npos)
+		{
+			size_t escapes = 0;
+			while (escapeChar != '\0' && endPos - escapes > searchStart && line[endPos - escapes - 1] == escapeChar) ++escapes;
+			if (escapes % 2 == 0) return endPos + marker.length();
+			from = endPos + 1;
+		}
+		return std::string_view::npos;
+	}
+
+	/// <summary>
+	/// Lexes one row. The state a row ends in only depends on its text and the state it starts in,
+	/// so rows can be lexed one at a time from any row whose starting state is known
+	/// </summary>
+	/// <param name="line">The row's text</param>
+	/// <param name="state">The state the row above ended in</param>
+	/// <param name="row">The row number stored in the highlights</param>
+	/// <param name="highlights">Where the row's highlights are added, or nullptr if only the state is needed</param>
+	/// <returns>The state the next row starts in</returns>
+	LineState lexLine(const EditorSyntax& syntax, const std::string_view& line, const LineState state, const size_t row, std::vector<HighlightLocations>* highlights)
+	{
+		const auto addHighlight = [&](const HighlightType type, const size_t startCol, const size_t endCol)
+			{
+				if (highlights != nullptr) highlights->emplace_back(type, row, startCol, row, endCol);
+			};
+		const auto closeBlock = [&](const LineState blockState, const size_t startCol, const size_t searchFrom) //Returns npos if the block stays open
+			{
+				const Block& block = syntax.blocks[blockState - 1];
+				const size_t endCol = block.close.empty() ? std::string_view::npos
+					: findEndMarker(line, searchFrom, block.close, block.escapes ? syntax.escapeChar : '\0');
+				addHighlight(block.type, startCol, endCol == std::string_view::npos ? line.length() : endCol);
+				return endCol;
+			};
+
+		size_t pos = 0;
+		if (state != normalState && state <= syntax.blocks.size()) //Continue the block left open by the row above
+		{
+			pos = closeBlock(state, 0, 0);
+			if (pos == std::string_view::npos) return state;
+		}
+
+		while (pos < line.length())
+		{
+			size_t wordEnd = pos;
+			while (wordEnd < line.length() && !syntax.separators[static_cast<unsigned char>(line[wordEnd])]) ++wordEnd;
+			if (wordEnd > pos)
+			{
+				const std::string_view word = line.substr(pos, wordEnd - pos);
+				const bool number = syntax.numbers == NumberRule::Prefix ? word[0] >= '0' && word[0] <= '9'
+					: word.find_first_not_of("0123456789") == std::string_view::npos;
+				if (number)
+				{
+					addHighlight(HighlightType::Number, pos, wordEnd);
+				}
+				else if (const uint8_t keyword = syntax.keywords.accept[walk(syntax.keywords, word)]; keyword != 0)
+				{
+					addHighlight(static_cast<HighlightType>(keyword), pos, wordEnd);
+				}
+			}
+			if (wordEnd == line.length()) break;
+
+			size_t openerLength = 0;
+			const LineState block = matchOpener(syntax.openers, line.substr(wordEnd), openerLength);
+			if (block == normalState)
+			{
+				pos = wordEnd + 1;
+				continue;
+			}
+			pos = closeBlock(block, wordEnd, wordEnd + openerLength);
+			if (pos == std::string_view::npos) return syntax.blocks[block - 1].multiline ? block : normalState; //Comments to the end of the row and unclosed single row strings end here
+		}
+		return normalState;
+	}
+}
@@ -25,25 +25,12 @@ SOFTWARE.
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
+#include <array>
+#include <memory>
 #include <cstdint> //uint8_t
 
 namespace SyntaxHighlight{
-	struct EditorSyntax
-	{
-		std::vector<std::string> filematch;
-		std::vector<std::string> builtInTypeKeywords;
-		std::vector<std::string> loopKeywords;
-		std::vector<std::string> otherKeywords;
-		std::string singlelineComment;
-		std::string multilineCommentStart;
-		std::string multilineCommentEnd;
-		char escapeChar;
-	};
-
-	EditorSyntax* syntax();
-
-	void initSyntax(const std::string_view& fName);
-
 	enum class HighlightType
 	{
 		Normal,
@@ -57,29 +44,69 @@ namespace SyntaxHighlight{
 		EnumCount
 	};
 
-	uint8_t color(HighlightType);
+	/// <summary>
+	/// What a row starts in: 0 if nothing is open, otherwise 1 + the index of the block (multiline comment or string) left open by the rows above it
+	/// </summary>
+	using LineState = uint8_t;
+	constexpr LineState normalState = 0;
 
+	/// <summary>
+	/// A set of words compiled into a transition table. Walking a word through it ends on a state that says which word (if any) it was
+	/// </summary>
+	struct Dfa
+	{
+		std::array<uint8_t, 256> classes{}; //The column of each byte. Bytes that appear in no word are class 0, which always leads to the dead state
+		uint16_t classCount = 1;
+		std::vector<uint16_t> next; //next[state * classCount + class]. State 0 is dead, state 1 is the start
+		std::vector<uint8_t> accept; //What ending a word on each state means, 0 for nothing
+	};
 
-	//================================================ CPP KEYWORDS =================================================================\\
+	/// <summary>
+	/// Something that runs until its closing marker: a string or a comment
+	/// </summary>
+	struct Block
+	{
+		HighlightType type;
+		std::string close; //Empty for comments that take the rest of the row
+		bool multiline; //Stays open across rows until it is closed
+		bool escapes; //The escape character in front of the closing marker doesn't close it
+	};
 
-	static const std::vector<std::string> cppFiletypes{ ".cpp", ".cc", ".cxx", ".hpp", ".h", ".hxx", ".hh" };
-	static const std::vector<std::string> cppBuiltInTypes{
-		//Built-in types and main keywords
-		"alignas", "alignof", "asm", "_asm", "auto", "bool", "char", "char8_t", "char16_t", "char32_t", "class",
-		"compl", "concept", "const", "consteval", "constexpr", "constinit", "const_cast", "decltype", "delete", "double",
-		"dynamic_cast", "enum", "explicit", "export", "extern", "false", "float", "friend", "inline", "int", "long",
-		"mutable", "namespace", "new", "noexcept", "nullptr", "operator", "private", "protected", "public", "register",
-		"reinterpret_cast", "requires", "short", "signed", "sizeof", "static", "static_assert", "static_cast", "struct",
-		"template", "this", "thread_local", "true", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual",
-		"void", "volatile", "wchar_t"
+	enum class NumberRule : uint8_t
+	{
+		Digits, //Words made of digits only
+		Prefix //Words starting with a digit, like 0x1F or 10u
 	};
-	static const std::vector<std::string> cppControlKeywords{
-		//Loop/Control keywords
-		"and", "and_eq", "bitand", "bitor", "break", "case", "catch", "continue", "co_await", "co_return", "co_yield", "default",
-		"do", "else", "for", "goto", "if", "not", "not_eq", "or", "or_eq", "return", "switch", "throw", "try", "while", "xor", "xor_eq"
+
+	/// <summary>
+	/// A language, compiled from its definition file. The definition format is described in the README
+	/// </summary>
+	struct EditorSyntax
+	{
+		std::string name;
+		std::vector<std::string> extensions; //Matched against the last extension of the file name, e.g. .cpp
+		std::vector<std::string> interpreters; //Matched against the program a #! first row runs, e.g. python3
+		std::array<bool, 256> separators{}; //The bytes that end a word
+		Dfa keywords; //Accepts the HighlightType of each keyword
+		Dfa openers; //Accepts 1 + the index of the block each opening marker starts
+		std::vector<Block> blocks;
+		NumberRule numbers = NumberRule::Digits;
+		char escapeChar = '\0';
 	};
-	static const std::vector<std::string> cppOtherKeywords{
-		//Some other keywords, such as macro definitions
-		"#define", "#ifdef", "#ifndef", "#if", "defined", "#include", "#elif", "#endif"
-	}; 
-}
\ No newline at end of file
+
+	std::shared_ptr<const EditorSyntax> syntax(const std::string_view& fName, const std::string_view& firstLine);
+
+	std::string initSyntax();
+
+	uint8_t color(HighlightType);
+}
+
+struct HighlightLocations
+{
+	SyntaxHighlight::HighlightType colorType;
+	size_t startRow, startCol, endRow, endCol;
+};
+
+namespace SyntaxHighlight{
+	LineState lexLine(const EditorSyntax& syntax, const std::string_view& line, const LineState state, const size_t row = 0, std::vector<HighlightLocations>* highlights = nullptr);
+}
@@ -0,0 +1,294 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Terminal.hpp"
+#include "KeyActions/KeyActions.hh"
+#include "Trace/Trace.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+#ifdef _WIN32
+#include <conio.h>
+#elif defined(__linux__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <signal.h>
+#endif
+
+/// <summary>
+/// Construct the console terminal
+/// </summary>
+/// <param name="recordFileName">If not empty, every byte of input gets appended to this file</param>
+ConsoleTerminal::ConsoleTerminal(const std::string_view& recordFileName)
+{
+	if (!recordFileName.empty())
+	{
+		recordFile.open(std::string(recordFileName), std::ios::binary | std::ios::trunc);
+	}
+}
+
+/// <summary>
+/// Saves the default terminal settings so they can be restored on exit
+/// </summary>
+/// <returns>False if the settings couldn't be read</returns>
+bool ConsoleTerminal::init()
+{
+#ifdef _WIN32
+	return GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), &defaultMode); //Try to get the default terminal settings
+#elif defined(__linux__) || defined(__APPLE__)
+	if (tcgetattr(STDOUT_FILENO, &defaultMode) == -1) return false;
+	//A resize only has to interrupt waitForInput, whose poll is never restarted, so the main loop wakes up and lays the views out again.
+	//Other calls are restarted, so a resize doesn't cut a read short
+	struct sigaction resize{};
+	resize.sa_handler = [](int) {};
+	resize.sa_flags = SA_RESTART;
+	sigemptyset(&resize.sa_mask);
+	sigaction(SIGWINCH, &resize, nullptr);
+	return true;
+#endif
+}
+
+/// <summary>
+/// Enables raw input mode by disabling specific flags
+/// </summary>
+/// <returns></returns>
+bool ConsoleTerminal::enableRawInput()
+{
+#ifdef _WIN32
+	DWORD rawMode = ENABLE_EXTENDED_FLAGS | (defaultMode & ~ENABLE_LINE_INPUT & ~ENABLE_PROCESSED_INPUT
+		& ~ENABLE_ECHO_INPUT & ~ENABLE_PROCESSED_OUTPUT & ~ENABLE_WRAP_AT_EOL_OUTPUT); //Disabling certain input/output modes to enable raw mode
+
+	return SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), rawMode);
+#elif defined(__linux__) || defined(__APPLE__)
+	termios raw = defaultMode; //Start from the default settings, so only the flags below change
+	raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+	raw.c_oflag &= ~(OPOST);
+	raw.c_cflag |= (CS8);
+	raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+	raw.c_cc[VMIN] = 0;
+	raw.c_cc[VTIME] = 1;
+
+	return tcsetattr(STDOUT_FILENO, TCSAFLUSH, &raw) >= 0;
+#endif
+}
+
+/// <summary>
+/// Disables raw input mode by setting the terminal back to the default mode
+/// </summary>
+void ConsoleTerminal::disableRawInput()
+{
+#ifdef _WIN32
+	SetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), defaultMode);
+#elif defined(__linux__) || defined(__APPLE__)
+	tcsetattr(STDOUT_FILENO, TCSAFLUSH, &defaultMode);
+#endif
+}
+
+/// <summary>
+/// Gets the terminal's row/column count
+/// </summary>
+/// <returns>False if the size couldn't be found</returns>
+bool ConsoleTerminal::getSize(size_t& rows, size_t& cols)
+{
+#ifdef _WIN32
+	CONSOLE_SCREEN_BUFFER_INFO screenInfo;
+	if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &screenInfo)) return false;
+	rows = static_cast<size_t>(screenInfo.srWindow.Bottom - screenInfo.srWindow.Top) + 1;
+	cols = static_cast<size_t>(screenInfo.srWindow.Right - screenInfo.srWindow.Left) + 1;
+
+#elif defined(__linux__) || defined(__APPLE__)
+	winsize ws;
+	if (ioctl(1, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0) //If getting the window size from ioctl fails
+	{
+		std::cout.write("\x1b[999C\x1b[999B", 12); //Move to the bottom-right corner of the screen
+		std::cout.write("\x1b[6n", 4); //Report cursor position - Gets reported as ESC[rows;colsR
+
+		std::string buf; buf.resize(32);
+		uint8_t i = 0;
+		while (i < buf.size())
+		{
+			std::cin.read(buf.data(), 1);
+			if (buf[i] == 'R') break;
+			++i;
+		}
+
+		if (buf[0] != static_cast<uint8_t>(KeyActions::KeyAction::Esc) || buf[1] != '[') return false;
+		int reportedRows, reportedCols;
+		if (sscanf(buf.data() + 2, "%d;%d", &reportedRows, &reportedCols) != 2) return false; //If the rows/cols data wasn't reported
+		rows = reportedRows; cols = reportedCols;
+	}
+	else
+	{
+		cols = ws.ws_col;
+		rows = ws.ws_row;
+	}
+#endif
+	return true;
+}
+
+void ConsoleTerminal::write(const std::string_view& output)
+{
+	TRACE_SCOPE("terminalWrite");
+	std::cout << output;
+	std::cout.flush(); //Flush so everything displays properly
+}
+
+/// <summary>
+/// Windows reads one key code at a time with _getch() from conio.h. Linux reads whatever is available, waiting up to 1/10 of a second
+/// </summary>
+size_t ConsoleTerminal::read(char* buffer, const size_t count)
+{
+	if (count == 0) return 0;
+#ifdef _WIN32
+	buffer[0] = static_cast<char>(_getch());
+	const size_t bytesRead = 1;
+#elif defined(__linux__) || defined(__APPLE__)
+	const ssize_t result = ::read(STDIN_FILENO, buffer, count);
+	if (result == -1) exit(EXIT_FAILURE);
+	const size_t bytesRead = static_cast<size_t>(result);
+#endif
+	record(buffer, bytesRead);
+	return bytesRead;
+}
+
+/// <summary>
+/// Windows checks the console for key presses, Linux polls stdin
+/// </summary>
+bool ConsoleTerminal::waitForInput(const std::chrono::milliseconds timeout)
+{
+#ifdef _WIN32
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (!_kbhit()) //The console input handle is also signaled for events that aren't keys, like focus changes
+	{
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (remaining.count() <= 0 || WaitForSingleObject(GetStdHandle(STD_INPUT_HANDLE), static_cast<DWORD>(remaining.count())) != WAIT_OBJECT_0) return false;
+	}
+	return true;
+#elif defined(__linux__) || defined(__APPLE__)
+	pollfd input{ STDIN_FILENO, POLLIN, 0 };
+	return poll(&input, 1, static_cast<int>(timeout.count())) > 0;
+#endif
+}
+
+bool ConsoleTerminal::readLine(std::string& line)
+{
+	if (!std::getline(std::cin, line)) return false;
+	record(line.data(), line.length());
+	record("\r", 1); //Recorded the way Enter arrives in raw mode, so a replay reads the same line back
+	return true;
+}
+
+void ConsoleTerminal::record(const char* bytes, const size_t count)
+{
+	if (!recordFile.is_open() || count == 0) return;
+	recordFile.write(bytes, count);
+	recordFile.flush(); //The trace stays usable even if the editor doesn't exit cleanly
+}
+
+/// <summary>
+/// Construct the headless terminal
+/// </summary>
+/// <param name="keys">The raw bytes of the recorded input</param>
+/// <param name="rows"></param>
+/// <param name="cols"></param>
+HeadlessTerminal::HeadlessTerminal(std::string keys, const size_t rows, const size_t cols) : input(std::move(keys)), screenRows(rows), screenCols(cols)
+{}
+
+bool HeadlessTerminal::getSize(size_t& rows, size_t& cols)
+{
+	rows = screenRows;
+	cols = screenCols;
+	return true;
+}
+
+/// <summary>
+/// Output is counted and thrown away, so rendering is measured without the cost of a real terminal drawing it
+/// </summary>
+void HeadlessTerminal::write(const std::string_view& output)
+{
+	outputBytes += output.length();
+}
+
+/// <summary>
+/// Hands out one key's worth of bytes at a time, the way a terminal delivers a keypress.
+/// Esc followed by [ or O is an escape sequence (arrow keys, Home, Delete, etc.) and belongs to the same key, up to its final letter or ~.
+/// Once a key has been read, the next read times out (returns 0) like a real read would, so a lone Esc never swallows the key after it
+/// </summary>
+size_t HeadlessTerminal::read(char* buffer, const size_t count)
+{
+	if (count == 0 || inputPos >= input.length()) return 0;
+
+	if (inputPos >= keyEnd) //Starting a new key
+	{
+		if (keyFinished)
+		{
+			keyFinished = false;
+			return 0;
+		}
+		keyEnd = inputPos + 1;
+		if (input[inputPos] == static_cast<char>(KeyActions::KeyAction::Esc) && keyEnd < input.length()
+			&& (input[keyEnd] == '[' || input[keyEnd] == 'O'))
+		{
+			++keyEnd;
+			while (keyEnd < input.length())
+			{
+				const char c = input[keyEnd++];
+				if (std::isalpha(static_cast<unsigned char>(c)) || c == '~') break;
+			}
+		}
+	}
+	const size_t bytesRead = std::min(count, keyEnd - inputPos); //A key read in parts (Esc first, then the rest of the sequence) is handed out across several reads
+	std::copy_n(input.begin() + inputPos, bytesRead, buffer);
+	inputPos += bytesRead;
+	keyFinished = inputPos >= keyEnd;
+	return bytesRead;
+}
+
+/// <summary>
+/// Reads up to the next Enter. The prompt line has no escape sequences, so it is read byte by byte
+/// </summary>
+bool HeadlessTerminal::readLine(std::string& line)
+{
+	line.clear();
+	if (inputPos >= input.length()) return false;
+	keyFinished = false;
+	while (inputPos < input.length())
+	{
+		const char c = input[inputPos++];
+		if (c == '\r' || c == '\n') break;
+		line.push_back(c);
+	}
+	keyEnd = inputPos;
+	return true;
+}
+
+bool HeadlessTerminal::atEnd() const
+{
+	return inputPos >= input.length();
+}
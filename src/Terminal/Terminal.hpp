@@ -0,0 +1,127 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <chrono>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__linux__) || defined(__APPLE__)
+#include <termios.h>
+#endif
+
+/// <summary>
+/// Where the editor's output goes and where its input comes from.
+/// The console implementation talks to the real terminal, the headless one plays back recorded input and throws the output away
+/// </summary>
+class Terminal
+{
+public:
+	virtual ~Terminal() = default;
+
+	virtual bool init() = 0;
+	virtual bool enableRawInput() = 0;
+	virtual void disableRawInput() = 0;
+	virtual bool getSize(size_t& rows, size_t& cols) = 0;
+	virtual void write(const std::string_view& output) = 0;
+	/// <summary>
+	/// Reads up to count bytes of raw input. Returns 0 if nothing arrived before the read timed out
+	/// </summary>
+	virtual size_t read(char* buffer, const size_t count) = 0;
+	/// <summary>
+	/// Returns true if input is waiting to be read, waiting up to timeout for some to arrive
+	/// </summary>
+	virtual bool waitForInput(const std::chrono::milliseconds timeout) = 0;
+	/// <summary>
+	/// Reads a line of input while raw mode is disabled (the command/search prompt), without the line ending
+	/// </summary>
+	virtual bool readLine(std::string& line) = 0;
+	/// <summary>
+	/// True once there is no more input to read. Only a headless terminal ever runs out
+	/// </summary>
+	virtual bool atEnd() const { return false; }
+};
+
+/// <summary>
+/// The real terminal/console window. Input can optionally be recorded to a file for replaying later with --replay
+/// </summary>
+class ConsoleTerminal : public Terminal
+{
+public:
+	ConsoleTerminal(const std::string_view& recordFileName = "");
+
+	bool init() override;
+	bool enableRawInput() override;
+	void disableRawInput() override;
+	bool getSize(size_t& rows, size_t& cols) override;
+	void write(const std::string_view& output) override;
+	size_t read(char* buffer, const size_t count) override;
+	bool waitForInput(const std::chrono::milliseconds timeout) override;
+	bool readLine(std::string& line) override;
+
+private:
+	void record(const char* bytes, const size_t count);
+
+private:
+#ifdef _WIN32
+	DWORD defaultMode = 0;
+#elif defined(__linux__) || defined(__APPLE__)
+	termios defaultMode{};
+#endif
+	std::ofstream recordFile;
+};
+
+/// <summary>
+/// A terminal with a fixed size, no screen and input taken from a recorded key trace.
+/// Used to drive the editor without a terminal so keystroke latency can be measured reproducibly
+/// </summary>
+class HeadlessTerminal : public Terminal
+{
+public:
+	HeadlessTerminal(std::string input, const size_t rows = 24, const size_t cols = 80);
+
+	bool init() override { return true; }
+	bool enableRawInput() override { return true; }
+	void disableRawInput() override {}
+	bool getSize(size_t& rows, size_t& cols) override;
+	void write(const std::string_view& output) override;
+	size_t read(char* buffer, const size_t count) override;
+	bool waitForInput(const std::chrono::milliseconds) override { return false; } //Replayed keys arrive one at a time, as if typed, so each is timed to its own frame
+	bool readLine(std::string& line) override;
+	bool atEnd() const override;
+
+	size_t bytesWritten() const { return outputBytes; }
+
+private:
+	std::string input;
+	size_t inputPos = 0;
+	size_t keyEnd = 0; //The end of the key being read, so the bytes of one key never run into the next
+	bool keyFinished = false; //True if the last read finished a key, so the next read times out
+	size_t screenRows, screenCols;
+	size_t outputBytes = 0;
+};
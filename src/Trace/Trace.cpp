@@ -0,0 +1,153 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Trace.hpp"
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <format>
+#include <cstdlib>
+
+namespace Trace
+{
+	struct Event
+	{
+		const char* name;
+		uint64_t startNs, endNs;
+		uint32_t threadId;
+	};
+
+	/// <summary>
+	/// One thread's events. Only the owning thread writes, so recording is a plain store followed by a release of the new head
+	/// </summary>
+	struct ThreadBuffer
+	{
+		static constexpr size_t capacity = 1 << 15; //The newest 32768 events per thread are kept (about 1MB)
+		std::array<Event, capacity> events;
+		std::atomic<uint64_t> head = 0; //Total events ever recorded. The ring holds the last 'capacity' of them
+		std::atomic<bool> inUse = true; //False once the owning thread has exited, so a new thread can take the buffer over
+	};
+
+	std::atomic<bool> tracingEnabled = false;
+	std::string traceFileName;
+	const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+
+	std::mutex buffersMutex; //Only taken when a thread records its first event, and when writing the trace
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::atomic<uint32_t> nextThreadId = 1;
+
+	/// <summary>
+	/// Gives the buffer back when its thread exits. Its events stay in it until they are overwritten
+	/// </summary>
+	struct BufferOwner
+	{
+		ThreadBuffer* buffer = nullptr;
+		uint32_t threadId = 0;
+		~BufferOwner() { if (buffer != nullptr) buffer->inUse.store(false, std::memory_order_release); }
+	};
+	thread_local BufferOwner owner;
+
+	/// <summary>
+	/// Finds a buffer for the calling thread, reusing one from a thread that has exited so the number of buffers is bounded by the number of threads alive at once
+	/// </summary>
+	static ThreadBuffer* threadBuffer()
+	{
+		if (owner.buffer != nullptr) return owner.buffer;
+
+		std::lock_guard lock(buffersMutex);
+		owner.threadId = nextThreadId++;
+		for (const auto& buffer : buffers)
+		{
+			bool expected = false;
+			if (buffer->inUse.compare_exchange_strong(expected, true)) return owner.buffer = buffer.get();
+		}
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		return owner.buffer = buffers.back().get();
+	}
+
+	/// <summary>
+	/// Starts recording events. The trace is written to fileName when the editor exits
+	/// </summary>
+	void start(const std::string_view& fileName)
+	{
+		traceFileName = fileName;
+		tracingEnabled.store(true, std::memory_order_relaxed);
+		atexit(finish);
+	}
+
+	bool isEnabled()
+	{
+		return tracingEnabled.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Nanoseconds since the editor started. Never 0, since Scope uses 0 for "not recording"
+	/// </summary>
+	uint64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count() + 1;
+	}
+
+	void record(const char* name, const uint64_t startNs, const uint64_t endNs)
+	{
+		ThreadBuffer* buffer = threadBuffer();
+		const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+		buffer->events[head % ThreadBuffer::capacity] = Event{ name, startNs, endNs, owner.threadId };
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	/// <summary>
+	/// Stops recording and writes every buffered event as Chrome trace-event JSON ("X" complete events, times in microseconds)
+	/// </summary>
+	void finish()
+	{
+		if (!tracingEnabled.exchange(false)) return;
+
+		std::ofstream file(traceFileName);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		std::lock_guard lock(buffersMutex);
+		for (const auto& buffer : buffers)
+		{
+			const uint64_t head = buffer->head.load(std::memory_order_acquire);
+			constexpr uint64_t margin = 64; //A thread still finishing an event may be overwriting the oldest slots of a full ring, so those are skipped
+			const uint64_t oldest = head > ThreadBuffer::capacity ? head - ThreadBuffer::capacity + margin : 0;
+			for (uint64_t i = oldest; i < head; ++i)
+			{
+				const Event& event = buffer->events[i % ThreadBuffer::capacity];
+				file << (first ? "\n" : ",\n");
+				file << std::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+					event.name, event.threadId, event.startNs / 1000.0, (event.endNs - event.startNs) / 1000.0);
+				first = false;
+			}
+		}
+		file << "\n]}\n";
+	}
+}
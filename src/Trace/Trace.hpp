@@ -0,0 +1,63 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string_view>
+#include <cstdint>
+
+/// <summary>
+/// Scoped trace events, written out as a Chrome trace (chrome://tracing, ui.perfetto.dev) when the editor exits.
+/// Each thread records into its own fixed-size ring buffer without locking, so tracing a long session keeps only the newest events.
+/// Without NVE_TRACING defined, TRACE_SCOPE compiles to nothing
+/// </summary>
+namespace Trace
+{
+	void start(const std::string_view& fileName);
+	bool isEnabled();
+	void record(const char* name, const uint64_t startNs, const uint64_t endNs);
+	uint64_t now();
+	void finish();
+
+	/// <summary>
+	/// Records an event covering its lifetime. Names must be string literals, as only the pointer is stored
+	/// </summary>
+	class Scope
+	{
+	public:
+		Scope(const char* eventName) : name(eventName), startNs(isEnabled() ? now() : 0) {}
+		~Scope() { if (startNs != 0) record(name, startNs, now()); }
+
+	private:
+		const char* name;
+		uint64_t startNs;
+	};
+}
+
+#ifdef NVE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name)
+#endif
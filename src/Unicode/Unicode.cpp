@@ -0,0 +1,498 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Unicode.hpp"
+#include "UnicodeTables.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NVE_SSE2
+#endif
+
+static constexpr char32_t replacementCharacter = 0xFFFD;
+static constexpr char32_t zeroWidthJoiner = 0x200D;
+static constexpr char32_t emojiPresentation = 0xFE0F; //Variation selector 16, which asks for the emoji (wide) form of the character before it
+static constexpr char32_t firstRegionalIndicator = 0x1F1E6, lastRegionalIndicator = 0x1F1FF; //Pairs of these are flags
+static constexpr char32_t firstEmojiModifier = 0x1F3FB, lastEmojiModifier = 0x1F3FF; //Skin tones
+
+template <size_t N>
+static bool inTable(const Unicode::Tables::Range(&table)[N], const char32_t codePoint)
+{
+	const auto range = std::upper_bound(std::begin(table), std::end(table), codePoint, [](const char32_t c, const Unicode::Tables::Range& r) { return c < r.first; });
+	return range != std::begin(table) && codePoint <= (range - 1)->last;
+}
+
+static bool isRegionalIndicator(const char32_t codePoint)
+{
+	return codePoint >= firstRegionalIndicator && codePoint <= lastRegionalIndicator;
+}
+
+/// <summary>
+/// True if the code point belongs to the character before it rather than starting a new one
+/// </summary>
+static bool extendsCharacter(const char32_t codePoint)
+{
+	if (codePoint < 0x300) return false;
+	return (codePoint >= firstEmojiModifier && codePoint <= lastEmojiModifier) || inTable(Unicode::Tables::zeroWidth, codePoint);
+}
+
+/// <summary>
+/// The start of the code point that ends at pos. A byte that isn't part of a valid sequence is a code point of its own
+/// </summary>
+static size_t codePointStart(const std::string_view& text, const size_t pos)
+{
+	size_t start = pos - 1;
+	while (start > 0 && pos - start < 4 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) --start;
+	size_t length;
+	Unicode::decode(text, start, length);
+	return start + length == pos ? start : pos - 1;
+}
+
+/// <summary>
+/// Where the ASCII run at pos ends, for measuring it a byte at a time. The last byte before non-ASCII text is left out, as combining marks may follow it
+/// </summary>
+static size_t plainRunEnd(const std::string_view& text, const size_t pos, const size_t limit)
+{
+	const size_t end = pos + Unicode::asciiLength(text.substr(pos, limit - pos));
+	return end > pos && end < text.length() && static_cast<unsigned char>(text[end]) >= 0x80 ? end - 1 : end;
+}
+
+/// <summary>
+/// Moves past the character at pos, adding the columns it takes to 'column'
+/// </summary>
+/// <returns>Where the next character starts</returns>
+static size_t step(const std::string_view& text, const size_t pos, size_t& column)
+{
+	const size_t end = Unicode::nextCharacter(text, pos);
+	column += text[pos] == '\t' ? Unicode::tabWidth - column % Unicode::tabWidth : Unicode::characterWidth(text, pos, end);
+	return end;
+}
+
+/// <summary>
+/// The length of the ASCII text at the start of 'text'. Checks 16 bytes at a time with SSE2, or 8 at a time otherwise
+/// </summary>
+size_t Unicode::asciiLength(const std::string_view& text)
+{
+	const char* data = text.data();
+	const size_t length = text.length();
+	size_t pos = 0;
+#ifdef NVE_SSE2
+	for (; pos + 16 <= length; pos += 16)
+	{
+		const int highBits = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos))); //One bit per byte, set for bytes over 0x7F
+		if (highBits != 0) return pos + std::countr_zero(static_cast<unsigned int>(highBits));
+	}
+#endif
+	for (; pos + 8 <= length; pos += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, data + pos, sizeof(word));
+		const uint64_t highBits = word & 0x8080808080808080ull;
+		if (highBits != 0) return pos + (std::endian::native == std::endian::little ? std::countr_zero(highBits) : std::countl_zero(highBits)) / 8;
+	}
+	while (pos < length && static_cast<unsigned char>(data[pos]) < 0x80) ++pos;
+	return pos;
+}
+
+bool Unicode::isAscii(const std::string_view& text)
+{
+	return asciiLength(text) == text.length();
+}
+
+/// <summary>
+/// Decodes the UTF-8 code point at pos. Invalid sequences (cut short, overlong, surrogates) decode as U+FFFD, one byte long
+/// </summary>
+/// <param name="text"></param>
+/// <param name="pos"></param>
+/// <param name="length">Set to how many bytes the code point takes</param>
+/// <returns></returns>
+char32_t Unicode::decode(const std::string_view& text, const size_t pos, size_t& length)
+{
+	const unsigned char lead = static_cast<unsigned char>(text[pos]);
+	length = 1;
+	if (lead < 0x80) return lead;
+
+	size_t count;
+	char32_t codePoint, smallest;
+	if ((lead & 0xE0) == 0xC0) { count = 2; codePoint = lead & 0x1F; smallest = 0x80; }
+	else if ((lead & 0xF0) == 0xE0) { count = 3; codePoint = lead & 0x0F; smallest = 0x800; }
+	else if ((lead & 0xF8) == 0xF0) { count = 4; codePoint = lead & 0x07; smallest = 0x10000; }
+	else return replacementCharacter;
+	if (pos + count > text.length()) return replacementCharacter;
+
+	for (size_t i = 1; i < count; ++i)
+	{
+		const unsigned char next = static_cast<unsigned char>(text[pos + i]);
+		if ((next & 0xC0) != 0x80) return replacementCharacter;
+		codePoint = (codePoint << 6) | (next & 0x3F);
+	}
+	if (codePoint < smallest || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) return replacementCharacter;
+	length = count;
+	return codePoint;
+}
+
+/// <summary>
+/// How many columns a code point takes on its own: 0 for combining marks and format characters, 2 for wide characters, otherwise 1
+/// </summary>
+size_t Unicode::codePointWidth(const char32_t codePoint)
+{
+	if (codePoint < 0x300) return 1;
+	if (inTable(Tables::zeroWidth, codePoint)) return 0;
+	return inTable(Tables::wide, codePoint) ? 2 : 1;
+}
+
+/// <summary>
+/// Finds where the character starting at pos ends
+/// </summary>
+size_t Unicode::nextCharacter(const std::string_view& text, const size_t pos)
+{
+	if (pos >= text.length()) return text.length();
+	size_t length;
+	char32_t codePoint = decode(text, pos, length);
+	size_t end = pos + length;
+	if (codePoint < 0x80 && (end == text.length() || static_cast<unsigned char>(text[end]) < 0x80)) return end; //Nothing can be joined onto it
+
+	if (isRegionalIndicator(codePoint) && end < text.length() && isRegionalIndicator(decode(text, end, length))) //A flag
+	{
+		end += length;
+	}
+	while (end < text.length())
+	{
+		const char32_t next = decode(text, end, length);
+		if (!extendsCharacter(next) && codePoint != zeroWidthJoiner) break; //Anything after a zero width joiner is joined onto the character
+		codePoint = next;
+		end += length;
+	}
+	return end;
+}
+
+/// <summary>
+/// Finds where the character ending at pos starts
+/// </summary>
+size_t Unicode::previousCharacter(const std::string_view& text, const size_t pos)
+{
+	if (pos == 0) return 0;
+	size_t start = codePointStart(text, pos), length;
+	while (start > 0)
+	{
+		const size_t before = codePointStart(text, start);
+		if (!extendsCharacter(decode(text, start, length)) && decode(text, before, length) != zeroWidthJoiner) break;
+		start = before;
+	}
+
+	if (isRegionalIndicator(decode(text, start, length))) //Flags pair up regional indicators from the start of the run of them
+	{
+		size_t runStart = start;
+		while (runStart > 0)
+		{
+			const size_t before = codePointStart(text, runStart);
+			if (!isRegionalIndicator(decode(text, before, length))) break;
+			if (before > 0 && decode(text, codePointStart(text, before), length) == zeroWidthJoiner) break; //Joined onto the character before it, so it doesn't pair
+			runStart = before;
+		}
+		if (((start - runStart) / 4) % 2 == 1) start = codePointStart(text, start);
+	}
+	return start;
+}
+
+/// <summary>
+/// Finds where the character containing byte 'pos' starts. A position that is already at the start of a character is returned as it is
+/// </summary>
+size_t Unicode::characterStart(const std::string_view& text, const size_t pos)
+{
+	if (pos == 0 || pos >= text.length()) return pos;
+	size_t start = pos, length;
+	while (start > 0 && pos - start < 3 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) --start;
+	decode(text, start, length);
+	const size_t codePointEnd = start + length > pos ? start + length : pos + 1;
+	return previousCharacter(text, codePointEnd);
+}
+
+/// <summary>
+/// How many columns the character in [start, end) takes. Tabs depend on where they are, so they aren't measured here
+/// </summary>
+size_t Unicode::characterWidth(const std::string_view& text, const size_t start, const size_t end)
+{
+	size_t length;
+	const char32_t first = decode(text, start, length);
+	if (isRegionalIndicator(first)) return start + length < end ? 2 : 1;
+
+	const size_t width = codePointWidth(first);
+	if (width != 1) return width;
+	for (size_t pos = start + length; pos < end; pos += length)
+	{
+		if (decode(text, pos, length) == emojiPresentation) return 2;
+	}
+	return 1;
+}
+
+/// <summary>
+/// The column the character at byte 'pos' is drawn at. A position inside a character gives the column the character starts at
+/// </summary>
+size_t Unicode::column(const std::string_view& text, const size_t pos)
+{
+	const size_t limit = std::min(pos, text.length());
+	size_t col = 0;
+	for (size_t i = 0; i < limit;)
+	{
+		const size_t runEnd = plainRunEnd(text, i, limit);
+		while (i < runEnd) //ASCII is a column a byte, so only the tabs need looking at
+		{
+			const char* tab = static_cast<const char*>(std::memchr(text.data() + i, '\t', runEnd - i));
+			const size_t stop = tab != nullptr ? tab - text.data() : runEnd;
+			col += stop - i;
+			i = stop;
+			if (tab != nullptr)
+			{
+				col += tabWidth - col % tabWidth;
+				++i;
+			}
+		}
+		if (i >= limit) break;
+
+		size_t next = col;
+		const size_t end = step(text, i, next);
+		if (end > limit) break;
+		col = next;
+		i = end;
+	}
+	return col;
+}
+
+/// <summary>
+/// Finds the character drawn over 'targetColumn'
+/// </summary>
+/// <returns>Where the character starts, or the length of the text if it ends before the column</returns>
+size_t Unicode::indexAtColumn(const std::string_view& text, const size_t targetColumn)
+{
+	size_t col = 0;
+	for (size_t i = 0; i < text.length();)
+	{
+		const size_t runEnd = plainRunEnd(text, i, text.length());
+		while (i < runEnd)
+		{
+			const char* tab = static_cast<const char*>(std::memchr(text.data() + i, '\t', runEnd - i));
+			const size_t stop = tab != nullptr ? tab - text.data() : runEnd;
+			if (col + (stop - i) > targetColumn) return i + (targetColumn - col);
+			col += stop - i;
+			i = stop;
+			if (tab != nullptr)
+			{
+				col += tabWidth - col % tabWidth;
+				if (col > targetColumn) return i;
+				++i;
+			}
+		}
+		if (i >= text.length()) break;
+
+		size_t next = col;
+		const size_t end = step(text, i, next);
+		if (next > targetColumn) return i;
+		col = next;
+		i = end;
+	}
+	return text.length();
+}
+
+/// <summary>
+/// Copies text into 'rendered' with its tabs replaced by spaces up to the next tab stop
+/// </summary>
+void Unicode::expandTabs(const std::string_view& text, std::string& rendered)
+{
+	rendered.clear();
+	if (text.empty()) return; //An empty row's data() may be null, which memchr mustn't be given
+	if (std::memchr(text.data(), '\t', text.length()) == nullptr)
+	{
+		rendered.assign(text);
+		return;
+	}
+	rendered.reserve(text.length() + tabWidth);
+	size_t col = 0;
+	for (size_t i = 0; i < text.length();)
+	{
+		const size_t runEnd = plainRunEnd(text, i, text.length());
+		while (i < runEnd)
+		{
+			const char* tab = static_cast<const char*>(std::memchr(text.data() + i, '\t', runEnd - i));
+			const size_t stop = tab != nullptr ? tab - text.data() : runEnd;
+			rendered.append(text, i, stop - i);
+			col += stop - i;
+			i = stop;
+			if (tab != nullptr)
+			{
+				rendered.append(tabWidth - col % tabWidth, ' ');
+				col += tabWidth - col % tabWidth;
+				++i;
+			}
+		}
+		if (i >= text.length()) break;
+
+		const size_t start = i, startCol = col;
+		i = step(text, i, col);
+		if (text[start] == '\t')
+		{
+			rendered.append(col - startCol, ' ');
+			rendered.append(text, start + 1, i - start - 1); //Anything joined onto the tab
+		}
+		else
+		{
+			rendered.append(text, start, i - start);
+		}
+	}
+}
+
+/// <summary>
+/// Finds the part of a rendered row (which has no tabs left) drawn in the columns [firstColumn, firstColumn + columns)
+/// </summary>
+Unicode::Clip Unicode::clipColumns(const std::string_view& rendered, const size_t firstColumn, const size_t columns)
+{
+	Clip clip;
+	size_t col = 0, i = 0;
+	while (i < rendered.length() && col < firstColumn) //Find the first character inside the columns
+	{
+		const size_t runEnd = plainRunEnd(rendered, i, rendered.length());
+		const size_t skip = std::min(runEnd - i, firstColumn - col);
+		i += skip;
+		col += skip;
+		if (col >= firstColumn || i >= rendered.length()) break;
+
+		size_t next = col;
+		i = step(rendered, i, next);
+		if (next > firstColumn) clip.spacesBefore = std::min(next - firstColumn, columns); //A wide character cut by the left edge
+		col = next;
+	}
+	while (i < rendered.length() && col >= firstColumn) //Marks whose character was cut off
+	{
+		const size_t end = nextCharacter(rendered, i);
+		if (characterWidth(rendered, i, end) != 0) break;
+		i = end;
+	}
+
+	clip.start = i;
+	const size_t lastColumn = firstColumn + columns;
+	while (i < rendered.length() && col < lastColumn)
+	{
+		const size_t runEnd = plainRunEnd(rendered, i, rendered.length());
+		const size_t take = std::min(runEnd - i, lastColumn - col);
+		i += take;
+		col += take;
+		if (col >= lastColumn || i >= rendered.length()) break;
+
+		size_t next = col;
+		const size_t end = step(rendered, i, next);
+		if (next > lastColumn) //A wide character cut by the right edge
+		{
+			clip.spacesAfter = lastColumn - col;
+			break;
+		}
+		col = next;
+		i = end;
+	}
+	if (clip.spacesAfter == 0) //Marks joined onto the last character
+	{
+		while (i < rendered.length())
+		{
+			const size_t end = nextCharacter(rendered, i);
+			if (characterWidth(rendered, i, end) != 0) break;
+			i = end;
+		}
+	}
+	clip.end = std::max(i, clip.start);
+	return clip;
+}
+
+/// <summary>
+/// Splits a row into display lines of at most 'columns' columns, calling onLine with the column each line after the first starts at.
+/// Tabs are split like the spaces they are drawn as, while any other character that doesn't fit moves to the next line whole
+/// </summary>
+/// <returns>How many display lines the row takes</returns>
+template <typename OnLine>
+static size_t wrapRow(const std::string_view& text, const size_t columns, OnLine onLine)
+{
+	size_t lines = 1, lineStart = 0, col = 0;
+	if (columns == 0) return lines;
+	const auto breakAt = [&](const size_t start)
+	{
+		lineStart = start;
+		++lines;
+		onLine(start);
+	};
+	for (size_t i = 0; i < text.length();)
+	{
+		const size_t runEnd = plainRunEnd(text, i, text.length());
+		while (i < runEnd)
+		{
+			const char* tab = static_cast<const char*>(std::memchr(text.data() + i, '\t', runEnd - i));
+			const size_t stop = tab != nullptr ? tab - text.data() : runEnd;
+			col += stop - i;
+			i = stop;
+			if (tab != nullptr)
+			{
+				col += Unicode::tabWidth - col % Unicode::tabWidth;
+				++i;
+			}
+		}
+		while (col > lineStart + columns) breakAt(lineStart + columns); //ASCII breaks at every full line
+		if (i >= text.length()) break;
+
+		size_t next = col;
+		const bool tab = text[i] == '\t';
+		i = step(text, i, next);
+		if (!tab && next > col)
+		{
+			while (col >= lineStart + columns) breakAt(lineStart + columns);
+			if (next > lineStart + columns && col > lineStart) breakAt(col);
+		}
+		col = next;
+	}
+	while (col > lineStart + columns) breakAt(lineStart + columns);
+	return lines;
+}
+
+/// <summary>
+/// How many display lines a row takes when it is wrapped at 'columns'. Every row takes at least one, even when it is empty
+/// </summary>
+size_t Unicode::wrapCount(const std::string_view& text, const size_t columns)
+{
+	if (isAscii(text)) //Every line but the last is full
+	{
+		const size_t width = column(text, text.length());
+		return width > columns ? (width + columns - 1) / columns : 1;
+	}
+	return wrapRow(text, columns, [](const size_t) {});
+}
+
+/// <summary>
+/// Finds the column each display line of a row starts at when it is wrapped at 'columns'. The first line always starts at 0
+/// </summary>
+void Unicode::wrapStarts(const std::string_view& text, const size_t columns, std::vector<size_t>& starts)
+{
+	starts.assign(1, 0);
+	wrapRow(text, columns, [&](const size_t start) { starts.push_back(start); });
+}
@@ -0,0 +1,64 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/// <summary>
+/// Display widths of UTF-8 text. A character is a grapheme cluster: a code point together with the combining marks, variation selectors,
+/// emoji modifiers and zero width joined code points that follow it. It takes 0, 1 or 2 columns, and tabs advance to the next tab stop.
+/// Bytes that aren't valid UTF-8 are characters of their own, one column wide, as terminals draw them as a replacement character
+/// </summary>
+namespace Unicode
+{
+	inline constexpr size_t tabWidth = 8;
+
+	/// <summary>
+	/// Where a column range starts and ends in a row. A wide character cut in half by either edge is left out,
+	/// and the column of it that is inside the range is filled with a space
+	/// </summary>
+	struct Clip
+	{
+		size_t start = 0, end = 0; //Byte range of the characters inside the columns
+		size_t spacesBefore = 0, spacesAfter = 0;
+	};
+
+	size_t asciiLength(const std::string_view& text);
+	bool isAscii(const std::string_view& text);
+	char32_t decode(const std::string_view& text, const size_t pos, size_t& length);
+	size_t codePointWidth(const char32_t codePoint);
+	size_t nextCharacter(const std::string_view& text, const size_t pos);
+	size_t previousCharacter(const std::string_view& text, const size_t pos);
+	size_t characterStart(const std::string_view& text, const size_t pos);
+	size_t characterWidth(const std::string_view& text, const size_t start, const size_t end);
+	size_t column(const std::string_view& text, const size_t pos);
+	size_t indexAtColumn(const std::string_view& text, const size_t targetColumn);
+	void expandTabs(const std::string_view& text, std::string& rendered);
+	Clip clipColumns(const std::string_view& rendered, const size_t firstColumn, const size_t columns);
+	size_t wrapCount(const std::string_view& text, const size_t columns);
+	void wrapStarts(const std::string_view& text, const size_t columns, std::vector<size_t>& starts);
+}
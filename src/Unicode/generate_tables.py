@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Generates UnicodeTables.hpp from the Unicode data that ships with Python's unicodedata module.
+# Run it from this directory after a Python upgrade brings a newer Unicode version: python3 generate_tables.py
+import sys
+import unicodedata
+
+def ranges(predicate):
+	"""Merges the code points above ASCII matching predicate into [first, last] ranges"""
+	found = []
+	for cp in range(0x80, sys.maxunicode + 1):
+		if not predicate(cp):
+			continue
+		if found and found[-1][1] == cp - 1:
+			found[-1][1] = cp
+		else:
+			found.append([cp, cp])
+	return found
+
+def zeroWidth(cp):
+	if 0x1160 <= cp <= 0x11FF or 0xD7B0 <= cp <= 0xD7FF: #Hangul vowels and final consonants join the syllable before them
+		return True
+	if cp == 0x00AD: #The soft hyphen is drawn
+		return False
+	return unicodedata.category(chr(cp)) in ('Mn', 'Me', 'Cf')
+
+def wide(cp):
+	if 0x20000 <= cp <= 0x2FFFD or 0x30000 <= cp <= 0x3FFFD: #CJK ideographs, including the ones not assigned yet
+		return True
+	return unicodedata.category(chr(cp)) != 'Cn' and unicodedata.east_asian_width(chr(cp)) in ('W', 'F') and not zeroWidth(cp)
+
+def table(name, found):
+	rows = ['\tinline constexpr Range {}[] =\n\t{{'.format(name)]
+	for i in range(0, len(found), 6):
+		rows.append('\t\t' + ' '.join('{{ 0x{:X}, 0x{:X} }},'.format(first, last) for first, last in found[i:i + 6]))
+	rows.append('\t};')
+	return '\n'.join(rows)
+
+license = open('Unicode.hpp').read().split('*/')[0] + '*/'
+print(license, file=open('UnicodeTables.hpp', 'w'), end='')
+with open('UnicodeTables.hpp', 'a') as out:
+	out.write('''
+
+#pragma once
+
+//Generated by generate_tables.py from Unicode {} data. Don't edit by hand
+namespace Unicode::Tables
+{{
+	struct Range
+	{{
+		char32_t first, last;
+	}};
+
+	//Combining marks, format characters and the joining Hangul jamo, which take no column of their own
+{}
+
+	//East Asian wide and fullwidth characters (CJK, Hangul syllables, emoji presentation), which take two columns
+{}
+}}
+'''.format(unicodedata.unidata_version, table('zeroWidth', ranges(zeroWidth)), table('wide', ranges(wide))))
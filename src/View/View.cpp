@@ -0,0 +1,34 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "View.hpp"
+
+/// <summary>
+/// Construct a view of a buffer, starting at the top of the file
+/// </summary>
+/// <param name="buf"></param>
+View::View(std::shared_ptr<Buffer> buf) : buffer(std::move(buf)), fileCursorX(0), fileCursorY(0), renderedCursorX(0), renderedCursorY(0), savedRenderedCursorXPos(0),
+colNumberToDisplay(0), rowOffset(0), colOffset(0), wrapOffset(0), rows(0), cols(0), top(0), left(0), gutter(0), selectionType(Registers::SelectionType::Character), selectionAnchorX(0), selectionAnchorY(0),
+drawnRowOffset(0), drawnValid(false)
+{}
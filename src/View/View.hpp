@@ -0,0 +1,69 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "Buffer/Buffer.hpp"
+#include "Registers/Registers.hpp"
+#include "WrapIndex.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <optional>
+
+struct Cursor
+{
+	size_t fileCursorX, fileCursorY;
+	bool primary = false;
+};
+
+/// <summary>
+/// A window onto a buffer: the cursor, the scroll offsets and the part of the screen it is drawn in.
+/// Split views of the same file share one buffer
+/// </summary>
+struct View
+{
+	View(std::shared_ptr<Buffer> buffer);
+
+	std::shared_ptr<Buffer> buffer;
+	size_t fileCursorX, fileCursorY;
+	size_t renderedCursorX, renderedCursorY;
+	size_t savedRenderedCursorXPos; bool updateSavedPos = true;
+	size_t colNumberToDisplay;
+	size_t rowOffset, colOffset;
+	std::optional<WrapIndex> wrap; //Set while long rows are soft wrapped instead of scrolled sideways
+	size_t wrapOffset; //While wrapping, how many of the display lines of the row at rowOffset are scrolled past
+	size_t rows, cols; //The size of the text area, not counting the status row
+	size_t top, left; //Where the text area starts on the screen
+	size_t gutter; //How many columns before the text area show which rows changed since the file was saved
+
+	std::vector<Cursor> extraCursors; //Secondary cursors for multi-cursor editing. The primary cursor is fileCursorX/Y
+
+	Registers::SelectionType selectionType;
+	size_t selectionAnchorX, selectionAnchorY; //Where visual mode was started. The selection spans from here to the file cursor
+
+	std::vector<std::string> drawnRows; //What each row of the text area showed after the last frame, so only rows that change are written again
+	size_t drawnRowOffset; //The row offset drawnRows were drawn at, or the first display line while wrapping
+	bool drawnValid; //False if the screen under the view may not match drawnRows, like after a resize or a command typed in cooked mode
+};
@@ -0,0 +1,229 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "WrapIndex.hpp"
+#include "Unicode/Unicode.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+
+#include <algorithm>
+#include <bit>
+
+/// <summary>
+/// Measures every row again, for a new buffer or after the rows were replaced wholesale
+/// </summary>
+void WrapIndex::build(const std::vector<FileHandler::Row>& rows, const size_t columns)
+{
+	TRACE_SCOPE("WrapIndex::build");
+	Memory::Scope memoryScope(Memory::Subsystem::Rendered);
+	mColumns = columns;
+	mWidths.resize(rows.size());
+	mLines.resize(rows.size());
+	for (size_t row = 0; row < rows.size(); ++row)
+	{
+		measure(rows, row);
+	}
+	buildTree();
+}
+
+/// <summary>
+/// Updates the index after rows [first, oldEnd) were replaced by rows [first, newEnd). Only those rows are measured.
+/// If the row count stays the same the tree is updated in place, otherwise it is summed again from the kept line counts
+/// </summary>
+void WrapIndex::update(const std::vector<FileHandler::Row>& rows, const size_t first, const size_t oldEnd, const size_t newEnd)
+{
+	if (mLines.size() + newEnd != rows.size() + oldEnd || first > oldEnd || oldEnd > mLines.size()) //The index doesn't match the rows the edit was made to
+	{
+		build(rows, mColumns);
+		return;
+	}
+
+	Memory::Scope memoryScope(Memory::Subsystem::Rendered);
+	if (oldEnd == newEnd)
+	{
+		for (size_t row = first; row < newEnd; ++row)
+		{
+			const size_t oldLines = mLines[row];
+			measure(rows, row);
+			addLines(row, oldLines, mLines[row]);
+		}
+		return;
+	}
+
+	if (newEnd > oldEnd)
+	{
+		mWidths.insert(mWidths.begin() + oldEnd, newEnd - oldEnd, 0);
+		mLines.insert(mLines.begin() + oldEnd, newEnd - oldEnd, 0);
+	}
+	else
+	{
+		mWidths.erase(mWidths.begin() + newEnd, mWidths.begin() + oldEnd);
+		mLines.erase(mLines.begin() + newEnd, mLines.begin() + oldEnd);
+	}
+	for (size_t row = first; row < newEnd; ++row)
+	{
+		measure(rows, row);
+	}
+	buildTree();
+}
+
+/// <summary>
+/// Wraps the rows at a new width. ASCII rows get their line counts from the widths already measured
+/// </summary>
+void WrapIndex::resize(const std::vector<FileHandler::Row>& rows, const size_t columns)
+{
+	TRACE_SCOPE("WrapIndex::resize");
+	if (columns == mColumns) return;
+	if (rows.size() != mLines.size())
+	{
+		build(rows, columns);
+		return;
+	}
+	mColumns = columns;
+	for (size_t row = 0; row < rows.size(); ++row)
+	{
+		if (mWidths[row] & unicodeRow) measure(rows, row);
+		else mLines[row] = mWidths[row] > mColumns ? (mWidths[row] + mColumns - 1) / mColumns : 1;
+	}
+	buildTree();
+}
+
+/// <summary>
+/// Empties the index, so it is built again the next time it is updated
+/// </summary>
+void WrapIndex::clear()
+{
+	mWidths.clear();
+	mLines.clear();
+	mTree.clear();
+	mTotal = 0;
+}
+
+size_t WrapIndex::columns() const
+{
+	return mColumns;
+}
+
+size_t WrapIndex::rowCount() const
+{
+	return mLines.size();
+}
+
+/// <summary>
+/// The display lines of every row together
+/// </summary>
+size_t WrapIndex::lineCount() const
+{
+	return mTotal;
+}
+
+size_t WrapIndex::rowLines(const size_t row) const
+{
+	return row < mLines.size() ? mLines[row] : 1;
+}
+
+/// <summary>
+/// The display lines of the rows before 'row', which is the display line the row starts on
+/// </summary>
+size_t WrapIndex::linesBefore(const size_t row) const
+{
+	size_t lines = 0;
+	for (size_t i = std::min(row, mLines.size()); i > 0; i &= i - 1)
+	{
+		lines += mTree[i];
+	}
+	return lines;
+}
+
+/// <summary>
+/// Finds the row a display line is on, by walking down the tree
+/// </summary>
+/// <param name="line"></param>
+/// <param name="lineInRow">Set to which of the row's display lines it is</param>
+/// <returns>The row, or the last row if the line is past the end</returns>
+size_t WrapIndex::rowAtLine(const size_t line, size_t& lineInRow) const
+{
+	if (mLines.empty() || line >= mTotal)
+	{
+		lineInRow = mLines.empty() ? 0 : mLines.back() - 1;
+		return mLines.empty() ? 0 : mLines.size() - 1;
+	}
+	size_t row = 0, remaining = line;
+	for (size_t bit = std::bit_floor(mLines.size()); bit > 0; bit >>= 1)
+	{
+		if (row + bit <= mLines.size() && mTree[row + bit] <= remaining)
+		{
+			row += bit;
+			remaining -= mTree[row];
+		}
+	}
+	lineInRow = remaining;
+	return row;
+}
+
+/// <summary>
+/// Measures a row's width and display lines. Only rows with non-ASCII text are walked character by character
+/// </summary>
+void WrapIndex::measure(const std::vector<FileHandler::Row>& rows, const size_t row)
+{
+	const Line& line = rows[row].line;
+	if (line.isAscii())
+	{
+		mWidths[row] = Unicode::column(line, line.length());
+		mLines[row] = mWidths[row] > mColumns ? (mWidths[row] + mColumns - 1) / mColumns : 1;
+	}
+	else
+	{
+		mWidths[row] = unicodeRow;
+		mLines[row] = Unicode::wrapCount(line, mColumns);
+	}
+}
+
+/// <summary>
+/// Sums the line counts into the tree in O(n), by adding each node into its parent
+/// </summary>
+void WrapIndex::buildTree()
+{
+	mTree.assign(mLines.size() + 1, 0);
+	mTotal = 0;
+	for (size_t i = 1; i < mTree.size(); ++i)
+	{
+		mTree[i] += mLines[i - 1];
+		mTotal += mLines[i - 1];
+		const size_t parent = i + (i & (~i + 1));
+		if (parent < mTree.size()) mTree[parent] += mTree[i];
+	}
+}
+
+/// <summary>
+/// Changes the line count of one row in O(log n)
+/// </summary>
+void WrapIndex::addLines(const size_t row, const size_t oldLines, const size_t newLines)
+{
+	for (size_t i = row + 1; i < mTree.size(); i += i & (~i + 1))
+	{
+		mTree[i] = mTree[i] - oldLines + newLines;
+	}
+	mTotal = mTotal - oldLines + newLines;
+}
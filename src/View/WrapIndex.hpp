@@ -0,0 +1,64 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include "File/File.hpp"
+
+#include <vector>
+#include <cstddef>
+
+/// <summary>
+/// How many display lines each row of a buffer takes when it is soft wrapped at a width, summed in a Fenwick tree
+/// so a display line can be turned into a row (and back) in O(log n).
+/// Each row's width is kept too, so a resize only has to measure again the rows with non-ASCII text
+/// </summary>
+class WrapIndex
+{
+public:
+	void build(const std::vector<FileHandler::Row>& rows, const size_t columns);
+	void update(const std::vector<FileHandler::Row>& rows, const size_t first, const size_t oldEnd, const size_t newEnd);
+	void resize(const std::vector<FileHandler::Row>& rows, const size_t columns);
+	void clear();
+
+	size_t columns() const;
+	size_t rowCount() const;
+	size_t lineCount() const;
+	size_t rowLines(const size_t row) const;
+	size_t linesBefore(const size_t row) const;
+	size_t rowAtLine(const size_t line, size_t& lineInRow) const;
+
+private:
+	void measure(const std::vector<FileHandler::Row>& rows, const size_t row);
+	void buildTree();
+	void addLines(const size_t row, const size_t oldLines, const size_t newLines);
+
+private:
+	static constexpr size_t unicodeRow = size_t(1) << (sizeof(size_t) * 8 - 1); //Set in mWidths for rows with non-ASCII text, whose lines depend on more than their width
+
+	size_t mColumns = 0;
+	std::vector<size_t> mWidths; //The columns each row takes, unwrapped
+	std::vector<size_t> mLines; //The display lines each row takes
+	std::vector<size_t> mTree; //Fenwick tree over mLines. mTree[i] holds the sum of the rows (i - lowbit(i), i]
+	size_t mTotal = 0;
+};
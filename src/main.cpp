@@ -24,71 +24,154 @@ SOFTWARE.
 
 #include "Input/Input.hpp"
 #include "Console/Console.hpp"
+#include "Profiler/Profiler.hpp"
+#include "Trace/Trace.hpp"
+#include "Memory/Memory.hpp"
+#include "Pager/Pager.hpp"
 
 #include <iostream>
-#include <thread>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string_view>
+#include <chrono>
+#include <cstdlib>
 
-static std::atomic<bool> runThread = true; //Main thread will update this bool, while secondary thread reads from it
+/// <summary>
+/// Sends a key to the handler for the current mode, timing it if the :perf overlay is on.
+/// The timing ends when the next frame is written. What an edit leaves allocated is charged to the text,
+/// unless the code doing it (undo, registers, ...) charges its own subsystem
+/// </summary>
+void handleKey(const KeyActions::KeyAction inputCode)
+{
+	Profiler::beginSample();
+	Profiler::ScopedStage editStage(Profiler::Stage::Edit);
+	Memory::Scope memoryScope(Memory::Subsystem::Text);
+	InputHandler::dispatch(inputCode);
+	Console::journalEdits();
+}
 
-void updateScreen() //Makes sure the screen stays up to date with the size
+/// <summary>
+/// Runs the recorded keys through the editor without a terminal, timing each keystroke,
+/// then prints the latency percentiles of each stage
+/// </summary>
+int runHeadless(const bool memoryReport)
 {
-	while (runThread)
+	Profiler::enable();
+	while (Console::mode() != Mode::ExitMode && !Console::terminal().atEnd())
 	{
-		if (Console::setWindowSize()) //Only update if the terminal screen actually got updated
-		{
-			Console::refreshScreen();
-		}
+		if (Console::syncFiles()) Console::prepRenderedString();
+		const KeyActions::KeyAction inputCode = InputHandler::getInput();
+		if (inputCode == KeyActions::KeyAction::None) continue;
+
+		handleKey(inputCode);
+		Console::prepRenderedString();
+		if (Console::mode() != Mode::ExitMode) Console::refreshScreen(); //Writing the frame ends the sample
+		Profiler::endSample();
 	}
+	std::cout << Profiler::report();
+	if (memoryReport) std::cout << Memory::report();
+	Console::closeConsole();
+	return EXIT_SUCCESS;
 }
 
 int main(int argc, const char** argv)
 {
-#ifndef NDEBUG
-	argc = 2;
-	argv[1] = "test.cpp";
-#endif
-	if (argc != 2)
+	std::vector<std::string_view> fileNames;
+	std::string_view replayFileName, recordFileName, traceFileName;
+	bool headless = false, memoryReport = false, pager = false, follow = false;
+	size_t maxFps = 0; //0 draws a frame whenever the input has been handled
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--headless") headless = true;
+		else if (arg == "--replay" && i + 1 < argc) replayFileName = argv[++i];
+		else if (arg == "--record" && i + 1 < argc) recordFileName = argv[++i];
+		else if (arg == "--trace" && i + 1 < argc) traceFileName = argv[++i];
+		else if (arg == "--mem-report") memoryReport = true;
+		else if (arg == "-R") pager = true;
+		else if (arg == "-f") follow = true;
+		else if (arg == "--max-fps" && i + 1 < argc) maxFps = std::strtoul(argv[++i], nullptr, 10);
+		else fileNames.push_back(arg);
+	}
+	if (fileNames.empty() || (headless && replayFileName.empty()))
 	{
-		std::cerr << "ERROR: Usage: nve <filename>\n";
+		std::cerr << "ERROR: Usage: nve [-f] [--record keys.log] [--trace trace.json] [--mem-report] [--max-fps N] <filename> [filenames...]\n";
+		std::cerr << "       nve -R [--record keys.log] <filename>\n";
+		std::cerr << "       nve --headless --replay keys.log [--trace trace.json] [--mem-report] [-R] <filename> [filenames...]\n";
 		return EXIT_FAILURE;
 	}
+	if (!traceFileName.empty())
+	{
+#ifndef NVE_TRACING
+		std::cerr << "WARNING: nve was built without NVE_TRACING, so the trace will be empty\n";
+#endif
+		Trace::start(traceFileName); //Written when the editor exits
+	}
 
-	Console::initConsole(argv[1]);
+	pager = pager || (fileNames.size() == 1 && Pager::isTooBig(fileNames.front())); //Only the first file is paged with -R
+
+	if (headless)
+	{
+		std::ifstream replayFile{ std::string(replayFileName), std::ios::binary };
+		if (!replayFile)
+		{
+			std::cerr << "ERROR: Could not open " << replayFileName << "\n";
+			return EXIT_FAILURE;
+		}
+		std::stringstream keys;
+		keys << replayFile.rdbuf();
+		if (pager) return Pager::run(fileNames.front(), std::make_unique<HeadlessTerminal>(keys.str()));
+		Console::initConsole(fileNames, std::make_unique<HeadlessTerminal>(keys.str()));
+		if (follow) Console::toggleFollow();
+		return runHeadless(memoryReport);
+	}
 
-	std::thread t(updateScreen);
-	t.detach();
+	if (pager) return Pager::run(fileNames.front(), std::make_unique<ConsoleTerminal>(recordFileName));
+	Console::initConsole(fileNames, std::make_unique<ConsoleTerminal>(recordFileName));
+	if (follow) Console::toggleFollow(); //The first file is the one shown
 
-	while (true)
+	//Keys that are already waiting (key repeat, a paste, a slow link catching up) are all handled before the next frame is drawn,
+	//so how fast keys go through doesn't depend on how long a frame takes to draw
+	Terminal& terminal = Console::terminal();
+	const std::chrono::milliseconds minFrameInterval(maxFps > 0 ? 1000 / maxFps : 0);
+	constexpr std::chrono::milliseconds maxFrameDelay(100); //Input that keeps arriving still gets a frame at least this often
+	constexpr std::chrono::milliseconds followInterval(50); //How often followed files are checked for new rows while no key arrives
+	constexpr std::chrono::milliseconds fileCheckInterval(250); //How often the files are checked for changes by other programs while no key arrives
+	std::chrono::steady_clock::time_point lastFrame;
+	while (Console::mode() != Mode::ExitMode)
 	{
-		while (Console::mode() == Mode::CommandMode || Console::mode() == Mode::ReadMode)
+		const auto sinceFrame = std::chrono::steady_clock::now() - lastFrame;
+		const auto untilFrameAllowed = std::chrono::duration_cast<std::chrono::milliseconds>(minFrameInterval - sinceFrame);
+		if (sinceFrame >= maxFrameDelay || !terminal.waitForInput(std::max(untilFrameAllowed, std::chrono::milliseconds(0))))
 		{
 			Console::refreshScreen();
-			const KeyActions::KeyAction inputCode = InputHandler::getInput();
-			if (inputCode != KeyActions::KeyAction::None)
-			{
-				InputHandler::doCommand(inputCode);
-				Console::prepRenderedString();
-			}
+			lastFrame = std::chrono::steady_clock::now();
 		}
-		while (Console::mode() == Mode::EditMode)
+
+		//Changes to the files (lines appended to a followed file, another program saving one) and to the window's size are drawn while waiting for a key,
+		//rather than only after the next one. A resize interrupts the wait (SIGWINCH), except on Windows where it is noticed when the wait times out
+		while (!terminal.waitForInput(Console::isFollowing() ? followInterval : fileCheckInterval))
 		{
+			const bool resized = Console::setWindowSize();
+			if (!Console::syncFiles() && !resized) continue;
 			Console::prepRenderedString();
 			Console::refreshScreen();
-			const KeyActions::KeyAction inputCode = InputHandler::getInput();
-			if (inputCode != KeyActions::KeyAction::None)
-			{
-				InputHandler::handleInput(inputCode);
-			}
+			lastFrame = std::chrono::steady_clock::now();
 		}
-		if (Console::mode() == Mode::ExitMode)
+		const bool resized = Console::setWindowSize(); //Keys kept arriving, so the wait above was skipped
+		if (Console::syncFiles() || resized) Console::prepRenderedString();
+
+		const KeyActions::KeyAction inputCode = InputHandler::getInput();
+		if (inputCode != KeyActions::KeyAction::None)
 		{
-			Console::disableRawInput();
-			break;
+			handleKey(inputCode);
+			Console::prepRenderedString(); //The view follows the cursor after every key, not only the keys that get drawn
 		}
 	}
+	Console::disableRawInput();
+	if (memoryReport) std::cout << "\n" << Memory::report(); //Printed while the buffers are still open, so it shows what they held
+	Console::closeConsole();
 
-	runThread = false;
-	if(t.joinable()) t.join();
-	
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Diff/Diff.hpp"
+#include "Diff/LineChanges.hpp"
+#include "File/File.hpp"
+
+#include <iostream>
+#include <format>
+#include <random>
+#include <algorithm>
+#include <initializer_list>
+
+//Checks of the line diff that the gutter and reloading a changed file are built on. Lines are written as one letter each
+static int failures = 0;
+
+static void check(const bool passed, const std::string_view& what)
+{
+	if (passed) return;
+	std::cerr << "FAILED: " << what << "\n";
+	++failures;
+}
+
+static std::vector<uint64_t> hashes(const std::string_view& lines)
+{
+	std::vector<uint64_t> hashed;
+	for (const char line : lines) hashed.push_back(Diff::hashLine(std::string_view(&line, 1)));
+	return hashed;
+}
+
+static std::string describe(const std::vector<Diff::Hunk>& hunks)
+{
+	std::string text;
+	for (const Diff::Hunk& hunk : hunks) text += std::format("{{{},{},{},{}}}", hunk.oldStart, hunk.oldCount, hunk.newStart, hunk.newCount);
+	return text;
+}
+
+/// <summary>
+/// Checks the hunks that turn one version into another, given as {oldStart, oldCount, newStart, newCount}
+/// </summary>
+static void checkCompare(const std::string_view& oldLines, const std::string_view& newLines, const std::initializer_list<Diff::Hunk> expected, const size_t maxEdits = Diff::defaultMaxEdits)
+{
+	const std::vector<Diff::Hunk> hunks = Diff::compare(hashes(oldLines), hashes(newLines), maxEdits);
+	const std::string wanted = describe(std::vector<Diff::Hunk>(expected));
+	check(describe(hunks) == wanted, std::format("compare(\"{}\", \"{}\") gave {} instead of {}", oldLines, newLines, describe(hunks), wanted));
+}
+
+/// <summary>
+/// The fewest lines added and deleted that turn one version into the other: everything outside their longest common subsequence
+/// </summary>
+static size_t fewestEdits(const std::string_view& oldLines, const std::string_view& newLines)
+{
+	std::vector<std::vector<size_t>> common(oldLines.size() + 1, std::vector<size_t>(newLines.size() + 1, 0));
+	for (size_t x = oldLines.size(); x-- > 0;)
+	{
+		for (size_t y = newLines.size(); y-- > 0;)
+		{
+			common[x][y] = oldLines[x] == newLines[y] ? common[x + 1][y + 1] + 1 : std::max(common[x + 1][y], common[x][y + 1]);
+		}
+	}
+	return oldLines.size() + newLines.size() - 2 * common[0][0];
+}
+
+/// <summary>
+/// Diffs random versions over a small alphabet, so lines repeat, and checks the hunks are in order, apart, turn the old version
+/// into the new one, and add and delete the fewest lines
+/// </summary>
+static void checkRandomCompares()
+{
+	std::mt19937 random(1);
+	for (int n = 0; n < 2000; ++n)
+	{
+		std::string oldLines(random() % 12, 'a'), newLines(random() % 12, 'a');
+		for (char& line : oldLines) line = static_cast<char>('a' + random() % 3);
+		for (char& line : newLines) line = static_cast<char>('a' + random() % 3);
+		const std::vector<Diff::Hunk> hunks = Diff::compare(hashes(oldLines), hashes(newLines));
+
+		std::string applied;
+		size_t oldLine = 0, edits = 0;
+		bool apart = true;
+		for (const Diff::Hunk& hunk : hunks)
+		{
+			const bool first = &hunk == &hunks.front();
+			apart = apart && (hunk.oldCount > 0 || hunk.newCount > 0) && (first ? hunk.oldStart >= oldLine : hunk.oldStart > oldLine);
+			applied += oldLines.substr(oldLine, hunk.oldStart - oldLine);
+			check(applied.size() == hunk.newStart, std::format("compare(\"{}\", \"{}\") gave {}: a hunk's new start is off", oldLines, newLines, describe(hunks)));
+			applied += newLines.substr(hunk.newStart, hunk.newCount);
+			oldLine = hunk.oldStart + hunk.oldCount;
+			edits += hunk.oldCount + hunk.newCount;
+		}
+		applied += oldLines.substr(std::min(oldLine, oldLines.size()));
+		check(apart, std::format("compare(\"{}\", \"{}\") gave {}: hunks overlap, touch or are empty", oldLines, newLines, describe(hunks)));
+		check(applied == newLines, std::format("compare(\"{}\", \"{}\") gave {}, which makes \"{}\"", oldLines, newLines, describe(hunks), applied));
+		check(edits == fewestEdits(oldLines, newLines), std::format("compare(\"{}\", \"{}\") gave {}, which isn't the fewest edits", oldLines, newLines, describe(hunks)));
+	}
+}
+
+/// <summary>
+/// Checks the gutter sign of every row, written as one character each: ' ' none, '+' added, '~' modified, '_' deleted below, '^' deleted above
+/// </summary>
+static void checkSigns(const LineChanges& changes, const std::vector<FileHandler::Row>& rows, const std::string_view& expected, const std::string_view& after)
+{
+	static constexpr std::string_view signs = " +~_^";
+	std::string actual;
+	for (size_t row = 0; row < rows.size(); ++row) actual.push_back(signs[static_cast<size_t>(changes.sign(row))]);
+	check(actual == expected, std::format("after {} the signs were \"{}\" instead of \"{}\"", after, actual, expected));
+}
+
+/// <summary>
+/// Edits rows one change at a time, the way the editor reports them, and checks the signs stay right as hunks grow, merge and go away
+/// </summary>
+static void checkLineChanges()
+{
+	const std::string text = "a\nb\nc\nd\ne\nf\ng";
+	std::vector<FileHandler::Row> rows = FileHandler::loadRows(text);
+	LineChanges changes;
+	changes.reset(text);
+	checkSigns(changes, rows, "       ", "loading");
+
+	rows[1].line = "B";
+	changes.update(rows, 1, 2, 2);
+	checkSigns(changes, rows, " ~     ", "changing b");
+
+	rows[2].line = "C"; //Next to the hunk of b, so it joins it
+	changes.update(rows, 2, 3, 3);
+	checkSigns(changes, rows, " ~~    ", "changing c");
+
+	rows.insert(rows.begin() + 5, FileHandler::Row{ Line("x") });
+	changes.update(rows, 5, 5, 6);
+	checkSigns(changes, rows, " ~~  +  ", "adding x after e");
+
+	rows[1].line = "b";
+	changes.update(rows, 1, 2, 2);
+	checkSigns(changes, rows, "  ~  +  ", "changing b back");
+
+	rows[2].line = "c";
+	changes.update(rows, 2, 3, 3);
+	checkSigns(changes, rows, "     +  ", "changing c back");
+
+	rows.erase(rows.begin() + 3); //d, so c gets the sign
+	changes.update(rows, 3, 4, 3);
+	checkSigns(changes, rows, "  _ +  ", "deleting d");
+
+	rows.erase(rows.begin() + 3); //e, between the deletion of d and the addition of x, so the three become one hunk
+	changes.update(rows, 3, 4, 3);
+	checkSigns(changes, rows, "   ~  ", "deleting e");
+
+	rows.erase(rows.begin());
+	changes.update(rows, 0, 1, 0);
+	checkSigns(changes, rows, "^ ~  ", "deleting a");
+
+	rows.insert(rows.begin() + 2, FileHandler::Row{ Line("d") });
+	rows.insert(rows.begin() + 3, FileHandler::Row{ Line("e") });
+	rows.erase(rows.begin() + 4);
+	rows.insert(rows.begin(), FileHandler::Row{ Line("a") });
+	changes.update(rows, 0, 5, 7);
+	checkSigns(changes, rows, "       ", "undoing everything at once");
+}
+
+int main()
+{
+	checkCompare("abc", "abc", {});
+	checkCompare("abc", "axc", { { 1, 1, 1, 1 } });
+	checkCompare("ac", "abc", { { 1, 0, 1, 1 } });
+	checkCompare("abc", "ac", { { 1, 1, 1, 0 } });
+	checkCompare("", "ab", { { 0, 0, 0, 2 } });
+	checkCompare("ab", "", { { 0, 2, 0, 0 } });
+	checkCompare("abcd", "axyd", { { 1, 2, 1, 2 } });
+	checkCompare("abcde", "aXcdY", { { 1, 1, 1, 1 }, { 4, 1, 4, 1 } });
+	checkCompare("abcdef", "acdxef", { { 1, 1, 1, 0 }, { 4, 0, 3, 1 } });
+	checkCompare("abcdefg", "aXcdeYg", { { 1, 5, 1, 5 } }, 1); //Past maxEdits everything between the first and last difference is one hunk
+	checkRandomCompares();
+	checkLineChanges();
+
+	if (failures > 0) return EXIT_FAILURE;
+	std::cout << "All diff checks passed\n";
+	return EXIT_SUCCESS;
+}
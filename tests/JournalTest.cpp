@@ -0,0 +1,176 @@
+/**
+* MIT License
+
+Copyright (c) 2024 Nathan Davis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Journal/Journal.hpp"
+#include "File/File.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <format>
+#include <initializer_list>
+#include <cstdlib>
+
+//Checks of recovering swap files through the editor. The swap files are written here byte by byte, as an editor that crashed would
+//have left them, and the editor is run on them with --headless
+static int failures = 0;
+static std::string editor;
+
+static void check(const bool passed, const std::string_view& what)
+{
+	if (passed) return;
+	std::cerr << "FAILED: " << what << "\n";
+	++failures;
+}
+
+template<typename T>
+static void put(std::string& out, const T value)
+{
+	out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// <summary>
+/// The header of a swap file started from the file as it is on disk. 'sizeChange' makes it one for a different version of the file
+/// </summary>
+static std::string header(const std::string_view& fileName, const int64_t sizeChange = 0)
+{
+	const FileHandler::FileStamp stamp = FileHandler::fileStamp(fileName);
+	std::string bytes("NVESWAP1");
+	put<uint64_t>(bytes, stamp.size + sizeChange);
+	put<int64_t>(bytes, static_cast<int64_t>(stamp.modified.time_since_epoch().count()));
+	return bytes;
+}
+
+/// <summary>
+/// An edit that replaced rows [first, first + removed) with 'rows'
+/// </summary>
+static std::string edit(const uint64_t first, const uint64_t removed, const std::initializer_list<std::string_view> rows)
+{
+	std::string bytes;
+	put<uint32_t>(bytes, 0x54494445);
+	put<uint64_t>(bytes, first);
+	put<uint64_t>(bytes, removed);
+	put<uint64_t>(bytes, rows.size());
+	for (const std::string_view& row : rows)
+	{
+		put<uint64_t>(bytes, row.length());
+		bytes.append(row);
+	}
+	uint32_t hash = 2166136261u;
+	for (const char c : bytes) hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+	put(bytes, hash);
+	return bytes;
+}
+
+static void write(const std::string_view& fileName, const std::string_view& contents)
+{
+	std::ofstream(std::string(fileName), std::ios::binary) << contents;
+}
+
+static std::string read(const std::string_view& fileName)
+{
+	std::ifstream file{ std::string(fileName), std::ios::binary };
+	std::stringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+/// <summary>
+/// Types keys into the editor editing test.txt, in the current directory
+/// </summary>
+static void run(const std::string_view& keys)
+{
+	write("keys.txt", keys);
+	if (std::system(std::format("\"{}\" --headless --replay keys.txt test.txt", editor).c_str()) != 0) check(false, std::format("the editor failed on keys {}", keys));
+}
+
+static const std::string original = "one\ntwo\nthree\nfour";
+
+/// <summary>
+/// Several whole edits followed by one the crash cut short. The whole ones are replayed, the torn one is dropped, and the swap file
+/// is removed once the editor exits cleanly
+/// </summary>
+static void checkRecover()
+{
+	write("test.txt", original);
+	std::string swap = header("test.txt");
+	swap += edit(1, 1, { "TWO" });
+	swap += edit(4, 0, { "five", "six" });
+	swap += edit(0, 1, {});
+	const std::string torn = edit(0, 1, { "lost" });
+	swap += torn.substr(0, torn.length() - 3);
+	write(Journal::path("test.txt"), swap);
+
+	run(":recover\r:w\r:q\r");
+	check(read("test.txt") == "TWO\nthree\nfour\nfive\nsix", std::format(":recover gave \"{}\"", read("test.txt")));
+	check(!Journal::exists("test.txt"), "the swap file was left after :recover and a clean exit");
+}
+
+/// <summary>
+/// A swap file made for another version of the file isn't replayed, and is left alone so it can still be looked at
+/// </summary>
+static void checkHeaderMismatch()
+{
+	write("test.txt", original);
+	const std::string swap = header("test.txt", 1) + edit(0, 1, { "ONE" });
+	write(Journal::path("test.txt"), swap);
+
+	run(":recover\riZ\x1b:w\r:q\r");
+	check(read("test.txt") == "Zone\ntwo\nthree\nfour", std::format(":recover of a swap file for another version gave \"{}\"", read("test.txt")));
+	check(read(Journal::path("test.txt")) == swap, "a swap file that couldn't be recovered was changed");
+}
+
+/// <summary>
+/// :dropswap deletes the swap file without replaying it, and the edits after it are journaled into a new one
+/// </summary>
+static void checkDropSwap()
+{
+	write("test.txt", original);
+	write(Journal::path("test.txt"), header("test.txt") + edit(0, 1, { "ONE" }));
+
+	run(":dropswap\riZ\x1b:w\r:q\r");
+	check(read("test.txt") == "Zone\ntwo\nthree\nfour", std::format(":dropswap gave \"{}\"", read("test.txt")));
+	check(!Journal::exists("test.txt"), "the swap file was left after :dropswap and a clean exit");
+}
+
+int main(int argc, const char** argv)
+{
+	if (argc != 3)
+	{
+		std::cerr << "Usage: nve_journal_test <nve> <work directory>\n";
+		return EXIT_FAILURE;
+	}
+	editor = std::filesystem::absolute(argv[1]).string();
+	std::filesystem::create_directories(argv[2]);
+	std::filesystem::current_path(argv[2]);
+
+	checkRecover();
+	checkHeaderMismatch();
+	checkDropSwap();
+
+	if (failures > 0) return EXIT_FAILURE;
+	std::cout << "All swap file checks passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+#Runs one replay test: types keys.txt into a copy of input.txt with nve --headless, then compares the saved file with expected.txt
+#cmake -DNVE=<path to nve> -DTEST_DIR=<test directory> -DWORK_DIR=<scratch directory> -P ReplayTest.cmake
+file(MAKE_DIRECTORY "${WORK_DIR}")
+configure_file("${TEST_DIR}/input.txt" "${WORK_DIR}/test.txt" COPYONLY)
+execute_process(COMMAND "${NVE}" --headless --replay "${TEST_DIR}/keys.txt" test.txt WORKING_DIRECTORY "${WORK_DIR}" RESULT_VARIABLE result OUTPUT_QUIET)
+if (NOT result EQUAL 0)
+	message(FATAL_ERROR "nve exited with ${result}")
+endif()
+
+file(READ "${WORK_DIR}/test.txt" actual)
+file(READ "${TEST_DIR}/expected.txt" expected)
+if (NOT actual STREQUAL expected)
+	message(FATAL_ERROR "The file holds:\n${actual}\nbut should hold:\n${expected}")
+endif()